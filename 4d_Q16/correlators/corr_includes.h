@@ -7,6 +7,7 @@
 #include <string.h>             // For print_var.c, setup.c, gauge_info.c
 #include "../include/complex.h"
 #include "../include/susy.h"
+#include "../include/inline_susy.h"
 #include "../include/macros.h"
 #include "lattice.h"
 #include "../include/comdefs.h"
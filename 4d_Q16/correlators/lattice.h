@@ -81,6 +81,11 @@ EXTERN site *lattice;
 #define N_POINTERS 3
 EXTERN char **gen_pt[N_POINTERS];
 
+// Sites whose neighbors are all on this node (INTERIOR), and the rest,
+// listed by make_lattice() for FORPARTSITES_OMP
+EXTERN int n_part_sites[2];
+EXTERN int *part_sites[2];
+
 // Scalar fields and their bilinear traces
 // Just need one set of N_B / N_K for current measurement
 #define N_B 1
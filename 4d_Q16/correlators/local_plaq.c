@@ -13,7 +13,6 @@ double local_plaquette(double *ss_plaq, double *st_plaq) {
   double min_plaq = 200.0 * NCOL;
 #endif
   msg_tag *mtag0, *mtag1;
-  matrix tmat;
 
   // We can exploit a symmetry under dir<-->dir2
   for (dir = YUP; dir < NUMLINK; dir++) {
@@ -30,8 +29,9 @@ double local_plaquette(double *ss_plaq, double *st_plaq) {
 
       if (dir == TUP || dir2 == TUP) {
         FORALLSITES(i, s) {
-          mult_nn(&(tempmat[i]), (matrix *)(gen_pt[0][i]), &tmat);
-          cur_plaq = (double)realtrace((matrix *)(gen_pt[1][i]), &tmat);
+          cur_plaq = (double)realtrace_mult_nn((matrix *)(gen_pt[1][i]),
+                                               &(tempmat[i]),
+                                               (matrix *)(gen_pt[0][i]));
           if (cur_plaq > max_plaq)
             max_plaq = cur_plaq;
 #ifdef MIN_PLAQ
@@ -43,8 +43,9 @@ double local_plaquette(double *ss_plaq, double *st_plaq) {
       }
       else {
         FORALLSITES(i, s) {
-          mult_nn(&(tempmat[i]), (matrix *)(gen_pt[0][i]), &tmat);
-          cur_plaq = (double)realtrace((matrix *)(gen_pt[1][i]), &tmat);
+          cur_plaq = (double)realtrace_mult_nn((matrix *)(gen_pt[1][i]),
+                                               &(tempmat[i]),
+                                               (matrix *)(gen_pt[0][i]));
           if (cur_plaq > max_plaq)
             max_plaq = cur_plaq;
 #ifdef MIN_PLAQ
@@ -8,7 +8,6 @@ void plaquette(double *ss_plaq, double *st_plaq) {
   register site *s;
   double ss_sum = 0.0, st_sum = 0.0;
   msg_tag *mtag0, *mtag1;
-  matrix tmat;
 
   // We can exploit a symmetry under dir<-->dir2
   for (dir = YUP; dir < NUMLINK; dir++) {
@@ -28,14 +27,16 @@ void plaquette(double *ss_plaq, double *st_plaq) {
       // Compute tr[Udag_a(x+b) Udag_b(x) U_a(x) U_b(x+a)]
       if (dir == TUP || dir2 == TUP) {
         FORALLSITES(i, s) {
-          mult_nn(&(tempmat[i]), (matrix *)(gen_pt[0][i]), &tmat);
-          st_sum += (double)realtrace((matrix *)(gen_pt[1][i]), &tmat);
+          st_sum += (double)realtrace_mult_nn((matrix *)(gen_pt[1][i]),
+                                              &(tempmat[i]),
+                                              (matrix *)(gen_pt[0][i]));
         }
       }
       else {
         FORALLSITES(i, s) {
-          mult_nn(&(tempmat[i]), (matrix *)(gen_pt[0][i]), &tmat);
-          ss_sum += (double)realtrace((matrix *)(gen_pt[1][i]), &tmat);
+          ss_sum += (double)realtrace_mult_nn((matrix *)(gen_pt[1][i]),
+                                              &(tempmat[i]),
+                                              (matrix *)(gen_pt[0][i]));
         }
       }
       cleanup_gather(mtag0);
@@ -12,11 +12,18 @@
 // g_vecfloatsum()        Sum a vector of Reals over all nodes
 // g_doublesum()          Sum a double over all nodes
 // g_vecdoublesum()       Sum a vector of doubles over all nodes
+// g_vecdoublesum_start() Start a non-blocking sum of a vector of doubles
+// g_sum_wait()           Wait for a non-blocking sum to finish
 // g_complexsum()         Sum a generic precision complex number over all nodes
 // g_veccomplexsum()      Sum a vector of generic precision complex numbers
 //                          over all nodes
 // g_dcomplexsum()        Sum a double precision complex number over all nodes
 // g_vecdcomplexsum()     Sum a vector of double_complex over all nodes
+// g_floatsum_add()       Queue a Real to be summed over all nodes
+// g_doublesum_add()      Queue a double to be summed over all nodes
+// g_complexsum_add()     Queue a generic precision complex number
+// g_dcomplexsum_add()    Queue a double precision complex number
+// g_sum_start()          Start a non-blocking sum of everything queued
 // g_xor32()              Find global exclusive or of 32-bit word
 // g_floatmax()           Find maximum Real over all nodes
 // g_doublemax()          Find maximum double over all nodes
@@ -50,8 +57,12 @@
 // wait_gather()          Wait for receives to finish,
 //                          ensuring that the data have actually arrived,
 //                          and set pointers to received data
-// cleanup_gather()       Free all the buffers that were allocated
+// cleanup_gather()       Free all the buffers that were allocated,
+//                          or return a persistent gather plan to the pool
 //                          NB: The gathered data may soon disappear
+// rebind_gather()        Point a declared gather at another field
+//                          with the same layout, to do it again
+// release_gather()       Finish a gather to be done again, keeping its tag
 // accumulate_gather()    Combine gathers into single message tag
 // declare_accumulate_gather_site()
 //                        Do declare_gather_site() and accumulate_gather()
@@ -59,8 +70,10 @@
 // declare_accumulate_gather_field()
 //                        Do declare_gather_field() and accumulate_gather()
 //                          in single step
-// start_gather_site()    Declare/prepare/do site gather in a single step
-// start_gather_field()   Declare/prepare/do field gather in a single step
+// start_gather_site()    Declare/prepare/do site gather in a single step,
+//                          reusing a persistent gather plan when possible
+// start_gather_field()   Declare/prepare/do field gather in a single step,
+//                          reusing a persistent gather plan when possible
 // start_general_gather_site()
 //                        Start asynchronous sends and receives required
 //                          to gather site data at arbitrary displacement
@@ -71,11 +84,18 @@
 //                          data have actually arrived,
 //                          and set pointers to received data
 // cleanup_general_gather()
-//                        Free all the buffers that were allocated
+//                        Return the persistent gather plan to the pool
 //                          NB: the gathered data may soon disappear
+// gather_stats()         Number of messages and bytes sent by gathers
+// malloc_shared()        Allocate a field that other ranks on the same node
+//                          can read directly, with -DSHM_GATHER
+// free_shared()          Free a field allocated by malloc_shared()
 #include <time.h>
 #include "generic_includes.h"
 #include <mpi.h>
+#if defined(SHM_GATHER) && MPI_VERSION < 3
+#error "SHM_GATHER requires MPI-3 shared memory windows"
+#endif
 #if PRECISION == 1
 #define OUR_MPI_REAL MPI_FLOAT
 #else
@@ -87,12 +107,15 @@
 /* message types used here */
 #define SEND_INTEGER_ID    1  /* send an integer to one other node */
 #define SEND_FIELD_ID      2  /* id of field sent from one node to another */
-#define GENERAL_GATHER_ID  3  /* id used by general_gather routines */
 #define GATHER_BASE_ID     4  /* ids greater than or equal to this are used
                                  by the gather routines */
 
 // Macro to compute the message id
 #define GATHER_ID(x) (GATHER_BASE_ID+(x))
+#ifdef SHM_GATHER
+// Tags for messages saying that a shared field has been read
+#define DONE_ID(x) (tag_upper - GATHER_ID(x))
+#endif
 // -----------------------------------------------------------------
 
 
@@ -137,6 +160,10 @@ typedef struct gather_t {
   id_list_t *id_list;            /* list of id offsets for sending */
   int n_recv_msgs, n_send_msgs;  /* number of messages to receive and send */
   int offset_increment; /* total number of message ids used for this gather */
+#ifdef SHM_GATHER
+  int **remote;         // For receives from ranks on this node, the indices
+                        // there of the neighbors, in sitelist[2] order
+#endif
 } gather_t;
 
 /* structure to keep track of details of a declared gather */
@@ -157,6 +184,9 @@ typedef struct {
   char *msg_buf;        /* address of buffer malloc'd for message */
   gmem_t *gmem;         /* linked list explaining detailed usage for buffer */
   MPI_Request msg_req;  /* message handle returned by system call */
+#ifdef SHM_GATHER
+  int *remote;          // Neighbor indices on the sending rank, or NULL
+#endif
 } msg_sr_t;
 
 /* structure to store declared gathers
@@ -170,8 +200,36 @@ struct msg_tag {
   int nsends;        /* number of messages to send in gather */
   msg_sr_t *recv_msgs;  /* array of messages to receive */
   msg_sr_t *send_msgs;  /* array of messages to send */
+  struct gather_plan *plan;  // Persistent plan owning this tag, or NULL
 };
 
+// Persistent gather plan, with message buffers and MPI persistent requests
+// These depend only on the size, direction and parity of the gather,
+// so the source field and destination pointers are set for each use
+typedef struct gather_plan {
+  int size, index, parity;
+  int in_use;           // Started but not yet cleaned up
+  msg_tag *mtag;
+  struct gather_plan *next;  // Next plan for the same direction
+#ifdef SHM_GATHER
+  int shared;                // Reads on-node neighbors in shared memory
+  struct shared_seg *seg;    // Segment holding the field while in use
+  MPI_Request *done_req;     // nrecvs sends, then nsends receives
+#endif
+} gather_plan;
+
+#ifdef SHM_GATHER
+// Field from malloc_shared(), in an MPI-3 shared memory window
+// peer_base is its address in each rank of node_comm
+typedef struct shared_seg {
+  char *base;
+  MPI_Aint size;
+  MPI_Win win;
+  char **peer_base;
+  struct shared_seg *next;
+} shared_seg;
+#endif
+
 // Global variables for communications stuff
 /* message ids for gather encode a sequence number for the gather
    so that if several gathers are going at once, you can read
@@ -185,6 +243,27 @@ static gather_t *gather_array;  // Array storing gather setup info
 
 // Number of gathers (mappings) that have been set up
 static int n_gathers, gather_array_len;
+
+// Pool of persistent gather plans, with one list per direction
+static gather_plan **plan_list;
+static int plan_list_len;
+static int tag_upper;           // Largest allowed message tag
+
+// Messages and bytes sent by gathers, reported by gather_stats()
+static double gather_msgs = 0.0, gather_bytes = 0.0;
+static void free_gather_plan(gather_plan *plan);
+static void free_gather_plans();
+static void free_sums();
+
+#ifdef SHM_GATHER
+// Ranks on this node, with the rank in node_comm of each node
+// or -1 for nodes elsewhere
+static MPI_Comm node_comm;
+static int node_size, *node_rank;
+static shared_seg *seg_list = NULL;
+static void finish_shared_plan(gather_plan *plan);
+static void free_shared_segs();
+#endif
 // -----------------------------------------------------------------
 
 
@@ -203,14 +282,20 @@ void err_func(MPI_Comm *comm, int *stat, ...) {
 
 // Machine initialization
 void initialize_machine(int *argc, char ***argv) {
-  int i, flag, *tag_ub;
+  int i, flag, *tag_ub, provided;
   MPI_Comm comm;
   MPI_Errhandler errhandler;
 
-  flag = MPI_Init(argc, argv);
+  // Only the master thread communicates, outside threaded site loops
+  // and the helper threads of save_async (io_lat.c)
+  flag = MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
   comm = MPI_COMM_WORLD;
   if (flag)
     err_func(&comm, &flag);
+  if (provided < MPI_THREAD_FUNNELED) {
+    printf("node%i: MPI_THREAD_FUNNELED not supported\n", mynode());
+    terminate(1);
+  }
   flag = MPI_Errhandler_create(err_func, &errhandler);
   if (flag)
     err_func(&comm, &flag);
@@ -237,6 +322,7 @@ void initialize_machine(int *argc, char ***argv) {
   /* Note: with MPI-2 MPI_Comm_get_attr is preferred,
      but we keep MPI_Attr_get until MPI-2 is more widely available */
   MPI_Attr_get(MPI_COMM_WORLD, MPI_TAG_UB, &tag_ub, &flag);
+  tag_upper = *tag_ub;
   num_gather_ids = *tag_ub + 1 - GATHER_BASE_ID;
   if (num_gather_ids > 1024)
     num_gather_ids = 1024;
@@ -249,12 +335,47 @@ void initialize_machine(int *argc, char ***argv) {
   n_gathers = 0;
   gather_array_len = 0;
   gather_array = NULL;
+
+  plan_list_len = 0;
+  plan_list = NULL;
+
+#ifdef SHM_GATHER
+  // Find the ranks that share memory with this one
+  MPI_Group world_group, node_group;
+  int *ranks, nodes = numnodes();
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0,
+                      MPI_INFO_NULL, &node_comm);
+  MPI_Comm_size(node_comm, &node_size);
+  MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+  MPI_Comm_group(node_comm, &node_group);
+  ranks = malloc(nodes * sizeof(*ranks));
+  node_rank = malloc(nodes * sizeof(*node_rank));
+  if (ranks == NULL || node_rank == NULL) {
+    printf("initialize_machine: node%d can't malloc node_rank\n", mynode());
+    terminate(1);
+  }
+  for (i = 0; i < nodes; i++)
+    ranks[i] = i;
+  MPI_Group_translate_ranks(world_group, nodes, ranks, node_group, node_rank);
+  for (i = 0; i < nodes; i++) {
+    if (node_rank[i] == MPI_UNDEFINED)
+      node_rank[i] = -1;
+  }
+  free(ranks);
+  MPI_Group_free(&world_group);
+  MPI_Group_free(&node_group);
+#endif
 }
 
 // Normal exit for multinode processes
 void normal_exit(int status) {
   time_stamp("exit");
   g_sync();
+  free_gather_plans();
+  free_sums();
+#ifdef SHM_GATHER
+  free_shared_segs();
+#endif
   MPI_Finalize();
   exit(status);
 }
@@ -352,6 +473,43 @@ void g_vecdoublesum(double *dpt, int length) {
   free(work);
 }
 
+// Start summing a vector of doubles over all nodes, in place
+// dpt must not be touched until g_sum_wait() returns
+// Falls back to a blocking sum before MPI-3
+// Sums queued by the g_*sum_add() routines below use the same tag,
+// adding the packed values and where to return them
+typedef struct {
+  void *pt;
+  int type;
+} sum_entry;
+
+struct sum_tag {
+  MPI_Request req;
+  int n;              // Number of queued sums to return
+  sum_entry *entry;
+  double *buf;
+};
+
+static void start_sum(sum_tag *tag, double *dpt, int length) {
+#if MPI_VERSION >= 3
+  MPI_Iallreduce(MPI_IN_PLACE, dpt, length, MPI_DOUBLE, MPI_SUM,
+                 MPI_COMM_WORLD, &(tag->req));
+#else
+  MPI_Allreduce(MPI_IN_PLACE, dpt, length, MPI_DOUBLE, MPI_SUM,
+                MPI_COMM_WORLD);
+  tag->req = MPI_REQUEST_NULL;
+#endif
+}
+
+sum_tag* g_vecdoublesum_start(double *dpt, int length) {
+  sum_tag *tag = malloc(sizeof(*tag));
+  tag->n = 0;
+  tag->entry = NULL;
+  tag->buf = NULL;
+  start_sum(tag, dpt, length);
+  return tag;
+}
+
 // Sum complex over all nodes
 void g_complexsum(complex *cpt) {
   complex work;
@@ -389,6 +547,148 @@ void g_vecdcomplexsum(double_complex *cpt, int length) {
 
 
 
+// -----------------------------------------------------------------
+// Batched global sums
+// g_floatsum_add(), g_doublesum_add(), g_complexsum_add() and
+// g_dcomplexsum_add() queue a sum without doing it,
+// g_sum_start() then starts all queued sums as a single reduction,
+// and g_sum_wait() returns the results to the queued addresses
+// Values are read by g_sum_start() and are summed in double precision
+// The queued variables must not be touched until g_sum_wait() returns
+#define SUM_REAL     0
+#define SUM_DOUBLE   1
+#define SUM_COMPLEX  2
+#define SUM_DCOMPLEX 3
+static sum_entry *sum_queue = NULL;
+static int n_queue = 0, max_queue = 0;
+// Persistent tag for g_sum_start(), with the sizes of its arrays
+static sum_tag batch_tag;
+static int max_entry = 0, max_buf = 0, batch_pending = 0;
+
+static void queue_sum(void *pt, int type) {
+  if (n_queue == max_queue) {
+    max_queue += 16;
+    sum_queue = realloc(sum_queue, max_queue * sizeof(*sum_queue));
+    if (sum_queue == NULL) {
+      printf("queue_sum: node%d can't realloc sum_queue\n", this_node);
+      terminate(1);
+    }
+  }
+  sum_queue[n_queue].pt = pt;
+  sum_queue[n_queue].type = type;
+  n_queue++;
+}
+
+void g_floatsum_add(Real *fpt) {
+  queue_sum(fpt, SUM_REAL);
+}
+
+void g_doublesum_add(double *dpt) {
+  queue_sum(dpt, SUM_DOUBLE);
+}
+
+void g_complexsum_add(complex *cpt) {
+  queue_sum(cpt, SUM_COMPLEX);
+}
+
+void g_dcomplexsum_add(double_complex *cpt) {
+  queue_sum(cpt, SUM_DCOMPLEX);
+}
+
+// Pack the queued values and start summing them
+// The queue is swapped with the entries of a single persistent tag,
+// whose buffer only grows, so only one g_sum_start() may be pending
+sum_tag* g_sum_start() {
+  int i, length = 0, max;
+  sum_tag *tag = &batch_tag;
+  sum_entry *entry;
+  double *buf;
+
+  if (batch_pending) {
+    printf("g_sum_start: node%d already has a sum pending\n", this_node);
+    terminate(1);
+  }
+  if (2 * n_queue + 1 > max_buf) {
+    max_buf = 2 * n_queue + 1;
+    tag->buf = realloc(tag->buf, max_buf * sizeof(*(tag->buf)));
+    if (tag->buf == NULL) {
+      printf("g_sum_start: node%d can't realloc buf\n", this_node);
+      terminate(1);
+    }
+  }
+  buf = tag->buf;
+  for (i = 0; i < n_queue; i++) {
+    switch (sum_queue[i].type) {
+      case SUM_REAL:
+        buf[length++] = *(Real *)sum_queue[i].pt;
+        break;
+      case SUM_DOUBLE:
+        buf[length++] = *(double *)sum_queue[i].pt;
+        break;
+      case SUM_COMPLEX:
+        buf[length++] = ((complex *)sum_queue[i].pt)->real;
+        buf[length++] = ((complex *)sum_queue[i].pt)->imag;
+        break;
+      case SUM_DCOMPLEX:
+        buf[length++] = ((double_complex *)sum_queue[i].pt)->real;
+        buf[length++] = ((double_complex *)sum_queue[i].pt)->imag;
+        break;
+    }
+  }
+  entry = tag->entry;
+  max = max_entry;
+  tag->n = n_queue;
+  tag->entry = sum_queue;
+  max_entry = max_queue;
+  sum_queue = entry;
+  max_queue = max;
+  n_queue = 0;
+  batch_pending = 1;
+  start_sum(tag, tag->buf, length);
+  return tag;
+}
+
+// Wait for a non-blocking sum to finish, return any queued sums
+// and free the tag unless it is the persistent one
+void g_sum_wait(sum_tag *tag) {
+  int i, j = 0;
+  double *buf = tag->buf;
+
+  MPI_Wait(&(tag->req), MPI_STATUS_IGNORE);
+  for (i = 0; i < tag->n; i++) {
+    switch (tag->entry[i].type) {
+      case SUM_REAL:
+        *(Real *)tag->entry[i].pt = (Real)buf[j++];
+        break;
+      case SUM_DOUBLE:
+        *(double *)tag->entry[i].pt = buf[j++];
+        break;
+      case SUM_COMPLEX:
+        ((complex *)tag->entry[i].pt)->real = (Real)buf[j++];
+        ((complex *)tag->entry[i].pt)->imag = (Real)buf[j++];
+        break;
+      case SUM_DCOMPLEX:
+        ((double_complex *)tag->entry[i].pt)->real = buf[j++];
+        ((double_complex *)tag->entry[i].pt)->imag = buf[j++];
+        break;
+    }
+  }
+  if (tag == &batch_tag)
+    batch_pending = 0;
+  else
+    free(tag);
+}
+
+// Free the queue and the persistent tag arrays at exit
+static void free_sums() {
+  free(sum_queue);
+  free(batch_tag.entry);
+  free(batch_tag.buf);
+}
+// -----------------------------------------------------------------
+
+
+
 // -----------------------------------------------------------------
 // Global xor and maxima
 // Global exclusive or acting on u_int32type, for checksums
@@ -869,6 +1169,46 @@ static int get_max_receives(int n_recv) {
   return work;
 }
 
+#ifdef SHM_GATHER
+// For each receive from a rank on this node, get the indices there
+// of the neighbors, in the order of sitelist[2]
+// This is the order in which that rank would send them
+static int** make_remote_list(comlink *recv, int n_recv,
+                              comlink *send, int n_send) {
+  int i, **remote = malloc(n_recv * sizeof(*remote));
+  MPI_Request *req = malloc(n_send * sizeof(*req));
+
+  if ((n_recv > 0 && remote == NULL) || (n_send > 0 && req == NULL)) {
+    printf("make_remote_list: node%d can't malloc\n", this_node);
+    terminate(1);
+  }
+
+  for (i = 0; send != NULL; i++, send = send->nextcomlink) {
+    req[i] = MPI_REQUEST_NULL;
+    if (node_rank[send->othernode] >= 0)
+      MPI_Isend(send->sitelist[2], send->n_subl_connected[2], MPI_INT,
+                send->othernode, 0, MPI_COMM_WORLD, &req[i]);
+  }
+
+  for (i = 0; recv != NULL; i++, recv = recv->nextcomlink) {
+    remote[i] = NULL;
+    if (node_rank[recv->othernode] < 0)
+      continue;
+    remote[i] = malloc(recv->n_subl_connected[2] * sizeof(int));
+    if (remote[i] == NULL) {
+      printf("make_remote_list: node%d can't malloc\n", this_node);
+      terminate(1);
+    }
+    MPI_Recv(remote[i], recv->n_subl_connected[2], MPI_INT, recv->othernode,
+             0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  }
+
+  MPI_Waitall(n_send, req, MPI_STATUSES_IGNORE);
+  free(req);
+  return remote;
+}
+#endif
+
 // Add another gather to the list of tables
 int make_gather(
   void (*func)(int, int, int, int, int*, int, int*, int*, int*, int*),
@@ -1026,6 +1366,12 @@ int make_gather(
                                            gather_array[dir].neighborlist_send);
 
   gather_array[dir].offset_increment = get_max_receives(gather_array[dir].n_recv_msgs);
+#ifdef SHM_GATHER
+  gather_array[dir].remote = make_remote_list(gather_array[dir].neighborlist,
+                                              gather_array[dir].n_recv_msgs,
+                                              gather_array[dir].neighborlist_send,
+                                              gather_array[dir].n_send_msgs);
+#endif
 
   if (inverse != WANT_INVERSE) {
     free(send_subl);
@@ -1087,6 +1433,12 @@ int make_gather(
 
   gather_array[dir].offset_increment =
     get_max_receives(gather_array[dir].n_recv_msgs);
+#ifdef SHM_GATHER
+  gather_array[dir].remote = make_remote_list(gather_array[dir].neighborlist,
+                                              gather_array[dir].n_recv_msgs,
+                                              gather_array[dir].neighborlist_send,
+                                              gather_array[dir].n_send_msgs);
+#endif
 
   free(send_subl);
   return (dir - 1);
@@ -1189,6 +1541,7 @@ msg_tag* declare_strided_gather(
   mtag = malloc(sizeof(*mtag));
   mtag->nids = gt->offset_increment;
   mtag->ids = NULL;
+  mtag->plan = NULL;
 
   /* allocate a buffer for the msg_sr_t's.  This is dynamically allocated
      because there may be an arbitrary number of gathers in progress
@@ -1235,6 +1588,13 @@ msg_tag* declare_strided_gather(
     mrecv[i].id_offset = i;
     mrecv[i].msg_size = size*compt->n_subl_connected[subl];
     mrecv[i].msg_buf = NULL;
+#ifdef SHM_GATHER
+    // sitelist[subl] is a contiguous part of sitelist[2]
+    mrecv[i].remote = NULL;
+    if (gt->remote[i] != NULL)
+      mrecv[i].remote = gt->remote[i]
+                        + (compt->sitelist[subl] - compt->sitelist[2]);
+#endif
     gmem = (gmem_t *)malloc(sizeof(gmem_t));
     mrecv[i].gmem = gmem;
     gmem->num = compt->n_subl_connected[subl];
@@ -1254,6 +1614,9 @@ msg_tag* declare_strided_gather(
     msend[i].id_offset = idl->id_offset;
     msend[i].msg_size = size*compt->n_subl_connected[subl];
     msend[i].msg_buf = NULL;
+#ifdef SHM_GATHER
+    msend[i].remote = NULL;
+#endif
     gmem = (gmem_t *)malloc(sizeof(gmem_t));
     msend[i].gmem = gmem;
     gmem->num = compt->n_subl_connected[subl];
@@ -1364,6 +1727,8 @@ void do_gather(msg_tag *mtag) {
     MPI_Isend(mbuf[i].msg_buf, mbuf[i].msg_size, MPI_BYTE, mbuf[i].msg_node,
               GATHER_ID(mtag->ids[mbuf[i].id_offset]), MPI_COMM_WORLD,
               &mbuf[i].msg_req);
+    gather_msgs++;
+    gather_bytes += mbuf[i].msg_size;
   }
 }
 
@@ -1381,6 +1746,12 @@ void wait_gather(msg_tag *mtag) {
   for (i = 0; i < mtag->nsends; i++) {
     MPI_Wait(&mtag->send_msgs[i].msg_req, &status);
   }
+
+#ifdef SHM_GATHER
+  // Make sure we see what the neighbors wrote before they started
+  if (mtag->plan != NULL && mtag->plan->seg != NULL)
+    MPI_Win_sync(mtag->plan->seg->win);
+#endif
 }
 
 // Free buffers associated with message tag
@@ -1388,6 +1759,16 @@ void cleanup_gather(msg_tag *mtag) {
   int i;
   gmem_t *gmem, *next;
 
+  // Persistent plans keep their buffers and requests for the next use
+  if (mtag->plan != NULL) {
+#ifdef SHM_GATHER
+    if (mtag->plan->seg != NULL)
+      finish_shared_plan(mtag->plan);
+#endif
+    mtag->plan->in_use = 0;
+    return;
+  }
+
   if (mtag->ids != NULL)
     for (i = 0; i < mtag->nids; ++i)
       id_array[mtag->ids[i]] = 0;
@@ -1420,6 +1801,440 @@ void cleanup_gather(msg_tag *mtag) {
   free(mtag->ids);
   free(mtag);
 }
+
+// Move the sources of a declared gather, not in progress, from old_field
+// to field, keeping its buffers and message ids for the next do_gather()
+// Pointers to neighbors on this node still point into old_field
+void rebind_gather(msg_tag *mtag, void *old_field, void *field) {
+  int i;
+  gmem_t *gmem;
+
+  for (i = 0; i < mtag->nsends; i++) {
+    for (gmem = mtag->send_msgs[i].gmem; gmem != NULL; gmem = gmem->next)
+      gmem->mem = (char *)field + (gmem->mem - (char *)old_field);
+  }
+}
+
+// Nothing is left to finish once wait_gather() returns
+void release_gather(msg_tag *mtag) {
+}
+
+// Messages and bytes sent by gathers from this node since the start
+void gather_stats(double *nmsgs, double *nbytes) {
+  *nmsgs = gather_msgs;
+  *nbytes = gather_bytes;
+}
+// -----------------------------------------------------------------
+
+
+// -----------------------------------------------------------------
+// Fields in shared memory
+// With -DSHM_GATHER, malloc_shared() puts a field in an MPI-3 shared
+// memory window over the ranks of each node, so that gathers from it
+// can point gen_pt straight at the field on other ranks of the same node
+// Only empty messages then go between these ranks, when the gather starts
+// to say that the field is ready, and when it is cleaned up to say that
+// it has been read
+// As with gen_pt pointing to the field on this node, the field must not
+// change between the start and the cleanup of the gather
+// All ranks on the node must call malloc_shared() and free_shared()
+// in the same order, like make_fields()
+// Otherwise, or with one rank per node, these are just malloc() and free()
+void* malloc_shared(size_t size) {
+#ifdef SHM_GATHER
+  int r, disp_unit;
+  MPI_Aint peer_size;
+  MPI_Info info;
+  shared_seg *seg;
+
+  if (node_size == 1)
+    return malloc(size);
+
+  seg = malloc(sizeof(*seg));
+  if (seg == NULL) {
+    printf("malloc_shared: node%d can't malloc seg\n", this_node);
+    terminate(1);
+  }
+  seg->peer_base = malloc(node_size * sizeof(*seg->peer_base));
+  if (seg->peer_base == NULL) {
+    printf("malloc_shared: node%d can't malloc peer_base\n", this_node);
+    terminate(1);
+  }
+
+  // Let each rank's part be placed in its own memory
+  MPI_Info_create(&info);
+  MPI_Info_set(info, "alloc_shared_noncontig", "true");
+  MPI_Win_allocate_shared((MPI_Aint)size, 1, info, node_comm,
+                          &seg->base, &seg->win);
+  MPI_Info_free(&info);
+  for (r = 0; r < node_size; r++)
+    MPI_Win_shared_query(seg->win, r, &peer_size, &disp_unit,
+                         &seg->peer_base[r]);
+  // Passive target epoch for MPI_Win_sync() in the gathers
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, seg->win);
+
+  seg->size = (MPI_Aint)size;
+  seg->next = seg_list;
+  seg_list = seg;
+  return seg->base;
+#else
+  return malloc(size);
+#endif
+}
+
+void free_shared(void *ptr) {
+#ifdef SHM_GATHER
+  shared_seg *seg, **prev;
+
+  for (prev = &seg_list; (seg = *prev) != NULL; prev = &seg->next) {
+    if (seg->base == ptr) {
+      *prev = seg->next;
+      MPI_Win_unlock_all(seg->win);
+      MPI_Win_free(&seg->win);
+      free(seg->peer_base);
+      free(seg);
+      return;
+    }
+  }
+#endif
+  free(ptr);
+}
+
+#ifdef SHM_GATHER
+// Segment containing pointer p, or NULL
+static shared_seg* find_shared_seg(char *p) {
+  shared_seg *seg;
+
+  for (seg = seg_list; seg != NULL; seg = seg->next) {
+    if (p >= seg->base && p < seg->base + seg->size)
+      return seg;
+  }
+  return NULL;
+}
+
+// Free the remaining segments before MPI_Finalize,
+// in the same order on all ranks
+static void free_shared_segs() {
+  while (seg_list != NULL)
+    free_shared(seg_list->base);
+}
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Persistent gather plans
+// start_gather_site(), start_gather_field() and start_gather_strided()
+// take a plan with the same size, direction and parity from the pool,
+// making a new one only if all of them are in use
+// The plan keeps its message buffers and MPI_Send_init/MPI_Recv_init
+// requests, so a gather only sets pointers, packs, starts and waits,
+// and cleanup_gather() just returns the plan to the pool
+// There are only as many plans as gathers in flight at the same time
+// With -DSHM_GATHER, fields from malloc_shared() get separate plans
+// that read neighbors on other ranks of the same node in shared memory
+// Plans use a fixed tag for each direction and message,
+// above the round-robin ids of declare_gather_*(), so all nodes agree
+// on the tags even if they make new plans at different times
+// MPI matches messages with the same tag between two nodes
+// in the order they are started, which is the same on every node
+
+// Point the plan at the source field and set the pointers in dest,
+// to the field for neighbors on this node and into the receive buffers
+// for neighbors on other nodes
+static void set_plan_pointers(gather_plan *plan, char *field, int stride,
+                              char **dest) {
+  register int i, j;
+  register site *s;
+  register char *tpt;
+  int *neighbor = gather_array[plan->index].neighbor;
+  msg_tag *mtag = plan->mtag;
+  gmem_t *gmem;
+
+  if (plan->parity == EVENANDODD) {
+    FORALLSITES(i, s) {
+      if (neighbor[i] != NOWHERE)
+        dest[i] = field + neighbor[i] * stride;
+    }
+  }
+  else {
+    FORSOMEPARITY(i, s, plan->parity) {
+      if (neighbor[i] != NOWHERE)
+        dest[i] = field + neighbor[i] * stride;
+    }
+  }
+
+  for (i = 0; i < mtag->nrecvs; i++) {
+    gmem = mtag->recv_msgs[i].gmem;
+#ifdef SHM_GATHER
+    // Point straight at the field on the other rank
+    if (plan->seg != NULL && mtag->recv_msgs[i].remote != NULL) {
+      tpt = plan->seg->peer_base[node_rank[mtag->recv_msgs[i].msg_node]]
+            + (field - plan->seg->base);
+      for (j = 0; j < gmem->num; j++)
+        dest[gmem->sitelist[j]] = tpt + mtag->recv_msgs[i].remote[j] * stride;
+      continue;
+    }
+#endif
+    tpt = mtag->recv_msgs[i].msg_buf;
+    for (j = 0; j < gmem->num; j++, tpt += gmem->size)
+      dest[gmem->sitelist[j]] = tpt;
+  }
+
+  for (i = 0; i < mtag->nsends; i++) {
+    gmem = mtag->send_msgs[i].gmem;
+    gmem->mem = field;
+    gmem->stride = stride;
+  }
+}
+
+// Declare the gather once, then allocate its buffers
+// and set up persistent requests
+// shared plans (only with -DSHM_GATHER) send empty messages
+// to other ranks on this node, and need no buffers for them
+static gather_plan* make_gather_plan(char *field, int stride, int size,
+                                     int index, int parity, int shared,
+                                     char **dest) {
+  int i, tag0 = num_gather_ids;
+  gather_plan *plan;
+  msg_tag *mtag;
+  msg_sr_t *mbuf;
+
+  // First tag for this direction
+  for (i = 0; i < index; i++)
+    tag0 += gather_array[i].offset_increment;
+  if (GATHER_ID(tag0 + gather_array[index].offset_increment) > tag_upper) {
+    printf("make_gather_plan: node%d out of message tags\n", this_node);
+    terminate(1);
+  }
+#ifdef SHM_GATHER
+  if (2 * GATHER_ID(tag0 + gather_array[index].offset_increment) >= tag_upper) {
+    printf("make_gather_plan: node%d out of message tags\n", this_node);
+    terminate(1);
+  }
+#endif
+
+  plan = malloc(sizeof(*plan));
+  if (plan == NULL) {
+    printf("make_gather_plan: node%d can't malloc plan\n", this_node);
+    terminate(1);
+  }
+  plan->size = size;
+  plan->index = index;
+  plan->parity = parity;
+  plan->in_use = 0;
+
+  mtag = declare_strided_gather(field, stride, size, index, parity, dest);
+  mtag->nids = 0;     // Fixed tags rather than round-robin ids
+  mtag->plan = plan;
+  plan->mtag = mtag;
+
+#ifdef SHM_GATHER
+  // Empty messages to and from ranks on this node, with tags DONE_ID()
+  // counting down from the top, say that a field has been read
+  plan->shared = shared;
+  plan->seg = NULL;
+  plan->done_req = malloc((mtag->nrecvs + mtag->nsends + 1)
+                          * sizeof(*plan->done_req));
+  if (plan->done_req == NULL) {
+    printf("make_gather_plan: node%d can't malloc done_req\n", this_node);
+    terminate(1);
+  }
+  mbuf = mtag->recv_msgs;
+  for (i = 0; i < mtag->nrecvs; i++) {
+    plan->done_req[i] = MPI_REQUEST_NULL;
+    if (!shared || mbuf[i].remote == NULL)
+      continue;
+    MPI_Recv_init(NULL, 0, MPI_BYTE, mbuf[i].msg_node,
+                  GATHER_ID(tag0 + mbuf[i].id_offset), MPI_COMM_WORLD,
+                  &mbuf[i].msg_req);
+    MPI_Send_init(NULL, 0, MPI_BYTE, mbuf[i].msg_node,
+                  DONE_ID(tag0 + mbuf[i].id_offset), MPI_COMM_WORLD,
+                  &plan->done_req[i]);
+  }
+  mbuf = mtag->send_msgs;
+  for (i = 0; i < mtag->nsends; i++) {
+    plan->done_req[mtag->nrecvs + i] = MPI_REQUEST_NULL;
+    if (!shared || node_rank[mbuf[i].msg_node] < 0)
+      continue;
+    MPI_Send_init(NULL, 0, MPI_BYTE, mbuf[i].msg_node,
+                  GATHER_ID(tag0 + mbuf[i].id_offset), MPI_COMM_WORLD,
+                  &mbuf[i].msg_req);
+    MPI_Recv_init(NULL, 0, MPI_BYTE, mbuf[i].msg_node,
+                  DONE_ID(tag0 + mbuf[i].id_offset), MPI_COMM_WORLD,
+                  &plan->done_req[mtag->nrecvs + i]);
+  }
+#endif
+
+  mbuf = mtag->recv_msgs;
+  for (i = 0; i < mtag->nrecvs; i++) {
+#ifdef SHM_GATHER
+    if (shared && mbuf[i].remote != NULL)
+      continue;
+#endif
+    mbuf[i].msg_buf = malloc(mbuf[i].msg_size);
+    if (mbuf[i].msg_buf == NULL) {
+      printf("NO ROOM for msg_buf, node%d\n", mynode());
+      terminate(1);
+    }
+    MPI_Recv_init(mbuf[i].msg_buf, mbuf[i].msg_size, MPI_BYTE,
+                  mbuf[i].msg_node, GATHER_ID(tag0 + mbuf[i].id_offset),
+                  MPI_COMM_WORLD, &mbuf[i].msg_req);
+  }
+
+  mbuf = mtag->send_msgs;
+  for (i = 0; i < mtag->nsends; i++) {
+#ifdef SHM_GATHER
+    if (shared && node_rank[mbuf[i].msg_node] >= 0)
+      continue;
+#endif
+    mbuf[i].msg_buf = malloc(mbuf[i].msg_size);
+    if (mbuf[i].msg_buf == NULL) {
+      printf("NO ROOM for msg_buf, node%d\n", mynode());
+      terminate(1);
+    }
+    MPI_Send_init(mbuf[i].msg_buf, mbuf[i].msg_size, MPI_BYTE,
+                  mbuf[i].msg_node, GATHER_ID(tag0 + mbuf[i].id_offset),
+                  MPI_COMM_WORLD, &mbuf[i].msg_req);
+  }
+
+  // Add to the front of the list for this direction
+  plan->next = plan_list[index];
+  plan_list[index] = plan;
+  return plan;
+}
+
+static void free_gather_plan(gather_plan *plan) {
+  int i;
+  msg_tag *mtag = plan->mtag;
+
+  for (i = 0; i < mtag->nrecvs; i++)
+    MPI_Request_free(&mtag->recv_msgs[i].msg_req);
+  for (i = 0; i < mtag->nsends; i++)
+    MPI_Request_free(&mtag->send_msgs[i].msg_req);
+#ifdef SHM_GATHER
+  for (i = 0; i < mtag->nrecvs + mtag->nsends; i++) {
+    if (plan->done_req[i] != MPI_REQUEST_NULL)
+      MPI_Request_free(&plan->done_req[i]);
+  }
+  free(plan->done_req);
+#endif
+  mtag->plan = NULL;
+  cleanup_gather(mtag);       // Frees the buffers and the msg_tag
+  free(plan);
+}
+
+// Free the whole pool, e.g. before MPI_Finalize
+static void free_gather_plans() {
+  int index;
+  gather_plan *plan, *next;
+
+  for (index = 0; index < plan_list_len; index++) {
+    for (plan = plan_list[index]; plan != NULL; plan = next) {
+      next = plan->next;
+      free_gather_plan(plan);
+    }
+    plan_list[index] = NULL;
+  }
+}
+
+#ifdef SHM_GATHER
+// Tell the ranks we read from that we are done with their field,
+// and wait until the ranks reading ours are done with it,
+// since it may change as soon as the gather is cleaned up
+static void finish_shared_plan(gather_plan *plan) {
+  int i;
+  msg_tag *mtag = plan->mtag;
+
+  for (i = 0; i < mtag->nrecvs; i++) {
+    if (plan->done_req[i] != MPI_REQUEST_NULL)
+      MPI_Start(&plan->done_req[i]);
+  }
+  MPI_Waitall(mtag->nrecvs + mtag->nsends, plan->done_req,
+              MPI_STATUSES_IGNORE);
+  plan->seg = NULL;
+}
+#endif
+
+// Find or make a plan, then start it
+static msg_tag* start_gather_plan(char *field, int stride, int size,
+                                  int index, int parity, char **dest) {
+  register int i, j;
+  register char *tpt;
+  int shared = 0;
+  gather_plan *plan;
+  msg_sr_t *mbuf;
+  gmem_t *gmem;
+#ifdef SHM_GATHER
+  shared_seg *seg = find_shared_seg(field);
+  shared = (seg != NULL);
+#endif
+
+  if (index >= plan_list_len) {
+    plan_list = realloc(plan_list, n_gathers * sizeof(*plan_list));
+    if (plan_list == NULL) {
+      printf("start_gather_plan: node%d can't realloc plan_list\n",
+             this_node);
+      terminate(1);
+    }
+    for (i = plan_list_len; i < n_gathers; i++)
+      plan_list[i] = NULL;
+    plan_list_len = n_gathers;
+  }
+
+  for (plan = plan_list[index]; plan != NULL; plan = plan->next) {
+    if (!plan->in_use && plan->size == size && plan->parity == parity
+#ifdef SHM_GATHER
+        && plan->shared == shared
+#endif
+       )
+      break;
+  }
+  if (plan == NULL)
+    plan = make_gather_plan(field, stride, size, index, parity, shared, dest);
+  plan->in_use = 1;
+#ifdef SHM_GATHER
+  plan->seg = seg;
+#endif
+  set_plan_pointers(plan, field, stride, dest);
+
+  // Post receives, then pack and start sends
+  mbuf = plan->mtag->recv_msgs;
+  for (i = 0; i < plan->mtag->nrecvs; i++)
+    MPI_Start(&mbuf[i].msg_req);
+
+#ifdef SHM_GATHER
+  // Ranks on this node just hear that the field is ready,
+  // once our writes to it are visible
+  if (shared) {
+    MPI_Win_sync(seg->win);
+    for (i = 0; i < plan->mtag->nsends; i++) {
+      if (plan->done_req[plan->mtag->nrecvs + i] != MPI_REQUEST_NULL)
+        MPI_Start(&plan->done_req[plan->mtag->nrecvs + i]);
+    }
+  }
+#endif
+
+  mbuf = plan->mtag->send_msgs;
+  for (i = 0; i < plan->mtag->nsends; i++) {
+#ifdef SHM_GATHER
+    if (shared && node_rank[mbuf[i].msg_node] >= 0) {
+      MPI_Start(&mbuf[i].msg_req);
+      gather_msgs++;
+      continue;
+    }
+#endif
+    tpt = mbuf[i].msg_buf;
+    gmem = mbuf[i].gmem;
+    for (j = 0; j < gmem->num; j++, tpt += gmem->size)
+      memcpy(tpt, gmem->mem + gmem->sitelist[j] * gmem->stride, gmem->size);
+    MPI_Start(&mbuf[i].msg_req);
+    gather_msgs++;
+    gather_bytes += mbuf[i].msg_size;
+  }
+  return plan->mtag;
+}
 // -----------------------------------------------------------------
 
 
@@ -1440,7 +2255,8 @@ msg_tag* declare_gather_site(
          index, parity, dest);
 }
 
-// Old style gather routine: declare and start in one call
+// Old style gather routine: declare and start in one call,
+// through a persistent gather plan
 msg_tag* start_gather_site(
   field_offset field, /* which field? Some member of structure "site" */
   int size,   /* size in bytes of the field (eg sizeof(vector))*/
@@ -1450,14 +2266,8 @@ msg_tag* start_gather_site(
          one of EVEN, ODD or EVENANDODD. */
   char **dest)   /* one of the vectors of pointers */
 {
-  msg_tag *mt;
-
-  mt = declare_strided_gather((char *)lattice + field, sizeof(site), size,
-                              index, parity, dest);
-  prepare_gather(mt);
-  do_gather(mt);
-
-  return mt;
+  return start_gather_plan((char *)lattice + field, sizeof(site), size,
+                           index, parity, dest);
 }
 // -----------------------------------------------------------------
 
@@ -1478,7 +2288,8 @@ msg_tag* declare_gather_field(
   return declare_strided_gather(field, size, size, index, parity, dest);
 }
 
-// Old style gather routine: declare and start in one call
+// Old style gather routine: declare and start in one call,
+// through a persistent gather plan
 msg_tag* start_gather_field(
   void *field,   /* which field? Pointer returned by malloc() */
   int size,   /* size in bytes of the field (eg sizeof(vector))*/
@@ -1488,13 +2299,22 @@ msg_tag* start_gather_field(
          one of EVEN, ODD or EVENANDODD. */
   char **dest)   /* one of the vectors of pointers */
 {
-  msg_tag *mt;
-
-  mt = declare_strided_gather(field, size, size, index, parity, dest);
-  prepare_gather(mt);
-  do_gather(mt);
+  return start_gather_plan(field, size, size, index, parity, dest);
+}
 
-  return mt;
+// Declare and start a gather from an array of structures,
+// e.g. one component of a Twist_Fermion field
+msg_tag* start_gather_strided(
+  void *field,          /* source buffer aligned to desired field */
+  int stride,           /* bytes between fields in source buffer */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int parity,   /* parity of sites whose neighbors we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  return start_gather_plan(field, stride, size, index, parity, dest);
 }
 // -----------------------------------------------------------------
 
@@ -1638,6 +2458,7 @@ void accumulate_gather(msg_tag **mmtag, msg_tag *mtag) {
     amtag->recv_msgs = NULL;
     amtag->nsends = 0;
     amtag->send_msgs = NULL;
+    amtag->plan = NULL;
     *mmtag = amtag;
   }
   else
@@ -1730,16 +2551,67 @@ void declare_accumulate_gather_field(
      don't clean up, you will eventually run out of space **
 */
 
-struct msg_tmp { int node, count; }; /* temporary structure for keeping track
-          of messages to be sent or received */
-static struct msg_tmp *to_nodes, *from_nodes; /* arrays for messages */
-static int g_gather_flag=0; /* flag to tell if general gather in progress */
-static int tsize;     /* size of entry in messages =2*sizeof(int)+size */
-static char **tdest;     /* tdest is copy of dest */
-/* from_nodes, tsize and tdest are global because they are set in
-   start_general_gather_site() and used in wait_general_gather().  This
-   works because we allow only one general_gather in progress at a
-   time. */
+// The first gather from each displacement makes a new gather with
+// make_gather(), so it must be called on all nodes together
+// Later gathers from the same displacement reuse it,
+// through the same persistent gather plans as start_gather_site()
+// Unlike the nearest-neighbor gathers, no inverse is made
+typedef struct general_gather {
+  int disp[NDIMS];
+  int index;
+  struct general_gather *next;
+} general_gather;
+static general_gather *general_list = NULL;
+
+// Find coordinates of site at displacement args (or -args backwards)
+// Used by make_gather for general gathers
+static void general_coords(
+  int x, int y, int z, int t,       // Coordinates of site
+  int *args,                        // Displacement
+  int fb,                           // Forwards/backwards
+  int *x2p, int *y2p, int *z2p, int *t2p)
+                                    // Pointers to coordinates of neighbor
+{
+  *x2p = (x + fb * args[XUP] + nx) % nx;
+  *y2p = (y + fb * args[YUP] + ny) % ny;
+  *z2p = (z + fb * args[ZUP] + nz) % nz;
+  *t2p = (t + fb * args[TUP] + nt) % nt;
+}
+
+// Return the index of the gather from displacement, making it if necessary
+static int general_index(int *displacement) {
+  int dir, gather_parity;
+  general_gather *g;
+
+  for (g = general_list; g != NULL; g = g->next) {
+    for (dir = XUP; dir <= TUP; dir++) {
+      if (g->disp[dir] != displacement[dir])
+        break;
+    }
+    if (dir > TUP)
+      return g->index;
+  }
+
+  g = malloc(sizeof(*g));
+  if (g == NULL) {
+    printf("general_index: node%d can't malloc gather\n", this_node);
+    terminate(1);
+  }
+  for (dir = XUP; dir <= TUP; dir++)
+    g->disp[dir] = displacement[dir];
+
+  if ((nx&1) || (ny&1) || (nz&1) || (nt&1))
+    gather_parity = SCRAMBLE_PARITY;
+  else if ((g->disp[XUP] + g->disp[YUP] + g->disp[ZUP] + g->disp[TUP]) & 1)
+    gather_parity = SWITCH_PARITY;
+  else
+    gather_parity = SAME_PARITY;
+  g->index = make_gather(general_coords, g->disp, NO_INVERSE,
+                         ALLOW_EVEN_ODD, gather_parity);
+  g->next = general_list;
+  general_list = g;
+  return g->index;
+}
 
 msg_tag* start_general_strided_gather(
   char *field,          /* source buffer aligned to desired field */
@@ -1750,238 +2622,8 @@ msg_tag* start_general_strided_gather(
          one of EVEN, ODD or EVENANDODD. */
   char **dest)   /* one of the vectors of pointers */
 {
-  register int i, j;
-  register site *s;
-  register char *tpt; /* scratch pointer in buffers */
-  int nsites;   /* number of sites in this receive or send */
-  int disp_parity;  /* parity of displacement vector */
-  int send_parity;  /* parity of sites that may be sent */
-  int tx, ty, tz, tt;  /* temporary coordinates */
-  int othernode;    /* node sent to or received from */
-  msg_sr_t *mrecv, *msend;
-  msg_tag *mtag;    /* message tag, to be returned */
-  int n_send_msgs, n_recv_msgs;
-
-  /* check for gather already in progress */
-  if (g_gather_flag != 0) {
-    printf("ERROR: node%d, two general_gathers() at once!\n", mynode());
-    terminate(1);
-  }
-  n_recv_msgs = 0;
-  n_send_msgs = 0;
-  tsize = 2 * sizeof(int) + size;   // Align pointer to double word
-  tdest = dest;
-  /* find parity of sites that may be sent */
-  if ((displacement[XUP] + displacement[YUP] + displacement[ZUP] +
-       displacement[TUP]) % 2 == 0)
-    disp_parity = EVEN;
-  else
-    disp_parity = ODD;
-  switch(parity) {
-    case EVEN:
-      if (disp_parity == EVEN)
-        send_parity = EVEN;
-      else
-        send_parity = ODD;
-      break;
-    case ODD:
-      if (disp_parity == EVEN)
-        send_parity = ODD;
-      else
-        send_parity = EVEN;
-      break;
-    default: // EVENANDODD
-      if (parity != EVENANDODD) {
-  printf("ERROR: bad parity\n");
-  terminate(parity);
-      }
-      send_parity = EVENANDODD;
-      break;
-  }
-
-  /* set pointers in sites whose neighbors are on this node.  (If all
-     neighbors are on this node, this is the only thing done.) Make
-     list of nodes from whom we expect messages */
-  FORSOMEPARITY(i, s, parity) {
-    if (displacement[XUP] != 0)
-      tx = (s->x + displacement[XUP] + nx) % nx;
-    else
-      tx = s->x;
-    if (displacement[YUP] != 0)
-      ty = (s->y + displacement[YUP] + ny) % ny;
-    else
-      ty = s->y;
-    if (displacement[ZUP] != 0)
-      tz = (s->z + displacement[ZUP] + nz) % nz;
-    else
-      tz = s->z;
-    if (displacement[TUP] != 0)
-      tt = (s->t + displacement[TUP] + nt) % nt;
-    else
-      tt = s->t;
-    othernode = node_number(tx, ty, tz, tt);
-    if (othernode == this_node)
-      dest[i] = field + node_index(tx, ty, tz, tt) * stride;
-    else {
-      for (j=0;j<n_recv_msgs;j++) if (from_nodes[j].node==othernode) break;
-      if (j < n_recv_msgs)
-  from_nodes[j].count++;
-      else {
-  if (n_recv_msgs == 0) {
-    from_nodes = malloc(sizeof(*from_nodes));
-    from_nodes[0].node = othernode;
-    from_nodes[0].count = 1;
-    n_recv_msgs++;
-  }
-  else {
-    from_nodes = realloc(from_nodes,
-                         (n_recv_msgs + 1) * sizeof(*from_nodes));
-    from_nodes[j].node = othernode;
-    from_nodes[j].count = 1;
-    n_recv_msgs++;
-  }
-      }
-    }
-  }
-
-  /* scan sites of parity we are sending, make list of nodes to which
-     we must send messages and the number of messages to each. */
-  FORSOMEPARITY(i, s, send_parity) {
-    if (displacement[XUP] != 0)
-      tx = (s->x - displacement[XUP] + nx) % nx;
-    else
-      tx = s->x;
-    if (displacement[YUP] != 0)
-      ty = (s->y - displacement[YUP] + ny) % ny;
-    else
-      ty = s->y;
-    if (displacement[ZUP] != 0)
-      tz = (s->z - displacement[ZUP] + nz) % nz;
-    else
-      tz = s->z;
-    if (displacement[TUP] != 0)
-      tt = (s->t - displacement[TUP] + nt) % nt;
-    else
-      tt = s->t;
-    othernode = node_number(tx, ty, tz, tt);
-    if (othernode != this_node) {
-      for (j = 0; j < n_send_msgs; j++) if (to_nodes[j].node == othernode) break;
-      if (j < n_send_msgs) {
-  to_nodes[j].count++;
-      }
-      else {
-  if (n_send_msgs == 0) {
-    to_nodes = malloc(sizeof(*to_nodes));
-    to_nodes[0].node = othernode;
-    to_nodes[0].count = 1;
-    n_send_msgs++;
-  }
-  else {
-    to_nodes = realloc(to_nodes, (n_send_msgs + 1) * sizeof(*to_nodes));
-    to_nodes[j].node = othernode;
-    to_nodes[j].count = 1;
-    n_send_msgs++;
-  }
-      }
-    }
-  }
-
-  mtag = malloc(sizeof(*mtag));
-  if (n_recv_msgs == 0)
-    mrecv = NULL;
-  else {
-    mrecv = malloc(n_recv_msgs * sizeof(*mrecv));
-    if (mrecv == NULL) {
-      printf("start_general_strided_gather: node%d can't malloc mrecv\n",
-             mynode());
-      terminate(1);
-    }
-  }
-  if (n_send_msgs == 0)
-    msend = NULL;
-  else {
-    msend = malloc(n_send_msgs * sizeof(*msend));
-    if (msend == NULL) {
-      printf("start_general_strided_gather: node%d can't malloc msend\n",
-             mynode());
-      terminate(1);
-    }
-  }
-  mtag->recv_msgs = mrecv;
-  mtag->send_msgs = msend;
-
-  mtag->nrecvs = n_recv_msgs;
-  mtag->nsends = n_send_msgs;
-
-  /* for each node which has neighbors of my sites */
-  for (i = 0; i < n_recv_msgs; i++) {
-    /* allocate buffer to receive neighbors */
-    nsites = from_nodes[i].count;
-    mrecv[i].msg_node = from_nodes[i].node;
-    mrecv[i].msg_size = nsites*tsize;
-    mrecv[i].msg_buf = (char *)malloc(nsites*tsize);
-    if (mrecv[i].msg_buf == NULL) {
-      printf("start_general_strided_gather: node%d can't malloc msg_buf\n",
-             mynode());
-      terminate(1);
-    }
-    /* post receive */
-    MPI_Irecv(mrecv[i].msg_buf, nsites*tsize, MPI_BYTE,
-         from_nodes[i].node, GENERAL_GATHER_ID,
-         MPI_COMM_WORLD, &mrecv[i].msg_req);
-  }
-
-  /* for each node whose neighbors I have */
-  for (i = 0; i < n_send_msgs; i++) {
-    /* Allocate buffer to gather data. */
-    tpt = malloc(to_nodes[i].count * tsize);
-    if (tpt == NULL) {
-      printf("start_general_strided_gather: node%d can't malloc tpt\n",
-             mynode());
-      terminate(1);
-    }
-    msend[i].msg_node = to_nodes[i].node;
-    msend[i].msg_size = to_nodes[i].count*tsize;
-    msend[i].msg_buf = tpt;
-  }
-
-  /* reset to_node counters */
-  for (i = 0; i < n_send_msgs; i++)
-    to_nodes[i].count = 0;
-  /* gather data into the buffers. Each entry in the buffers consists
-     of the index of the site to which the data is sent, followed by
-     the actual data */
-  FORSOMEPARITY(i, s, send_parity) {
-    tx = (s->x - displacement[XUP] + nx) % nx;
-    ty = (s->y - displacement[YUP] + ny) % ny;
-    tz = (s->z - displacement[ZUP] + nz) % nz;
-    tt = (s->t - displacement[TUP] + nt) % nt;
-    othernode = node_number(tx, ty, tz, tt);
-    if (othernode != this_node) {
-      for (j = 0; j < n_send_msgs; j++) if (to_nodes[j].node == othernode) break;
-      tpt = msend[j].msg_buf + to_nodes[j].count*tsize;
-      *(int *)tpt = node_index(tx, ty, tz, tt);
-      /* index of site on other node */
-      memcpy(tpt + 2 * sizeof(int), field + i * stride, size);
-      to_nodes[j].count++;
-    }
-  }
-
-  /* start the sends */
-  for (i = 0; i < n_send_msgs; i++) {
-    nsites = to_nodes[i].count;
-    MPI_Isend(msend[i].msg_buf, nsites*tsize, MPI_BYTE,
-              to_nodes[i].node, GENERAL_GATHER_ID,
-              MPI_COMM_WORLD, &msend[i].msg_req);
-  }
-
-  /* free temporary arrays */
-  if (n_send_msgs > 0)
-    free(to_nodes);
-  /* mark gather in progress and return */
-  g_gather_flag = 1;
-
-  return mtag;
+  return start_gather_plan(field, stride, size, general_index(displacement),
+                           parity, dest);
 }
 
 msg_tag* start_general_gather_site(
@@ -2010,40 +2652,11 @@ msg_tag* start_general_gather_field(
 
 // Wait for a general gather to complete
 void wait_general_gather(msg_tag *mtag) {
-  int i, j, k;
-  MPI_Status status;
-
-  g_gather_flag = 0;
-  for (i = 0; i < mtag->nrecvs; i++) {
-    MPI_Wait(&mtag->recv_msgs[i].msg_req, &status);
-    /* set pointers in sites to correct location */
-    for (j=0; j<from_nodes[i].count; j++) {
-      /* k = index of site on this node, sent in message */
-      k = *(int *)(mtag->recv_msgs[i].msg_buf + j*tsize);
-      tdest[k] = mtag->recv_msgs[i].msg_buf + j*tsize + 2*sizeof(int);
-    }
-  }
-  if (i > 0)
-    free(from_nodes);
+  wait_gather(mtag);
 }
 
-// Free memory associated with general gather
+// Return a general gather to the pool of persistent plans
 void cleanup_general_gather(msg_tag *mtag) {
-  int i;
-  MPI_Status status;
-
-  /* free all receive buffers */
-  for (i = 0; i < mtag->nrecvs; i++) {
-    free(mtag->recv_msgs[i].msg_buf);
-  }
-  /* wait for all send messages, free all send buffers */
-  for (i = 0; i < mtag->nsends; i++) {
-    MPI_Wait(&mtag->send_msgs[i].msg_req, &status);
-    free(mtag->send_msgs[i].msg_buf);
-  }
-  /* free the msg_tag buffer */
-  free(mtag->recv_msgs);
-  free(mtag->send_msgs);
-  free(mtag);
+  cleanup_gather(mtag);
 }
 // -----------------------------------------------------------------
@@ -0,0 +1,1688 @@
+// -----------------------------------------------------------------
+// Communications routines with POSIX threads as ranks
+// Every rank is a thread of a single process, running main() with its own
+// copy of the variables declared RANK_LOCAL (see ../include/config.h)
+// The number of ranks is given by the THREAD_RANKS environment variable,
+// with a single rank by default
+// Since all ranks share the same memory, gathers never copy anything:
+// gen_pt points straight at the field on the rank holding the neighbor
+// As with -DSHM_GATHER in com_mpi.c, the source field must not change
+// between the start of a gather and its cleanup, which only returns
+// once all other ranks have finished reading from the field
+// Reductions and broadcasts synchronize through shared atomic counters,
+// then combine the values of all ranks in rank order, so that every rank
+// gets the same reproducible result
+// Exported functions:
+// initialize_machine()   Start the ranks and do machine dependent setup
+// normal_exit()          Close communications and exit
+// terminate()            Halt program abruptly and exit
+// machine_type()         Return string describing communications architecture
+// mynode()               Return node number of this node
+// numnodes()             Return number of nodes
+// g_sync()               Provide a synchronization point for all nodes
+// g_floatsum()           Sum a Real over all nodes
+// g_vecfloatsum()        Sum a vector of Reals over all nodes
+// g_doublesum()          Sum a double over all nodes
+// g_vecdoublesum()       Sum a vector of doubles over all nodes
+// g_vecdoublesum_start() Sum a vector of doubles over all nodes,
+//                          with the results returned by g_sum_wait()
+// g_sum_wait()           Finish a sum started by g_vecdoublesum_start()
+//                          or g_sum_start()
+// g_complexsum()         Sum a generic precision complex number over all nodes
+// g_veccomplexsum()      Sum a vector of generic precision complex numbers
+//                          over all nodes
+// g_dcomplexsum()        Sum a double precision complex number over all nodes
+// g_vecdcomplexsum()     Sum a vector of double_complex over all nodes
+// g_floatsum_add()       Queue a Real to be summed over all nodes
+// g_doublesum_add()      Queue a double to be summed over all nodes
+// g_complexsum_add()     Queue a generic precision complex number
+// g_dcomplexsum_add()    Queue a double precision complex number
+// g_sum_start()          Sum everything queued
+// g_xor32()              Find global exclusive or of 32-bit word
+// g_floatmax()           Find maximum Real over all nodes
+// g_doublemax()          Find maximum double over all nodes
+// broadcast_float()      Broadcast a generic precision number from
+//                          node 0 to all nodes
+// broadcast_double()     Broadcast a double precision number
+// broadcast_complex()    Broadcast a generic precision complex number
+// broadcast_dcomplex()   Broadcast a double precision complex number
+// broadcast_bytes()      Broadcast a number of bytes
+// send_integer()         Send an integer to one other node
+// receive_integer()      Receive an integer
+// send_field()           Send a field to one other node
+// get_field()            Receive a field from some other node
+// dclock()               Return a double precision time, with arbitrary zero
+// time_stamp()           Print wall clock time with message
+// sort_eight_gathers()   Sort eight contiguous gathers
+//                          from XUP, XDOWN, YUP, YDOWN, ...
+//                          to XUP, YUP, ..., XDOWN, YDOWN, ...
+// make_nn_gathers()      Make all necessary lists for communications with
+//                          nodes containing neighbor sites
+// make_gather()          Calculate and store necessary communications lists
+//                          for a given gather mapping
+// declare_gather_site()  Create a message tag that defines specific
+//                          details of a site gather to be used later
+// declare_gather_field() Create a message tag that defines specific
+//                          details of a field gather to be used later
+// prepare_gather()       Nothing to allocate, kept for compatibility
+// do_gather()            Tell the other ranks where to find the source field
+// wait_gather()          Wait for the ranks holding the neighbors
+//                          and point to their fields
+// cleanup_gather()       Wait for the ranks reading from this one
+//                          and free the message tag
+//                          NB: The gathered data may soon disappear
+// rebind_gather()        Point a declared gather at another field
+//                          with the same layout, to do it again
+// release_gather()       Wait for the ranks reading from this one,
+//                          keeping the message tag to do the gather again
+// accumulate_gather()    Combine gathers into single message tag
+// declare_accumulate_gather_site()
+//                        Do declare_gather_site() and accumulate_gather()
+//                          in single step
+// declare_accumulate_gather_field()
+//                        Do declare_gather_field() and accumulate_gather()
+//                          in single step
+// start_gather_site()    Declare/prepare/do site gather in a single step
+// start_gather_field()   Declare/prepare/do field gather in a single step
+// start_general_gather_site()
+//                        Start gathering site data at arbitrary displacement
+// start_general_gather_field()
+//                        Start gathering field data at arbitrary displacement
+// wait_general_gather()  Wait for the ranks holding the neighbors
+//                          and point to their fields
+// cleanup_general_gather()
+//                        Wait for the ranks reading from this one
+//                          NB: the gathered data may soon disappear
+// gather_stats()         Number of fields read by other ranks, with no bytes
+// malloc_shared()        Allocate a field, just with malloc()
+// free_shared()          Free a field allocated by malloc_shared()
+#include <time.h>
+#include "generic_includes.h"
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define NOWHERE -1  // Not an index in array of fields
+
+// Gathers that each rank may have in progress at once
+#define MAX_GATHERS 1024
+
+// Types of point-to-point messages
+#define SEND_INTEGER_ID 1
+#define SEND_FIELD_ID   2
+
+// The ranks run the main() of the program
+int main(int argc, char *argv[]);
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Internal data types
+// Structure to hold all necessary info for a gather
+// Sites whose neighbors are on other ranks are listed in order,
+// so that the first n_remote_even of them are the even sites
+// Lists of ranks are kept for EVEN, ODD and EVENANDODD sites
+typedef struct gather_t {
+  int *neighbor;      // Index of the neighbor on this rank, or NOWHERE
+  int n_remote, n_remote_even;
+  int *site;          // Sites on this rank with neighbors elsewhere
+  int *rank, *index;  // Rank holding each of these neighbors and its index
+  int n_src[3];       // Number of ranks holding neighbors
+  int *src[3];        // List of these ranks
+  int n_readers[3];   // Number of ranks with neighbors on this rank
+} gather_t;
+
+// One gather from a source field, within a message tag
+typedef struct {
+  char *field;        // Source field on this rank
+  int stride;         // Bytes between fields in source buffer
+  int index;          // Gather to use
+  int subl;           // 0, 1 or 2 for EVEN, ODD or EVENANDODD
+  char **dest;        // Where to put the pointers to neighbors
+  int seq;            // Sequence number given by do_gather()
+} gather_part;
+
+struct msg_tag {
+  int n;              // Number of gathers combined in this tag
+  gather_part *part;
+  int started;        // do_gather() called, cleanup not yet done
+};
+
+// Each rank posts the field of each gather it does in its next slot,
+// where the other ranks find it once seq is set
+// The slot stays busy until the rank cleans up the gather,
+// which waits for done to reach the number of ranks reading the field
+typedef struct {
+  int seq;
+  int done;
+  int busy;
+  char *field;
+} gather_slot;
+
+// Point-to-point message waiting to be received
+typedef struct message {
+  int from, type, size;
+  char *buf;
+  struct message *next;
+} message;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t arrived;
+  message *first, *last;
+} mailbox;
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Variables shared by all ranks, set up before they start
+static int n_ranks = 1;
+static int saved_argc;
+static char **saved_argv;
+static int exit_status = 0;
+static pthread_t *rank_thread;
+
+// Barrier, with a count of ranks arriving and the number of times passed
+static int barrier_count = 0, barrier_gen = 0;
+
+// Values of each rank to reduce or broadcast
+static void **reduce_pt;
+
+// Slots for MAX_GATHERS gathers from each rank
+static gather_slot *slot_table;
+
+// For each pair of ranks, whether the first reads from the second
+// in the EVEN, ODD and EVENANDODD gathers being made
+static int *read_table;
+
+// Messages for each rank
+static mailbox *mail;
+
+// Variables for each rank
+// my_rank stays -1 in the thread that starts the ranks
+static RANK_LOCAL int my_rank = -1;
+static RANK_LOCAL gather_t *gather_array;
+
+// Number of gathers (mappings) that have been set up
+static RANK_LOCAL int n_gathers, gather_array_len;
+
+// Gathers done so far by this rank, and the fields read in wait_gather()
+static RANK_LOCAL int gather_seq = 0;
+static RANK_LOCAL char **src_field;
+
+// Fields read by other ranks, reported by gather_stats()
+static RANK_LOCAL double gather_msgs = 0.0;
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Synchronization through shared atomics
+// Let the other ranks run while waiting for them
+static void spin() {
+  sched_yield();
+}
+
+// The last rank to arrive resets the count and lets the others go
+// Values written before the barrier are seen by all ranks after it
+static void barrier() {
+  int gen = __atomic_load_n(&barrier_gen, __ATOMIC_ACQUIRE);
+
+  if (__atomic_add_fetch(&barrier_count, 1, __ATOMIC_ACQ_REL) == n_ranks) {
+    __atomic_store_n(&barrier_count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&barrier_gen, gen + 1, __ATOMIC_RELEASE);
+  }
+  else {
+    while (__atomic_load_n(&barrier_gen, __ATOMIC_ACQUIRE) == gen)
+      spin();
+  }
+}
+
+// Combine the n values of size bytes at pt over all ranks, in rank order
+// op(out, in, n) combines in into out
+static void combine(void *pt, int n, int size,
+                    void (*op)(void *out, void *in, int n)) {
+  int r;
+  char *work = malloc(n * size);
+
+  if (work == NULL) {
+    printf("combine: node%d can't malloc work\n", my_rank);
+    terminate(1);
+  }
+  reduce_pt[my_rank] = pt;
+  barrier();
+  memcpy(work, reduce_pt[0], n * size);
+  for (r = 1; r < n_ranks; r++)
+    op(work, reduce_pt[r], n);
+  barrier();
+  memcpy(pt, work, n * size);
+  free(work);
+}
+
+static void sum_int(void *out, void *in, int n) {
+  int i;
+  for (i = 0; i < n; i++)
+    ((int *)out)[i] += ((int *)in)[i];
+}
+
+static void sum_uint32(void *out, void *in, int n) {
+  int i;
+  for (i = 0; i < n; i++)
+    ((u_int32type *)out)[i] += ((u_int32type *)in)[i];
+}
+
+static void xor_uint32(void *out, void *in, int n) {
+  int i;
+  for (i = 0; i < n; i++)
+    ((u_int32type *)out)[i] ^= ((u_int32type *)in)[i];
+}
+
+static void sum_real(void *out, void *in, int n) {
+  int i;
+  for (i = 0; i < n; i++)
+    ((Real *)out)[i] += ((Real *)in)[i];
+}
+
+static void sum_double(void *out, void *in, int n) {
+  int i;
+  for (i = 0; i < n; i++)
+    ((double *)out)[i] += ((double *)in)[i];
+}
+
+static void max_real(void *out, void *in, int n) {
+  int i;
+  for (i = 0; i < n; i++) {
+    if (((Real *)in)[i] > ((Real *)out)[i])
+      ((Real *)out)[i] = ((Real *)in)[i];
+  }
+}
+
+static void max_double(void *out, void *in, int n) {
+  int i;
+  for (i = 0; i < n; i++) {
+    if (((double *)in)[i] > ((double *)out)[i])
+      ((double *)out)[i] = ((double *)in)[i];
+  }
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Basic communications functions
+// Each rank runs main() from the start, returning to exit the thread
+static void* run_rank(void *arg) {
+  int status;
+
+  my_rank = (int)(long)arg;
+  status = main(saved_argc, saved_argv);
+  if (my_rank == 0)
+    exit_status = status;
+  return NULL;
+}
+
+// Machine initialization
+// The first call starts the ranks, and exits once they are all done
+// The ranks then call it again from main() to set up their own tables
+void initialize_machine(int *argc, char ***argv) {
+  int i;
+  char *env;
+  pthread_attr_t attr;
+  struct rlimit limit;
+
+  if (my_rank >= 0) {
+    n_gathers = 0;
+    gather_array_len = 0;
+    gather_array = NULL;
+    src_field = malloc(n_ranks * sizeof(*src_field));
+    if (src_field == NULL) {
+      printf("initialize_machine: node%d can't malloc src_field\n", my_rank);
+      terminate(1);
+    }
+    return;
+  }
+
+  // Check if 32-bit int is set correctly
+#ifdef SHORT_IS_32BIT
+  if (sizeof(unsigned short) != 4) {
+    printf("node%d: SHORT_IS_32BIT is set but sizeof(unsigned short) = %d\n",
+           mynode(), sizeof(unsigned short));
+    exit(1);
+  }
+#else
+  if (sizeof(unsigned int) != 4) {
+    printf("node%d: SHORT_IS_32BIT is not set but sizeof(unsigned int) = %d\n",
+           mynode(), (int)sizeof(unsigned int));
+    exit(1);
+  }
+#endif
+
+  env = getenv("THREAD_RANKS");
+  if (env != NULL)
+    n_ranks = atoi(env);
+  if (n_ranks < 1) {
+    printf("initialize_machine: bad number of ranks THREAD_RANKS=%s\n", env);
+    exit(1);
+  }
+
+  rank_thread = malloc(n_ranks * sizeof(*rank_thread));
+  reduce_pt = malloc(n_ranks * sizeof(*reduce_pt));
+  slot_table = malloc(n_ranks * MAX_GATHERS * sizeof(*slot_table));
+  read_table = malloc(n_ranks * n_ranks * 3 * sizeof(*read_table));
+  mail = malloc(n_ranks * sizeof(*mail));
+  if (rank_thread == NULL || reduce_pt == NULL || slot_table == NULL
+      || read_table == NULL || mail == NULL) {
+    printf("initialize_machine: can't malloc tables for %d ranks\n", n_ranks);
+    exit(1);
+  }
+  for (i = 0; i < n_ranks * MAX_GATHERS; i++) {
+    slot_table[i].seq = -1;
+    slot_table[i].busy = 0;
+  }
+  for (i = 0; i < n_ranks; i++) {
+    pthread_mutex_init(&mail[i].lock, NULL);
+    pthread_cond_init(&mail[i].arrived, NULL);
+    mail[i].first = NULL;
+    mail[i].last = NULL;
+  }
+
+  // Give each rank as much stack as the main thread
+  saved_argc = *argc;
+  saved_argv = *argv;
+  pthread_attr_init(&attr);
+  if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+    pthread_attr_setstacksize(&attr, limit.rlim_cur);
+  for (i = 0; i < n_ranks; i++) {
+    if (pthread_create(&rank_thread[i], &attr, run_rank, (void *)(long)i)) {
+      printf("initialize_machine: can't start rank %d\n", i);
+      exit(1);
+    }
+  }
+  for (i = 0; i < n_ranks; i++)
+    pthread_join(rank_thread[i], NULL);
+  exit(exit_status);
+}
+
+static void free_sums();
+
+// Normal exit: end this rank, and the program once all ranks are done
+void normal_exit(int status) {
+  time_stamp("exit");
+  g_sync();
+  free_sums();
+  if (my_rank == 0)
+    exit_status = status;
+  fflush(stdout);
+  pthread_exit(NULL);
+}
+
+// Terminate all ranks at once
+void terminate(int status) {
+  time_stamp("termination");
+  printf("Termination: node%d, status = %d\n", this_node, status);
+  fflush(NULL);
+  _exit(status);
+}
+
+// Tell what kind of machine we are on
+static char name[]="POSIX threads as ranks";
+char* machine_type() {
+  return name;
+}
+
+// Return this node number
+int mynode() {
+  return my_rank;
+}
+
+// Return number of nodes
+int numnodes() {
+  return n_ranks;
+}
+
+// Synchronize all nodes
+void g_sync() {
+  barrier();
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Global sums
+// Sum signed integer over all nodes
+void g_intsum(int *ipt) {
+  combine(ipt, 1, sizeof(int), sum_int);
+}
+
+// Sum unsigned 32-bit integer type
+void g_uint32sum(u_int32type *pt) {
+  combine(pt, 1, sizeof(u_int32type), sum_uint32);
+}
+
+// Sum Real over all nodes
+void g_floatsum(Real *fpt) {
+  combine(fpt, 1, sizeof(Real), sum_real);
+}
+
+// Sum a vector of Reals over all nodes
+void g_vecfloatsum(Real *fpt, int length) {
+  combine(fpt, length, sizeof(Real), sum_real);
+}
+
+// Sum double over all nodes
+void g_doublesum(double *dpt) {
+  combine(dpt, 1, sizeof(double), sum_double);
+}
+
+// Sum a vector of doubles over all nodes
+void g_vecdoublesum(double *dpt, int length) {
+  combine(dpt, length, sizeof(double), sum_double);
+}
+
+// The ranks are never far apart, so g_vecdoublesum_start() and
+// g_sum_start() do the whole sum, leaving g_sum_wait() to return
+// any queued sums and free the tag
+typedef struct {
+  void *pt;
+  int type;
+} sum_entry;
+
+struct sum_tag {
+  int n;              // Number of queued sums to return
+  sum_entry *entry;
+  double *buf;
+};
+
+sum_tag* g_vecdoublesum_start(double *dpt, int length) {
+  sum_tag *tag = malloc(sizeof(*tag));
+
+  if (tag == NULL) {
+    printf("g_vecdoublesum_start: node%d can't malloc tag\n", my_rank);
+    terminate(1);
+  }
+  tag->n = 0;
+  tag->entry = NULL;
+  tag->buf = NULL;
+  g_vecdoublesum(dpt, length);
+  return tag;
+}
+
+// Sum complex over all nodes
+void g_complexsum(complex *cpt) {
+  combine(cpt, 2, sizeof(Real), sum_real);
+}
+
+// Sum a vector of complex over all nodes
+void g_veccomplexsum(complex *cpt, int length) {
+  combine(cpt, 2 * length, sizeof(Real), sum_real);
+}
+
+// Sum double_complex over all nodes
+void g_dcomplexsum(double_complex *cpt) {
+  combine(cpt, 2, sizeof(double), sum_double);
+}
+
+// Sum a vector of double_complex over all nodes
+void g_vecdcomplexsum(double_complex *cpt, int length) {
+  combine(cpt, 2 * length, sizeof(double), sum_double);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Batched global sums
+// g_floatsum_add(), g_doublesum_add(), g_complexsum_add() and
+// g_dcomplexsum_add() queue a sum without doing it,
+// g_sum_start() then does all queued sums as a single reduction,
+// and g_sum_wait() returns the results to the queued addresses
+// Values are read by g_sum_start() and are summed in double precision
+// The queued variables must not be touched until g_sum_wait() returns
+#define SUM_REAL     0
+#define SUM_DOUBLE   1
+#define SUM_COMPLEX  2
+#define SUM_DCOMPLEX 3
+static RANK_LOCAL sum_entry *sum_queue = NULL;
+static RANK_LOCAL int n_queue = 0, max_queue = 0;
+// Persistent tag for g_sum_start(), with the sizes of its arrays
+static RANK_LOCAL sum_tag batch_tag;
+static RANK_LOCAL int max_entry = 0, max_buf = 0, batch_pending = 0;
+
+static void queue_sum(void *pt, int type) {
+  if (n_queue == max_queue) {
+    max_queue += 16;
+    sum_queue = realloc(sum_queue, max_queue * sizeof(*sum_queue));
+    if (sum_queue == NULL) {
+      printf("queue_sum: node%d can't realloc sum_queue\n", my_rank);
+      terminate(1);
+    }
+  }
+  sum_queue[n_queue].pt = pt;
+  sum_queue[n_queue].type = type;
+  n_queue++;
+}
+
+void g_floatsum_add(Real *fpt) {
+  queue_sum(fpt, SUM_REAL);
+}
+
+void g_doublesum_add(double *dpt) {
+  queue_sum(dpt, SUM_DOUBLE);
+}
+
+void g_complexsum_add(complex *cpt) {
+  queue_sum(cpt, SUM_COMPLEX);
+}
+
+void g_dcomplexsum_add(double_complex *cpt) {
+  queue_sum(cpt, SUM_DCOMPLEX);
+}
+
+// Pack the queued values and sum them
+// The queue is swapped with the entries of a single persistent tag,
+// whose buffer only grows, so only one g_sum_start() may be pending
+sum_tag* g_sum_start() {
+  int i, length = 0, max;
+  sum_tag *tag = &batch_tag;
+  sum_entry *entry;
+  double *buf;
+
+  if (batch_pending) {
+    printf("g_sum_start: node%d already has a sum pending\n", my_rank);
+    terminate(1);
+  }
+  if (2 * n_queue + 1 > max_buf) {
+    max_buf = 2 * n_queue + 1;
+    tag->buf = realloc(tag->buf, max_buf * sizeof(*(tag->buf)));
+    if (tag->buf == NULL) {
+      printf("g_sum_start: node%d can't realloc buf\n", my_rank);
+      terminate(1);
+    }
+  }
+  buf = tag->buf;
+  for (i = 0; i < n_queue; i++) {
+    switch (sum_queue[i].type) {
+      case SUM_REAL:
+        buf[length++] = *(Real *)sum_queue[i].pt;
+        break;
+      case SUM_DOUBLE:
+        buf[length++] = *(double *)sum_queue[i].pt;
+        break;
+      case SUM_COMPLEX:
+        buf[length++] = ((complex *)sum_queue[i].pt)->real;
+        buf[length++] = ((complex *)sum_queue[i].pt)->imag;
+        break;
+      case SUM_DCOMPLEX:
+        buf[length++] = ((double_complex *)sum_queue[i].pt)->real;
+        buf[length++] = ((double_complex *)sum_queue[i].pt)->imag;
+        break;
+    }
+  }
+  entry = tag->entry;
+  max = max_entry;
+  tag->n = n_queue;
+  tag->entry = sum_queue;
+  max_entry = max_queue;
+  sum_queue = entry;
+  max_queue = max;
+  n_queue = 0;
+  batch_pending = 1;
+  g_vecdoublesum(tag->buf, length);
+  return tag;
+}
+
+// Return any queued sums and free the tag unless it is the persistent one
+void g_sum_wait(sum_tag *tag) {
+  int i, j = 0;
+  double *buf = tag->buf;
+
+  for (i = 0; i < tag->n; i++) {
+    switch (tag->entry[i].type) {
+      case SUM_REAL:
+        *(Real *)tag->entry[i].pt = (Real)buf[j++];
+        break;
+      case SUM_DOUBLE:
+        *(double *)tag->entry[i].pt = buf[j++];
+        break;
+      case SUM_COMPLEX:
+        ((complex *)tag->entry[i].pt)->real = (Real)buf[j++];
+        ((complex *)tag->entry[i].pt)->imag = (Real)buf[j++];
+        break;
+      case SUM_DCOMPLEX:
+        ((double_complex *)tag->entry[i].pt)->real = buf[j++];
+        ((double_complex *)tag->entry[i].pt)->imag = buf[j++];
+        break;
+    }
+  }
+  if (tag == &batch_tag)
+    batch_pending = 0;
+  else
+    free(tag);
+}
+
+// Free the queue and the persistent tag arrays at exit
+static void free_sums() {
+  free(sum_queue);
+  free(batch_tag.entry);
+  free(batch_tag.buf);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Global xor and maxima
+// Global exclusive or acting on u_int32type, for checksums
+void g_xor32(u_int32type *pt) {
+  combine(pt, 1, sizeof(u_int32type), xor_uint32);
+}
+
+// Find maximum of Real over all nodes
+void g_floatmax(Real *fpt) {
+  combine(fpt, 1, sizeof(Real), max_real);
+}
+
+// Find maximum of double over all nodes
+void g_doublemax(double *dpt) {
+  combine(dpt, 1, sizeof(double), max_double);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Broadcasts
+// Broadcast Real from node zero
+void broadcast_float(Real *fpt) {
+  broadcast_bytes((char *)fpt, sizeof(Real));
+}
+
+// Broadcast double from node zero
+void broadcast_double(double *dpt) {
+  broadcast_bytes((char *)dpt, sizeof(double));
+}
+
+// Broadcast generic precision complex number from node zero
+void broadcast_complex(complex *cpt) {
+  broadcast_bytes((char *)cpt, sizeof(complex));
+}
+
+// Broadcast double precision complex number from node zero
+void broadcast_dcomplex(double_complex *cpt) {
+  broadcast_bytes((char *)cpt, sizeof(double_complex));
+}
+
+// Broadcast bytes from node 0 to all others
+// Node 0 waits for the others to copy them before going on
+void broadcast_bytes(char *buf, int size) {
+  if (my_rank == 0)
+    reduce_pt[0] = buf;
+  barrier();
+  if (my_rank != 0)
+    memcpy(buf, reduce_pt[0], size);
+  barrier();
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Point-to-point messages
+// The sender copies the message into the mailbox of the receiver
+// and goes on, while the receiver waits for the first message
+// of the right type from the right rank
+static void send_message(char *buf, int size, int type, int tonode) {
+  message *m = malloc(sizeof(*m));
+
+  if (m == NULL || (m->buf = malloc(size)) == NULL) {
+    printf("send_message: node%d can't malloc message\n", my_rank);
+    terminate(1);
+  }
+  m->from = my_rank;
+  m->type = type;
+  m->size = size;
+  m->next = NULL;
+  memcpy(m->buf, buf, size);
+
+  pthread_mutex_lock(&mail[tonode].lock);
+  if (mail[tonode].last == NULL)
+    mail[tonode].first = m;
+  else
+    mail[tonode].last->next = m;
+  mail[tonode].last = m;
+  pthread_cond_broadcast(&mail[tonode].arrived);
+  pthread_mutex_unlock(&mail[tonode].lock);
+}
+
+static void receive_message(char *buf, int size, int type, int fromnode) {
+  mailbox *box = &mail[my_rank];
+  message *m, *prev;
+
+  pthread_mutex_lock(&box->lock);
+  while (1) {
+    for (prev = NULL, m = box->first; m != NULL; prev = m, m = m->next) {
+      if (m->from == fromnode && m->type == type)
+        break;
+    }
+    if (m != NULL)
+      break;
+    pthread_cond_wait(&box->arrived, &box->lock);
+  }
+  if (prev == NULL)
+    box->first = m->next;
+  else
+    prev->next = m->next;
+  if (box->last == m)
+    box->last = prev;
+  pthread_mutex_unlock(&box->lock);
+
+  if (m->size != size) {
+    printf("receive_message: node%d expected %d bytes from node%d, got %d\n",
+           my_rank, size, fromnode, m->size);
+    terminate(1);
+  }
+  memcpy(buf, m->buf, size);
+  free(m->buf);
+  free(m);
+}
+
+// Send an integer to one other node
+// To be called only by the node doing the sending
+void send_integer(int tonode, int *address) {
+  send_message((char *)address, sizeof(int), SEND_INTEGER_ID, tonode);
+}
+
+// Receive an integer from another node
+void receive_integer(int fromnode, int *address) {
+  receive_message((char *)address, sizeof(int), SEND_INTEGER_ID, fromnode);
+}
+
+// Send a field to one other node
+// To be called only by the node doing the sending
+void send_field(char *buf, int size, int tonode) {
+  send_message(buf, size, SEND_FIELD_ID, tonode);
+}
+
+// To be called only by the node to which the field was sent
+void get_field(char *buf, int size, int fromnode) {
+  receive_message(buf, size, SEND_FIELD_ID, fromnode);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Timing routines
+// Double precision CPU time in seconds
+// This is the time used by all ranks together
+double dclock_cpu() {
+  long fine;
+  fine = clock();
+  return (((double)fine) / CLOCKS_PER_SEC);
+}
+
+// Double precision wall clock time in seconds
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+double dclock() {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return ((double)tp.tv_sec + (double)tp.tv_usec * 1.e-6);
+}
+#else
+double dclock() {
+  return dclock_cpu();
+}
+#endif
+
+// Print time stamp
+void time_stamp(char *msg) {
+  time_t time_stamp;
+
+  if (mynode() == 0) {
+    time(&time_stamp);
+    printf("%s: %s\n", msg, ctime(&time_stamp));
+    fflush(stdout);
+  }
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Functions used for gathers
+// Sort a list of eight gather_t structures into the order we want:
+// XUP, YUP, ZUP, TUP, TDOWN, ZDOWN, YDOWN, XDOWN
+// Start from the index for the first pointer
+void sort_eight_gathers(int index) {
+  gather_t tt[8];
+  int i;
+
+  for (i = 0; i < 8; i++)
+    memcpy(&tt[i], &gather_array[index + i], sizeof(gather_t));
+  FORALLUPDIR(i) {
+    memcpy(&gather_array[index + i], &tt[2 * i], sizeof(gather_t));
+    memcpy(&gather_array[index + OPP_DIR(i)],
+           &tt[2 * i + 1], sizeof(gather_t));
+  }
+}
+
+// Find coordinates of neighbor
+// Used by make_gather for nearest neighbor gathers
+static void neighbor_coords_special(
+  int x, int y, int z, int t,       // Coordinates of site
+  int *dirpt,                       // Direction (eg XUP)
+  int fb,                           // Forwards/backwards
+  int *x2p, int *y2p, int *z2p, int *t2p)
+                                    // Pointers to coordinates of neighbor
+{
+  int dir;
+
+  dir = (fb==FORWARDS) ? *dirpt : OPP_DIR(*dirpt);
+  *x2p = x;
+  *y2p = y;
+  *z2p = z;
+  *t2p = t;
+  switch(dir) {
+    case XUP   : *x2p = (x + 1) % nx;       break;
+    case XDOWN : *x2p = (x + nx - 1) % nx;  break;
+    case YUP   : *y2p = (y + 1) % ny;       break;
+    case YDOWN : *y2p = (y + ny - 1) % ny;  break;
+    case ZUP   : *z2p = (z + 1) % nz;       break;
+    case ZDOWN : *z2p = (z + nz - 1) % nz;  break;
+    case TUP   : *t2p = (t + 1) % nt;       break;
+    case TDOWN : *t2p = (t + nt - 1) % nt;  break;
+    default: printf("BOTCH: bad direction\n"); terminate(1);
+  }
+}
+
+// Set up the tables needed by nearest neighbor gather routines
+// make_lattice() must be called first
+void make_nn_gathers() {
+  int i, gather_parity;
+
+  if (n_gathers != 0) {
+    printf("error: make_nn_gathers must come before any make_gather\n");
+    terminate(1);
+  }
+
+  gather_array_len = 8;
+  gather_array = malloc(gather_array_len * sizeof(*gather_array));
+  if (gather_array == NULL) {
+    printf("make_nn_gathers: node%d can't malloc gather_array\n", this_node);
+    terminate(1);
+  }
+
+  if ((nx&1) || (ny&1) || (nz&1) || (nt&1))
+    gather_parity = SCRAMBLE_PARITY;
+  else
+    gather_parity = SWITCH_PARITY;
+
+  FORALLUPDIR(i) {
+    make_gather(neighbor_coords_special, &i, WANT_INVERSE,
+                ALLOW_EVEN_ODD, gather_parity);
+  }
+
+  /* Sort into the order we want for nearest neighbor gathers,
+     so you can use XUP, XDOWN, etc. as argument in calling them. */
+  sort_eight_gathers(0);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Functions used to make gathers
+static int parity_function(int x, int y, int z, int t) {
+  return (x + y + z + t)&1;
+}
+
+// Find the neighbors of the sites on this rank in direction fb,
+// then count the ranks reading from this one
+// Called by all ranks together
+static void make_lists(gather_t *gt,
+  void (*func)(int, int, int, int, int*, int, int*, int*, int*, int*),
+  int *args, int fb)
+{
+  int i, n = 0, r, subl, *reads;
+  site *s;
+  int x, y, z, t;
+
+  gt->neighbor = malloc(sites_on_node * sizeof(int));
+  gt->site = malloc(sites_on_node * sizeof(int));
+  gt->rank = malloc(sites_on_node * sizeof(int));
+  gt->index = malloc(sites_on_node * sizeof(int));
+  if (gt->neighbor == NULL || gt->site == NULL
+      || gt->rank == NULL || gt->index == NULL) {
+    printf("make_gather: node%d no room for neighbor lists\n", my_rank);
+    terminate(1);
+  }
+
+  // Row of read_table for this rank
+  reads = read_table + my_rank * n_ranks * 3;
+  for (i = 0; i < n_ranks * 3; i++)
+    reads[i] = 0;
+
+  gt->n_remote_even = 0;
+  FORALLSITES(i, s) {
+    func(s->x, s->y, s->z, s->t, args, fb, &x, &y, &z, &t);
+    r = node_number(x, y, z, t);
+    if (r == my_rank) {
+      gt->neighbor[i] = node_index(x, y, z, t);
+      continue;
+    }
+    gt->neighbor[i] = NOWHERE;
+    gt->site[n] = i;
+    gt->rank[n] = r;
+    gt->index[n] = node_index(x, y, z, t);
+    n++;
+    if (i < even_sites_on_node) {
+      gt->n_remote_even = n;
+      reads[3 * r] = 1;
+    }
+    else
+      reads[3 * r + 1] = 1;
+    reads[3 * r + 2] = 1;
+  }
+  gt->n_remote = n;
+
+  for (subl = 0; subl < 3; subl++) {
+    gt->src[subl] = malloc(n_ranks * sizeof(int));
+    if (gt->src[subl] == NULL) {
+      printf("make_gather: node%d no room for src\n", my_rank);
+      terminate(1);
+    }
+    gt->n_src[subl] = 0;
+    for (r = 0; r < n_ranks; r++) {
+      if (reads[3 * r + subl])
+        gt->src[subl][gt->n_src[subl]++] = r;
+    }
+  }
+
+  // Wait for all rows of read_table, then count this column
+  barrier();
+  for (subl = 0; subl < 3; subl++) {
+    gt->n_readers[subl] = 0;
+    for (r = 0; r < n_ranks; r++)
+      gt->n_readers[subl] += read_table[(r * n_ranks + my_rank) * 3 + subl];
+  }
+  barrier();
+}
+
+// Add another gather to the list of tables
+int make_gather(
+  void (*func)(int, int, int, int, int*, int, int*, int*, int*, int*),
+                        /* function which defines sites to gather from */
+  int *args,    /* list of arguments, to be passed to function */
+  int inverse,    /* OWN_INVERSE, WANT_INVERSE, or NO_INVERSE */
+  int want_even_odd,  /* ALLOW_EVEN_ODD or NO_EVEN_ODD */
+  int parity_conserve)  /* {SAME,SWITCH,SCRAMBLE}_PARITY */
+{
+  int i, subl;
+  site *s;
+  int dir, x, y, z, t;
+  int send_subl[2];     /* sublist of sender for a given receiver */
+
+  // Index of the new gather, followed by its inverse if wanted
+  dir = n_gathers;
+  if (inverse == WANT_INVERSE)
+    n_gathers += 2;
+  else
+    n_gathers += 1;
+
+  // If necessary, lengthen gather array to add more gathers
+  if (n_gathers > gather_array_len) {
+    gather_array_len = n_gathers;
+    gather_array = realloc(gather_array,
+                           gather_array_len * sizeof(*gather_array));
+    if (gather_array == NULL) {
+      printf("make_gather: node%d can't realloc gather_array\n", my_rank);
+      terminate(1);
+    }
+  }
+
+  for (subl = 0; subl < 2; subl++)
+    send_subl[subl] = NOWHERE;
+
+  // Check to see if mapping has advertised parity and inverse properties
+  // Also check to see if it returns legal values for coordinates
+  FORALLSITES(i, s) {
+    // Find coordinates of neighbor who sends us data
+    func(s->x, s->y, s->z, s->t, args, FORWARDS, &x, &y, &z, &t);
+
+    if (x < 0 || y < 0 || z < 0 || t < 0 ||
+        x >= nx || y >= ny || z >= nz || t >= nt) {
+      printf("Gather mapping does not stay in lattice\n");
+      printf("It mapped %d %d %d %d to %d %d %d %d\n",
+             s->x, s->y, s->z, s->t, x, y, z, t);
+      terminate(1);
+    }
+
+    if (parity_conserve != SCRAMBLE_PARITY) {
+      int r_subl, s_subl;
+      r_subl = parity_function(s->x, s->y, s->z, s->t);
+      s_subl = parity_function(x, y, z, t);
+
+      if (want_even_odd == ALLOW_EVEN_ODD) {
+        if (send_subl[r_subl] == NOWHERE)
+          send_subl[r_subl] = s_subl;
+        else if (send_subl[r_subl] != s_subl) {
+          printf("Gather mixes up sublattices: %d vs %d\n",
+                 send_subl[r_subl], s_subl);
+          printf("on mapping %d %d %d %d -> %d %d %d %d\n",
+                 s->x, s->y, s->z, s->t, x, y, z, t);
+          terminate(1);
+        }
+      }
+
+      if (parity_conserve == SAME_PARITY && s_subl != r_subl) {
+        printf("Gather mapping does not obey claimed SAME_PARITY\n");
+        printf("It mapped %d %d %d %d with %d to %d %d %d %d with %d\n",
+               s->x, s->y, s->z, s->t, r_subl, x, y, z, t, s_subl);
+        terminate(1);
+      }
+      if (parity_conserve == SWITCH_PARITY && s_subl == r_subl) {
+        printf("Gather mapping does not obey claimed SWITCH_PARITY\n");
+        printf("It mapped %d %d %d %d with %d to %d %d %d %d with %d\n",
+               s->x, s->y, s->z, s->t, r_subl, x, y, z, t, s_subl);
+        terminate(1);
+      }
+
+      if (inverse == OWN_INVERSE) {
+        int x2, y2, z2, t2;
+        func(x, y, z, t, args, FORWARDS, &x2, &y2, &z2, &t2);
+        if (s->x != x2 || s->y != y2 || s->z != z2 || s->t != t2) {
+          printf("Gather mapping is not its own inverse\n");
+          printf("Its square mapped %d %d %d %d to %d %d %d %d\n",
+                 s->x, s->y, s->z, s->t, x2, y2, z2, t2);
+          terminate(1);
+        }
+      }
+    }
+  }
+
+  // The inverse gather has index one more than the original
+  make_lists(&gather_array[dir], func, args, FORWARDS);
+  if (inverse == WANT_INVERSE)
+    make_lists(&gather_array[dir + 1], func, args, BACKWARDS);
+  return dir;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Gather routines
+/* declare_strided_gather() returns a pointer to msg_tag which will
+   be used as input to subsequent prepare_gather() (optional), do_gather(),
+   wait_gather() and cleanup_gather() calls.
+
+   This handles gathers from both the site structure and an array of
+   fields and is not called directly by the user.  Instead they should
+   call declare_gather_site() or declare_gather_field().
+
+ prepare_gather() does nothing, since there are no buffers to allocate.
+
+ do_gather() tells the other ranks where to find the source field.
+    Pointers to neighbors on this rank are already set by the declaration.
+
+ wait_gather() waits for the ranks holding the neighbors to do the gather,
+    and points to their fields.
+
+ cleanup_gather() tells the ranks holding the neighbors that their fields
+    have been read, waits for the ranks reading from this one,
+    and frees the msg_tag.
+
+ do_gather() may be repeated after a wait_gather(), with the same source
+    field, which must not change until the gather is cleaned up
+
+   example:
+  msg_tag *tag;
+  tag = declare_gather_site(F_OFFSET(src), sizeof(vector), XUP,
+                            EVEN, gen_pt[0]);
+  prepare_gather(tag);  ** this step is optional **
+  do_gather(tag);
+    ** do other stuff, but don't modify tag, gen_pt[0] or src **
+  wait_gather(tag);
+    ** gen_pt[0][i] now contains the address of the src
+     vector on the neighbor of site i in the XUP direction
+     for all even sites i.
+     Do whatever you want with it here, but don't modify tag,
+     gen_pt[0] or src **
+  cleanup_gather(tag);
+    ** src may now be modified **
+*/
+
+// Return msg_tag containing details for specific gather
+// Handle gathers from both the site structure and an array of fields
+msg_tag* declare_strided_gather(
+  void *field,          /* source buffer aligned to desired field */
+  int stride,           /* bytes between fields in source buffer */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int subl,   /* subl of sites whose neighbors we gather.
+         It is EVENANDODD, if all sublattices are done. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  int i;          /* scratch */
+  site *s;          /* scratch pointer to site */
+  gather_t *gt;         /* pointer to current gather */
+  msg_tag *mtag;
+
+  gt = &gather_array[index];
+
+  /* set pointers in sites whose neighbors are on this node.  (If all
+     neighbors are on this node, this is the only thing done.) */
+  if (subl == EVENANDODD) {
+    FORALLSITES(i, s) {
+      if (gt->neighbor[i] != NOWHERE)
+        dest[i] = (char *)field + gt->neighbor[i] * stride;
+    }
+  }
+  else {
+    FORSOMEPARITY(i, s, subl) {
+      if (gt->neighbor[i] != NOWHERE)
+        dest[i] = (char *)field + gt->neighbor[i] * stride;
+    }
+  }
+
+  mtag = malloc(sizeof(*mtag));
+  if (mtag == NULL || (mtag->part = malloc(sizeof(gather_part))) == NULL) {
+    printf("declare_strided_gather: node%d can't malloc mtag\n", my_rank);
+    terminate(1);
+  }
+  mtag->n = 1;
+  mtag->started = 0;
+  mtag->part->field = (char *)field;
+  mtag->part->stride = stride;
+  mtag->part->index = index;
+  mtag->part->dest = dest;
+  switch(subl) {
+    case EVEN:        mtag->part->subl = 0; break;
+    case ODD:         mtag->part->subl = 1; break;
+    case EVENANDODD:  mtag->part->subl = 2; break;
+    default:  printf("ERROR: bad sublattice\n"); terminate(subl);
+  }
+  return mtag;
+}
+
+// Slot of rank r for gather seq
+static gather_slot* find_slot(int r, int seq) {
+  return &slot_table[r * MAX_GATHERS + seq % MAX_GATHERS];
+}
+
+// Wait for rank r to start gather seq, returning its slot
+static gather_slot* wait_slot(int r, int seq) {
+  gather_slot *slot = find_slot(r, seq);
+  while (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq)
+    spin();
+  return slot;
+}
+
+// Tell the ranks holding the neighbors that we are done with their fields,
+// then wait for all ranks reading from this one
+// Every rank tells the others before waiting, so none can hang
+static void finish_gather(msg_tag *mtag) {
+  int i, k, n;
+  gather_part *p;
+  gather_t *gt;
+  gather_slot *slot;
+
+  for (k = 0; k < mtag->n; k++) {
+    p = &mtag->part[k];
+    gt = &gather_array[p->index];
+    for (i = 0; i < gt->n_src[p->subl]; i++) {
+      slot = wait_slot(gt->src[p->subl][i], p->seq);
+      __atomic_add_fetch(&slot->done, 1, __ATOMIC_ACQ_REL);
+    }
+  }
+
+  for (k = 0; k < mtag->n; k++) {
+    p = &mtag->part[k];
+    n = gather_array[p->index].n_readers[p->subl];
+    slot = find_slot(my_rank, p->seq);
+    while (__atomic_load_n(&slot->done, __ATOMIC_ACQUIRE) != n)
+      spin();
+    slot->busy = 0;
+  }
+  mtag->started = 0;
+}
+
+// Nothing to allocate for the gather
+void prepare_gather(msg_tag *mtag) {
+}
+
+// Post the source fields for the other ranks
+// Repeating the gather first finishes the previous one
+void do_gather(msg_tag *mtag) {
+  int k;
+  gather_part *p;
+  gather_slot *slot;
+
+  if (mtag->started)
+    finish_gather(mtag);
+
+  for (k = 0; k < mtag->n; k++) {
+    p = &mtag->part[k];
+    p->seq = gather_seq++;
+    slot = find_slot(my_rank, p->seq);
+    if (slot->busy) {
+      printf("do_gather: node%d has more than %d gathers in progress\n",
+             my_rank, MAX_GATHERS);
+      terminate(1);
+    }
+    slot->busy = 1;
+    slot->done = 0;
+    slot->field = p->field;
+    __atomic_store_n(&slot->seq, p->seq, __ATOMIC_RELEASE);
+    gather_msgs += gather_array[p->index].n_readers[p->subl];
+  }
+  mtag->started = 1;
+}
+
+// Wait for the ranks holding the neighbors to post their fields,
+// and point to the neighbors there
+void wait_gather(msg_tag *mtag) {
+  int i, k, r, first, last;
+  gather_part *p;
+  gather_t *gt;
+
+  for (k = 0; k < mtag->n; k++) {
+    p = &mtag->part[k];
+    gt = &gather_array[p->index];
+    for (i = 0; i < gt->n_src[p->subl]; i++) {
+      r = gt->src[p->subl][i];
+      src_field[r] = wait_slot(r, p->seq)->field;
+    }
+
+    first = (p->subl == 1) ? gt->n_remote_even : 0;
+    last = (p->subl == 0) ? gt->n_remote_even : gt->n_remote;
+    for (i = first; i < last; i++) {
+      p->dest[gt->site[i]] = src_field[gt->rank[i]]
+                             + gt->index[i] * p->stride;
+    }
+  }
+}
+
+// Free the message tag once all ranks are done with the gather
+void cleanup_gather(msg_tag *mtag) {
+  if (mtag->started)
+    finish_gather(mtag);
+  free(mtag->part);
+  free(mtag);
+}
+
+// Move the sources of a declared gather, not in progress,
+// from old_field to field
+// Pointers to neighbors on this node still point into old_field
+void rebind_gather(msg_tag *mtag, void *old_field, void *field) {
+  int k;
+  gather_part *p;
+
+  for (k = 0; k < mtag->n; k++) {
+    p = &mtag->part[k];
+    p->field = (char *)field + (p->field - (char *)old_field);
+  }
+}
+
+// Let the source fields change, keeping the tag for the next do_gather()
+void release_gather(msg_tag *mtag) {
+  if (mtag->started)
+    finish_gather(mtag);
+}
+
+// Fields of this node read by other ranks since the start,
+// none of which are copied
+void gather_stats(double *nmsgs, double *nbytes) {
+  *nmsgs = gather_msgs;
+  *nbytes = 0.0;
+}
+
+// All ranks share memory anyway
+void* malloc_shared(size_t size) {
+  return malloc(size);
+}
+
+void free_shared(void *ptr) {
+  free(ptr);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Convenience routines for gathers
+// Declare gather with a field offset
+msg_tag* declare_gather_site(
+  field_offset field, /* which field? Some member of structure "site" */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int parity,   /* parity of sites whose neighbors we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  return declare_strided_gather((char *)lattice + field, sizeof(site), size,
+         index, parity, dest);
+}
+
+// Old style gather routine: declare and start in one call
+msg_tag* start_gather_site(
+  field_offset field, /* which field? Some member of structure "site" */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int parity,   /* parity of sites whose neighbors we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  msg_tag *mt;
+
+  mt = declare_strided_gather((char *)lattice + field, sizeof(site), size,
+                              index, parity, dest);
+  prepare_gather(mt);
+  do_gather(mt);
+
+  return mt;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Gather routines from an array of fields
+// Declare a gather from an array of fields
+msg_tag* declare_gather_field(
+  void *field,   /* which field? Pointer returned by malloc() */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int parity,   /* parity of sites whose neighbors we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  return declare_strided_gather(field, size, size, index, parity, dest);
+}
+
+// Old style gather routine: declare and start in one call
+msg_tag* start_gather_field(
+  void *field,   /* which field? Pointer returned by malloc() */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int parity,   /* parity of sites whose neighbors we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  msg_tag *mt;
+
+  mt = declare_strided_gather(field, size, size, index, parity, dest);
+  prepare_gather(mt);
+  do_gather(mt);
+
+  return mt;
+}
+
+// Declare and start a gather from an array of structures,
+// e.g. one component of a Twist_Fermion field
+msg_tag* start_gather_strided(
+  void *field,          /* source buffer aligned to desired field */
+  int stride,           /* bytes between fields in source buffer */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int parity,   /* parity of sites whose neighbors we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  msg_tag *mt;
+
+  mt = declare_strided_gather(field, stride, size, index, parity, dest);
+  prepare_gather(mt);
+  do_gather(mt);
+
+  return mt;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Multi-gather routines
+/* accumulate_gather(msg_tag **mtag, msg_tag *tag)
+   Joins declared gathers together under a single msg_tag.
+   The second argument (tag) would be merged with the first (mtag).
+   If mtag is NULL then this just copies tag into mtag.
+
+ declare_accumulate_gather_site() declares and joins gathers.
+
+ example:
+
+   msg_tag *mtag;
+
+   mtag = NULL;
+   declare_accumulate_gather_site(&mtag, F_OFFSET(phi), sizeof(vector),
+                                  XUP, EVEN, gen_pt1);
+   declare_accumulate_gather_site(&mtag, F_OFFSET(phi), sizeof(vector),
+                                  XDOWN, EVEN, gen_pt2);
+   prepare_gather(mtag);  ** optional **
+   do_gather(mtag);
+   wait_gather(mtag);
+   ** stuff **
+   cleanup_gather(mtag);
+
+ The gathers joined under mtag are done in the order they were added,
+ which must be the same on all ranks
+*/
+
+// Merge already declared gather
+void accumulate_gather(msg_tag **mmtag, msg_tag *mtag) {
+  msg_tag *mmt = *mmtag;
+
+  if (mmt == NULL) {
+    mmt = malloc(sizeof(*mmt));
+    if (mmt == NULL) {
+      printf("accumulate_gather: node%d can't malloc mtag\n", my_rank);
+      terminate(1);
+    }
+    mmt->n = 0;
+    mmt->part = NULL;
+    mmt->started = 0;
+    *mmtag = mmt;
+  }
+  mmt->part = realloc(mmt->part, (mmt->n + mtag->n) * sizeof(gather_part));
+  if (mmt->part == NULL) {
+    printf("accumulate_gather: node%d can't realloc parts\n", my_rank);
+    terminate(1);
+  }
+  memcpy(mmt->part + mmt->n, mtag->part, mtag->n * sizeof(gather_part));
+  mmt->n += mtag->n;
+}
+
+// Declare and merge gather, handling both site structure and array of fields
+static void declare_accumulate_strided_gather(
+  msg_tag **mmtag,      /* tag to accumulate gather into */
+  void *field,          /* which field? Some member of structure "site" */
+  int stride,           /* bytes between fields in source buffer */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int parity,   /* parity of sites whose neighbors we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  msg_tag *mtag;
+
+  mtag = declare_strided_gather(field, stride, size, index, parity, dest);
+  if (*mmtag == NULL)
+    *mmtag = mtag;
+  else {
+    accumulate_gather(mmtag, mtag);
+    cleanup_gather(mtag);
+  }
+}
+
+// Declare and merge gather from field offset
+void declare_accumulate_gather_site(
+  msg_tag **mmtag,
+  field_offset field, /* which field? Some member of structure "site" */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int parity,   /* parity of sites whose neighbors we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  declare_accumulate_strided_gather(mmtag, (char *)lattice + field,
+             sizeof(site), size, index, parity, dest);
+}
+
+// Declare and merge gather from an array of fields
+void declare_accumulate_gather_field(
+  msg_tag **mmtag,
+  void *field,   /* which field? Pointer returned by malloc() */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int parity,   /* parity of sites whose neighbors we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  declare_accumulate_strided_gather(mmtag, (char *)field, size, size, index,
+             parity, dest);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// General gather routines
+// start_general_gather_site returns a msg_tag to be used as input
+// to subsequent wait_general_gather and cleanup_general_gather calls
+
+// Usage: tag = start_general_gather_site(src, size, disp, parity, dest)
+// Example:
+//  msg_tag *tag;
+//  int disp[4] = {1, -1, 0, 0};    // Displacement
+//  tag = start_general_gather_site(F_OFFSET(phi), sizeof(vector), disp,
+//                                  EVEN, gen_pt[0]);
+//
+//  // Can do other stuff that doesn't depend on phi
+//  wait_general_gather(tag);
+//  // gen_pt[0][i] now contains the address of the phi vector
+//  // on the site displaced from site i for all even sites i
+//  // Do whatever you want with it here, but don't modify phi
+//  cleanup_general_gather(tag);
+// The first gather from each displacement makes a new gather with
+// make_gather(), and later gathers from the same displacement reuse it
+typedef struct general_gather {
+  int disp[NDIMS];
+  int index;
+  struct general_gather *next;
+} general_gather;
+static RANK_LOCAL general_gather *general_list = NULL;
+
+// Find coordinates of site at displacement args (or -args backwards)
+// Used by make_gather for general gathers
+static void general_coords(
+  int x, int y, int z, int t,       // Coordinates of site
+  int *args,                        // Displacement
+  int fb,                           // Forwards/backwards
+  int *x2p, int *y2p, int *z2p, int *t2p)
+                                    // Pointers to coordinates of neighbor
+{
+  *x2p = (x + fb * args[XUP] + nx) % nx;
+  *y2p = (y + fb * args[YUP] + ny) % ny;
+  *z2p = (z + fb * args[ZUP] + nz) % nz;
+  *t2p = (t + fb * args[TUP] + nt) % nt;
+}
+
+// Return the index of the gather from displacement, making it if necessary
+// All ranks gather from the same displacements in the same order,
+// so they make each new gather together
+static int general_index(int *displacement) {
+  int dir, gather_parity;
+  general_gather *g;
+
+  for (g = general_list; g != NULL; g = g->next) {
+    for (dir = XUP; dir <= TUP; dir++) {
+      if (g->disp[dir] != displacement[dir])
+        break;
+    }
+    if (dir > TUP)
+      return g->index;
+  }
+
+  g = malloc(sizeof(*g));
+  if (g == NULL) {
+    printf("general_index: node%d can't malloc gather\n", this_node);
+    terminate(1);
+  }
+  for (dir = XUP; dir <= TUP; dir++)
+    g->disp[dir] = displacement[dir];
+
+  if ((nx&1) || (ny&1) || (nz&1) || (nt&1))
+    gather_parity = SCRAMBLE_PARITY;
+  else if ((g->disp[XUP] + g->disp[YUP] + g->disp[ZUP] + g->disp[TUP]) & 1)
+    gather_parity = SWITCH_PARITY;
+  else
+    gather_parity = SAME_PARITY;
+  g->index = make_gather(general_coords, g->disp, NO_INVERSE,
+                         ALLOW_EVEN_ODD, gather_parity);
+  g->next = general_list;
+  general_list = g;
+  return g->index;
+}
+
+msg_tag* start_general_strided_gather(
+  char *field,          /* source buffer aligned to desired field */
+  int stride,           /* bytes between fields in source buffer */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int *displacement,  /* displacement to gather from. four components */
+  int subl,   /* subl of sites whose neighbors we gather.
+         It is EVENANDODD, if all sublattices are done. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  return start_gather_strided(field, stride, size,
+                              general_index(displacement), subl, dest);
+}
+
+msg_tag* start_general_gather_site(
+  field_offset field, /* which field? Some member of structure "site" */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int *displacement,  /* displacement to gather from. four components */
+  int parity,   /* parity of sites to which we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  return start_general_strided_gather((char *)lattice + field, sizeof(site),
+               size, displacement, parity, dest);
+}
+
+msg_tag* start_general_gather_field(
+  void *field,         /* which field? Pointer returned by malloc() */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int *displacement,  /* displacement to gather from. four components */
+  int parity,   /* parity of sites to which we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  return start_general_strided_gather((char *)field, size, size,
+               displacement, parity, dest);
+}
+
+// Wait for a general gather to complete
+void wait_general_gather(msg_tag *mtag) {
+  wait_gather(mtag);
+}
+
+// Free memory associated with general gather
+void cleanup_general_gather(msg_tag *mtag) {
+  cleanup_gather(mtag);
+}
+// -----------------------------------------------------------------
@@ -13,11 +13,18 @@
    g_vecfloatsum()        Sum a vector of Reals over all nodes
    g_doublesum()          Sum a double over all nodes
    g_vecdoublesum()       Sum a vector of doubles over all nodes
+   g_vecdoublesum_start() Start a non-blocking sum of a vector of doubles
+   g_sum_wait()           Wait for a non-blocking sum to finish
    g_complexsum()         Sum a generic precision complex number over all nodes
    g_veccomplexsum()      Sum a vector of generic precision complex numbers
                             over all nodes
    g_dcomplexsum()        Sum a double precision complex number over all nodes
    g_vecdcomplexsum()     Sum a vector of double_complex over all nodes
+   g_floatsum_add()       Queue a Real to be summed over all nodes
+   g_doublesum_add()      Queue a double to be summed over all nodes
+   g_complexsum_add()     Queue a generic precision complex number
+   g_dcomplexsum_add()    Queue a double precision complex number
+   g_sum_start()          Start a non-blocking sum of everything queued
    g_xor32()              Find global exclusive or of 32-bit word
    g_floatmax()           Find maximum Real over all nodes
    g_doublemax()          Find maximum double over all nodes
@@ -52,6 +59,8 @@
                             data has actually arrived
    cleanup_gather()       Free all the buffers that were allocated, WHICH
                             MEANS THAT THE GATHERED DATA MAY SOON DISAPPEAR
+   rebind_gather()        Point a declared gather at another field
+   release_gather()       Finish a gather to be done again, keeping its tag
    accumulate_gather()    Combine gathers into single message tag
    declare_accumulate_gather_site()   Do declare_gather_site() and
                                       accumulate_gather() in single step
@@ -71,6 +80,9 @@
            received data.
    cleanup_general_gather()  frees all the buffers that were allocated, WHICH
                                MEANS THAT THE GATHERED DATA MAY SOON DISAPPEAR.
+   gather_stats()          Number of messages and bytes sent by gathers
+   malloc_shared()         Allocate a field, just with malloc()
+   free_shared()           Free a field allocated by malloc_shared()
 */
 
 #include <time.h>
@@ -189,6 +201,21 @@ void g_doublesum(double *dpt) {
 void g_vecdoublesum(double *dpt, int ndoubles) {
 }
 
+// Start summing a vector of doubles over all nodes
+// Nothing to do, so just hand back a dummy tag
+struct sum_tag {
+  int dummy;
+};
+
+sum_tag* g_vecdoublesum_start(double *dpt, int ndoubles) {
+  static sum_tag tag;
+  return &tag;
+}
+
+// Wait for a non-blocking sum to finish
+void g_sum_wait(sum_tag *tag) {
+}
+
 // Sum complex over all nodes
 void g_complexsum(complex *cpt) {
 }
@@ -205,6 +232,26 @@ void g_dcomplexsum(double_complex *cpt) {
 void g_vecdcomplexsum(double_complex *cpt, int ncomplex) {
 }
 
+// Queue sums for g_sum_start()
+// Nothing to do, the values already are the sums
+void g_floatsum_add(Real *fpt) {
+}
+
+void g_doublesum_add(double *dpt) {
+}
+
+void g_complexsum_add(complex *cpt) {
+}
+
+void g_dcomplexsum_add(double_complex *cpt) {
+}
+
+// Start summing everything queued
+sum_tag* g_sum_start() {
+  static sum_tag tag;
+  return &tag;
+}
+
 // Global exclusive or acting on u_int32type
 void g_xor32(u_int32type *pt) {
 }
@@ -646,6 +693,28 @@ void wait_gather(msg_tag *mtag) {
 // Free buffers associated with message tag
 void cleanup_gather(msg_tag *mtag) {
 }
+
+// Only the pointers to neighbors, set by the caller, depend on the field
+void rebind_gather(msg_tag *mtag, void *old_field, void *field) {
+}
+
+void release_gather(msg_tag *mtag) {
+}
+
+// No messages are ever sent
+void gather_stats(double *nmsgs, double *nbytes) {
+  *nmsgs = 0.0;
+  *nbytes = 0.0;
+}
+
+// With a single node there are no other ranks to share with
+void* malloc_shared(size_t size) {
+  return malloc(size);
+}
+
+void free_shared(void *ptr) {
+  free(ptr);
+}
 // -----------------------------------------------------------------
 
 
@@ -722,6 +791,27 @@ msg_tag* start_gather_field(
 
   return mt;
 }
+
+// Declare and start a gather from an array of structures,
+// e.g. one component of a Twist_Fermion field
+msg_tag* start_gather_strided(
+  void *field,          /* source buffer aligned to desired field */
+  int stride,           /* bytes between fields in source buffer */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int parity,   /* parity of sites whose neighbors we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest)   /* one of the vectors of pointers */
+{
+  msg_tag *mt;
+
+  mt = declare_strided_gather(field, stride, size, index, parity, dest);
+  prepare_gather(mt);
+  do_gather(mt);
+
+  return mt;
+}
 // -----------------------------------------------------------------
 
 
@@ -869,7 +959,64 @@ void declare_accumulate_gather_field(
 //  cleanup_general_gather(tag);
 //  // Subsequent calls will overwrite the gathered fields
 //  // If you don't clean up, you will eventually run out of space
-static int g_gather_flag = 0; /* flag to tell if general gather in progress */
+// The first gather from each displacement makes a new gather with
+// make_gather(), and later gathers from the same displacement reuse it
+typedef struct general_gather {
+  int disp[NDIMS];
+  int index;
+  struct general_gather *next;
+} general_gather;
+static general_gather *general_list = NULL;
+
+// Find coordinates of site at displacement args (or -args backwards)
+// Used by make_gather for general gathers
+static void general_coords(
+  int x, int y, int z, int t,       // Coordinates of site
+  int *args,                        // Displacement
+  int fb,                           // Forwards/backwards
+  int *x2p, int *y2p, int *z2p, int *t2p)
+                                    // Pointers to coordinates of neighbor
+{
+  *x2p = (x + fb * args[XUP] + nx) % nx;
+  *y2p = (y + fb * args[YUP] + ny) % ny;
+  *z2p = (z + fb * args[ZUP] + nz) % nz;
+  *t2p = (t + fb * args[TUP] + nt) % nt;
+}
+
+// Return the index of the gather from displacement, making it if necessary
+static int general_index(int *displacement) {
+  int dir, gather_parity;
+  general_gather *g;
+
+  for (g = general_list; g != NULL; g = g->next) {
+    for (dir = XUP; dir <= TUP; dir++) {
+      if (g->disp[dir] != displacement[dir])
+        break;
+    }
+    if (dir > TUP)
+      return g->index;
+  }
+
+  g = malloc(sizeof(*g));
+  if (g == NULL) {
+    printf("general_index: node%d can't malloc gather\n", this_node);
+    terminate(1);
+  }
+  for (dir = XUP; dir <= TUP; dir++)
+    g->disp[dir] = displacement[dir];
+
+  if ((nx&1) || (ny&1) || (nz&1) || (nt&1))
+    gather_parity = SCRAMBLE_PARITY;
+  else if ((g->disp[XUP] + g->disp[YUP] + g->disp[ZUP] + g->disp[TUP]) & 1)
+    gather_parity = SWITCH_PARITY;
+  else
+    gather_parity = SAME_PARITY;
+  g->index = make_gather(general_coords, g->disp, NO_INVERSE,
+                         ALLOW_EVEN_ODD, gather_parity);
+  g->next = general_list;
+  general_list = g;
+  return g->index;
+}
 
 msg_tag* start_general_strided_gather(
   char *field,          /* source buffer aligned to desired field */
@@ -880,66 +1027,8 @@ msg_tag* start_general_strided_gather(
          It is EVENANDODD, if all sublattices are done. */
   char **dest)   /* one of the vectors of pointers */
 {
-  site *s;      /* scratch pointer to site */
-  int i;          /* scratch */
-  int tx, ty, tz, tt;  /* temporary coordinates */
-
-  // Check for gather already in progress
-  if (g_gather_flag != 0) {
-    fprintf(stderr, "ERROR: node%d, two general_gathers() at once!\n",
-            mynode());
-    exit(1);
-  }
-
-  /* set pointers in sites whose neighbors are on this node.  (If all
-     neighbors are on this node, this is the only thing done.) Make
-     list of nodes from whom we expect messages */
-  if (subl == EVENANDODD) {
-    FORALLSITES(i, s) {
-      if (displacement[XUP] != 0)
-        tx = (s->x + displacement[XUP] + nx) % nx;
-      else
-        tx = s->x;
-      if (displacement[YUP] != 0)
-        ty = (s->y + displacement[YUP] + ny) % ny;
-      else
-        ty = s->y;
-      if (displacement[ZUP] != 0)
-        tz = (s->z + displacement[ZUP] + nz) % nz;
-      else
-        tz = s->z;
-      if (displacement[TUP] != 0)
-        tt = (s->t + displacement[TUP] + nt) % nt;
-      else
-        tt = s->t;
-      dest[i] = field + stride * node_index(tx, ty, tz, tt);
-    }
-  }
-  else {
-    FORSOMEPARITY(i, s, subl) {
-      if (displacement[XUP] != 0)
-        tx = (s->x + displacement[XUP] + nx) % nx;
-      else
-        tx = s->x;
-      if (displacement[YUP] != 0)
-        ty = (s->y + displacement[YUP] + ny) % ny;
-      else
-        ty = s->y;
-      if (displacement[ZUP] != 0)
-        tz = (s->z + displacement[ZUP] + nz) % nz;
-      else
-        tz = s->z;
-      if (displacement[TUP] != 0)
-        tt = (s->t + displacement[TUP] + nt) % nt;
-      else
-        tt = s->t;
-      dest[i] = field + stride * node_index(tx, ty, tz, tt);
-    }
-  }
-
-  // Mark gather in progress and return
-  g_gather_flag = 1;
-  return NULL;
+  return start_gather_strided(field, stride, size,
+                              general_index(displacement), subl, dest);
 }
 
 msg_tag* start_general_gather_site(
@@ -968,10 +1057,11 @@ msg_tag* start_general_gather_field(
 
 // Wait for a general gather to complete
 void wait_general_gather(msg_tag *mtag) {
-  g_gather_flag = 0;
+  wait_gather(mtag);
 }
 
 // Free memory associated with general gather
 void cleanup_general_gather(msg_tag *mtag) {
+  cleanup_gather(mtag);
 }
 // -----------------------------------------------------------------
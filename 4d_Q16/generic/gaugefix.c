@@ -39,9 +39,9 @@
 #include "generic_includes.h"
 
 // Scratch space
-static matrix *diffmatp;                // Malloced diffmat pointer
-static vector *sumvecp;                 // Malloced sumvec pointer
-field_offset diffmat_offset, sumvec_offset;   // Field offsets
+static RANK_LOCAL matrix *diffmatp;                     // Malloced diffmat pointer
+static RANK_LOCAL vector *sumvecp;                      // Malloced sumvec pointer
+RANK_LOCAL field_offset diffmat_offset, sumvec_offset;  // Field offsets
 // -----------------------------------------------------------------
 
 
@@ -3,6 +3,7 @@
 // These are patterned after stdio fopen, fseek, fwrite, fread, fclose
 // Needed in case system doesn't use ANSI standard calls
 #include "generic_includes.h"
+#include "../include/io_lat.h"
 #include <sys/types.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -27,3 +28,44 @@ int g_close(FILE *stream) {
   return fclose(stream);
 }
 // -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Each node opens the file for itself and accesses its records
+// with one seek and one call for each contiguous run
+static int sites_io(const char *filename, const char *mode, off_t offset,
+                    size_t size, int n, int32type *index, char *buf,
+                    int write) {
+  int j, run, count = 0;
+  FILE *fp = fopen(filename, mode);
+
+  if (fp == NULL)
+    return 0;
+
+  for (j = 0; j < n; j += run) {
+    for (run = 1; j + run < n && index[j + run] == index[j] + run; run++)
+      ;
+    if (fseeko(fp, offset + (off_t)index[j] * size, SEEK_SET) < 0)
+      break;
+    if (write)
+      count += (int)fwrite(buf + j * size, size, run, fp);
+    else
+      count += (int)fread(buf + j * size, size, run, fp);
+  }
+  if (fclose(fp) != 0)
+    return 0;
+  return count;
+}
+
+// Node 0 has already created the file, so the others must not truncate it
+int g_write_sites(const char *filename, off_t offset, size_t size,
+                  int n, int32type *index, void *buf) {
+  return sites_io(filename, "r+b", offset, size, n, index, buf, 1);
+}
+
+int g_read_sites(const char *filename, off_t offset, size_t size,
+                 int n, int32type *index, void *buf) {
+  return sites_io(filename, "rb", offset, size, n, index, buf, 0);
+}
+// -----------------------------------------------------------------
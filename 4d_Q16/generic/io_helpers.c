@@ -14,6 +14,8 @@ gauge_file *save_lattice(int flag, char *filename) {
   double dtime;
   gauge_file *gf = NULL;
 
+  // Finish any background save while its plaquette is here for its info file
+  finish_async_save();
   plaquette(&g_ssplaq, &g_stplaq);
   d_linktrsum(&linktrsum);
   nersc_checksum = nersc_cksum();
@@ -23,6 +25,13 @@ gauge_file *save_lattice(int flag, char *filename) {
     case SAVE_SERIAL:
       gf = save_serial(filename);
       break;
+    case SAVE_PARALLEL:
+      gf = save_parallel(filename);
+      break;
+    case SAVE_ASYNC:      // Finished by the next save or finish_async_save
+      save_async(filename);
+      gf = NULL;
+      break;
     case FORGET:
       gf = NULL;
       break;
@@ -112,6 +121,12 @@ gauge_file *reload_lattice(int flag, char *filename) {
     case RELOAD_SERIAL:   // Read binary lattice serially
       gf = restore_serial(filename);
       break;
+    case RELOAD_PARALLEL: // Read binary lattice in parallel
+      gf = restore_parallel(filename);
+      break;
+    case PEEK:            // Only report on the lattice file
+      gf = peek_serial(filename);
+      break;
     default:
       node0_printf("reload_lattice: Bad startflag %d\n", flag);
       terminate(1);
@@ -119,6 +134,8 @@ gauge_file *reload_lattice(int flag, char *filename) {
   dtime += dclock();
   if (flag != FRESH && flag != CONTINUE)
     node0_printf("Time to reload gauge configuration = %e\n", dtime);
+  if (flag == PEEK)
+    return gf;
 
   plaquette(&g_ssplaq, &g_stplaq);
   d_linktrsum(&linktrsum);
@@ -149,7 +166,7 @@ int ask_starting_lattice(FILE *fp, int prompt, int *flag, char *filename) {
   int status;
 
   if (prompt!=0)
-    printf("enter 'continue', 'fresh' or 'reload_serial'\n");
+    printf("enter 'continue', 'fresh', 'reload_serial', 'reload_parallel' or 'peek'\n");
   status = fscanf(fp, "%s", savebuf);
   if (status == EOF) {
     printf("ask_starting_lattice: EOF on STDIN.\n");
@@ -172,6 +189,10 @@ int ask_starting_lattice(FILE *fp, int prompt, int *flag, char *filename) {
   }
   else if (strcmp("reload_serial", savebuf) == 0)
     *flag = RELOAD_SERIAL;
+  else if (strcmp("reload_parallel", savebuf) == 0)
+    *flag = RELOAD_PARALLEL;
+  else if (strcmp("peek", savebuf) == 0)
+    *flag = PEEK;
   else {
     printf(" is not a valid starting lattice option. INPUT ERROR.\n");
     return 1;
@@ -203,7 +224,7 @@ int ask_ending_lattice(FILE *fp, int prompt, int *flag, char *filename) {
   int status;
 
   if (prompt!=0)
-    printf("'forget' lattice at end or 'save_serial'\n");
+    printf("'forget' lattice at end, 'save_serial', 'save_parallel' or 'save_async'\n");
   status = fscanf(fp,"%s", savebuf);
   if (status != 1) {
     printf("\nask_ending_lattice: ERROR IN INPUT: error reading ending lattice command\n");
@@ -212,6 +233,10 @@ int ask_ending_lattice(FILE *fp, int prompt, int *flag, char *filename) {
   printf("%s", savebuf);
   if (strcmp("save_serial", savebuf) == 0)
     *flag = SAVE_SERIAL;
+  else if (strcmp("save_parallel", savebuf) == 0)
+    *flag = SAVE_PARALLEL;
+  else if (strcmp("save_async", savebuf) == 0)
+    *flag = SAVE_ASYNC;
   else if (strcmp("forget", savebuf) == 0) {
     *flag = FORGET;
     printf("\n");
@@ -278,7 +303,7 @@ int ask_gauge_fix(FILE *fp, int prompt, int *flag) {
 // Comments begin with # and apply to the rest of the line
 // Verify that the input tag agrees with the expected tag
 static int get_tag(FILE *fp, char *tag, char *myname) {
-  static char checktag[80];
+  static RANK_LOCAL char checktag[80];
   char line[512];
   int s;
 
@@ -10,6 +10,11 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <assert.h>
+#include <pthread.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 // This is dangerous -- it assumes off_t = long for this compilation
 #ifndef HAVE_FSEEKO
@@ -158,15 +163,15 @@ static void flush_lbuf_to_file(gauge_file *gf, fmatrix *lbuf,
 
 // -----------------------------------------------------------------
 // Accumulate checksums
-static void accum_cksums(gauge_file *gf, int *rank29, int *rank31,
-                         u_int32type *buf, int n) {
+void accum_cksums(gauge_check *gc, int *rank29, int *rank31,
+                  u_int32type *buf, int n) {
 
   int k;
   u_int32type *val;
 
   for (k = 0, val = buf; k < n; k++, val++) {
-    gf->check.sum29 ^= (*val)<<(*rank29) | (*val)>>(32-(*rank29));
-    gf->check.sum31 ^= (*val)<<(*rank31) | (*val)>>(32-(*rank31));
+    gc->sum29 ^= (*val)<<(*rank29) | (*val)>>(32-(*rank29));
+    gc->sum31 ^= (*val)<<(*rank31) | (*val)>>(32-(*rank31));
     (*rank29)++;
     if (*rank29 >= 29)
       *rank29 = 0;
@@ -195,7 +200,7 @@ static void flush_tbuf_to_lbuf(gauge_file *gf, int *rank29, int *rank31,
     nword = NUMLINK * (int)sizeof(fmatrix)
                     / (int)sizeof(int32type) * tbuf_length;
     buf = (u_int32type *)&lbuf[NUMLINK * (*buf_length)];
-    accum_cksums(gf, rank29, rank31, buf, nword);
+    accum_cksums(&gf->check, rank29, rank31, buf, nword);
 
     *buf_length += tbuf_length;
   }
@@ -368,6 +373,129 @@ void w_serial(gauge_file *gf) {
 
 
 
+#ifdef HAVE_MMAP
+// -----------------------------------------------------------------
+// With a single node, map the file and convert each site straight
+// into lattice[].link[], skipping lbuf
+#define SITE_WORDS (NUMLINK * (int)sizeof(fmatrix) / (int)sizeof(int32type))
+
+// Left rotation through rank bits, leaving val unchanged for rank 0
+#define ROTATE(val, rank) ((val) << (rank) | (val) >> ((32 - (rank)) & 31))
+
+// Accumulate the checksums of the words of one site, whose first word
+// has ranks rank29 and rank31, looking up the ranks of the following words
+// so that only the exclusive ors are carried between iterations
+// and the loop can be vectorized
+static void site_words_cksums(gauge_check *gc, u_int32type *val,
+                              const int *tab29, const int *tab31) {
+  int k;
+  u_int32type sum29 = 0, sum31 = 0;
+
+  for (k = 0; k < SITE_WORDS; k++) {
+    sum29 ^= ROTATE(val[k], tab29[k]);
+    sum31 ^= ROTATE(val[k], tab31[k]);
+  }
+  gc->sum29 ^= sum29;
+  gc->sum31 ^= sum31;
+}
+
+// Return 1 without reading anything if the file can't be mapped,
+// so that r_serial reads it through lbuf instead
+static int r_mmap(gauge_file *gf) {
+  gauge_header *gh = gf->header;
+  char *map;
+  int rcv_rank, rcv_coords, k, x, y, z, t;
+  int tab29[29 + SITE_WORDS], tab31[31 + SITE_WORDS];
+  off_t gauge_check_size;     // Size of gauge configuration checksum record
+  off_t coord_list_size;      // Size of coordinate list in bytes
+  off_t head_size;            // Size of header plus coordinate list
+  off_t checksum_offset;      // Where we put the checksum
+  off_t size, word;
+  struct stat st;
+  gauge_check test_gc;
+  fmatrix tmat[NUMLINK], *src;
+
+  if (gh->magic_number == GAUGE_VERSION_NUMBER)
+    gauge_check_size = sizeof(gf->check.sum29) + sizeof(gf->check.sum31);
+  else
+    gauge_check_size = 0;
+
+  if (gh->order == NATURAL_ORDER)
+    coord_list_size = 0;
+  else
+    coord_list_size = sizeof(int32type) * volume;
+  checksum_offset = gh->header_bytes + coord_list_size;
+  head_size = checksum_offset + gauge_check_size;
+
+  // Leave short files to r_serial to report
+  size = head_size + (off_t)volume * NUMLINK * sizeof(fmatrix);
+  if (fstat(fileno(gf->fp), &st) != 0 || st.st_size < size)
+    return 1;
+  map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(gf->fp), 0);
+  if (map == MAP_FAILED)
+    return 1;
+  if (gh->order == NATURAL_ORDER)
+    madvise(map, size, MADV_SEQUENTIAL);
+
+  for (k = 0; k < 29 + SITE_WORDS; k++)
+    tab29[k] = k % 29;
+  for (k = 0; k < 31 + SITE_WORDS; k++)
+    tab31[k] = k % 31;
+
+  test_gc.sum29 = 0;
+  test_gc.sum31 = 0;
+  for (rcv_rank = 0; rcv_rank < volume; rcv_rank++) {
+    if (gh->order == NATURAL_ORDER)
+      rcv_coords = rcv_rank;
+    else
+      rcv_coords = gf->rank2rcv[rcv_rank];
+
+    x = rcv_coords % nx;
+    rcv_coords /= nx;
+    y = rcv_coords % ny;
+    rcv_coords /= ny;
+    z = rcv_coords % nz;
+    rcv_coords /= nz;
+    t = rcv_coords % nt;
+
+    // Only copy the site if it must be byte reversed
+    src = (fmatrix *)(map + head_size
+                          + (off_t)rcv_rank * NUMLINK * sizeof(fmatrix));
+    if (gf->byterevflag == 1) {
+      memcpy(tmat, src, NUMLINK * sizeof(fmatrix));
+      byterevn((int32type *)tmat, SITE_WORDS);
+      src = tmat;
+    }
+
+    // Count 32-bit words mod 29 and mod 31 in order of appearance on file
+    word = (off_t)rcv_rank * SITE_WORDS;
+    site_words_cksums(&test_gc, (u_int32type *)src,
+                      tab29 + word % 29, tab31 + word % 31);
+    f2d_mat(src, &lattice[node_index(x, y, z, t)].link[0]);
+  }
+  munmap(map, size);
+
+  // Read and verify checksum
+  printf("Restored binary gauge configuration serially from file %s\n",
+         gf->filename);
+  if (gh->magic_number == GAUGE_VERSION_NUMBER) {
+    printf("Time stamp %s\n", gh->time_stamp);
+    if (fseeko(gf->fp, checksum_offset, SEEK_SET) < 0) {
+      printf("r_mmap: node0 fseeko %lld failed error %d file %s\n",
+             (long long)checksum_offset, errno, gf->filename);
+      fflush(stdout);
+      terminate(1);
+    }
+    read_checksum(gf, &test_gc);
+  }
+  fflush(stdout);
+  return 0;
+}
+// -----------------------------------------------------------------
+#endif
+
+
+
 // -----------------------------------------------------------------
 // Only node 0 reads the gauge configuration gf from a binary file
 void r_serial(gauge_file *gf) {
@@ -390,6 +518,12 @@ void r_serial(gauge_file *gf) {
   fmatrix *lbuf = NULL;   // Only allocate on node0
   fmatrix tmat[NUMLINK];
 
+#ifdef HAVE_MMAP
+  // A single node maps the file instead, if it can
+  if (numnodes() == 1 && r_mmap(gf) == 0)
+    return;
+#endif
+
   if (this_node == 0) {
     // Compute offset for reading gauge configuration
     if (gh->magic_number == GAUGE_VERSION_NUMBER)
@@ -553,6 +687,477 @@ void r_serial(gauge_file *gf) {
 
 
 
+// -----------------------------------------------------------------
+// Parallel reading and writing, with every node handling its own sites
+// The file format, including the checksums, is the same as serial I/O
+typedef struct {
+  int32type record;   // Position of the site on file
+  int site;           // Index of the site on this node
+} site_record;
+
+static int compare_records(const void *a, const void *b) {
+  int32type ra = ((site_record *)a)->record;
+  int32type rb = ((site_record *)b)->record;
+  return (ra > rb) - (ra < rb);
+}
+
+// List the sites on this node in the order of their records on file
+// rank2rcv gives the coordinates of each record, or is NULL
+// if the file is in natural order
+static site_record *sort_site_records(int32type *rank2rcv) {
+  register int i;
+  register site *s;
+  int rcv_rank, rcv_coords, x, y, z, t;
+  site_record *list = malloc(sites_on_node * sizeof(*list));
+
+  if (list == NULL) {
+    printf("sort_site_records: node%d can't malloc list\n", this_node);
+    terminate(1);
+  }
+
+  if (rank2rcv == NULL) {
+    FORALLSITES(i, s) {
+      list[i].record = s->x + nx * (s->y + ny * (s->z + nz * s->t));
+      list[i].site = i;
+    }
+  }
+  else {
+    // Every node scans the whole site list for its own sites
+    i = 0;
+    for (rcv_rank = 0; rcv_rank < volume; rcv_rank++) {
+      rcv_coords = rank2rcv[rcv_rank];
+      x = rcv_coords % nx;
+      rcv_coords /= nx;
+      y = rcv_coords % ny;
+      rcv_coords /= ny;
+      z = rcv_coords % nz;
+      rcv_coords /= nz;
+      t = rcv_coords % nt;
+      if (node_number(x, y, z, t) == this_node && i < sites_on_node) {
+        list[i].record = rcv_rank;
+        list[i].site = node_index(x, y, z, t);
+        i++;
+      }
+    }
+    if (i != sites_on_node) {
+      printf("sort_site_records: node%d found %d of its %d sites\n",
+             this_node, i, sites_on_node);
+      terminate(1);
+    }
+  }
+  qsort(list, sites_on_node, sizeof(*list), compare_records);
+  return list;
+}
+
+// Accumulate the checksums of the NUMLINK matrices of the n listed sites,
+// counting 32-bit words mod 29 and mod 31 from the position on file
+static void site_cksums(gauge_check *gc, int n, site_record *list,
+                        fmatrix *buf) {
+  int j, rank29, rank31;
+  int nword = NUMLINK * sizeof(fmatrix) / sizeof(int32type);
+  off_t word;
+
+  for (j = 0; j < n; j++) {
+    word = (off_t)list[j].record * nword;
+    rank29 = word % 29;
+    rank31 = word % 31;
+    accum_cksums(gc, &rank29, &rank31,
+                 (u_int32type *)&buf[NUMLINK * j], nword);
+  }
+}
+
+// Allocate the file records and single-precision links of this node
+static void setup_site_buf(char *myname, site_record *list,
+                           int32type **index, fmatrix **buf) {
+  int j;
+
+  *index = malloc(sites_on_node * sizeof(**index));
+  *buf = malloc(sites_on_node * NUMLINK * sizeof(**buf));
+  if (*index == NULL || *buf == NULL) {
+    printf("%s: node%d can't malloc buf\n", myname, this_node);
+    terminate(1);
+  }
+  for (j = 0; j < sites_on_node; j++)
+    (*index)[j] = list[j].record;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// All nodes write their own sites of the gauge configuration gf,
+// whose header node 0 has written in w_serial_i
+void w_parallel(gauge_file *gf) {
+  register int j;
+  int n;
+  gauge_header *gh = gf->header;
+  site_record *list = sort_site_records(NULL);
+  int32type *index;
+  fmatrix *buf;
+  off_t checksum_offset;      // Location of checksum
+  off_t head_size;            // Size of header plus checksum record
+
+  setup_site_buf("w_parallel", list, &index, &buf);
+  for (j = 0; j < sites_on_node; j++)
+    d2f_mat(&lattice[list[j].site].link[0], &buf[NUMLINK * j]);
+
+  // Only node 0 knows the header size from writing it, so find it here
+  // No coordinate list written
+  checksum_offset = sizeof(gh->magic_number) + sizeof(gh->dims)
+                  + sizeof(gh->time_stamp) + sizeof(gh->order);
+  head_size = checksum_offset + sizeof(gf->check.sum29)
+                              + sizeof(gf->check.sum31);
+
+  gf->check.sum29 = 0;
+  gf->check.sum31 = 0;
+  site_cksums(&gf->check, sites_on_node, list, buf);
+
+  // The header must be on file before the other nodes open it
+  if (this_node == 0)
+    fflush(gf->fp);
+  g_sync();
+  n = g_write_sites(gf->filename, head_size, NUMLINK * sizeof(fmatrix),
+                    sites_on_node, index, buf);
+  if (n != sites_on_node) {
+    printf("w_parallel: node%d gauge configuration write error %d file %s\n",
+           this_node, errno, gf->filename);
+    fflush(stdout);
+    terminate(1);
+  }
+
+  // Combine node checksum contributions with global exclusive or
+  g_xor32(&gf->check.sum29);
+  g_xor32(&gf->check.sum31);
+  free(list);
+  free(index);
+  free(buf);
+
+  if (this_node == 0) {
+    printf("Saved gauge configuration in parallel to binary file %s\n",
+           gf->filename);
+    printf("Time stamp %s\n", gh->time_stamp);
+
+    // Write checksum
+    if (fseeko(gf->fp, checksum_offset, SEEK_SET) < 0) {
+      printf("w_parallel: node%d fseeko %lld failed error %d file %s\n",
+             this_node, (long long)checksum_offset, errno, gf->filename);
+      fflush(stdout);
+      terminate(1);
+    }
+    write_checksum(gf);
+  }
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// All nodes read their own sites of the gauge configuration gf,
+// whose header node 0 has read and broadcast in r_serial_i
+void r_parallel(gauge_file *gf) {
+  register int j;
+  int n;
+  gauge_header *gh = gf->header;
+  site_record *list = sort_site_records(gf->rank2rcv);
+  int32type *index;
+  fmatrix *buf;
+  gauge_check test_gc;
+  off_t gauge_check_size;     // Size of gauge configuration checksum record
+  off_t coord_list_size;      // Size of coordinate list in bytes
+  off_t head_size;            // Size of header plus coordinate list
+  off_t checksum_offset;      // Where we put the checksum
+
+  if (gh->magic_number == GAUGE_VERSION_NUMBER)
+    gauge_check_size = sizeof(gf->check.sum29) + sizeof(gf->check.sum31);
+  else
+    gauge_check_size = 0;
+
+  if (gh->order == NATURAL_ORDER)
+    coord_list_size = 0;
+  else
+    coord_list_size = sizeof(int32type) * volume;
+  checksum_offset = gh->header_bytes + coord_list_size;
+  head_size = checksum_offset + gauge_check_size;
+
+  setup_site_buf("r_parallel", list, &index, &buf);
+  n = g_read_sites(gf->filename, head_size, NUMLINK * sizeof(fmatrix),
+                   sites_on_node, index, buf);
+  if (n != sites_on_node) {
+    printf("r_parallel: node%d gauge configuration read error %d file %s\n",
+           this_node, errno, gf->filename);
+    fflush(stdout);
+    terminate(1);
+  }
+
+  if (gf->byterevflag == 1)
+    byterevn((int32type *)buf,
+             sites_on_node * NUMLINK * sizeof(fmatrix) / sizeof(int32type));
+
+  test_gc.sum29 = 0;
+  test_gc.sum31 = 0;
+  site_cksums(&test_gc, sites_on_node, list, buf);
+
+  // Copy NUMLINK matrices to generic-precision lattice
+  for (j = 0; j < sites_on_node; j++)
+    f2d_mat(&buf[NUMLINK * j], &lattice[list[j].site].link[0]);
+
+  // Combine node checksum contributions with global exclusive or
+  g_xor32(&test_gc.sum29);
+  g_xor32(&test_gc.sum31);
+  free(list);
+  free(index);
+  free(buf);
+
+  if (this_node == 0) {
+    // Read and verify checksum
+    printf("Restored binary gauge configuration in parallel from file %s\n",
+           gf->filename);
+    if (gh->magic_number == GAUGE_VERSION_NUMBER) {
+      printf("Time stamp %s\n", gh->time_stamp);
+      if (fseeko(gf->fp, checksum_offset, SEEK_SET) < 0) {
+        printf("r_parallel: node0 fseeko %lld failed error %d file %s\n",
+               (long long)checksum_offset, errno, gf->filename);
+        fflush(stdout);
+        terminate(1);
+      }
+      read_checksum(gf, &test_gc);
+    }
+    fflush(stdout);
+  }
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Asynchronous saves, in which every node snapshots its own sites
+// and leaves their checksums and writing to a helper thread
+// The helpers write <filename>.tmp, which only replaces the file and
+// gains its .info file in finish_async_save(), so that an interrupted
+// save leaves the previous one intact
+// The helper only uses this state, since globals may be private
+// to the rank that started it (RANK_LOCAL)
+typedef struct {
+  gauge_file *gf;
+  char tmpname[MAXFILENAME + 4];
+  int n;                  // Number of sites on this node
+  site_record *list;
+  fmatrix *buf;           // Single-precision snapshot of the links
+  off_t checksum_offset;  // Location of checksum
+  off_t head_size;        // Size of header plus checksum record
+  gauge_check check;      // Checksums of the sites on this node
+  int status, error;      // Non-zero status and errno if the write failed
+  pthread_t thread;
+} async_save;
+
+static RANK_LOCAL async_save *saving = NULL;
+
+static void *async_write(void *arg) {
+  async_save *as = (async_save *)arg;
+  int j, run;
+  size_t size = NUMLINK * sizeof(fmatrix);
+  FILE *fp;
+
+  site_cksums(&as->check, as->n, as->list, as->buf);
+
+  // Node 0 has already created the file, so it is not truncated
+  fp = fopen(as->tmpname, "r+b");
+  if (fp == NULL) {
+    as->status = 1;
+    as->error = errno;
+    return NULL;
+  }
+  for (j = 0; j < as->n; j += run) {
+    for (run = 1; j + run < as->n &&
+                  as->list[j + run].record == as->list[j].record + run; run++)
+      ;
+    if (fseeko(fp, as->head_size + (off_t)as->list[j].record * size,
+               SEEK_SET) < 0 ||
+        (int)fwrite(&as->buf[NUMLINK * j], size, run, fp) != run) {
+      as->status = 1;
+      as->error = errno;
+      break;
+    }
+  }
+  if (fclose(fp) != 0 && as->status == 0) {
+    as->status = 1;
+    as->error = errno;
+  }
+  return NULL;
+}
+
+// Snapshot the links and start saving them in the background,
+// after waiting for any previous save to finish
+void save_async(char *filename) {
+  register int j;
+  async_save *as;
+  gauge_header *gh;
+
+  finish_async_save();
+  as = malloc(sizeof(*as));
+  if (as == NULL) {
+    printf("save_async: node%d can't malloc as\n", this_node);
+    terminate(1);
+  }
+  snprintf(as->tmpname, sizeof(as->tmpname), "%s.tmp", filename);
+
+  // Node 0 creates the file and writes the header, as for w_serial
+  as->gf = w_serial_i(as->tmpname);
+  as->gf->filename = filename;
+  gh = as->gf->header;
+  if (this_node == 0) {
+    fclose(as->gf->fp);
+    as->gf->fp = NULL;
+  }
+  as->checksum_offset = sizeof(gh->magic_number) + sizeof(gh->dims)
+                      + sizeof(gh->time_stamp) + sizeof(gh->order);
+  as->head_size = as->checksum_offset + sizeof(as->check.sum29)
+                                      + sizeof(as->check.sum31);
+
+  as->n = sites_on_node;
+  as->list = sort_site_records(NULL);
+  as->buf = malloc(sites_on_node * NUMLINK * sizeof(*(as->buf)));
+  if (as->buf == NULL) {
+    printf("save_async: node%d can't malloc buf\n", this_node);
+    terminate(1);
+  }
+  for (j = 0; j < sites_on_node; j++)
+    d2f_mat(&lattice[as->list[j].site].link[0], &as->buf[NUMLINK * j]);
+  as->check.sum29 = 0;
+  as->check.sum31 = 0;
+  as->status = 0;
+  as->error = 0;
+
+  // The file must exist before any helper opens it
+  g_sync();
+  if (pthread_create(&as->thread, NULL, async_write, as) != 0) {
+    printf("save_async: node%d can't create helper thread\n", this_node);
+    terminate(1);
+  }
+  saving = as;
+  node0_printf("Saving gauge configuration in the background to %s\n",
+               filename);
+}
+
+// Wait for the save in progress, if any, and complete the file
+void finish_async_save() {
+  async_save *as = saving;
+  gauge_file *gf;
+
+  if (as == NULL)
+    return;
+  saving = NULL;
+  pthread_join(as->thread, NULL);
+  if (as->status != 0) {
+    printf("finish_async_save: node%d gauge configuration write error %d ",
+           this_node, as->error);
+    printf("file %s\n", as->tmpname);
+    fflush(stdout);
+    terminate(1);
+  }
+
+  // Combine node checksum contributions with global exclusive or,
+  // which every node only reaches once its helper has finished
+  gf = as->gf;
+  gf->check = as->check;
+  g_xor32(&gf->check.sum29);
+  g_xor32(&gf->check.sum31);
+
+  if (this_node == 0) {
+    gf->fp = fopen(as->tmpname, "r+b");
+    if (gf->fp == NULL || fseeko(gf->fp, as->checksum_offset, SEEK_SET) < 0) {
+      printf("finish_async_save: node0 can't write checksum error %d ", errno);
+      printf("file %s\n", as->tmpname);
+      fflush(stdout);
+      terminate(1);
+    }
+    write_checksum(gf);
+    fclose(gf->fp);
+    if (rename(as->tmpname, gf->filename) != 0) {
+      printf("finish_async_save: node0 can't rename %s to %s error %d\n",
+             as->tmpname, gf->filename, errno);
+      fflush(stdout);
+      terminate(1);
+    }
+    printf("Saved gauge configuration asynchronously to binary file %s\n",
+           gf->filename);
+    printf("Time stamp %s\n", gf->header->time_stamp);
+    write_gauge_info_file(gf);
+  }
+
+  free(as->list);
+  free(as->buf);
+  free(gf->header);
+  free(gf);
+  free(as);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Prefetch the lattice file to be reloaded next
+// This only warms the page cache: a helper thread on node 0 reads
+// through the whole file and discards the data, so that reload_lattice
+// reads it from memory rather than disk, but still decodes, checksums
+// and distributes it as usual, since that needs all the nodes
+// Failures are harmless, leaving reload_lattice to report any problem
+typedef struct {
+  char filename[MAXFILENAME];
+  pthread_t thread;
+} prefetch;
+
+static RANK_LOCAL prefetch *prefetching = NULL;
+
+static void *read_ahead(void *arg) {
+  prefetch *pf = (prefetch *)arg;
+  char buf[65536];
+  FILE *fp;
+
+  fp = fopen(pf->filename, "rb");
+  if (fp == NULL)
+    return NULL;
+  while (fread(buf, 1, sizeof(buf), fp) == sizeof(buf))
+    ;
+  fclose(fp);
+  return NULL;
+}
+
+void prefetch_lattice(char *filename) {
+  prefetch *pf;
+
+  finish_prefetch();
+  if (this_node != 0)
+    return;
+  pf = malloc(sizeof(*pf));
+  if (pf == NULL) {
+    printf("prefetch_lattice: node0 can't malloc pf\n");
+    terminate(1);
+  }
+  strncpy(pf->filename, filename, MAXFILENAME - 1);
+  pf->filename[MAXFILENAME - 1] = '\0';
+  if (pthread_create(&pf->thread, NULL, read_ahead, pf) != 0) {
+    free(pf);
+    return;
+  }
+  prefetching = pf;
+  printf("Prefetching gauge configuration %s\n", filename);
+}
+
+// Wait for the prefetch in progress, if any
+void finish_prefetch() {
+  prefetch *pf = prefetching;
+
+  if (pf == NULL)
+    return;
+  prefetching = NULL;
+  pthread_join(pf->thread, NULL);
+  free(pf);
+}
+// -----------------------------------------------------------------
+
+
+
 // -----------------------------------------------------------------
 // Top level routines
 // Restore lattice file by reading serially from node 0
@@ -575,6 +1180,38 @@ gauge_file* restore_serial(char *filename) {
   return gf;
 }
 
+// Report the header of a lattice file and the plaquette recorded
+// in its info file, without reading any links
+gauge_file* peek_serial(char *filename) {
+  gauge_file *gf;
+  char sums[64], ssplaq[64], stplaq[64], linktr[64], cksum[64];
+
+  gf = r_serial_i(filename);
+  if (this_node == 0) {
+    printf("Peeked at gauge configuration %s\n", filename);
+    if (gf->header->magic_number == GAUGE_VERSION_NUMBER)
+      printf("Time stamp %s\n", gf->header->time_stamp);
+    if (read_gauge_info_item(gf, "checksums", sums, sizeof(sums)) == 0) {
+      sscanf(sums, "%x %x", &gf->check.sum29, &gf->check.sum31);
+      printf("Checksums %x %x\n", gf->check.sum29, gf->check.sum31);
+    }
+    if (read_gauge_info_item(gf, "gauge.ssplaq", ssplaq, sizeof(ssplaq)) == 0
+     && read_gauge_info_item(gf, "gauge.stplaq", stplaq, sizeof(stplaq)) == 0)
+      printf("CHECK PLAQ: %s %s\n", ssplaq, stplaq);
+    else
+      printf("No plaquette in info file\n");
+    if (read_gauge_info_item(gf, "gauge.nersc_linktr",
+                             linktr, sizeof(linktr)) == 0
+     && read_gauge_info_item(gf, "gauge.nersc_checksum",
+                             cksum, sizeof(cksum)) == 0)
+      printf("CHECK NERSC LINKTR: %s CKSUM: %s\n", linktr, cksum);
+    fflush(stdout);
+  }
+  broadcast_bytes((char *)&gf->check, sizeof(gf->check));
+  r_serial_f(gf);
+  return gf;
+}
+
 // Save lattice in natural order by writing serially from node 0
 gauge_file* save_serial(char *filename) {
   gauge_file *gf;
@@ -585,4 +1222,34 @@ gauge_file* save_serial(char *filename) {
 
   return gf;
 }
+
+// Restore lattice file with every node reading its own sites
+gauge_file* restore_parallel(char *filename) {
+  gauge_file *gf;
+  gf = r_serial_i(filename);
+  if (gf->header->magic_number == LIME_MAGIC_NO) {
+    r_serial_f(gf);
+    // Close this reader and die with an error
+    free(gf->header);
+    free(gf);
+    node0_printf("Looks like a SciDAC file -- unsupported\n");
+    terminate(1);
+  }
+  else {
+    r_parallel(gf);
+    r_serial_f(gf);
+  }
+  return gf;
+}
+
+// Save lattice in natural order with every node writing its own sites
+gauge_file* save_parallel(char *filename) {
+  gauge_file *gf;
+
+  gf = w_serial_i(filename);
+  w_parallel(gf);
+  w_serial_f(gf);
+
+  return gf;
+}
 // -----------------------------------------------------------------
@@ -312,6 +312,42 @@ void write_gauge_info_file(gauge_file *gf) {
 
 
 
+// -----------------------------------------------------------------
+// Copy the value of keyword in the ASCII info file of gf,
+// without any quotes, to value with length nvalue
+// Return 0 if successful, 1 if the file or keyword is missing
+int read_gauge_info_item(gauge_file *gf, char *keyword,
+                         char *value, size_t nvalue) {
+  FILE *info_fp;
+  char info_filename[256], line[MAX_LINE_LENGTH], *pt;
+  size_t n, len = strlen(keyword);
+
+  strcpy(info_filename, gf->filename);
+  strcat(info_filename, ASCII_GAUGE_INFO_EXT);
+  if ((info_fp = fopen(info_filename, "r")) == NULL)
+    return 1;
+
+  // Lines have the form keyword = value or keyword = "value"
+  while (fgets(line, MAX_LINE_LENGTH, info_fp) != NULL) {
+    if (strncmp(line, keyword, len) != 0 || line[len] != ' ' ||
+        (pt = strchr(line + len, '=')) == NULL)
+      continue;
+    pt += strspn(pt + 1, " \"") + 1;
+    n = strcspn(pt, "\"\n");
+    if (n >= nvalue)
+      n = nvalue - 1;
+    strncpy(value, pt, n);
+    value[n] = '\0';
+    fclose(info_fp);
+    return 0;
+  }
+  fclose(info_fp);
+  return 1;
+}
+// -----------------------------------------------------------------
+
+
+
 // -----------------------------------------------------------------
 // Set up the input gauge file and gauge header structures
 gauge_file* setup_input_gauge_file(char *filename) {
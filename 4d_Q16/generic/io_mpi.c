@@ -0,0 +1,82 @@
+// -----------------------------------------------------------------
+// Wrappers for parallel file access using collective MPI-IO
+// for the site data and ANSI standard I/O otherwise
+// Requires com_mpi.c
+#include "generic_includes.h"
+#include "../include/io_lat.h"
+#include <sys/types.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mpi.h>
+
+FILE *g_open(const char *filename, const char *mode) {
+  return fopen(filename,mode);
+}
+
+int g_seek(FILE *stream, off_t offset, int whence) {
+  return fseeko(stream,offset,whence);
+}
+
+size_t g_write(const void *ptr, size_t size, size_t nmemb,FILE *stream) {
+  return fwrite(ptr,size,nmemb,stream);
+}
+
+size_t g_read(void *ptr, size_t size, size_t nmemb, FILE *stream) {
+  return fread(ptr,size,nmemb,stream);
+}
+
+int g_close(FILE *stream) {
+  return fclose(stream);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// The file view of each node selects its own records, so that a single
+// collective call moves all of the data, with MPI-IO free to aggregate
+// the requests of many nodes into large contiguous accesses
+static int sites_io(const char *filename, int amode, off_t offset,
+                    size_t size, int n, int32type *index, void *buf,
+                    int write) {
+  int count = 0, flag;
+  MPI_File fh;
+  MPI_Datatype record, filetype;
+  MPI_Status status;
+
+  if (MPI_File_open(MPI_COMM_WORLD, (char *)filename, amode,
+                    MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+    return 0;
+
+  MPI_Type_contiguous((int)size, MPI_BYTE, &record);
+  MPI_Type_commit(&record);
+  MPI_Type_create_indexed_block(n, 1, (int *)index, record, &filetype);
+  MPI_Type_commit(&filetype);
+  MPI_File_set_view(fh, (MPI_Offset)offset, record, filetype, "native",
+                    MPI_INFO_NULL);
+
+  if (write)
+    flag = MPI_File_write_all(fh, buf, n, record, &status);
+  else
+    flag = MPI_File_read_all(fh, buf, n, record, &status);
+  if (flag == MPI_SUCCESS)
+    MPI_Get_count(&status, record, &count);
+
+  MPI_Type_free(&filetype);
+  MPI_Type_free(&record);
+  if (MPI_File_close(&fh) != MPI_SUCCESS)
+    return 0;
+  return count;
+}
+
+// Node 0 has already created the file, so it is not truncated
+int g_write_sites(const char *filename, off_t offset, size_t size,
+                  int n, int32type *index, void *buf) {
+  return sites_io(filename, MPI_MODE_WRONLY, offset, size, n, index, buf, 1);
+}
+
+int g_read_sites(const char *filename, off_t offset, size_t size,
+                 int n, int32type *index, void *buf) {
+  return sites_io(filename, MPI_MODE_RDONLY, offset, size, n, index, buf, 0);
+}
+// -----------------------------------------------------------------
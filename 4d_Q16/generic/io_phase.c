@@ -1,36 +1,157 @@
 // -----------------------------------------------------------------
-// Crude IO for diagonal elements and columns of Q in pfaffian computation
-// For now keep things simple by not bothering with a header or checksums
-// In fact, let's not even bother with binary reading/writing for now
-// Each node reads and writes its own ascii file
+// Binary IO for diagonal elements and columns of Q in pfaffian computation
+// Each file starts with a phase_header recording the lattice, NCOL,
+// precision, number of nodes, range of columns or diagonal elements,
+// and checksums of both the gauge configuration and the data
+// Node 0 handles the diagonal elements, while every node reads and writes
+// its own rows of the columns of Q, through g_read_sites and g_write_sites
+// Loading checks the header against the running computation
 #include "generic_includes.h"
 #include "../include/io_lat.h"
+#include <sys/types.h>
+
+// This is dangerous -- it assumes off_t = long for this compilation
+#ifndef HAVE_FSEEKO
+#define fseeko fseek
+#endif
+
+// Columns of Q are copied through a buffer of up to this many bytes
+#define PHASE_BUF_BYTES (1 << 24)
 // -----------------------------------------------------------------
 
 
 
 // -----------------------------------------------------------------
 #ifdef PHASE
-// Only load completed diagonal elements on node0
-void load_diag(complex *diag, int ckpt_load) {
-  int i;
-  char infile[80];
-  FILE *fp = NULL;
+// Set up the header for elements first to last of this computation
+// Only node 0 has the checksums of the gauge configuration
+static void setup_phase_header(phase_header *ph, int magic,
+                               int first, int last) {
+  ph->magic_number = magic;
+  ph->dims[XUP] = nx;
+  ph->dims[YUP] = ny;
+  ph->dims[ZUP] = nz;
+  ph->dims[TUP] = nt;
+  ph->ncol = NCOL;
+  ph->precision = PRECISION;
+  ph->nodes = numnodes();
+  ph->first = first;
+  ph->last = last;
+  if (startlat_p != NULL)
+    ph->gauge = startlat_p->check;
+  else {
+    ph->gauge.sum29 = 0;
+    ph->gauge.sum31 = 0;
+  }
+  ph->check.sum29 = 0;
+  ph->check.sum31 = 0;
+}
+
+// Accumulate the checksums of n words of data,
+// the first of which is word on file (counting from the end of the header)
+static void data_cksums(gauge_check *gc, off_t word, void *buf, int n) {
+  int rank29 = word % 29, rank31 = word % 31;
+  accum_cksums(gc, &rank29, &rank31, (u_int32type *)buf, n);
+}
+
+// Only write the header from node0, creating the file
+static void write_phase_header(char *myname, char *filename,
+                               phase_header *ph) {
+  FILE *fp;
+
+  if (this_node != 0)
+    return;
+  fp = fopen(filename, "wb");
+  if (fp == NULL) {
+    printf("%s: node0 can't open file %s\n", myname, filename);
+    fflush(stdout);
+    terminate(1);
+  }
+  if (fwrite(ph, sizeof(*ph), 1, fp) != 1) {
+    printf("%s: node0 can't write header to %s\n", myname, filename);
+    fflush(stdout);
+    terminate(1);
+  }
+  fclose(fp);
+}
+
+// Read the header on node0 and check it against the one expected,
+// then give all nodes the checksums of the data in expect->check
+static void read_phase_header(char *myname, char *filename,
+                              phase_header *expect) {
+  int status = 0;
+  phase_header ph;
+  FILE *fp;
 
   if (this_node == 0) {
-    sprintf(infile, "%s.diag%d", startfile, ckpt_load);
-    fp = fopen(infile, "r");    // Open to read
+    fp = fopen(filename, "rb");
     if (fp == NULL) {
-      printf("load_diag: node0 can't open file %s\n", infile);
+      printf("%s: node0 can't open file %s\n", myname, filename);
+      fflush(stdout);
+      terminate(1);
+    }
+    if (fread(&ph, sizeof(ph), 1, fp) != 1) {
+      printf("%s: node0 can't read header from %s\n", myname, filename);
       fflush(stdout);
       terminate(1);
     }
-
-    for (i = 1; i < ckpt_load; i += 2)  // Every other is trivial
-      fscanf(fp, "%lg\n%lg\n", &(diag[i].real), &(diag[i].imag));
     fclose(fp);
+
+    if (ph.magic_number != expect->magic_number) {
+      printf("%s: %s has magic number %x but expected %x\n", myname,
+             filename, ph.magic_number, expect->magic_number);
+      status++;
+    }
+    else {
+      if (ph.dims[XUP] != nx || ph.dims[YUP] != ny ||
+          ph.dims[ZUP] != nz || ph.dims[TUP] != nt) {
+        printf("%s: %s is for a %dx%dx%dx%d lattice\n", myname, filename,
+               ph.dims[XUP], ph.dims[YUP], ph.dims[ZUP], ph.dims[TUP]);
+        status++;
+      }
+      if (ph.ncol != NCOL || ph.precision != PRECISION) {
+        printf("%s: %s has NCOL %d and PRECISION %d\n", myname, filename,
+               ph.ncol, ph.precision);
+        status++;
+      }
+      if (ph.nodes != numnodes()) {
+        printf("%s: %s was written by %d nodes\n", myname, filename,
+               ph.nodes);
+        status++;
+      }
+      if (ph.first != expect->first || ph.last != expect->last) {
+        printf("%s: %s has elements %d--%d but expected %d--%d\n", myname,
+               filename, ph.first + 1, ph.last, expect->first + 1,
+               expect->last);
+        status++;
+      }
+      if (ph.gauge.sum29 != expect->gauge.sum29 ||
+          ph.gauge.sum31 != expect->gauge.sum31) {
+        printf("%s: %s is for configuration with checksums %x %x ",
+               myname, filename, ph.gauge.sum29, ph.gauge.sum31);
+        printf("not %x %x\n", expect->gauge.sum29, expect->gauge.sum31);
+        status++;
+      }
+    }
+    expect->check = ph.check;
+    fflush(stdout);
+  }
+  broadcast_bytes((char *)&status, sizeof(status));
+  if (status != 0)
+    terminate(1);
+  broadcast_bytes((char *)&(expect->check), sizeof(expect->check));
+}
+
+// Compare the checksums computed while loading with those on file
+static void check_phase_cksums(char *myname, char *filename,
+                               gauge_check *test_gc, gauge_check *gc) {
+  if (test_gc->sum29 != gc->sum29 || test_gc->sum31 != gc->sum31) {
+    node0_printf("%s: Checksum violation for %s. ", myname, filename);
+    node0_printf("Computed %x %x.  Read %x %x.\n",
+                 test_gc->sum29, test_gc->sum31, gc->sum29, gc->sum31);
+    fflush(stdout);
+    terminate(1);
   }
-  g_sync();   // Don't let other nodes race ahead
 }
 #endif
 // -----------------------------------------------------------------
@@ -39,122 +160,104 @@ void load_diag(complex *diag, int ckpt_load) {
 
 // -----------------------------------------------------------------
 #ifdef PHASE
-// Only load non-zero elements of remaining columns of Q
-// Read from node0 only -- transfer data to all other nodes one by one
-void loadQ(complex **Q, int ckpt_load) {
-  int i, j, savi = 0, savj = 0, ret = 1, Ndat = 16 * DIMF, Qlen;
-  int mynode = 0, destnode = 0, Nlines = 0;
-  char infile[80];
-  Real re, im;
-  complex **tbuf = NULL;   // Only malloc on node0 if numnodes() > 1
+// Only load completed diagonal elements on node0
+void load_diag(complex *diag, int ckpt_load) {
+  int i, n = ckpt_load / 2;
+  char infile[MAXFILENAME + 16];
+  complex *buf;
+  gauge_check test_gc;
+  phase_header ph;
   FILE *fp = NULL;
 
-  // Total length of each column of Q
-  Qlen = sites_on_node * Ndat * sizeof(complex);
+  sprintf(infile, "%s.diag%d", startfile, ckpt_load);
+  setup_phase_header(&ph, PHASE_DIAG_VERSION_NUMBER, 0, ckpt_load);
+  read_phase_header("load_diag", infile, &ph);
 
   if (this_node == 0) {
-    node0_printf("Reloading columns %d--%d\n", ckpt_load + 1, volume * Ndat);
-    sprintf(infile, "%s.Q%d", startfile, ckpt_load);
-    fp = fopen(infile, "r");    // Open to read
-    if (fp == NULL) {
-      printf("loadQ: node%d can't open file %s\n", this_node, infile);
+    buf = malloc(n * sizeof(*buf));
+    if (buf == NULL) {
+      printf("load_diag: node0 can't malloc buf\n");
       fflush(stdout);
       terminate(1);
     }
-
-    // Allocate temporary storage to be passed to other nodes
-    // Only need if numnodes() > 1, but hard-code it in any case
-    // to suppress compiler warnings
-    tbuf = malloc(volume * Ndat * sizeof(complex*));
-    for (i = ckpt_load; i < volume * Ndat; i++) {
-      tbuf[i] = malloc(sites_on_node * Ndat * sizeof(complex));
-      for (j = 0; j < sites_on_node * Ndat; j++)
-        tbuf[i][j] = cmplx(0.0, 0.0);
-    }
-    if (tbuf[volume * Ndat - 1] == NULL) {
-      printf("loadQ: can't malloc tbuf\n");
+    fp = fopen(infile, "rb");    // Open to read
+    if (fp == NULL || fseeko(fp, sizeof(ph), SEEK_SET) < 0
+                   || (int)fread(buf, sizeof(*buf), n, fp) != n) {
+      printf("load_diag: node0 can't read file %s\n", infile);
       fflush(stdout);
       terminate(1);
     }
+    fclose(fp);
 
-    // Fill Q[i][j] on node0
-    while (ret != EOF && i > 0) {
-      ret = fscanf(fp, "%d\t%d\t%d\t%lg\t%lg\n", &mynode, &i, &j, &re, &im);
-      Nlines++;
-      if (mynode == 1) {
-        tbuf[i][j] = cmplx(re, im);   // So we don't lose this
-        break;
-      }
-      else if (mynode == -1) {
-        savi = i;
-        break;
-      }
-      Q[i][j] = cmplx(re, im);
-    }
+    test_gc.sum29 = 0;
+    test_gc.sum31 = 0;
+    data_cksums(&test_gc, 0, buf, n * sizeof(*buf) / sizeof(int32type));
+    check_phase_cksums("load_diag", infile, &test_gc, &ph.check);
+    for (i = 1; i < ckpt_load; i += 2)  // Every other is trivial
+      diag[i] = buf[i / 2];
+    free(buf);
   }
   g_sync();   // Don't let other nodes race ahead
+}
+#endif
+// -----------------------------------------------------------------
 
-  // Now fill in each other node in turn
-  for (destnode = 1; destnode < numnodes(); destnode++) {
-    // Fill rest of buffer on node0
-    if (this_node == 0) {
-      while (ret != EOF && i > 0) {
-        ret = fscanf(fp, "%d\t%d\t%d\t%lg\t%lg\n", &mynode, &i, &j, &re, &im);
-        Nlines++;
-        if (mynode != destnode) {
-          savi = i;   // May still need to write below
-          savj = j;
-          break;
-        }
-        tbuf[i][j] = cmplx(re, im);
-      }
-    }
-    g_sync();   // Don't let other nodes race ahead
-
-    // Now send buffer to destnode
-    for (i = ckpt_load; i < volume * Ndat; i++) {
-      if (this_node == 0)
-        send_field((char *)tbuf[i], Qlen, destnode);
-      else if (this_node == destnode)
-        get_field((char *)Q[i], Qlen, 0);
-
-      g_sync();   // To be cautious
-    }
 
-    // Reset tbuf if we have another node to do
-    if (this_node == 0 && mynode != -1) {
-      for (i = ckpt_load; i < volume * Ndat; i++) {
-        for (j = 0; j < sites_on_node * Ndat; j++)
-          tbuf[i][j] = cmplx(0.0, 0.0);
-      }
 
-      tbuf[savi][savj] = cmplx(re, im);
-    }
-    g_sync();   // Don't let other nodes race ahead
+// -----------------------------------------------------------------
+#ifdef PHASE
+// Load the rows of the remaining columns of Q on each node
+void loadQ(complex **Q, int ckpt_load) {
+  int i, k, n, Ndat = 16 * DIMF, block;
+  int Qlen = sites_on_node * Ndat * sizeof(complex);
+  int nword = Qlen / sizeof(int32type);
+  char infile[MAXFILENAME + 16], *buf;
+  int32type *index;
+  gauge_check test_gc;
+  phase_header ph;
+
+  node0_printf("Reloading columns %d--%d\n", ckpt_load + 1, volume * Ndat);
+  sprintf(infile, "%s.Q%d", startfile, ckpt_load);
+  setup_phase_header(&ph, PHASE_Q_VERSION_NUMBER, ckpt_load, volume * Ndat);
+  read_phase_header("loadQ", infile, &ph);
+
+  // Read blocks of columns, recording the position of each on file
+  block = PHASE_BUF_BYTES / Qlen;
+  if (block < 1)
+    block = 1;
+  index = malloc(block * sizeof(*index));
+  buf = malloc(block * Qlen);
+  if (index == NULL || buf == NULL) {
+    printf("loadQ: node%d can't malloc buf\n", this_node);
+    fflush(stdout);
+    terminate(1);
   }
 
-  // Now we should be done
-  if (this_node == 0) {
-    if (mynode != -1) {
-      printf("loadQ: should be done but tag = %d\n", mynode);
+  test_gc.sum29 = 0;
+  test_gc.sum31 = 0;
+  for (i = ckpt_load; i < volume * Ndat; i += n) {
+    n = volume * Ndat - i;
+    if (n > block)
+      n = block;
+    for (k = 0; k < n; k++)
+      index[k] = (i + k - ckpt_load) * numnodes() + this_node;
+    if (g_read_sites(infile, sizeof(ph), Qlen, n, index, buf) != n) {
+      printf("loadQ: node%d can't read file %s\n", this_node, infile);
       fflush(stdout);
       terminate(1);
     }
-
-      // Check that the correct number of elements were read
-    if (Nlines - 1 != savi) {   // End of file key
-      printf("loadQ: read %d elements but should have had %d\n",
-             Nlines - 1, savi);
-      fflush(stdout);
-      terminate(1);
+    for (k = 0; k < n; k++) {
+      data_cksums(&test_gc, (off_t)index[k] * nword, buf + k * Qlen, nword);
+      memcpy(Q[i + k], buf + k * Qlen, Qlen);
     }
-
-    fclose(fp);
-    for (i = ckpt_load; i < volume * Ndat; i++)
-      free(tbuf[i]);
-    free(tbuf);
   }
-  g_sync();   // Don't let other nodes race ahead
+  free(index);
+  free(buf);
+
+  // Combine node checksum contributions with global exclusive or
+  g_xor32(&test_gc.sum29);
+  g_xor32(&test_gc.sum31);
+  check_phase_cksums("loadQ", infile, &test_gc, &ph.check);
 }
 #endif
 // -----------------------------------------------------------------
@@ -165,23 +268,36 @@ void loadQ(complex **Q, int ckpt_load) {
 #ifdef PHASE
 // Only save completed diagonal elements on node0
 void save_diag(complex *diag, int ckpt_save) {
-  int i;
-  char outfile[80];
+  int i, n = ckpt_save / 2;
+  char outfile[MAXFILENAME + 16];
+  complex *buf;
+  phase_header ph;
   FILE *fp = NULL;
 
   if (this_node == 0) {
     sprintf(outfile, "%s.diag%d", startfile, ckpt_save);
-    fp = fopen(outfile, "w");    // Open to write
-    if (fp == NULL) {
-      printf("save_diag: node%d can't open file %s\n", this_node, outfile);
+    buf = malloc(n * sizeof(*buf));
+    if (buf == NULL) {
+      printf("save_diag: node0 can't malloc buf\n");
       fflush(stdout);
       terminate(1);
     }
-
     for (i = 1; i < ckpt_save; i += 2)  // Every other is trivial
-      fprintf(fp, "%.16g\n%.16g\n", diag[i].real, diag[i].imag);
-    fflush(fp);
+      buf[i / 2] = diag[i];
+
+    setup_phase_header(&ph, PHASE_DIAG_VERSION_NUMBER, 0, ckpt_save);
+    data_cksums(&ph.check, 0, buf, n * sizeof(*buf) / sizeof(int32type));
+    write_phase_header("save_diag", outfile, &ph);
+
+    fp = fopen(outfile, "r+b");    // Open to write after header
+    if (fp == NULL || fseeko(fp, sizeof(ph), SEEK_SET) < 0
+                   || (int)fwrite(buf, sizeof(*buf), n, fp) != n) {
+      printf("save_diag: node0 can't write file %s\n", outfile);
+      fflush(stdout);
+      terminate(1);
+    }
     fclose(fp);
+    free(buf);
   }
   g_sync();   // Don't let other nodes race ahead
 }
@@ -192,71 +308,58 @@ void save_diag(complex *diag, int ckpt_save) {
 
 // -----------------------------------------------------------------
 #ifdef PHASE
-// Only save non-zero elements of remaining columns of Q
-// Write from node0 only -- transfer data from all other nodes one by one
+// Save the rows of the remaining columns of Q on each node
+// The file holds each column in turn, split into the rows of each node
 void saveQ(complex **Q, int ckpt_save) {
-  int i, j, Ndat = 16 * DIMF, mynode, Nlines = 0, Qlen;
-  char outfile[80];
-  FILE *fp = NULL;
-
-  // Total length of each column of Q
-  Qlen = sites_on_node * Ndat * sizeof(complex);
-
-  if (this_node == 0) {
-    printf("Dumping columns %d--%d\n", ckpt_save + 1, volume * Ndat);
-    sprintf(outfile, "%s.Q%d", startfile, ckpt_save);
-    fp = fopen(outfile, "w");    // Open to write
-    if (fp == NULL) {
-      printf("saveQ: node%d can't open file %s\n", this_node, outfile);
-      fflush(stdout);
-      terminate(1);
-    }
-
-    // node0 data ready to go
-    for (i = ckpt_save; i < volume * Ndat; i++) {
-      for (j = 0; j < sites_on_node * Ndat; j++)
-        if (Q[i][j].real != 0.0 || Q[i][j].real != 0.0) { // Loose condition
-          fprintf(fp, "0\t%d\t%d\t%.16g\t%.16g\n",
-                      i, j, Q[i][j].real, Q[i][j].imag);
-          Nlines++;
-      }
-    }
-    fflush(fp);
+  int i, k, n, Ndat = 16 * DIMF, block;
+  int Qlen = sites_on_node * Ndat * sizeof(complex);
+  int nword = Qlen / sizeof(int32type);
+  char outfile[MAXFILENAME + 16], *buf;
+  int32type *index;
+  phase_header ph;
+
+  node0_printf("Dumping columns %d--%d\n", ckpt_save + 1, volume * Ndat);
+  sprintf(outfile, "%s.Q%d", startfile, ckpt_save);
+
+  // Node 0 writes the header, including the checksums of all nodes
+  setup_phase_header(&ph, PHASE_Q_VERSION_NUMBER, ckpt_save, volume * Ndat);
+  for (i = ckpt_save; i < volume * Ndat; i++) {
+    k = (i - ckpt_save) * numnodes() + this_node;
+    data_cksums(&ph.check, (off_t)k * nword, Q[i], nword);
+  }
+  g_xor32(&ph.check.sum29);
+  g_xor32(&ph.check.sum31);
+  write_phase_header("saveQ", outfile, &ph);
+  g_sync();   // The file must exist before other nodes open it
+
+  // Write blocks of columns, recording the position of each on file
+  block = PHASE_BUF_BYTES / Qlen;
+  if (block < 1)
+    block = 1;
+  index = malloc(block * sizeof(*index));
+  buf = malloc(block * Qlen);
+  if (index == NULL || buf == NULL) {
+    printf("saveQ: node%d can't malloc buf\n", this_node);
+    fflush(stdout);
+    terminate(1);
   }
-  g_sync();   // Don't let other nodes race ahead
-
-  // Overwrite node0 Q with elements of Q on mynode
-  for (mynode = 1; mynode < numnodes(); mynode++) {
-    for (i = ckpt_save; i < volume * Ndat; i++) {
-      if (this_node == mynode)
-        send_field((char *)Q[i], Qlen, 0);
-      else if (this_node == 0)
-        get_field((char *)Q[i], Qlen, mynode);
 
-      g_sync();   // To be cautious
+  for (i = ckpt_save; i < volume * Ndat; i += n) {
+    n = volume * Ndat - i;
+    if (n > block)
+      n = block;
+    for (k = 0; k < n; k++) {
+      index[k] = (i + k - ckpt_save) * numnodes() + this_node;
+      memcpy(buf + k * Qlen, Q[i + k], Qlen);
     }
-    if (this_node == 0) {   // Now print, as above
-      for (i = ckpt_save; i < volume * Ndat; i++) {
-        for (j = 0; j < sites_on_node * Ndat; j++)
-          if (Q[i][j].real != 0.0 || Q[i][j].real != 0.0) { // Loose condition
-            fprintf(fp, "%d\t%d\t%d\t%.16g\t%.16g\n",
-                        mynode, i, j, Q[i][j].real, Q[i][j].imag);
-            Nlines++;
-        }
-      }
-      fflush(fp);
+    if (g_write_sites(outfile, sizeof(ph), Qlen, n, index, buf) != n) {
+      printf("saveQ: node%d can't write file %s\n", this_node, outfile);
+      fflush(stdout);
+      terminate(1);
     }
-    g_sync();   // Don't let other nodes race ahead
-  }
-
-  if (this_node == 0) {
-    // Add a last line containing a unique tag (-1)
-    // and the number of elements that were written,
-    // so we can check that the correct number were reloaded
-    fprintf(fp, "-1\t%d\t-1\t-1\t-1\n", Nlines);
-    fflush(fp);
-    fclose(fp);
   }
+  free(index);
+  free(buf);
   g_sync();   // Don't let other nodes race ahead
 }
 #endif
@@ -21,6 +21,8 @@
    node_number(x, y, z, t) returns the node number on which a site lives.
    node_index(x, y, z, t) returns the index of the site on the node - ie the
      site is lattice[node_index(x, y, z, t)].
+   boundary_distance(x, y, z, t) returns the distance from a site to the
+     nearest face of its hypercube that is shared with another node
    get_logical_dimensions() returns the machine dimensions
    get_logical_coordinates() returns the mesh coordinates of this node
    These routines will change as we change our minds about how to distribute
@@ -33,9 +35,9 @@
 #include <qmp.h>
 #endif
 
-static int squaresize[4];           // Dimensions of hypercubes
-static int nsquares[4];             // Number of hypercubes in each direction
-static int machine_coordinates[4];  // Logical machine coordinates
+static RANK_LOCAL int squaresize[4];           // Dimensions of hypercubes
+static RANK_LOCAL int nsquares[4];             // Number of hypercubes in each direction
+static RANK_LOCAL int machine_coordinates[4];  // Logical machine coordinates
 
 int prime[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
 #define MAXPRIMES (sizeof(prime) / sizeof(int))
@@ -167,6 +169,28 @@ int node_index(int x, int y, int z, int t) {
 
 
 
+// -----------------------------------------------------------------
+// Only divided directions have faces shared with other nodes
+// With no divided direction, return a distance larger than the lattice
+int boundary_distance(int x, int y, int z, int t) {
+  int dir, r, dist = nx + ny + nz + nt;
+  int coord[4] = {x, y, z, t};
+
+  FORALLUPDIR(dir) {
+    if (nsquares[dir] == 1)
+      continue;
+    r = coord[dir] % squaresize[dir];
+    if (r < dist)
+      dist = r;
+    if (squaresize[dir] - 1 - r < dist)
+      dist = squaresize[dir] - 1 - r;
+  }
+  return dist;
+}
+// -----------------------------------------------------------------
+
+
+
 // -----------------------------------------------------------------
 size_t num_sites(int node) {
   return sites_on_node;
@@ -2,13 +2,19 @@
 // Allocate space for lattice fields in the site struct
 // Fill in coordinates, parity, index
 // Allocate gen_pt pointers for gather results
+// List interior and boundary sites, for overlapping gathers with work
 // Initialize site-based random number generator if SITERAND defined
 #include "generic_includes.h"
 #include <defines.h>                  // For SITERAND
 
+// Interior sites are at least this far from every face shared with
+// another node, so that all their neighbors at displacements of at most
+// one in each direction are on this node
+#define INTERIOR_DEPTH 1
+
 void make_lattice() {
   register int i;
-  int x, y, z, t;
+  int x, y, z, t, part;
 
   // Allocate space for lattice
   node0_printf("Mallocing %.1f MBytes per core for lattice\n",
@@ -52,6 +58,36 @@ void make_lattice() {
       }
     }
   }
+
+  // List interior sites followed by boundary sites, each in index order
+  // Loops can then work on the interior while gathers are in flight
+  n_part_sites[INTERIOR] = 0;
+  n_part_sites[BOUNDARY] = 0;
+  for (i = 0; i < sites_on_node; i++) {
+    if (boundary_distance(lattice[i].x, lattice[i].y,
+                          lattice[i].z, lattice[i].t) >= INTERIOR_DEPTH)
+      n_part_sites[INTERIOR]++;
+    else
+      n_part_sites[BOUNDARY]++;
+  }
+  part_sites[INTERIOR] = malloc(sites_on_node * sizeof(int));
+  if (part_sites[INTERIOR] == NULL) {
+    printf("node%d: no room for site lists\n", this_node);
+    terminate(1);
+  }
+  part_sites[BOUNDARY] = part_sites[INTERIOR] + n_part_sites[INTERIOR];
+
+  n_part_sites[INTERIOR] = 0;
+  n_part_sites[BOUNDARY] = 0;
+  for (i = 0; i < sites_on_node; i++) {
+    if (boundary_distance(lattice[i].x, lattice[i].y,
+                          lattice[i].z, lattice[i].t) >= INTERIOR_DEPTH)
+      part = INTERIOR;
+    else
+      part = BOUNDARY;
+    part_sites[part][n_part_sites[part]] = i;
+    n_part_sites[part]++;
+  }
 }
 
 void free_lattice() {
@@ -60,6 +96,8 @@ void free_lattice() {
   for (i = 0; i < N_POINTERS; i++)
     free(gen_pt[i]);
 
+  free(part_sites[INTERIOR]);
+
   free(lattice);
 }
 // -----------------------------------------------------------------
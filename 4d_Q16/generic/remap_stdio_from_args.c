@@ -14,6 +14,11 @@ int remap_stdio_from_args(int argc, char *argv[]) {
       return 1;
     }
   }
+#ifdef THREADS
+  // Ranks running as threads share stdout and stderr, remapped by node 0
+  if (mynode() != 0)
+    return 0;
+#endif
   if (argc > 2) {
     fp = freopen(argv[2], "w", stdout);
     if (fp == NULL) {
@@ -22,20 +22,20 @@
 #define restrict rstrict /* C-90 T3D cludge */
 
 // Variables set by setup_fourier() and used by fourier()
-int dim[4];   /* dimensions */
-int logdim[4];    /* log_2 of dimension */
-int bitrev_dir;   /* index for bit reverse gather */
-int *butterfly_dir[4];  /* indices for butterflies.  First index is
+RANK_LOCAL int dim[4];   /* dimensions */
+RANK_LOCAL int logdim[4];    /* log_2 of dimension */
+RANK_LOCAL int bitrev_dir;   /* index for bit reverse gather */
+RANK_LOCAL int *butterfly_dir[4];  /* indices for butterflies.  First index is
          direction, second is level.  The actual space
          will be malloc'ed in setup_fourier(). */
       /* Level 0 is the lowest order butterfly, i.e.
          reverse the righmost (ones) bit.  Levels
          range from 0 to n-1 when the dimension is 2^n */
-int pbaserev_dir;       /* index for base p analog of bit reverse map */
-int pcyclic_dir[4];     /* index for cyclic mod p gather */
-int dmin[4], dmax[4];   /* Restrictions on range of FT */
-int pfactor[4];         /* Residual prime factor p */
-int notbase2;           /* True if we need to do a base p != 2 transform */
+RANK_LOCAL int pbaserev_dir;       /* index for base p analog of bit reverse map */
+RANK_LOCAL int pcyclic_dir[4];     /* index for cyclic mod p gather */
+RANK_LOCAL int dmin[4], dmax[4];   /* Restrictions on range of FT */
+RANK_LOCAL int pfactor[4];         /* Residual prime factor p */
+RANK_LOCAL int notbase2;           /* True if we need to do a base p != 2 transform */
 // -----------------------------------------------------------------
 
 
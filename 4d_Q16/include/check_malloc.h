@@ -3,7 +3,7 @@
 #define CHECK_MALLOC_H
 
 #ifdef CHECK_MALLOC
-static void * _malloc_ptr;
+static RANK_LOCAL void * _malloc_ptr;
 
 #define malloc(_size) \
   (( (_malloc_ptr = malloc(_size)), \
@@ -22,6 +22,10 @@
 // msg_tag structure used for gathers
 // Actual structure defined in individual com_*.c files
 typedef struct msg_tag msg_tag;
+
+// sum_tag structure used for non-blocking global sums
+// Actual structure defined in individual com_*.c files
+typedef struct sum_tag sum_tag;
 // -----------------------------------------------------------------
 
 
@@ -41,10 +45,17 @@ void g_floatsum(Real *fpt);
 void g_vecfloatsum(Real *fpt, int nReals);
 void g_doublesum(double *dpt);
 void g_vecdoublesum(double *dpt, int ndoubles);
+sum_tag* g_vecdoublesum_start(double *dpt, int ndoubles);
+void g_sum_wait(sum_tag *tag);
 void g_complexsum(complex *cpt);
 void g_veccomplexsum(complex *cpt, int ncomplex);
 void g_dcomplexsum(double_complex *cpt);
 void g_vecdcomplexsum(double_complex *cpt, int ncomplex);
+void g_floatsum_add(Real *fpt);
+void g_doublesum_add(double *dpt);
+void g_complexsum_add(complex *cpt);
+void g_dcomplexsum_add(double_complex *cpt);
+sum_tag* g_sum_start();
 void g_xor32(u_int32type *pt );
 void g_floatmax(Real *fpt);
 void g_doublemax(double *dpt);
@@ -87,6 +98,13 @@ void prepare_gather(msg_tag *mbuf);
 void do_gather(msg_tag *mbuf);
 void wait_gather(msg_tag *mbuf);
 void cleanup_gather(msg_tag *mbuf);
+void rebind_gather(msg_tag *mbuf, void *old_field, void *field);
+void release_gather(msg_tag *mbuf);
+void gather_stats(double *nmsgs, double *nbytes);  // Sent by this node
+
+// Fields that other ranks on the same node can gather without copies
+void* malloc_shared(size_t size);
+void free_shared(void *ptr);
 
 msg_tag* start_gather_site(
   field_offset field, /* which field? Some member of structure "site" */
@@ -125,6 +143,16 @@ msg_tag* start_gather_field(
          one of EVEN, ODD or EVENANDODD. */
   char **dest);  /* one of the vectors of pointers */
 
+msg_tag* start_gather_strided(
+  void *field,          /* source buffer aligned to desired field */
+  int stride,           /* bytes between fields in source buffer */
+  int size,   /* size in bytes of the field (eg sizeof(vector))*/
+  int index,    /* direction to gather from. eg XUP - index into
+         neighbor tables */
+  int parity,   /* parity of sites whose neighbors we gather.
+         one of EVEN, ODD or EVENANDODD. */
+  char **dest);  /* one of the vectors of pointers */
+
 void accumulate_gather(
   msg_tag **mmtag,      /* msg_tag to accumulate into */
   msg_tag *mtag);       /* msg_tag to add to the gather */
@@ -37,5 +37,17 @@
 // Most systems have this (exceptions: T3E UNICOS)
 #define HAVE_FSEEKO 1
 
+// Define if <sys/mman.h> exists with POSIX mmap
+// Most systems have this (exception: NT)
+#define HAVE_MMAP 1
+
+// Storage class of global and static variables that each rank keeps
+// for itself, which with com_threads.c (-DTHREADS) are thread-local
+#ifdef THREADS
+#define RANK_LOCAL __thread
+#else
+#define RANK_LOCAL
+#endif
+
 #endif
 // -----------------------------------------------------------------
@@ -15,6 +15,17 @@
   }                                                     \
 }
 
+// Fields gathered often by the fermion operator can be read directly
+// by other ranks on the same node (malloc_shared in com_mpi.c)
+// Free them with free_shared()
+#define FIELD_ALLOC_SHARED(name, typ) {                        \
+  name = malloc_shared(sites_on_node * sizeof(typ));           \
+  if (name == NULL) {                                          \
+    printf("node%d: FIELD_ALLOC_SHARED failed\n", this_node);  \
+    terminate(1);                                              \
+  }                                                            \
+}
+
 #define FIELD_ALLOC_VEC(name, typ, size) {                    \
   int ifield;                                                 \
   for (ifield = 0; ifield < size; ifield++) {                 \
@@ -7,5 +7,9 @@
 
 // Gauge configuration file type
 #define GAUGE_VERSION_NUMBER         0x4e87     // Decimal 20103
+
+// Pfaffian checkpoint file types
+#define PHASE_DIAG_VERSION_NUMBER    0x4e88     // Decimal 20104
+#define PHASE_Q_VERSION_NUMBER       0x4e89     // Decimal 20105
 #endif
 // -----------------------------------------------------------------
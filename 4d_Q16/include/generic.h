@@ -45,6 +45,7 @@ int get_prompt(FILE *fp, int *value);
 void setup_layout();
 int node_number(int x, int y, int z, int t);
 int node_index(int x, int y, int z, int t);
+int boundary_distance(int x, int y, int z, int t);
 size_t num_sites(int node);
 const int *get_logical_dimensions();
 const int *get_logical_coordinate();
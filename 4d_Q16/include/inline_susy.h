@@ -0,0 +1,456 @@
+// -----------------------------------------------------------------
+// Header-only, always-inlined versions of the matrix kernels in libraries/
+// Every loop runs over the compile-time NCOL and is fully unrolled,
+// and the floating-point operations are performed in exactly the same order
+// as in the corresponding library routine, so results are bit-identical
+// Compiling with -DINLINE maps the library names onto these versions;
+// otherwise only the fused kernels below are used
+// The library routine can still be called as e.g. (mult_nn)(a, b, c)
+#ifndef _INLINE_SUSY_H
+#define _INLINE_SUSY_H
+
+#include "../include/complex.h"
+#include "../include/susy.h"
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+// Applied to each loop over NCOL, including the nested ones
+#if defined(__GNUC__) && (__GNUC__ >= 8) && !defined(__clang__)
+#define UNROLL_NCOL _Pragma("GCC unroll 16")
+#else
+#define UNROLL_NCOL
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Traces, as in trace.c, realtr.c and complextr.c
+ALWAYS_INLINE complex _inline_trace(matrix *a) {
+  register int i;
+  complex tc;
+  CADD(a->e[0][0], a->e[1][1], tc);
+  UNROLL_NCOL
+  for (i = 2; i < NCOL; i++)
+    CSUM(tc, a->e[i][i]);
+  return tc;
+}
+
+ALWAYS_INLINE Real _inline_realtrace_nn(matrix *a, matrix *b) {
+  register int i, j;
+  register Real sum = 0.0;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      sum += a->e[i][j].real * b->e[j][i].real
+           - a->e[i][j].imag * b->e[j][i].imag;
+    }
+  }
+  return sum;
+}
+
+ALWAYS_INLINE Real _inline_realtrace(matrix *a, matrix *b) {
+  register int i, j;
+  register Real sum = 0.0;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      sum += a->e[i][j].real * b->e[i][j].real
+           + a->e[i][j].imag * b->e[i][j].imag;
+    }
+  }
+  return sum;
+}
+
+ALWAYS_INLINE complex _inline_complextrace_nn(matrix *a, matrix *b) {
+  register int i, j;
+  register Real sumr = 0.0, sumi = 0.0;
+  complex sum;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      sumr += a->e[i][j].real * b->e[j][i].real
+            - a->e[i][j].imag * b->e[j][i].imag;
+      sumi += a->e[i][j].real * b->e[j][i].imag
+            + a->e[i][j].imag * b->e[j][i].real;
+    }
+  }
+  sum.real = sumr;
+  sum.imag = sumi;
+  return sum;
+}
+
+ALWAYS_INLINE complex _inline_complextrace_an(matrix *a, matrix *b) {
+  register int i, j;
+  register Real sumr = 0.0, sumi = 0.0;
+  complex sum;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      sumr += a->e[i][j].real * b->e[i][j].real
+            + a->e[i][j].imag * b->e[i][j].imag;
+      sumi += a->e[i][j].real * b->e[i][j].imag
+            - a->e[i][j].imag * b->e[i][j].real;
+    }
+  }
+  sum.real = sumr;
+  sum.imag = sumi;
+  return sum;
+}
+
+ALWAYS_INLINE complex _inline_complextrace_na(matrix *a, matrix *b) {
+  register int i, j;
+  register Real sumr = 0.0, sumi = 0.0;
+  complex sum;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      sumr += a->e[i][j].real * b->e[i][j].real
+            + a->e[i][j].imag * b->e[i][j].imag;
+      sumi += a->e[i][j].imag * b->e[i][j].real
+            - a->e[i][j].real * b->e[i][j].imag;
+    }
+  }
+  sum.real = sumr;
+  sum.imag = sumi;
+  return sum;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Element-wise operations, as in clear_mat.c, addmat.c, submat.c,
+// s_m_mat.c, s_m_amat.c, s_m_a_mat.c, s_m_a_amat.c, s_m_s_mat.c,
+// s_m_s_amat.c and cs_m_a_mat.c
+ALWAYS_INLINE void _inline_clear_mat(matrix *m) {
+  register int i, j;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      m->e[i][j].real = 0.0;
+      m->e[i][j].imag = 0.0;
+    }
+  }
+}
+
+ALWAYS_INLINE void _inline_sum_matrix(matrix *b, matrix *c) {
+  register int i, j;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real += b->e[i][j].real;
+      c->e[i][j].imag += b->e[i][j].imag;
+    }
+  }
+}
+
+ALWAYS_INLINE void _inline_dif_matrix(matrix *b, matrix *c) {
+  register int i, j;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real -= b->e[i][j].real;
+      c->e[i][j].imag -= b->e[i][j].imag;
+    }
+  }
+}
+
+ALWAYS_INLINE void _inline_scalar_mult_matrix(matrix *a, Real s, matrix *b) {
+  register int i, j;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      b->e[i][j].real = s * a->e[i][j].real;
+      b->e[i][j].imag = s * a->e[i][j].imag;
+    }
+  }
+}
+
+ALWAYS_INLINE void _inline_scalar_mult_adj_matrix(matrix *a, Real s,
+                                                  matrix *b) {
+  register int i, j;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      b->e[i][j].real = s * a->e[j][i].real;
+      b->e[i][j].imag = -1.0 * s * a->e[j][i].imag;
+    }
+  }
+}
+
+ALWAYS_INLINE void _inline_scalar_mult_sum_matrix(matrix *b, Real s,
+                                                  matrix *c) {
+  register int i, j;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real += s * b->e[i][j].real;
+      c->e[i][j].imag += s * b->e[i][j].imag;
+    }
+  }
+}
+
+ALWAYS_INLINE void _inline_scalar_mult_dif_matrix(matrix *b, Real s,
+                                                  matrix *c) {
+  register int i, j;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real -= s * b->e[i][j].real;
+      c->e[i][j].imag -= s * b->e[i][j].imag;
+    }
+  }
+}
+
+ALWAYS_INLINE void _inline_scalar_mult_sum_adj_matrix(matrix *b, Real s,
+                                                      matrix *c) {
+  register int i, j;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real += s * b->e[j][i].real;
+      c->e[i][j].imag -= s * b->e[j][i].imag;
+    }
+  }
+}
+
+ALWAYS_INLINE void _inline_scalar_mult_dif_adj_matrix(matrix *b, Real s,
+                                                      matrix *c) {
+  register int i, j;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real -= s * b->e[j][i].real;
+      c->e[i][j].imag += s * b->e[j][i].imag;
+    }
+  }
+}
+
+ALWAYS_INLINE void _inline_c_scalar_mult_sum_mat(matrix *b, complex *s,
+                                                 matrix *c) {
+  register int i, j;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real += b->e[i][j].real * s->real - b->e[i][j].imag * s->imag;
+      c->e[i][j].imag += b->e[i][j].imag * s->real + b->e[i][j].real * s->imag;
+    }
+  }
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Matrix multiplication, as in m_mat_nn.c, m_mat_na.c and m_mat_an.c
+// The NN_*, NA_* and AN_* macros give element (i, j) of the k-th term
+#define NN_RE(a, b, i, j, k) (a->e[i][k].real * b->e[k][j].real \
+                            - a->e[i][k].imag * b->e[k][j].imag)
+#define NN_IM(a, b, i, j, k) (a->e[i][k].imag * b->e[k][j].real \
+                            + a->e[i][k].real * b->e[k][j].imag)
+#define NA_RE(a, b, i, j, k) (a->e[i][k].real * b->e[j][k].real \
+                            + a->e[i][k].imag * b->e[j][k].imag)
+#define NA_IM(a, b, i, j, k) (a->e[i][k].imag * b->e[j][k].real \
+                            - a->e[i][k].real * b->e[j][k].imag)
+#define AN_RE(a, b, i, j, k) (a->e[k][i].real * b->e[k][j].real \
+                            + a->e[k][i].imag * b->e[k][j].imag)
+#define AN_IM(a, b, i, j, k) (a->e[k][i].real * b->e[k][j].imag \
+                            - a->e[k][i].imag * b->e[k][j].real)
+
+// Products are accumulated element by element in registers, in the same
+// order as the library, and c is written once at the end
+// Otherwise every store to c forces a and b to be reloaded,
+// since the compiler cannot rule out c overlapping them
+// (as in the library, c must not be a or b)
+// S is either empty or "s *" for a scalar factor s applied to each term
+#define MULT_INIT(RE, IM, S)                                            \
+  register int i, j, k;                                                 \
+  register Real re, im;                                                 \
+  matrix t;                                                             \
+  UNROLL_NCOL                                                           \
+  for (i = 0; i < NCOL; i++) {                                          \
+    UNROLL_NCOL                                                         \
+    for (j = 0; j < NCOL; j++) {                                        \
+      re = S RE(a, b, i, j, 0);                                         \
+      im = S IM(a, b, i, j, 0);                                         \
+      UNROLL_NCOL                                                       \
+      for (k = 1; k < NCOL; k++) {                                      \
+        re += S RE(a, b, i, j, k);                                      \
+        im += S IM(a, b, i, j, k);                                      \
+      }                                                                 \
+      t.e[i][j].real = re;                                              \
+      t.e[i][j].imag = im;                                              \
+    }                                                                   \
+  }                                                                     \
+  *c = t;
+
+// OP is += or -=
+#define MULT_ACC(RE, IM, OP, S)                                         \
+  register int i, j, k;                                                 \
+  register Real re, im;                                                 \
+  matrix t;                                                             \
+  UNROLL_NCOL                                                           \
+  for (i = 0; i < NCOL; i++) {                                          \
+    UNROLL_NCOL                                                         \
+    for (j = 0; j < NCOL; j++) {                                        \
+      re = c->e[i][j].real;                                             \
+      im = c->e[i][j].imag;                                             \
+      UNROLL_NCOL                                                       \
+      for (k = 0; k < NCOL; k++) {                                      \
+        re OP S RE(a, b, i, j, k);                                      \
+        im OP S IM(a, b, i, j, k);                                      \
+      }                                                                 \
+      t.e[i][j].real = re;                                              \
+      t.e[i][j].imag = im;                                              \
+    }                                                                   \
+  }                                                                     \
+  *c = t;
+
+// c <-- a * b, c <-- c + a * b and c <-- c - a * b,
+// plus the same with a scalar factor s applied to each term,
+// as in s_m_mat_nn.c, s_m_mat_na.c and s_m_mat_an.c
+// For a bc or perm factor s = +/-1 the scaled products give the same bits
+// as scaling either factor or the result by s, and save that extra pass
+#define INLINE_MULT(name, RE, IM)                                       \
+ALWAYS_INLINE void _inline_##name(matrix *a, matrix *b, matrix *c) {    \
+  MULT_INIT(RE, IM, )                                                   \
+}                                                                       \
+ALWAYS_INLINE void _inline_##name##_sum(matrix *a, matrix *b, matrix *c) { \
+  MULT_ACC(RE, IM, +=, )                                                \
+}                                                                       \
+ALWAYS_INLINE void _inline_##name##_dif(matrix *a, matrix *b, matrix *c) { \
+  MULT_ACC(RE, IM, -=, )                                                \
+}                                                                       \
+ALWAYS_INLINE void _inline_scalar_##name(matrix *a, matrix *b, Real s,  \
+                                         matrix *c) {                   \
+  MULT_INIT(RE, IM, s *)                                                \
+}                                                                       \
+ALWAYS_INLINE void _inline_scalar_##name##_sum(matrix *a, matrix *b,    \
+                                               Real s, matrix *c) {     \
+  MULT_ACC(RE, IM, +=, s *)                                             \
+}                                                                       \
+ALWAYS_INLINE void _inline_scalar_##name##_dif(matrix *a, matrix *b,    \
+                                               Real s, matrix *c) {     \
+  MULT_ACC(RE, IM, -=, s *)                                             \
+}
+
+INLINE_MULT(mult_nn, NN_RE, NN_IM)
+INLINE_MULT(mult_na, NA_RE, NA_IM)
+INLINE_MULT(mult_an, AN_RE, AN_IM)
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Fused kernels with no library counterpart
+// Each gives the same bits as the unfused sequence in its comment,
+// without storing the intermediate product
+
+// Re Tr[adag.b.c], as mult_nn(b, c, &t) followed by realtrace(a, &t)
+ALWAYS_INLINE Real realtrace_mult_nn(matrix *a, matrix *b, matrix *c) {
+  register int i, j, k;
+  register Real sum = 0.0, re, im;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    UNROLL_NCOL
+    for (j = 0; j < NCOL; j++) {
+      re = NN_RE(b, c, i, j, 0);
+      im = NN_IM(b, c, i, j, 0);
+      UNROLL_NCOL
+      for (k = 1; k < NCOL; k++) {
+        re += NN_RE(b, c, i, j, k);
+        im += NN_IM(b, c, i, j, k);
+      }
+      sum += a->e[i][j].real * re + a->e[i][j].imag * im;
+    }
+  }
+  return sum;
+}
+
+// Tr[a.b], as mult_nn(a, b, &t) followed by trace(&t)
+// Only the diagonal of the product is computed
+ALWAYS_INLINE complex trace_mult_nn(matrix *a, matrix *b) {
+  register int i, k;
+  complex tc, diag;
+  UNROLL_NCOL
+  for (i = 0; i < NCOL; i++) {
+    diag.real = NN_RE(a, b, i, i, 0);
+    diag.imag = NN_IM(a, b, i, i, 0);
+    UNROLL_NCOL
+    for (k = 1; k < NCOL; k++) {
+      diag.real += NN_RE(a, b, i, i, k);
+      diag.imag += NN_IM(a, b, i, i, k);
+    }
+    if (i == 0)
+      tc = diag;
+    else if (i == 1) {
+      tc.real += diag.real;   // Same as CADD(t00, t11, tc)
+      tc.imag += diag.imag;
+    }
+    else
+      CSUM(tc, diag);
+  }
+  return tc;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Map the library names onto the inlined versions
+#ifdef INLINE
+#define trace(a)                          _inline_trace(a)
+#define realtrace_nn(a, b)                _inline_realtrace_nn(a, b)
+#define realtrace(a, b)                   _inline_realtrace(a, b)
+#define complextrace_nn(a, b)             _inline_complextrace_nn(a, b)
+#define complextrace_an(a, b)             _inline_complextrace_an(a, b)
+#define complextrace_na(a, b)             _inline_complextrace_na(a, b)
+#define clear_mat(m)                      _inline_clear_mat(m)
+#define sum_matrix(b, c)                  _inline_sum_matrix(b, c)
+#define dif_matrix(b, c)                  _inline_dif_matrix(b, c)
+#define scalar_mult_matrix(a, s, b)       _inline_scalar_mult_matrix(a, s, b)
+#define scalar_mult_adj_matrix(a, s, b)   _inline_scalar_mult_adj_matrix(a, s, b)
+#define scalar_mult_sum_matrix(b, s, c)   _inline_scalar_mult_sum_matrix(b, s, c)
+#define scalar_mult_dif_matrix(b, s, c)   _inline_scalar_mult_dif_matrix(b, s, c)
+#define scalar_mult_sum_adj_matrix(b, s, c) \
+        _inline_scalar_mult_sum_adj_matrix(b, s, c)
+#define scalar_mult_dif_adj_matrix(b, s, c) \
+        _inline_scalar_mult_dif_adj_matrix(b, s, c)
+#define c_scalar_mult_sum_mat(b, s, c)    _inline_c_scalar_mult_sum_mat(b, s, c)
+#define mult_nn(a, b, c)                  _inline_mult_nn(a, b, c)
+#define mult_nn_sum(a, b, c)              _inline_mult_nn_sum(a, b, c)
+#define mult_nn_dif(a, b, c)              _inline_mult_nn_dif(a, b, c)
+#define mult_na(a, b, c)                  _inline_mult_na(a, b, c)
+#define mult_na_sum(a, b, c)              _inline_mult_na_sum(a, b, c)
+#define mult_na_dif(a, b, c)              _inline_mult_na_dif(a, b, c)
+#define mult_an(a, b, c)                  _inline_mult_an(a, b, c)
+#define mult_an_sum(a, b, c)              _inline_mult_an_sum(a, b, c)
+#define mult_an_dif(a, b, c)              _inline_mult_an_dif(a, b, c)
+#define scalar_mult_nn(a, b, s, c)        _inline_scalar_mult_nn(a, b, s, c)
+#define scalar_mult_nn_sum(a, b, s, c)    _inline_scalar_mult_nn_sum(a, b, s, c)
+#define scalar_mult_nn_dif(a, b, s, c)    _inline_scalar_mult_nn_dif(a, b, s, c)
+#define scalar_mult_na(a, b, s, c)        _inline_scalar_mult_na(a, b, s, c)
+#define scalar_mult_na_sum(a, b, s, c)    _inline_scalar_mult_na_sum(a, b, s, c)
+#define scalar_mult_na_dif(a, b, s, c)    _inline_scalar_mult_na_dif(a, b, s, c)
+#define scalar_mult_an(a, b, s, c)        _inline_scalar_mult_an(a, b, s, c)
+#define scalar_mult_an_sum(a, b, s, c)    _inline_scalar_mult_an_sum(a, b, s, c)
+#define scalar_mult_an_dif(a, b, s, c)    _inline_scalar_mult_an_dif(a, b, s, c)
+#endif
+#endif
+// -----------------------------------------------------------------
@@ -4,12 +4,16 @@
 #define _IO_LAT_H
 
 // Definitions of restore and save lattice flags used in io_helpers.c
-#define CONTINUE      10
-#define FRESH         11
-#define RANDOM        12
-#define RELOAD_SERIAL 13
-#define FORGET        40
-#define SAVE_SERIAL   42
+#define CONTINUE        10
+#define FRESH           11
+#define RANDOM          12
+#define RELOAD_SERIAL   13
+#define RELOAD_PARALLEL 14
+#define PEEK            15
+#define FORGET          40
+#define SAVE_SERIAL     42
+#define SAVE_PARALLEL   43
+#define SAVE_ASYNC      44
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>     // For write, close and off_t
@@ -71,6 +75,10 @@ char *gauge_info_keyword[] = {
       "gauge.previous.filename",
       "gauge.previous.time_stamp",
       "gauge.previous.checksums",
+      "gauge.ssplaq",
+      "gauge.stplaq",
+      "gauge.nersc_linktr",
+      "gauge.nersc_checksum",
       ""       // Last entry MUST be a zero-length keyword
 };
 #else
@@ -102,6 +110,15 @@ typedef struct {
 void read_lat_dim_gf(char *filename, int *ndim, int dims[]);
 gauge_file *restore_serial(char *filename);
 gauge_file *save_serial(char *filename);
+gauge_file *restore_parallel(char *filename);
+gauge_file *peek_serial(char *filename);
+gauge_file *save_parallel(char *filename);
+void save_async(char *filename);
+void finish_async_save();
+void prefetch_lattice(char *filename);
+void finish_prefetch();
+void accum_cksums(gauge_check *gc, int *rank29, int *rank31,
+                  u_int32type *buf, int n);
 int write_gauge_info_item( FILE *fpout, /* ascii file pointer */
            char *keyword,   /* keyword */
            char *fmt,       /* output format -
@@ -136,12 +153,20 @@ void write_appl_gauge_info(FILE *fp);
 
 
 // -----------------------------------------------------------------
-// Prototypes for I/O routine interface in generic/io_ansi.c
+// Prototypes for I/O routine interface in generic/io_ansi.c or io_mpi.c
 FILE *g_open(const char *filename, const char *mode);
 int g_seek(FILE *stream, off_t offset, int whence);
 size_t g_write(const void *ptr, size_t size, size_t nmemb,FILE *stream);
 size_t g_read(void *ptr, size_t size, size_t nmemb, FILE *stream);
 int g_close(FILE *stream);
+
+// Collective access by all nodes to records of size bytes starting offset
+// bytes into the file, with buf[j] at record index[j] in increasing order
+// Return the number of records read or written by this node
+int g_write_sites(const char *filename, off_t offset, size_t size,
+                  int n, int32type *index, void *buf);
+int g_read_sites(const char *filename, off_t offset, size_t size,
+                 int n, int32type *index, void *buf);
 // -----------------------------------------------------------------
 
 
@@ -175,6 +200,8 @@ int sprint_gauge_info_item(
   int stride);      /* byte stride of data if
           count > 1 */
 void write_gauge_info_file(gauge_file *gf);
+int read_gauge_info_item(gauge_file *gf, char *keyword,
+                         char *value, size_t nvalue);
 gauge_file *setup_input_gauge_file(char *filename);
 gauge_file *setup_output_gauge_file();
 void read_checksum(gauge_file *gf, gauge_check *test_gc);
@@ -192,6 +219,19 @@ void byterevn(int32type w[], int n);
 // -----------------------------------------------------------------
 // IO for columns and diagonal elements of matrix Q
 // in pfaffian phase calculation
+// Each binary checkpoint file starts with this header
+// The rows of Q are ordered by node, so the number of nodes must match
+typedef struct {
+  int32type magic_number;   // Identifies diag or Q checkpoint
+  int32type dims[NDIMS];    // Full lattice dimensions
+  int32type ncol;           // NCOL
+  int32type precision;      // PRECISION of the complex data
+  int32type nodes;          // Number of nodes
+  int32type first, last;    // Range of columns or diagonal elements
+  gauge_check gauge;        // Checksums of the gauge configuration
+  gauge_check check;        // Checksums of the data
+} phase_header;
+
 #ifdef PHASE
 void loadQ(complex **Q, int ckpt_load);
 void saveQ(complex **Q, int ckpt_save);
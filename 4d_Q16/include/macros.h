@@ -93,6 +93,48 @@ typedef int field_offset;
 
 
 
+// -----------------------------------------------------------------
+// Threaded site loops, active when compiled with -DOMP (and -fopenmp)
+// args are extra OpenMP clauses, e.g. private(tmat) reduction(+:sum)
+// Nothing in the loop body may communicate or use global scratch space
+// Usage:
+//  FORALLSITES_OMP(i, s, private(tmat) reduction(+:sum)) {
+//    ...
+//  } END_LOOP_OMP;
+#ifdef OMP
+#define STRINGIFY(x) #x
+#define FORALLSITES_OMP(i,s,args) \
+    _Pragma(STRINGIFY(omp parallel for private(i,s) args)) \
+    for(i=0;i<sites_on_node;i++){ s = &(lattice[i]); (void)s;
+#define END_LOOP_OMP }
+#else
+#define FORALLSITES_OMP(i,s,args) FORALLSITES(i,s){
+#define END_LOOP_OMP }
+#endif
+
+// Threaded loop over the interior or boundary sites, with part one of
+// INTERIOR and BOUNDARY, so that the interior can be done before waiting
+// on a gather
+// Usage:
+//  FORPARTSITES_OMP(i, s, INTERIOR, private(tmat)) {
+//    ...
+//  } END_LOOP_OMP;
+#define INTERIOR 0
+#define BOUNDARY 1
+#ifdef OMP
+#define FORPARTSITES_OMP(i,s,part,args) \
+    _Pragma(STRINGIFY(omp parallel for private(i,s) args)) \
+    for(int k_=0;k_<n_part_sites[part];k_++){ \
+      i = part_sites[part][k_]; s = &(lattice[i]); (void)s;
+#else
+#define FORPARTSITES_OMP(i,s,part,args) \
+    for(int k_=0;k_<n_part_sites[part];k_++){ \
+      i = part_sites[part][k_]; s = &(lattice[i]);
+#endif
+// -----------------------------------------------------------------
+
+
+
 // -----------------------------------------------------------------
 // Timing switches
 #ifdef TIMING
@@ -10,8 +10,10 @@
 
 // prn_pt is a pointer passed to myrand()
 Real gaussian_rand_no(double_prn *prn_pt) {
-  static int iset = 0;
-  static Real gset;
+  // The spare deviate belongs to each rank
+  // Make_threads links its own -DTHREADS build of this file
+  static RANK_LOCAL int iset = 0;
+  static RANK_LOCAL Real gset;
   Real fac, r, v1, v2;
 
   if  (iset == 0) {
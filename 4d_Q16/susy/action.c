@@ -20,24 +20,25 @@ void compute_DmuUmu() {
   msg_tag *mtag0 = NULL;
 
   FORALLDIR(mu) {
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, ) {
       mult_na(&(s->link[mu]), &(s->link[mu]), &(tempmat[i]));
       mult_an(&(s->link[mu]), &(s->link[mu]), &(tempmat2[i]));
-    }
+    } END_LOOP_OMP;
 
     // Gather tempmat2 from below
     mtag0 = start_gather_field(tempmat2, sizeof(matrix),
                                goffset[mu] + 1, EVENANDODD, gen_pt[0]);
     wait_gather(mtag0);
     if (mu == 0) {
-      FORALLSITES(i, s)        // Initialize
+      FORALLSITES_OMP(i, s, ) {        // Initialize
         sub_matrix(&(tempmat[i]), (matrix *)(gen_pt[0][i]), &(DmuUmu[i]));
+      } END_LOOP_OMP;
     }
     else {
-      FORALLSITES(i, s) {
+      FORALLSITES_OMP(i, s, ) {
         sum_matrix(&(tempmat[i]), &(DmuUmu[i]));
         dif_matrix((matrix *)(gen_pt[0][i]), &(DmuUmu[i]));
-      }
+      } END_LOOP_OMP;
     }
     cleanup_gather(mtag0);
   }
@@ -45,7 +46,7 @@ void compute_DmuUmu() {
   // Add plaquette determinant contribution if G is non-zero
   // Assume compute_plaqdet() has already been run
   if (doG) {
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, private(mu, nu, j, tc)) {
       FORALLDIR(mu) {
         FORALLDIR(nu) {
           if (mu == nu)
@@ -57,7 +58,7 @@ void compute_DmuUmu() {
             CSUM(DmuUmu[i].e[j][j], tc);
         }
       }
-    }
+    } END_LOOP_OMP;
   }
 }
 // -----------------------------------------------------------------
@@ -84,13 +85,13 @@ void compute_Fmunu() {
                                 goffset[nu], EVENANDODD, gen_pt[1]);
       wait_gather(mtag0);
       wait_gather(mtag1);
-      FORALLSITES(i, s) {
+      FORALLSITES_OMP(i, s, private(mat0, mat1)) {
         mat0 = (matrix *)(gen_pt[0][i]);
         mat1 = (matrix *)(gen_pt[1][i]);
         mult_nn(&(s->link[mu]), mat0, &(tempmat[i]));
         mult_nn(&(s->link[nu]), mat1, &(tempmat2[i]));
         sub_matrix(&(tempmat[i]), &(tempmat2[i]), &(Fmunu[index][i]));
-      }
+      } END_LOOP_OMP;
       cleanup_gather(mtag0);
       cleanup_gather(mtag1);
     }
@@ -111,7 +112,8 @@ double gauge_action(int do_det) {
   complex tc;
   matrix tmat, tmat2;
 
-  FORALLSITES(i, s) {
+  FORALLSITES_OMP(i, s, private(index, tc, tmat, tmat2)
+                        reduction(+:g_action)) {
     // d^2 term normalized by C2 / 2
     // DmuUmu includes the plaquette determinant contribution if G is non-zero
     mult_nn(&(DmuUmu[i]), &(DmuUmu[i]), &tmat);
@@ -135,7 +137,7 @@ double gauge_action(int do_det) {
     if (fabs(tc.imag) > IMAG_TOL)
       printf("node%d WARNING: Im[s_B[%d]] = %.4g\n", this_node, i, tc.imag);
 #endif
-  }
+  } END_LOOP_OMP;
   g_action *= kappa;
   g_doublesum(&g_action);
   return g_action;
@@ -190,11 +192,11 @@ double cWline_action() {
 
   FORALLUPDIR(mu) {
     if (length[mu] == 1) {
-      FORALLSITES(i, s) {
+      FORALLSITES_OMP(i, s, private(tmat) reduction(+:sum)) {
         mat_copy(&(s->link[mu]), &tmat);
         scalar_add_diag(&tmat, -1.0);
         sum += realtrace(&tmat, &tmat);       // (U - I)^dag.(U - I)
-      }
+      } END_LOOP_OMP;
     }
   }
   sum *= kappa * cWline * cWline;
@@ -215,7 +217,7 @@ double det_action() {
   int a, b;
   double re, im, det_action = 0.0;
 
-  FORALLSITES(i, s) {
+  FORALLSITES_OMP(i, s, private(a, b, re, im) reduction(+:det_action)) {
     FORALLDIR(a) {
       for (b = a + 1; b < NUMLINK; b++) {
         re = plaqdet[a][b][i].real;
@@ -224,7 +226,7 @@ double det_action() {
         det_action += im * im;
       }
     }
-  }
+  } END_LOOP_OMP;
   det_action *= kappa_u1;
   g_doublesum(&det_action);
   return det_action;
@@ -277,10 +279,10 @@ double mom_action() {
   register site *s;
   double sum = 0.0;
 
-  FORALLSITES(i, s) {
+  FORALLSITES_OMP(i, s, private(mu) reduction(+:sum)) {
     FORALLDIR(mu)
       sum += (double)realtrace(&(s->mom[mu]), &(s->mom[mu]));
-  }
+  } END_LOOP_OMP;
   g_doublesum(&sum);
   return sum;
 }
@@ -32,5 +32,6 @@ void block_mcrg(int block) {
     FORALLDIR(dir)
       mat_copy(&(s->mom[dir]), &(s->link[dir]));
   }
+  invalidate_link_halo();
 }
 // -----------------------------------------------------------------
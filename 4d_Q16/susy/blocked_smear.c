@@ -97,6 +97,7 @@ void blocked_stout(int Nsmear, double alpha, int bl) {
     // Overwrites s->link
     exp_mult();
   }
+  invalidate_link_halo();
 }
 // -----------------------------------------------------------------
 
@@ -121,7 +122,7 @@ void blocked_APE(int Nsmear, double alpha, int project, int bl) {
     stride *= 2;
 
   for (n = 0; n < Nsmear; n++) {
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, private(dir, tmat)) {
       FORALLDIR(dir) {
         // Decide what to do with links before smearing
         // Polar project, divide out determinant, or nothing
@@ -132,7 +133,7 @@ void blocked_APE(int Nsmear, double alpha, int project, int bl) {
         else
           mat_copy(&(s->link[dir]), &(s->mom[dir]));
       }
-    }
+    } END_LOOP_OMP;
 
     FORALLDIR(dir) {
       FORALLSITES(i, s)
@@ -157,5 +158,6 @@ void blocked_APE(int Nsmear, double alpha, int project, int bl) {
       }
     }
   }
+  invalidate_link_halo();
 }
 // -----------------------------------------------------------------
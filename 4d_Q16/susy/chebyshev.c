@@ -17,6 +17,14 @@ void chebyshev_coeff() {
   Twist_Fermion *vek = mpm;
   Twist_Fermion *vec_next = pm0;
   Twist_Fermion *vec_prev = rm;
+  // Traces for each coefficient, summed together for each source
+  double *trace = malloc((cheb_order + 1) * sizeof(*trace));
+
+  if (trace == NULL) {
+    printf("chebyshev_coeff: can't malloc trace\n");
+    fflush(stdout);
+    terminate(1);
+  }
 
   // Initialize results and cheb_err, then average over Nstoch
   for (j = 0; j < cheb_order; j++) {
@@ -30,11 +38,10 @@ void chebyshev_coeff() {
     tr = 0.0;
     FORALLSITES(i, s)
       tr += magsq_TF(&(z_rand[i]));
-    g_doublesum(&tr);
-    cheb_coeff[0] += tr;
-    cheb_err[0] += tr * tr;
+    trace[0] = tr;
 
     if (cheb_order < 1) {
+      free(trace);
       free(vek);
       free(vec_next);
       free(vec_prev);
@@ -42,25 +49,24 @@ void chebyshev_coeff() {
     }
 
     // Second special case: c[1]
-    DSq(z_rand, tempTF);
+    // DSq uses tempTF internally, so it can't be the destination
+    DSq(z_rand, vek);
     tr = 0.0;
     FORALLSITES(i, s) {
-      scalar_mult_TF(&(tempTF[i]), two_ov_diff, &(vek[i]));
+      scalar_mult_TF(&(vek[i]), two_ov_diff, &(vek[i]));
       scalar_mult_sum_TF(&(z_rand[i]), msum_ov_diff, &(vek[i]));
       copy_TF(&(z_rand[i]), &(vec_prev[i]));
 
       TF_rdot_sum(&(z_rand[i]), &(vek[i]), &tr);
     }
-    g_doublesum(&tr);
-    cheb_coeff[1] += tr;
-    cheb_err[1] += tr * tr;
+    trace[1] = tr;
 
     // General case: c[j]
     for (j = 2; j < cheb_order; j++) {
-      DSq(vek, tempTF);
+      DSq(vek, vec_next);
       tr = 0.0;
       FORALLSITES(i, s) {
-        scalar_mult_TF(&(tempTF[i]), four_ov_diff, &(vec_next[i]));
+        scalar_mult_TF(&(vec_next[i]), four_ov_diff, &(vec_next[i]));
         scalar_mult_sum_TF(&(vek[i]), m2sum_ov_diff, &(vec_next[i]));
         dif_TF(&(vec_prev[i]), &(vec_next[i]));
         TF_rdot_sum(&(z_rand[i]), &(vec_next[i]), &tr);
@@ -69,9 +75,14 @@ void chebyshev_coeff() {
         copy_TF(&(vek[i]), &(vec_prev[i]));
         copy_TF(&(vec_next[i]), &(vek[i]));
       }
-      g_doublesum(&tr);
-      cheb_coeff[j] += tr;
-      cheb_err[j] += tr * tr;
+      trace[j] = tr;
+    }
+
+    // Sum all traces at once
+    g_vecdoublesum(trace, cheb_order);
+    for (j = 0; j < cheb_order; j++) {
+      cheb_coeff[j] += trace[j];
+      cheb_err[j] += trace[j] * trace[j];
     }
 #ifdef DEBUG_CHECK
     node0_printf("Stochastic estimator %d of %d:\n", k, Nstoch);
@@ -88,5 +99,6 @@ void chebyshev_coeff() {
     cheb_err[j] = sqrt(fabs(tr - cheb_coeff[j] * cheb_coeff[j]));
     cheb_err[j] *= sqrt1_ov_Nm1;
   }
+  free(trace);
 }
 // -----------------------------------------------------------------
@@ -0,0 +1,287 @@
+// -----------------------------------------------------------------
+// Multi-mass CG with a chronological initial guess for the MD evolution
+// With cg_forecast = N > 0 we keep the last N solutions psim[0]
+// for each pseudofermion, and use them to forecast the next one
+// by minimal residual extrapolation (Brower et al., hep-lat/9509012):
+// g = sum_k c_k x_k minimizes the (D^2 + shift[0])-norm of the error
+// over the span of the saved solutions x_k
+
+// The shifted solves need collinear residuals, which a guess breaks,
+// so only the smallest shift starts from the guess:
+// psim[0] = M_0^(-1) src comes from a single-shift CG starting at g,
+// with M_j = D^2 + shift[j], and for the other shifts we use
+//   M_j^(-1) src = psim[0] + (shift[0] - shift[j]) M_j^(-1) psim[0]
+// up to the residual of psim[0], with one weighted multi-shift solve
+// on psim[0] that only needs |shift[0] - shift[j]| |r_j| to be small
+// This is immediate for the shifts close to shift[0]
+// and fast for the well-conditioned large shifts
+// Each solve gets half the target |r|, so every shift still satisfies
+// |src - M_j psim[j]|^2 <= errormin |src|^2
+
+// Reversibility safeguards: the history is cleared at the start of each
+// trajectory, so it never carries information across accept/reject steps,
+// and the guessed solve stops at a quarter of the usual |r|^2,
+// so every shift meets at least the same absolute stopping condition
+// as a solve from zero
+// We fall back to a zero guess if the forecast does not reduce |r|^2
+
+// The weighted solve costs roughly as much as a solve from zero for the
+// shifts near the smallest eigenvalue of D^2, so forecasting only pays
+// when the guess makes the shift-0 solve very cheap
+// We therefore compare the cost of each forecast solve with the solve
+// from zero that started the trajectory, and stop forecasting for the
+// rest of the trajectory once it no longer saves operator applications
+//#define CG_DEBUG
+#include "susy_includes.h"
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Persistent workspace, allocated on first use
+// hist[n][k] is the kth most recent psim[0] for pseudofermion n
+// Nsaved[n] < 0 switches off forecasting until the next forecast_reset()
+// Nzero[n] is the cost of the last solve from zero
+static RANK_LOCAL struct {
+  int Nhist, Nweight;
+  int *Nsaved, *Nzero;
+  double *gram, *chol, *coeff;
+  Real *weight;
+  Twist_Fermion ***hist, *gm;
+} fc_ws = {0};
+
+static Twist_Fermion *malloc_TF() {
+  Twist_Fermion *TF = malloc_shared(sites_on_node * sizeof(Twist_Fermion));
+  if (TF == NULL) {
+    printf("setup_forecast_workspace: can't malloc fields\n");
+    fflush(stdout);
+    terminate(1);
+  }
+  return TF;
+}
+
+static void setup_forecast_workspace() {
+  int n, k, Nh = cg_forecast;
+
+  if (fc_ws.Nhist == 0) {
+    fc_ws.Nhist = Nh;
+    fc_ws.Nsaved = malloc(Nroot * sizeof(*fc_ws.Nsaved));
+    fc_ws.Nzero  = malloc(Nroot * sizeof(*fc_ws.Nzero));
+    fc_ws.gram   = malloc(Nh * (Nh + 1) * sizeof(*fc_ws.gram));
+    fc_ws.chol   = malloc(Nh * Nh * sizeof(*fc_ws.chol));
+    fc_ws.coeff  = malloc(Nh * sizeof(*fc_ws.coeff));
+    fc_ws.hist   = malloc(Nroot * sizeof(*fc_ws.hist));
+    for (n = 0; n < Nroot; n++) {
+      fc_ws.Nsaved[n] = 0;
+      fc_ws.hist[n] = malloc(Nh * sizeof(**fc_ws.hist));
+      for (k = 0; k < Nh; k++)
+        fc_ws.hist[n][k] = malloc_TF();
+    }
+    fc_ws.gm = malloc_TF();
+  }
+  if (Norder > fc_ws.Nweight) {
+    free(fc_ws.weight);
+    fc_ws.Nweight = Norder;
+    fc_ws.weight = malloc(Norder * sizeof(*fc_ws.weight));
+  }
+}
+
+// Forget all saved solutions
+// Called at the start of each trajectory
+void forecast_reset() {
+  int n;
+  for (n = 0; n < Nroot && fc_ws.Nhist > 0; n++)
+    fc_ws.Nsaved[n] = 0;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Minimal residual extrapolation coefficients c_k, solving
+//   sum_l (x_k, M_0 x_l) c_l = (x_k, src)
+// by Cholesky decomposition, newest solutions first
+// Successive solutions are nearly parallel, so we drop the older ones
+// once they no longer add a numerically independent direction
+// Return the number of solutions to use, with c_k in fc_ws.coeff
+// Uses mpm for temporary storage
+static int forecast_coeffs(int n, Twist_Fermion *src, int Nh) {
+  register int i, k, l, m;
+  int Nuse;
+  register site *s;
+  double *G = fc_ws.gram, *L = fc_ws.chol, *c = fc_ws.coeff, *h, sum, d;
+  complex ctmp;
+  Twist_Fermion **x = fc_ws.hist[n];
+
+  // Upper triangle of G[k][l] = (x_k, M_0 x_l) and h[k] = (x_k, src)
+  h = G + Nh * Nh;
+  for (k = 0; k < Nh * (Nh + 1); k++)
+    G[k] = 0.0;
+  for (l = 0; l < Nh; l++) {
+    DSq(x[l], mpm);
+    FORALLSITES_OMP(i, s, ) {
+      scalar_mult_sum_TF(&(x[l][i]), shift[0], &(mpm[i]));
+    } END_LOOP_OMP;
+    for (k = 0; k <= l; k++) {
+      sum = 0.0;
+      FORALLSITES_OMP(i, s, private(ctmp) reduction(+:sum)) {
+        ctmp = TF_dot(&(x[k][i]), &(mpm[i]));
+        sum += ctmp.real;
+      } END_LOOP_OMP;
+      G[k * Nh + l] = sum;
+    }
+    sum = 0.0;
+    FORALLSITES_OMP(i, s, private(ctmp) reduction(+:sum)) {
+      ctmp = TF_dot(&(x[l][i]), &(src[i]));
+      sum += ctmp.real;
+    } END_LOOP_OMP;
+    h[l] = sum;
+  }
+  g_vecdoublesum(G, Nh * (Nh + 1));
+
+  // Cholesky decomposition G = L L^T, stopping at the first pivot
+  // that is not positive to better than roundoff
+  for (k = 0; k < Nh; k++) {
+    d = G[k * Nh + k];
+    for (m = 0; m < k; m++)
+      d -= L[k * Nh + m] * L[k * Nh + m];
+    if (d <= 1.0e-12 * G[k * Nh + k])
+      break;
+    L[k * Nh + k] = sqrt(d);
+    for (l = k + 1; l < Nh; l++) {
+      sum = G[k * Nh + l];
+      for (m = 0; m < k; m++)
+        sum -= L[l * Nh + m] * L[k * Nh + m];
+      L[l * Nh + k] = sum / L[k * Nh + k];
+    }
+  }
+  Nuse = k;
+
+  // Forward and back substitution
+  for (k = 0; k < Nuse; k++) {
+    sum = h[k];
+    for (m = 0; m < k; m++)
+      sum -= L[k * Nh + m] * c[m];
+    c[k] = sum / L[k * Nh + k];
+  }
+  for (k = Nuse - 1; k >= 0; k--) {
+    sum = c[k];
+    for (m = k + 1; m < Nuse; m++)
+      sum -= L[m * Nh + k] * c[m];
+    c[k] = sum / L[k * Nh + k];
+  }
+  return Nuse;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Same arguments and return value as congrad_multi(),
+// plus the index n of the pseudofermion whose solutions we save
+// The returned iteration count includes both solves,
+// but not the (at most) cg_forecast + 1 applications of D^2
+// for the forecast itself
+int congrad_forecast(int n, Twist_Fermion *src, Twist_Fermion **psim,
+                     int MaxCG, Real errormin, Real *size_r) {
+
+  register int i, j, k;
+  register site *s;
+  int Nh, iteration = 0;
+  Real floatvar, size_g, *weight;
+  double source_norm = 0.0, xsq = 0.0, rsq, rsqstop;
+  double *c;
+  Twist_Fermion *gm, **x, *tp;
+
+  if (cg_forecast == 0)
+    return congrad_multi(src, psim, MaxCG, errormin, size_r);
+
+  setup_forecast_workspace();
+  if (fc_ws.Nsaved[n] < 0)
+    return congrad_multi(src, psim, MaxCG, errormin, size_r);
+
+  gm     = fc_ws.gm;
+  weight = fc_ws.weight;
+  c      = fc_ws.coeff;
+  x      = fc_ws.hist[n];
+
+  Nh = fc_ws.Nsaved[n];
+  if (Nh > 0)
+    Nh = forecast_coeffs(n, src, Nh);
+
+  if (Nh > 0) {
+    // psim[0] = g = sum_k c_k x_k, leaving r0 = src - M_0 g in rm
+    FORALLSITES_OMP(i, s, private(k, floatvar) reduction(+:source_norm)) {
+      clear_TF(&(psim[0][i]));
+      for (k = 0; k < Nh; k++) {
+        floatvar = (Real)c[k];
+        scalar_mult_sum_TF(&(x[k][i]), floatvar, &(psim[0][i]));
+      }
+      source_norm += (double)magsq_TF(&(src[i]));
+    } END_LOOP_OMP;
+    g_doublesum(&source_norm);
+    rsq = true_residual(src, psim[0], shift[0], rm);
+#ifdef CG_DEBUG
+    node0_printf("congrad_forecast: %d vectors, rsq %.4g / %.4g\n",
+                 Nh, rsq, source_norm);
+#endif
+    if (rsq >= source_norm)
+      Nh = 0;
+  }
+
+  if (Nh > 0) {
+    // Single-shift CG for psim[0] from the guess
+    rsqstop = 0.25 * errormin * source_norm;
+    if (shift_tol != NULL)
+      rsqstop *= shift_tol[0];
+    iteration += refine_shift(src, psim[0], shift[0], MaxCG, rsq, rsqstop);
+    rsq = 0.0;
+    FORALLSITES_OMP(i, s, reduction(+:rsq)) {
+      rsq += (double)magsq_TF(&(rm[i]));
+    } END_LOOP_OMP;
+    g_doublesum(&rsq);
+    *size_r = (Real)rsq;
+
+    // psim[j] = psim[0] + (shift[0] - shift[j]) M_j^(-1) psim[0]
+    FORALLSITES_OMP(i, s, private(j) reduction(+:xsq)) {
+      copy_TF(&(psim[0][i]), &(gm[i]));
+      for (j = 1; j < Norder; j++)
+        copy_TF(&(psim[0][i]), &(psim[j][i]));
+      xsq += (double)magsq_TF(&(gm[i]));
+    } END_LOOP_OMP;
+    g_doublesum(&xsq);
+    for (j = 0; j < Norder; j++)
+      weight[j] = shift[0] - shift[j];
+    floatvar = (Real)(0.25 * errormin * source_norm / xsq);
+    iteration += congrad_multi_add(gm, psim, MaxCG, floatvar, &size_g,
+                                   weight);
+#ifdef CG_DEBUG
+    node0_printf("congrad_forecast: %d iterations, %d from zero\n",
+                 iteration + Nh + 1, fc_ws.Nzero[n]);
+#endif
+
+    // Stop forecasting if this was no cheaper than starting from zero
+    if (iteration + Nh + 1 >= fc_ws.Nzero[n]) {
+      fc_ws.Nsaved[n] = -1;
+      return iteration;
+    }
+  }
+  else {
+    iteration += congrad_multi(src, psim, MaxCG, errormin, size_r);
+    fc_ws.Nzero[n] = iteration;
+  }
+
+  // Save psim[0], overwriting the oldest solution
+  tp = x[fc_ws.Nhist - 1];
+  for (k = fc_ws.Nhist - 1; k > 0; k--)
+    x[k] = x[k - 1];
+  x[0] = tp;
+  FORALLSITES_OMP(i, s, ) {
+    copy_TF(&(psim[0][i]), &(x[0][i]));
+  } END_LOOP_OMP;
+  if (fc_ws.Nsaved[n] < fc_ws.Nhist)
+    fc_ws.Nsaved[n]++;
+
+  return iteration;
+}
+// -----------------------------------------------------------------
@@ -0,0 +1,300 @@
+// -----------------------------------------------------------------
+// Mixed-precision multi-mass conjugate gradient with reliable updates
+// Same recurrences as congrad_multi.c, but D^2 and all vector updates
+// run on single-precision copies of the links and fermions
+// The single-precision solutions are periodically added into the
+// double-precision psim, at which point the unshifted residual
+// r = src - (D^2 + shift[0]) psim[0] is recomputed in double precision
+// (Sleijpen--van der Vorst reliable updates)
+// This happens whenever |r|^2 drops by RELIABLE_DELTA^2
+// from its maximum since the last update, and before declaring convergence
+// The reliable updates only correct the unshifted system, so the shifted
+// solutions lose their collinearity with r and their recurrence residuals
+// are not trustworthy after the first update
+// Each shifted solution is therefore checked in double precision at the
+// end, and refined by a double-precision CG if it does not meet rsqmin,
+// so every shift meets the same stopping criterion as the
+// double-precision CG
+//#define CG_DEBUG
+#include "susy_includes.h"
+
+#define RELIABLE_DELTA 0.1
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Persistent workspace, kept across calls and grown only when Norder
+// exceeds what has already been allocated
+// Unlike congrad_multi.c, pm[0] is used, for the single-precision pm0
+static RANK_LOCAL struct {
+  int Nalloc;
+  int *converged;
+  double *zeta_i, *zeta_im1, *zeta_ip1, *beta_i, *beta_im1, *alpha;
+  float *fz, *fa, *fb;    // Single-precision copies of the coefficients
+  Twist_Fermion_f **pm, **xm, *rm, *mpm;
+} mx_ws = {0};
+
+static Twist_Fermion_f *malloc_TF_f() {
+  Twist_Fermion_f *TF = malloc_shared(sites_on_node * sizeof(Twist_Fermion_f));
+  if (TF == NULL) {
+    printf("setup_mixed_workspace: can't malloc fields\n");
+    fflush(stdout);
+    terminate(1);
+  }
+  return TF;
+}
+
+static void setup_mixed_workspace() {
+  int j;
+
+  if (mx_ws.Nalloc == 0) {
+    mx_ws.rm = malloc_TF_f();
+    mx_ws.mpm = malloc_TF_f();
+  }
+  if (Norder <= mx_ws.Nalloc)
+    return;
+
+  if (mx_ws.Nalloc > 0) {
+    for (j = 0; j < mx_ws.Nalloc; j++) {
+      free_shared(mx_ws.pm[j]);
+      free_shared(mx_ws.xm[j]);
+    }
+    free(mx_ws.pm);
+    free(mx_ws.xm);
+    free(mx_ws.converged);
+    free(mx_ws.zeta_i);
+    free(mx_ws.zeta_im1);
+    free(mx_ws.zeta_ip1);
+    free(mx_ws.beta_i);
+    free(mx_ws.beta_im1);
+    free(mx_ws.alpha);
+    free(mx_ws.fz);
+  }
+
+  mx_ws.Nalloc = Norder;
+  mx_ws.converged = malloc(Norder * sizeof(*mx_ws.converged));
+  mx_ws.zeta_i    = malloc(Norder * sizeof(*mx_ws.zeta_i));
+  mx_ws.zeta_im1  = malloc(Norder * sizeof(*mx_ws.zeta_im1));
+  mx_ws.zeta_ip1  = malloc(Norder * sizeof(*mx_ws.zeta_ip1));
+  mx_ws.beta_i    = malloc(Norder * sizeof(*mx_ws.beta_i));
+  mx_ws.beta_im1  = malloc(Norder * sizeof(*mx_ws.beta_im1));
+  mx_ws.alpha     = malloc(Norder * sizeof(*mx_ws.alpha));
+  mx_ws.fz        = malloc(3 * Norder * sizeof(*mx_ws.fz));
+  mx_ws.fa        = mx_ws.fz + Norder;
+  mx_ws.fb        = mx_ws.fa + Norder;
+  mx_ws.pm = malloc(Norder * sizeof(*mx_ws.pm));
+  mx_ws.xm = malloc(Norder * sizeof(*mx_ws.xm));
+  for (j = 0; j < Norder; j++) {
+    mx_ws.pm[j] = malloc_TF_f();
+    mx_ws.xm[j] = malloc_TF_f();
+  }
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Same arguments and return value as congrad_multi()
+// The returned iteration count includes any double-precision refinement
+int congrad_multi_mixed(Twist_Fermion *src, Twist_Fermion **psim,
+                        int MaxCG, Real errormin, Real *size_r) {
+
+  register int i, j;
+  register site *s;
+  int N_iter, iteration = 0, reliable = 0;
+  float fshift = (float)shift[0], fb0, fa0, *fz, *fa, *fb;
+  double rsq, rsqnew, rsqstop, maxrr, c1, c2, cd, rsqj, source_norm = 0.0;
+  int *converged;
+  double *zeta_i, *zeta_im1, *zeta_ip1, *beta_i, *beta_im1, *alpha;
+  Twist_Fermion_f **pm, **xm, *r, *mp;
+
+  setup_mixed_workspace();
+  converged = mx_ws.converged;
+  zeta_i    = mx_ws.zeta_i;
+  zeta_im1  = mx_ws.zeta_im1;
+  zeta_ip1  = mx_ws.zeta_ip1;
+  beta_i    = mx_ws.beta_i;
+  beta_im1  = mx_ws.beta_im1;
+  alpha     = mx_ws.alpha;
+  pm        = mx_ws.pm;
+  xm        = mx_ws.xm;
+  r         = mx_ws.rm;
+  mp        = mx_ws.mpm;
+  fz        = mx_ws.fz;
+  fa        = mx_ws.fa;
+  fb        = mx_ws.fb;
+
+  // Single-precision links for this gauge field
+  load_links_f();
+
+  // Zero initial guess, r = pm[j] = source
+  for (j = 0; j < Norder; j++) {
+    converged[j] = 0;
+    zeta_im1[j] = 1;
+    zeta_i[j] = 1;
+    alpha[j] = 0;
+    beta_im1[j] = 1;
+  }
+  FORALLSITES_OMP(i, s, private(j) reduction(+:source_norm)) {
+    TF_d2f(&(src[i]), &(r[i]));
+    for (j = 0; j < Norder; j++) {
+      clear_TF(&(psim[j][i]));
+      clear_TF_f(&(xm[j][i]));
+      pm[j][i] = r[i];
+    }
+    source_norm += (double)magsq_TF(&(src[i]));
+  } END_LOOP_OMP;
+  g_doublesum(&source_norm);
+  rsq = source_norm;
+  maxrr = rsq;
+  rsqstop = errormin * source_norm;
+#ifdef CG_DEBUG
+  node0_printf("congrad_mixed: source_norm = %.4g\n", source_norm);
+  node0_printf("stopping when residue is %.4g\n", rsqstop);
+#endif
+
+  for (N_iter = 0; N_iter < MaxCG && rsq > rsqstop; N_iter++) {
+    // mp = (M(u) + shift[0]) pm0
+    // beta_i[0] = -(r, r) / (pm0, Mpm0)
+    DSq_f(pm[0], mp);
+    iteration++;
+    total_iters++;
+    cd = 0.0;
+    FORALLSITES_OMP(i, s, reduction(+:cd)) {
+      scalar_mult_sum_TF_f(&(pm[0][i]), fshift, &(mp[i]));
+      cd += TF_rdot_f(&(pm[0][i]), &(mp[i]));
+    } END_LOOP_OMP;
+    g_doublesum(&cd);
+    beta_i[0] = -rsq / cd;
+
+    // beta_i(sigma), zeta_ip1(sigma)
+    zeta_ip1[0] = 1;
+    fb[0] = -(float)beta_i[0];
+    for (j = 1; j < Norder; j++) {
+      if (converged[j] == 0) {
+        zeta_ip1[j] = zeta_i[j] * zeta_im1[j] * beta_im1[0];
+        c1 = beta_i[0] * alpha[0] * (zeta_im1[j] - zeta_i[j]);
+        c2 = zeta_im1[j] * beta_im1[0] * (1 - (shift[j] - shift[0]) * beta_i[0]);
+        zeta_ip1[j] /= c1 + c2;
+        beta_i[j] = beta_i[0] * zeta_ip1[j] / zeta_i[j];
+        fb[j] = -(float)beta_i[j];
+      }
+    }
+
+    // pm[j] = zeta_i[j] * r + alpha[j] * pm[j] (from the last iteration)
+    // x[j] = x[j] - beta[j] * pm[j]
+    // r = r + beta[0] * mp
+    fb0 = (float)beta_i[0];
+    rsqnew = 0.0;
+    FORALLSITES_OMP(i, s, private(j) reduction(+:rsqnew)) {
+      scalar_mult_sum_TF_f(&(pm[0][i]), fb[0], &(xm[0][i]));
+      for (j = 1; j < Norder; j++) {
+        if (converged[j] == 0) {
+          if (N_iter > 0)
+            scalar_mult_add_TF_f(&(r[i]), fz[j], &(pm[j][i]), fa[j],
+                                 &(pm[j][i]));
+          scalar_mult_sum_TF_f(&(pm[j][i]), fb[j], &(xm[j][i]));
+        }
+      }
+      scalar_mult_sum_TF_f(&(mp[i]), fb0, &(r[i]));
+      rsqnew += magsq_TF_f(&(r[i]));
+    } END_LOOP_OMP;
+    g_doublesum(&rsqnew);
+    if (rsqnew > maxrr)
+      maxrr = rsqnew;
+
+    // Reliable update: accumulate x[j] into psim[j] and replace r by
+    // the true double-precision residual of the unshifted system
+    if (rsqnew < RELIABLE_DELTA * RELIABLE_DELTA * maxrr
+        || rsqnew <= rsqstop) {
+      FORALLSITES_OMP(i, s, private(j)) {
+        for (j = 0; j < Norder; j++) {
+          TF_f2d_sum(&(xm[j][i]), &(psim[j][i]));
+          clear_TF_f(&(xm[j][i]));
+        }
+      } END_LOOP_OMP;
+      rsqj = true_residual(src, psim[0], shift[0], rm);
+#ifdef CG_DEBUG
+      node0_printf(" reliable update %d: iterated rsq %.4g, true %.4g\n",
+                   reliable, rsqnew, rsqj);
+#endif
+      rsqnew = rsqj;
+      maxrr = rsqnew;
+      reliable++;
+      FORALLSITES_OMP(i, s, ) {
+        TF_d2f(&(rm[i]), &(r[i]));
+      } END_LOOP_OMP;
+    }
+
+    // alpha_ip1[j] -- note shifted indices with respect to Eq. 2.43!
+    alpha[0] = rsqnew / rsq;
+    for (j = 1; j < Norder; j++) {
+      if (converged[j] == 0)
+        alpha[j] = alpha[0] * zeta_ip1[j] * beta_i[j] / (zeta_i[j] * beta_i[0]);
+    }
+
+    // pm0 = r + alpha[0] * pm0, needed right away by the operator
+    // The other pm[j] updates are deferred to the next sweep above
+    fa0 = (float)alpha[0];
+    for (j = 1; j < Norder; j++) {
+      fz[j] = (float)zeta_ip1[j];
+      fa[j] = (float)alpha[j];
+    }
+    FORALLSITES_OMP(i, s, ) {
+      scalar_mult_add_TF_f(&(r[i]), 1.0, &(pm[0][i]), fa0, &(pm[0][i]));
+    } END_LOOP_OMP;
+
+    // Test for convergence
+    rsq = rsqnew;
+    for (j = 1; j < Norder; j++) {
+      if (converged[j] == 0) {
+        rsqj = rsq * zeta_ip1[j] * zeta_ip1[j];
+        if (rsqj <= rsqstop) {
+          converged[j] = 1;
+#ifdef CG_DEBUG
+          node0_printf(" psi%d converged in %d steps, rsq = %.4g\n",
+                       j, N_iter, rsqj);
+#endif
+        }
+      }
+    }
+#ifdef CG_DEBUG
+    if ((N_iter / 10) * 10 == N_iter) {
+      node0_printf("iter %d residue %.4g\n", N_iter, (double)(rsq));
+      fflush(stdout);
+    }
+#endif
+
+    // Scroll scalars
+    for (j = 0; j < Norder; j++) {
+      if (converged[j] == 0) {
+        beta_im1[j] = beta_i[j];
+        zeta_im1[j] = zeta_i[j];
+        zeta_i[j] = zeta_ip1[j];
+      }
+    }
+  }
+  // Accumulate anything left over if we ran out of iterations
+  FORALLSITES_OMP(i, s, private(j)) {
+    for (j = 0; j < Norder; j++)
+      TF_f2d_sum(&(xm[j][i]), &(psim[j][i]));
+  } END_LOOP_OMP;
+  if (rsq > rsqstop)
+    node0_printf(" multi CONGRAD not converged\n rsq = %.4g\n", rsq);
+  *size_r = rsq;
+
+  // Check and if necessary refine each shifted solution in double precision
+  for (j = 1; j < Norder; j++) {
+    rsqj = true_residual(src, psim[j], shift[j], rm);
+#ifdef CG_DEBUG
+    node0_printf(" psi%d true rsq %.4g after %d reliable updates\n",
+                 j, rsqj, reliable);
+#endif
+    if (rsqj > rsqstop)
+      iteration += refine_shift(src, psim[j], shift[j], MaxCG - iteration,
+                                rsqj, rsqstop);
+  }
+  return iteration;
+}
+// -----------------------------------------------------------------
@@ -4,10 +4,21 @@
 // shift[Norder] is the array of mass values, set up in setup_rhmc.c
 // BEWARE: The temporary TF pm[0] is never malloced or used
 
-// At least for now we hard-code a zero initial guess
+// We hard-code a zero initial guess here
+// congrad_forecast.c builds initial guesses on top of these solves
 // We check all psi for convergence and quit doing the converged ones
 
 // In this version of the code, all the scalars are real because M = Ddag D
+
+// With cg_pipelined = 1 we use a pipelined (Ghysels--Vanroose) variant
+// that needs one merged global sum per iteration, overlapped with D^2
+// With cg_mixed = 1 we use the mixed-precision version in congrad_mixed.c
+
+// If the global shift_tol is not NULL, shift j stops once
+// |r_j|^2 <= shift_tol[j] * errormin * |src|^2 (non-pipelined CG only)
+// The non-pipelined CG also records the Lanczos coefficients of the
+// unshifted system, from which cg_lambda_min() estimates the smallest
+// eigenvalue of D^2
 //#define CG_DEBUG
 #include "susy_includes.h"
 // -----------------------------------------------------------------
@@ -15,55 +26,528 @@
 
 
 // -----------------------------------------------------------------
+// Persistent workspace, kept across calls and grown only when Norder
+// exceeds what has already been allocated
+// pm[0] is never malloced or used, since we use the global pm0 instead
+// scale_z and scale_a hold the previous iteration's pm update coefficients,
+// which are applied lazily in the same sweep as the next psim update
+// lz_step and lz_dir hold the CG step lengths and direction updates
+// of the last non-pipelined solve, for Nlz iterations with shift lz_shift
+static RANK_LOCAL struct {
+  int Nalloc, Nlanczos, Nlz;
+  int *converged, *active;
+  Real *scale_z, *scale_a, *scale_b, lz_shift;
+  double *zeta_i, *zeta_im1, *zeta_ip1, *beta_i, *beta_im1, *alpha, *stop;
+  double *lz_step, *lz_dir;
+  Twist_Fermion **pm;
+  Twist_Fermion *wm, *qm, *zm, *sm;   // Only for pipelined CG
+} cg_ws = {0};
+
 // Keep all Norder-dependent mallocs here so that we can change Norder
+// The fields are in shared memory like the other fields gathered by
+// the fermion operator, so all ranks must set these up together
+static void setup_cg_workspace() {
+  int j;
+
+  if (Norder <= cg_ws.Nalloc)
+    return;
+
+  if (cg_ws.Nalloc > 0) {
+    for (j = 1; j < cg_ws.Nalloc; j++)
+      free_shared(cg_ws.pm[j]);
+    free(cg_ws.pm);
+    free(cg_ws.converged);
+    free(cg_ws.active);
+    free(cg_ws.scale_z);
+    free(cg_ws.scale_a);
+    free(cg_ws.scale_b);
+    free(cg_ws.zeta_i);
+    free(cg_ws.zeta_im1);
+    free(cg_ws.zeta_ip1);
+    free(cg_ws.beta_i);
+    free(cg_ws.beta_im1);
+    free(cg_ws.alpha);
+    free(cg_ws.stop);
+  }
+
+  cg_ws.Nalloc = Norder;
+  cg_ws.converged = malloc(Norder * sizeof(*cg_ws.converged));
+  cg_ws.active    = malloc(Norder * sizeof(*cg_ws.active));
+  cg_ws.scale_z   = malloc(Norder * sizeof(*cg_ws.scale_z));
+  cg_ws.scale_a   = malloc(Norder * sizeof(*cg_ws.scale_a));
+  cg_ws.scale_b   = malloc(Norder * sizeof(*cg_ws.scale_b));
+  cg_ws.zeta_i    = malloc(Norder * sizeof(*cg_ws.zeta_i));
+  cg_ws.zeta_im1  = malloc(Norder * sizeof(*cg_ws.zeta_im1));
+  cg_ws.zeta_ip1  = malloc(Norder * sizeof(*cg_ws.zeta_ip1));
+  cg_ws.beta_i    = malloc(Norder * sizeof(*cg_ws.beta_i));
+  cg_ws.beta_im1  = malloc(Norder * sizeof(*cg_ws.beta_im1));
+  cg_ws.alpha     = malloc(Norder * sizeof(*cg_ws.alpha));
+  cg_ws.stop      = malloc(Norder * sizeof(*cg_ws.stop));
+  cg_ws.pm = malloc(Norder * sizeof(*cg_ws.pm));
+  cg_ws.pm[0] = NULL;
+  for (j = 1; j < Norder; j++) {
+    cg_ws.pm[j] = malloc_shared(sites_on_node * sizeof(Twist_Fermion));
+    if (cg_ws.pm[j] == NULL) {
+      printf("setup_cg_workspace: can't malloc pm[%d]\n", j);
+      fflush(stdout);
+      terminate(1);
+    }
+  }
+}
+// -----------------------------------------------------------------
+
+
+
+
+// Storage for the Lanczos coefficients, grown with MaxCG
+static void setup_lanczos_workspace(int MaxCG) {
+  if (MaxCG <= cg_ws.Nlanczos)
+    return;
+
+  free(cg_ws.lz_step);
+  free(cg_ws.lz_dir);
+  cg_ws.Nlanczos = MaxCG;
+  cg_ws.lz_step = malloc(MaxCG * sizeof(*cg_ws.lz_step));
+  cg_ws.lz_dir  = malloc(MaxCG * sizeof(*cg_ws.lz_dir));
+}
+
+// Extra vectors for the pipelined CG, allocated on first use
+static void setup_pipe_workspace() {
+  if (cg_ws.wm != NULL)
+    return;
+
+  cg_ws.wm = malloc_shared(sites_on_node * sizeof(Twist_Fermion));
+  cg_ws.qm = malloc_shared(sites_on_node * sizeof(Twist_Fermion));
+  cg_ws.zm = malloc_shared(sites_on_node * sizeof(Twist_Fermion));
+  cg_ws.sm = malloc_shared(sites_on_node * sizeof(Twist_Fermion));
+  if (cg_ws.wm == NULL || cg_ws.qm == NULL
+                       || cg_ws.zm == NULL || cg_ws.sm == NULL) {
+    printf("setup_pipe_workspace: can't malloc fields\n");
+    fflush(stdout);
+    terminate(1);
+  }
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Pipelined multi-shift CG
+// Same arguments and return value as congrad_multi() below
+// The unshifted recurrences follow Ghysels and Vanroose,
+// with w = M r, s = M pm0, z = M s and q = M w,
+// where M = D^2 + shift[0]
+// (r, r) and (w, r) are summed together, while D^2 computes q = M w
+// (pm0, M pm0) then follows from (w, r) and the previous scalars,
+// and the shifted systems use the usual Jegerlehner recurrences
+// Costs four more vectors and one extra D^2 at the start and end
+static int congrad_multi_pipe(Twist_Fermion *src, Twist_Fermion **psim,
+                              int MaxCG, Real errormin, Real *size_r) {
+
+  register int i, j, k;
+  register site *s;
+  int N_iter, iteration = 0, Nactive = 0, first = 1;
+  Real floatvar, floatvar2, floatvar3;
+  double rsq = 0.0, rsqstop = 0.0, c1, c2, cd, delta, rsqj;
+  double g_rr = 0.0, g_wr = 0.0;
+  complex ctmp;
+  int *converged, *active;
+  Real *scale_z, *scale_a, *scale_b;
+  double *zeta_i, *zeta_im1, *zeta_ip1, *beta_i, *beta_im1, *alpha;
+  Twist_Fermion tf, **pm, *wm, *qm, *zm, *sm;
+  sum_tag *tag;
+
+  setup_cg_workspace();
+  setup_pipe_workspace();
+  converged = cg_ws.converged;
+  active    = cg_ws.active;
+  scale_z   = cg_ws.scale_z;
+  scale_a   = cg_ws.scale_a;
+  scale_b   = cg_ws.scale_b;
+  zeta_i    = cg_ws.zeta_i;
+  zeta_im1  = cg_ws.zeta_im1;
+  zeta_ip1  = cg_ws.zeta_ip1;
+  beta_i    = cg_ws.beta_i;
+  beta_im1  = cg_ws.beta_im1;
+  alpha     = cg_ws.alpha;
+  pm        = cg_ws.pm;
+  wm        = cg_ws.wm;
+  qm        = cg_ws.qm;
+  zm        = cg_ws.zm;
+  sm        = cg_ws.sm;
+
+  // Zero initial guess, r = source, w = M r
+  for (j = 0; j < Norder; j++) {
+    converged[j] = 0;
+    zeta_im1[j] = 1;
+    zeta_i[j] = 1;
+    alpha[j] = 0;
+    beta_im1[j] = 1;
+  }
+  FORALLSITES_OMP(i, s, ) {
+    copy_TF(&(src[i]), &(rm[i]));
+  } END_LOOP_OMP;
+  DSq(rm, wm);
+  floatvar = shift[0];
+  FORALLSITES_OMP(i, s, private(ctmp) reduction(+:g_rr, g_wr)) {
+    scalar_mult_sum_TF(&(rm[i]), floatvar, &(wm[i]));
+    g_rr += (double)magsq_TF(&(rm[i]));
+    ctmp = TF_dot(&(wm[i]), &(rm[i]));
+    g_wr += ctmp.real;
+  } END_LOOP_OMP;
+
+  for (N_iter = 0; ; N_iter++) {
+    // Sum (r, r) and (w, r) while computing q = D^2 w
+    g_doublesum_add(&g_rr);
+    g_doublesum_add(&g_wr);
+    tag = g_sum_start();
+    DSq(wm, qm);
+    g_sum_wait(tag);
+    delta = g_wr;
+
+    if (N_iter == 0) {
+      rsqstop = errormin * g_rr;
+#ifdef CG_DEBUG
+      node0_printf("congrad_pipe: source_norm = %.4g\n", g_rr);
+      node0_printf("stopping when residue is %.4g\n", rsqstop);
+#endif
+    }
+    else {
+      // Finish the previous iteration now that we have the new |r|^2
+      alpha[0] = g_rr / rsq;
+      for (j = 1; j < Norder; j++) {
+        if (converged[j] == 0)
+          alpha[j] = alpha[0] * zeta_ip1[j] * beta_i[j] / (zeta_i[j] * beta_i[0]);
+        scale_z[j] = (Real)zeta_ip1[j];
+        scale_a[j] = (Real)alpha[j];
+      }
+
+      // Test for convergence
+      for (j = 1; j < Norder; j++) {
+        if (converged[j] == 0) {
+          rsqj = g_rr * zeta_ip1[j] * zeta_ip1[j];
+          if (rsqj <= rsqstop) {
+            converged[j] = 1;
+#ifdef CG_DEBUG
+            node0_printf(" psi%d converged in %d steps, rsq = %.4g\n",
+                         j, N_iter, rsqj);
+#endif
+          }
+        }
+      }
+
+      // Scroll scalars
+      for (j = 0; j < Norder; j++) {
+        if (converged[j] == 0) {
+          beta_im1[j] = beta_i[j];
+          zeta_im1[j] = zeta_i[j];
+          zeta_i[j] = zeta_ip1[j];
+        }
+      }
+    }
+    rsq = g_rr;
+#ifdef CG_DEBUG
+    if ((N_iter / 10) * 10 == N_iter) {
+      node0_printf("iter %d residue %.4g\n", N_iter, (double)(rsq));
+      fflush(stdout);
+    }
+#endif
+    if (N_iter >= MaxCG || rsq <= rsqstop)
+      break;
+    iteration++;
+    total_iters++;
+
+    // (pm0, M pm0) = (w, r) - alpha[0] * (r, r) / (-beta_im1[0])
+    cd = delta + alpha[0] * rsq / beta_im1[0];
+    beta_i[0] = -rsq / cd;
+#ifdef CG_DEBUG
+    node0_printf("beta_i %.4g rsq %.4g cd %.4g\n", beta_i[0], rsq, cd);
+#endif
+
+    // beta_i(sigma)
+    // zeta_ip1(sigma)
+    zeta_ip1[0] = 1;
+    Nactive = 0;
+    for (j = 1; j < Norder; j++) {
+      if (converged[j] == 0) {
+        zeta_ip1[j] = zeta_i[j] * zeta_im1[j] * beta_im1[0];
+        c1 = beta_i[0] * alpha[0] * (zeta_im1[j] - zeta_i[j]);
+        c2 = zeta_im1[j] * beta_im1[0] * (1 - (shift[j] - shift[0]) * beta_i[0]);
+        zeta_ip1[j] /= c1 + c2;
+        beta_i[j] = beta_i[0] * zeta_ip1[j] / zeta_i[j];
+        scale_b[j] = -(Real)beta_i[j];
+        active[Nactive] = j;
+        Nactive++;
+      }
+    }
+
+    // pm[j] = zeta_i[j] * r + alpha[j] * pm[j]
+    // psim[j] = psim[j] - beta[j] * pm[j]
+    // pm0 = r + alpha[0] * pm0, s = w + alpha[0] * s, z = M w + alpha[0] * z
+    // r = r + beta[0] * s, w = w + beta[0] * z
+    floatvar = (Real)alpha[0];
+    floatvar2 = (Real)beta_i[0];
+    floatvar3 = shift[0];
+    g_rr = 0.0;
+    g_wr = 0.0;
+    FORALLSITES_OMP(i, s, private(j, k, tf, ctmp) reduction(+:g_rr, g_wr)) {
+      for (k = 0; k < Nactive; k++) {
+        j = active[k];
+        if (first) {
+          copy_TF(&(rm[i]), &(pm[j][i]));
+          scalar_mult_TF(&(pm[j][i]), scale_b[j], &(psim[j][i]));
+        }
+        else {
+          scalar_mult_TF(&(rm[i]), scale_z[j], &tf);
+          scalar_mult_add_TF(&tf, &(pm[j][i]), scale_a[j], &(pm[j][i]));
+          scalar_mult_sum_TF(&(pm[j][i]), scale_b[j], &(psim[j][i]));
+        }
+      }
+
+      copy_TF(&(qm[i]), &tf);
+      scalar_mult_sum_TF(&(wm[i]), floatvar3, &tf);
+      if (first) {
+        copy_TF(&(rm[i]), &(pm0[i]));
+        copy_TF(&(wm[i]), &(sm[i]));
+        copy_TF(&tf, &(zm[i]));
+        scalar_mult_TF(&(pm0[i]), -floatvar2, &(psim[0][i]));
+      }
+      else {
+        scalar_mult_add_TF(&(rm[i]), &(pm0[i]), floatvar, &(pm0[i]));
+        scalar_mult_add_TF(&(wm[i]), &(sm[i]), floatvar, &(sm[i]));
+        scalar_mult_add_TF(&tf, &(zm[i]), floatvar, &(zm[i]));
+        scalar_mult_sum_TF(&(pm0[i]), -floatvar2, &(psim[0][i]));
+      }
+      scalar_mult_sum_TF(&(sm[i]), floatvar2, &(rm[i]));
+      scalar_mult_sum_TF(&(zm[i]), floatvar2, &(wm[i]));
+
+      g_rr += (double)magsq_TF(&(rm[i]));
+      ctmp = TF_dot(&(wm[i]), &(rm[i]));
+      g_wr += ctmp.real;
+    } END_LOOP_OMP;
+    first = 0;
+  }
+  if (rsq > rsqstop)
+    node0_printf(" multi CONGRAD not converged\n rsq = %.4g\n", rsq);
+
+  // Zero solution if we never iterated
+  if (first) {
+    FORALLSITES_OMP(i, s, private(j)) {
+      for (j = 0; j < Norder; j++)
+        clear_TF(&(psim[j][i]));
+    } END_LOOP_OMP;
+  }
+
+  *size_r = rsq;
+  return iteration;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Residual r = src - (D^2 + shift) psi, returning |r|^2
+// Uses mpm for temporary storage
+double true_residual(Twist_Fermion *src, Twist_Fermion *psi,
+                     Real shift, Twist_Fermion *r) {
+
+  register int i;
+  register site *s;
+  double rsq = 0.0;
+
+  DSq(psi, mpm);
+  FORALLSITES_OMP(i, s, reduction(+:rsq)) {
+    scalar_mult_sum_TF(&(psi[i]), shift, &(mpm[i]));
+    sub_TF(&(src[i]), &(mpm[i]), &(r[i]));
+    rsq += (double)magsq_TF(&(r[i]));
+  } END_LOOP_OMP;
+  g_doublesum(&rsq);
+  return rsq;
+}
+
+// Double-precision CG refining psi until |src - (D^2 + shift) psi|^2
+// is below rsqstop, starting from its residual in rm with |rm|^2 = rsq
+// Also uses pm0 and mpm for temporary storage
+// Used to finish shifted solutions and to solve from an initial guess
+int refine_shift(Twist_Fermion *src, Twist_Fermion *psi, Real shift,
+                 int MaxCG, double rsq, double rsqstop) {
+
+  register int i;
+  register site *s;
+  int N_iter;
+  Real a, b;
+  double pmp, rsqnew;
+  complex ctmp;
+
+  FORALLSITES_OMP(i, s, ) {
+    copy_TF(&(rm[i]), &(pm0[i]));
+  } END_LOOP_OMP;
+  for (N_iter = 0; N_iter < MaxCG && rsq > rsqstop; N_iter++) {
+    DSq(pm0, mpm);
+    pmp = 0.0;
+    FORALLSITES_OMP(i, s, private(ctmp) reduction(+:pmp)) {
+      scalar_mult_sum_TF(&(pm0[i]), shift, &(mpm[i]));
+      ctmp = TF_dot(&(pm0[i]), &(mpm[i]));
+      pmp += ctmp.real;
+    } END_LOOP_OMP;
+    g_doublesum(&pmp);
+
+    a = (Real)(rsq / pmp);
+    rsqnew = 0.0;
+    FORALLSITES_OMP(i, s, reduction(+:rsqnew)) {
+      scalar_mult_sum_TF(&(pm0[i]), a, &(psi[i]));
+      scalar_mult_sum_TF(&(mpm[i]), -a, &(rm[i]));
+      rsqnew += (double)magsq_TF(&(rm[i]));
+    } END_LOOP_OMP;
+    g_doublesum(&rsqnew);
+
+    b = (Real)(rsqnew / rsq);
+    FORALLSITES_OMP(i, s, ) {
+      scalar_mult_add_TF(&(rm[i]), &(pm0[i]), b, &(pm0[i]));
+    } END_LOOP_OMP;
+    rsq = rsqnew;
+  }
+  total_iters += N_iter;
+#ifdef CG_DEBUG
+  node0_printf(" refined shift %.4g in %d steps, rsq = %.4g\n",
+               shift, N_iter, rsq);
+#endif
+  return N_iter;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Smallest eigenvalue of D^2, estimated by the smallest Ritz value of the
+// unshifted system in the last non-pipelined solve, minus its shift
+// With CG step lengths a_k and direction updates b_k, the Lanczos
+// tridiagonal matrix has T_kk = 1 / a_k + b_(k-1) / a_(k-1)
+// and T_k(k+1) = sqrt(b_k) / a_k
+// The Ritz value converges to the smallest eigenvalue from above
+// Return zero if there is no estimate
+Real cg_lambda_min() {
+  int k, m, count, N = cg_ws.Nlz;
+  double *a = cg_ws.lz_step, *b = cg_ws.lz_dir;
+  double lo = 0.0, hi, mid, q;
+
+  if (N == 0)
+    return 0.0;
+
+  // Bisect on the Sturm sequence count of eigenvalues below mid,
+  // starting from T_00 >= smallest Ritz value
+  hi = 1.0 / a[0];
+  for (m = 0; m < 60; m++) {
+    mid = 0.5 * (lo + hi);
+    count = 0;
+    q = 1.0;
+    for (k = 0; k < N; k++) {
+      if (k == 0)
+        q = 1.0 / a[0] - mid;
+      else
+        q = 1.0 / a[k] + b[k - 1] / a[k - 1] - mid
+            - b[k - 1] / (a[k - 1] * a[k - 1] * q);
+      if (q == 0.0)
+        q = 1.0e-300;
+      if (q < 0.0)
+        count++;
+    }
+    if (count > 0)
+      hi = mid;
+    else
+      lo = mid;
+  }
+  if (hi <= cg_ws.lz_shift)
+    return 0.0;
+  return (Real)(hi - cg_ws.lz_shift);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
 // Return number of iterations
 // src is where the source is created
 // psim[Norder] are working TFs for the conjugate gradient
 // MaxCG is the maximum number of iterations per solve
 // errormin is the target |r|^2, scaled below by source_norm = |src|^2
 // size_r is the final obtained |r|^2, hopefully < errormin * source_norm
-int congrad_multi(Twist_Fermion *src, Twist_Fermion **psim,
-                  int MaxCG, Real errormin, Real *size_r) {
 
-  register int i, j;
+// Apart from the operator, each iteration makes one sweep to add the shift
+// and compute (pm, Mpm), and one sweep that updates all unconverged psim[j]
+// and pm[j] along with r and |r|^2
+// Only pm0 needs an extra (single-vector) update before the next operator
+
+// If weight is not NULL, psim[j] += weight[j] * (D^2 + shift[j])^(-1) src
+// instead of being overwritten, with shift j converged once
+// weight[j]^2 |r_j|^2 <= errormin * source_norm
+// Then we iterate until every shift has converged,
+// and skip the shifts (including shift[0]) that start out converged
+// shift_tol likewise has us iterate until every shift has converged,
+// after which psim[0] is no longer updated
+static int congrad_multi_std(Twist_Fermion *src, Twist_Fermion **psim,
+                             int MaxCG, Real errormin, Real *size_r,
+                             Real *weight) {
+
+  register int i, j, k;
   register site *s;
-  int N_iter, iteration = 0;
-  int *converged = malloc(Norder * sizeof(*converged));
+  int N_iter, iteration = 0, Nactive = 0, first = 1, done;
+  int add = (weight != NULL), base_done = 0;
+  int per_shift = (add || shift_tol != NULL);
   Real floatvar, floatvar2;     // SSE kluge
-  Real *floatvarj = malloc(Norder * sizeof(*floatvarj));
-  Real *floatvark = malloc(Norder * sizeof(*floatvark));
   double rsq, rsqnew, source_norm = 0.0, rsqstop, c1, c2, cd;
-  double *zeta_i   = malloc(Norder * sizeof(*zeta_i));
-  double *zeta_im1 = malloc(Norder * sizeof(*zeta_im1));
-  double *zeta_ip1 = malloc(Norder * sizeof(*zeta_ip1));
-  double *beta_i   = malloc(Norder * sizeof(*beta_i));
-  double *beta_im1 = malloc(Norder * sizeof(*beta_im1));
-  double *alpha    = malloc(Norder * sizeof(*alpha));
   double rsqj;
   complex ctmp;
-  Twist_Fermion **pm = malloc(Norder * sizeof(**pm));
-  for (i = 1; i < Norder; i++)    // !!!
-    pm[i] = malloc(sites_on_node * sizeof(Twist_Fermion));
+  int *converged, *active;
+  Real *scale_z, *scale_a, *scale_b;
+  double *zeta_i, *zeta_im1, *zeta_ip1, *beta_i, *beta_im1, *alpha, *stop;
+  Twist_Fermion tf, **pm;
+
+  setup_cg_workspace();
+  setup_lanczos_workspace(MaxCG);
+  converged = cg_ws.converged;
+  active    = cg_ws.active;
+  scale_z   = cg_ws.scale_z;
+  scale_a   = cg_ws.scale_a;
+  scale_b   = cg_ws.scale_b;
+  zeta_i    = cg_ws.zeta_i;
+  zeta_im1  = cg_ws.zeta_im1;
+  zeta_ip1  = cg_ws.zeta_ip1;
+  beta_i    = cg_ws.beta_i;
+  beta_im1  = cg_ws.beta_im1;
+  alpha     = cg_ws.alpha;
+  stop      = cg_ws.stop;
+  pm        = cg_ws.pm;
+  cg_ws.Nlz = 0;
+  cg_ws.lz_shift = shift[0];
 
   // Initialize zero initial guess, etc.
   // dest = 0, r = source, pm[j] = r
-  for (i = 0; i < Norder; i++)
-    converged[i] = 0;
-  FORALLSITES(i, s) {
+  // psim[j] and pm[j] for j > 0 are set in the first iteration's sweep
+  FORALLSITES_OMP(i, s, reduction(+:source_norm)) {
     copy_TF(&(src[i]), &(rm[i]));
     copy_TF(&(rm[i]), &(pm0[i]));
-    clear_TF(&(psim[0][i]));
-    for (j = 1; j < Norder; j++) {
-      clear_TF(&(psim[j][i]));
-      copy_TF(&(rm[i]), &(pm[j][i]));
-    }
-  }
-
-  FORALLSITES(i, s)
     source_norm += (double)magsq_TF(&(src[i]));
+  } END_LOOP_OMP;
   g_doublesum(&source_norm);
   rsq = source_norm;
   rsqstop = errormin * source_norm;
+  for (j = 0; j < Norder; j++) {
+    converged[j] = 0;
+    stop[j] = rsqstop;
+    if (shift_tol != NULL)
+      stop[j] *= shift_tol[j];
+  }
+  done = (rsq <= rsqstop);
+  if (add) {
+    // converged[0] stays zero so that the base scalars keep scrolling
+    base_done = (weight[0] * weight[0] * rsq <= stop[0]);
+    done = base_done;
+    for (j = 1; j < Norder; j++) {
+      converged[j] = (weight[j] * weight[j] * rsq <= stop[j]);
+      done &= converged[j];
+    }
+  }
 #ifdef CG_DEBUG
   node0_printf("congrad: source_norm = %.4g\n", source_norm);
   node0_printf("stopping when residue is %.4g\n", rsqstop);
@@ -76,30 +560,32 @@ int congrad_multi(Twist_Fermion *src, Twist_Fermion **psim,
     beta_im1[j] = 1;
   }
 
-  for (N_iter = 0; N_iter < MaxCG && rsq > rsqstop; N_iter++) {
+  for (N_iter = 0; N_iter < MaxCG && !done; N_iter++) {
     // mp = (M(u) + shift[0]) pm
+    // beta_i[0] = -(r, r) / (pm, Mpm)
     DSq(pm0, mpm);
     iteration++;
     total_iters++;
-    FORALLSITES(i, s)
-      scalar_mult_sum_TF(&(pm0[i]), shift[0], &(mpm[i]));
-
-    // beta_i[0] = -(r, r) / (pm, Mpm)
     cd = 0;
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, private(ctmp) reduction(+:cd)) {
+      scalar_mult_sum_TF(&(pm0[i]), shift[0], &(mpm[i]));
       ctmp = TF_dot(&(pm0[i]), &(mpm[i]));
       cd += ctmp.real;
-    }
+    } END_LOOP_OMP;
     g_doublesum(&cd);
 
     beta_i[0] = -rsq / cd;
+    cg_ws.lz_step[N_iter] = -beta_i[0];
 #ifdef CG_DEBUG
     node0_printf("beta_i %.4g rsq %.4g cd %.4g\n", beta_i[0], rsq, cd);
 #endif
 
     // beta_i(sigma)
     // zeta_ip1(sigma)
+    // Converged shifts are dropped from the list of active ones,
+    // so the sweep below never touches their psim or pm
     zeta_ip1[0] = 1;
+    Nactive = 0;
     for (j = 1; j < Norder; j++) {
       if (converged[j] == 0) {
         zeta_ip1[j] = zeta_i[j] * zeta_im1[j] * beta_im1[0];
@@ -107,36 +593,57 @@ int congrad_multi(Twist_Fermion *src, Twist_Fermion **psim,
         c2 = zeta_im1[j] * beta_im1[0] * (1 - (shift[j] - shift[0]) * beta_i[0]);
         zeta_ip1[j] /= c1 + c2;
         beta_i[j] = beta_i[0] * zeta_ip1[j] / zeta_i[j];
+        scale_b[j] = -(Real)beta_i[j];
+        if (add)
+          scale_b[j] *= weight[j];
+        active[Nactive] = j;
+        Nactive++;
       }
     }
 
+    // pm[j] = zeta_i[j] * r + alpha[j] * pm[j] (from the last iteration)
     // psim[j] = psim[j] - beta[j] * pm[j]
+    // r = r + beta[0] * mp
     floatvar = -(Real)beta_i[0];
-    for (j = 1; j < Norder; j++) {
-      if (converged[j] == 0)
-        floatvarj[j] = -(Real)beta_i[j];
-    }
-
-    FORALLSITES(i, s) {
-      scalar_mult_sum_TF(&(pm0[i]), floatvar, &(psim[0][i]));
-      for (j = 1; j < Norder; j++) {
-        if (converged[j] == 0)
-          scalar_mult_sum_TF(&(pm[j][i]), floatvarj[j], &(psim[j][i]));
+    floatvar2 = (Real)beta_i[0];
+    if (add)
+      floatvar *= weight[0];
+    rsqnew = 0;
+    FORALLSITES_OMP(i, s, private(j, k, tf) reduction(+:rsqnew)) {
+      for (k = 0; k < Nactive; k++) {
+        j = active[k];
+        if (first) {
+          copy_TF(&(rm[i]), &(pm[j][i]));
+          if (add)
+            scalar_mult_sum_TF(&(pm[j][i]), scale_b[j], &(psim[j][i]));
+          else
+            scalar_mult_TF(&(pm[j][i]), scale_b[j], &(psim[j][i]));
+        }
+        else {
+          scalar_mult_TF(&(rm[i]), scale_z[j], &tf);
+          scalar_mult_add_TF(&tf, &(pm[j][i]), scale_a[j], &(pm[j][i]));
+          scalar_mult_sum_TF(&(pm[j][i]), scale_b[j], &(psim[j][i]));
+        }
       }
-    }
-
-    // r = r + beta[0] * mp
-    floatvar = (Real)beta_i[0];
-    FORALLSITES(i, s)
-      scalar_mult_sum_TF(&(mpm[i]), floatvar, &(rm[i]));
+      if (add) {
+        if (base_done == 0)
+          scalar_mult_sum_TF(&(pm0[i]), floatvar, &(psim[0][i]));
+      }
+      else if (first)
+        scalar_mult_TF(&(pm0[i]), floatvar, &(psim[0][i]));
+      else if (base_done == 0)
+        scalar_mult_sum_TF(&(pm0[i]), floatvar, &(psim[0][i]));
 
-    // alpha_ip1[j]
-    rsqnew = 0;
-    FORALLSITES(i, s)
+      scalar_mult_sum_TF(&(mpm[i]), floatvar2, &(rm[i]));
       rsqnew += (double)magsq_TF(&(rm[i]));
+    } END_LOOP_OMP;
+    first = 0;
 
+    // alpha_ip1[j]
     g_doublesum(&rsqnew);
     alpha[0] = rsqnew / rsq;
+    cg_ws.lz_dir[N_iter] = alpha[0];
+    cg_ws.Nlz = N_iter + 1;
 #ifdef CG_DEBUG
     node0_printf("alpha %.4g rsqnew %.4g rsq %.4g\n", alpha[0], rsqnew, rsq);
 #endif
@@ -147,30 +654,27 @@ int congrad_multi(Twist_Fermion *src, Twist_Fermion **psim,
         alpha[j] = alpha[0] * zeta_ip1[j] * beta_i[j] / (zeta_i[j] * beta_i[0]);
     }
 
-    // pm[j] = zeta_ip1[j] * r + alpha[j] * pm[j]
+    // pm0 = r + alpha[0] * pm0, needed right away by the operator
+    // The other pm[j] updates are deferred to the next sweep above
     floatvar  = (Real)zeta_ip1[0];
     floatvar2 = (Real)alpha[0];
     for (j = 1; j < Norder; j++) {
-      floatvarj[j] = (Real)zeta_ip1[j];
-      floatvark[j] = (Real)alpha[j];
-    }
-    FORALLSITES(i, s) {
-      scalar_mult_TF(&(rm[i]),floatvar, &(mpm[i]));
-      scalar_mult_add_TF(&(mpm[i]), &(pm0[i]), floatvar2, &(pm0[i]));
-      for (j = 1; j < Norder; j++) {
-        if (converged[j] == 0) {
-          scalar_mult_TF(&(rm[i]), floatvarj[j], &(mpm[i]));
-          scalar_mult_add_TF(&(mpm[i]), &(pm[j][i]), floatvark[j], &(pm[j][i]));
-        }
-      }
+      scale_z[j] = (Real)zeta_ip1[j];
+      scale_a[j] = (Real)alpha[j];
     }
+    FORALLSITES_OMP(i, s, private(tf)) {
+      scalar_mult_TF(&(rm[i]), floatvar, &tf);
+      scalar_mult_add_TF(&tf, &(pm0[i]), floatvar2, &(pm0[i]));
+    } END_LOOP_OMP;
 
     // Test for convergence
     rsq = rsqnew;
     for (j = 1; j < Norder; j++) {
       if (converged[j] == 0) {
         rsqj = rsq * zeta_ip1[j] * zeta_ip1[j];
-        if (rsqj <= rsqstop) {
+        if (add)
+          rsqj *= weight[j] * weight[j];
+        if (rsqj <= stop[j]) {
           converged[j] = 1;
 #ifdef CG_DEBUG
           node0_printf(" psi%d converged in %d steps, rsq = %.4g\n",
@@ -179,6 +683,18 @@ int congrad_multi(Twist_Fermion *src, Twist_Fermion **psim,
         }
       }
     }
+    if (per_shift) {
+      rsqj = rsq;
+      if (add)
+        rsqj *= weight[0] * weight[0];
+      if (rsqj <= stop[0])
+        base_done = 1;
+      done = base_done;
+      for (j = 1; j < Norder; j++)
+        done &= converged[j];
+    }
+    else
+      done = (rsq <= rsqstop);
 #ifdef CG_DEBUG
     if ((N_iter / 10) * 10 == N_iter) {
       node0_printf("iter %d residue %.4g\n", N_iter, (double)(rsq));
@@ -195,9 +711,17 @@ int congrad_multi(Twist_Fermion *src, Twist_Fermion **psim,
       }
     }
   }
-  if (rsq > rsqstop)
+  if (!done)
     node0_printf(" multi CONGRAD not converged\n rsq = %.4g\n", rsq);
 
+  // Zero solution if we never iterated
+  if (first && !add) {
+    FORALLSITES_OMP(i, s, private(j)) {
+      for (j = 0; j < Norder; j++)
+        clear_TF(&(psim[j][i]));
+    } END_LOOP_OMP;
+  }
+
   *size_r = rsq;
 
   // Test inversion
@@ -223,18 +747,29 @@ int congrad_multi(Twist_Fermion *src, Twist_Fermion **psim,
   }
 #endif
 
-  for (i = 1; i < Norder; i++)
-    free(pm[i]);
-  free(pm);
-  free(zeta_i);
-  free(zeta_ip1);
-  free(zeta_im1);
-  free(beta_im1);
-  free(beta_i);
-  free(alpha);
-  free(converged);
-  free(floatvarj);
-  free(floatvark);
   return iteration;
 }
 // -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Return number of iterations, dispatching to the selected variant
+int congrad_multi(Twist_Fermion *src, Twist_Fermion **psim,
+                  int MaxCG, Real errormin, Real *size_r) {
+
+  if (cg_pipelined == 1)
+    return congrad_multi_pipe(src, psim, MaxCG, errormin, size_r);
+  if (cg_mixed == 1)
+    return congrad_multi_mixed(src, psim, MaxCG, errormin, size_r);
+  return congrad_multi_std(src, psim, MaxCG, errormin, size_r, NULL);
+}
+
+// psim[j] += weight[j] * (D^2 + shift[j])^(-1) src, with stopping condition
+// weight[j]^2 |r_j|^2 <= errormin * |src|^2 for each shift
+// Always uses the double-precision non-pipelined CG
+int congrad_multi_add(Twist_Fermion *src, Twist_Fermion **psim,
+                      int MaxCG, Real errormin, Real *size_r, Real *weight) {
+  return congrad_multi_std(src, psim, MaxCG, errormin, size_r, weight);
+}
+// -----------------------------------------------------------------
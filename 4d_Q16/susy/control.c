@@ -139,6 +139,11 @@ int main(int argc, char *argv[]) {
 
     // Less frequent measurements every "propinterval" trajectories
     if ((traj_done % propinterval) == (propinterval - 1)) {
+      // With save_async, also checkpoint in the background,
+      // which overlaps with the measurements and next trajectories
+      if (saveflag == SAVE_ASYNC && traj_done < trajecs - 1)
+        save_lattice(saveflag, savefile);
+
 #ifdef SMEAR
       // Optionally smear before less frequent measurements
       // NO_SMEAR sets Nsmear = 0
@@ -243,6 +248,7 @@ int main(int argc, char *argv[]) {
         // With first argument outside XUP, ..., TUP,
         // first four links are included in gauge-fixing condition
         gaugefix(TUP, 1.5, 5000, GAUGE_FIX_TOL, -1, -1);
+        invalidate_link_halo();
         gtime += dclock();
         node0_printf("GFIX time = %.4g seconds\n", gtime);
         node0_printf("BEFORE %.8g %.8g\n", ss_plaq, st_plaq);
@@ -274,6 +280,7 @@ int main(int argc, char *argv[]) {
           FORALLDIR(dir)
             mat_copy(&(s->mom[dir]), &(s->link[dir]));
         }
+        invalidate_link_halo();
       }
 #endif
 
@@ -283,6 +290,7 @@ int main(int argc, char *argv[]) {
         FORALLDIR(dir)
           mat_copy(&(UpsiU[dir][i]), &(s->link[dir]));
       }
+      invalidate_link_halo();
 
       // Recompute unsmeared plaqdet, Uinv, DmuUmu and Fmunu
       compute_plaqdet();
@@ -321,6 +329,7 @@ int main(int argc, char *argv[]) {
   // Save lattice if requested
   if (saveflag != FORGET)
     save_lattice(saveflag, savefile);
+  finish_async_save();
   g_sync();         // Needed by at least some clusters
   return 0;
 }
@@ -0,0 +1,330 @@
+// -----------------------------------------------------------------
+// Main procedure for N=4 SYM single-link kernel benchmarks
+// Check accuracy and throughput of the thread-safe polar decomposition
+// and matrix log against the reference LAPACK versions,
+// using the links of the loaded configuration
+// Then time D^2 on a gaussian random source, comparing the AoSoA
+// and AoS layouts in -DSIMD_LAYOUT builds
+// Time general gathers at the displacements used by MCRG blocking
+// Finally time each library matrix kernel against its inlined version
+// from inline_susy.h, and the fused kernels against the unfused sequences
+#define CONTROL
+#include "susy_includes.h"
+
+// Time lib and inl, each run once per site per repetition,
+// with matrix output in tempmat and tempmat2, respectively,
+// and real output summed in lib_sum and inl_sum
+// Then record the largest deviation between the two, which should vanish
+#define BENCH_KERNEL(name, lib, inl) {                                 \
+  FORALLSITES(i, s) {                                                   \
+    clear_mat(&(tempmat[i]));                                           \
+    clear_mat(&(tempmat2[i]));                                          \
+  }                                                                     \
+  lib_sum = 0.0;                                                        \
+  inl_sum = 0.0;                                                        \
+  lib_time = -dclock();                                                 \
+  for (rep = 0; rep < Nrep; rep++) {                                    \
+    FORALLSITES(i, s) {                                                 \
+      lib;                                                              \
+    }                                                                   \
+  }                                                                     \
+  lib_time += dclock();                                                 \
+  dtime = -dclock();                                                    \
+  for (rep = 0; rep < Nrep; rep++) {                                    \
+    FORALLSITES(i, s) {                                                 \
+      inl;                                                              \
+    }                                                                   \
+  }                                                                     \
+  dtime += dclock();                                                    \
+  node0_printf("BENCH_KERNEL %-26s library %.4g inline %.4g calls/sec\n", \
+               name, links / lib_time, links / dtime);                  \
+  FORALLSITES(i, s) {                                                   \
+    diff = max_diff(&(tempmat[i]), &(tempmat2[i]));                     \
+    if (diff > max_kernel)                                              \
+      max_kernel = diff;                                                \
+  }                                                                     \
+  if (fabs(lib_sum - inl_sum) > max_kernel)                             \
+    max_kernel = fabs(lib_sum - inl_sum);                               \
+}
+
+// Maximum magnitude of the difference between two matrices
+Real max_diff(matrix *a, matrix *b) {
+  register int i, j;
+  Real diff, max = 0.0;
+  complex tc;
+
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      CSUB(a->e[i][j], b->e[i][j], tc);
+      diff = cabs(&tc);
+      if (diff > max)
+        max = diff;
+    }
+  }
+  return max;
+}
+
+int main(int argc, char *argv[]) {
+  register int i;
+  register site *s;
+  int prompt, dir, rep, Nrep, j, k, bl, disp[NDIMS], Nreal = sizeof(Twist_Fermion) / sizeof(Real);
+  Real diff, max_u = 0.0, max_P = 0.0, max_log = 0.0, *r, *r_v;
+#ifdef SIMD_LAYOUT
+  Real max_diff_v = 0.0, max_r = 0.0;
+#endif
+  Real max_kernel = 0.0, max_halo = 0.0;
+  int halo_save = halo_coalesce;
+  double dtime, links, lib_time, lib_sum, inl_sum;
+  double msgs, bytes, msgs0, bytes0, nops, ngathers;
+  Twist_Fermion *halo_dest[2];
+  msg_tag *tag;
+  matrix u, P, Plog, u_ref, P_ref, Plog_ref, tmat;
+  complex tc;
+
+  // Setup
+  setlinebuf(stdout); // DEBUG
+  initialize_machine(&argc, &argv);
+  // Remap standard I/O
+  if (remap_stdio_from_args(argc, argv) == 1)
+    terminate(1);
+
+  g_sync();
+  prompt = setup();
+  setup_lambda();
+  epsilon();
+  setup_PtoP();
+  setup_FQ();
+
+  // Load input and run (loop removed)
+  if (readin(prompt) != 0) {
+    node0_printf("ERROR in readin, aborting\n");
+    terminate(1);
+  }
+
+  // Accuracy: largest deviation from LAPACK over all links
+  FORALLSITES(i, s) {
+    FORALLDIR(dir) {
+      polar_LAPACK(&(s->link[dir]), &u_ref, &P_ref);
+      matrix_log_LAPACK(&P_ref, &Plog_ref);
+      polar(&(s->link[dir]), &u, &P);
+      matrix_log(&P, &Plog);
+
+      diff = max_diff(&u, &u_ref);
+      if (diff > max_u)
+        max_u = diff;
+      diff = max_diff(&P, &P_ref);
+      if (diff > max_P)
+        max_P = diff;
+      diff = max_diff(&Plog, &Plog_ref);
+      if (diff > max_log)
+        max_log = diff;
+    }
+  }
+  g_floatmax(&max_u);
+  g_floatmax(&max_P);
+  g_floatmax(&max_log);
+  node0_printf("BENCH_POLAR max deviation from LAPACK: ");
+  node0_printf("u %.4g P %.4g log %.4g\n", max_u, max_P, max_log);
+
+  // Throughput: repeat enough to process roughly a million links per node
+  Nrep = 1 + 1000000 / (NUMLINK * sites_on_node);
+  links = (double)Nrep * NUMLINK * sites_on_node;
+
+  dtime = -dclock();
+  for (rep = 0; rep < Nrep; rep++) {
+    FORALLSITES(i, s) {
+      FORALLDIR(dir) {
+        polar_LAPACK(&(s->link[dir]), &(tempmat[i]), &(tempmat2[i]));
+        matrix_log_LAPACK(&(tempmat2[i]), &(tempmat2[i]));
+      }
+    }
+  }
+  dtime += dclock();
+  node0_printf("BENCH_POLAR LAPACK  %.4g links/sec per node\n",
+               links / dtime);
+
+  dtime = -dclock();
+  for (rep = 0; rep < Nrep; rep++) {
+    FORALLDIR(dir) {
+      polar_site(F_OFFSET(link[dir]), tempmat, tempmat2);
+      matrix_log_field(tempmat2, tempmat2);
+    }
+  }
+  dtime += dclock();
+  node0_printf("BENCH_POLAR batched %.4g links/sec per node\n",
+               links / dtime);
+
+  // D^2 on a gaussian random source in pm0
+  FORALLSITES(i, s) {
+    r = (Real *)&(pm0[i]);
+    for (j = 0; j < Nreal; j++)
+      r[j] = gaussian_rand_no(&(s->site_prn));
+  }
+  Nrep = 1 + 100000 / sites_on_node;
+  links = (double)Nrep * sites_on_node;
+  DSq(pm0, mpm);                // Gather the link halo outside the timing
+#ifdef SIMD_LAYOUT
+  simd_layout = 0;
+#endif
+  dtime = -dclock();
+  for (rep = 0; rep < Nrep; rep++)
+    DSq(pm0, mpm);
+  dtime += dclock();
+  node0_printf("BENCH_DIRAC AoS   %.4g sites/sec per node\n", links / dtime);
+
+#ifdef SIMD_LAYOUT
+  simd_layout = 1;
+  DSq(pm0, rm);
+  dtime = -dclock();
+  for (rep = 0; rep < Nrep; rep++)
+    DSq(pm0, rm);
+  dtime += dclock();
+  node0_printf("BENCH_DIRAC AoSoA %.4g sites/sec per node (VLEN %d)\n",
+               links / dtime, VLEN);
+
+  // Largest deviation relative to the largest component
+  FORALLSITES(i, s) {
+    r = (Real *)&(mpm[i]);
+    r_v = (Real *)&(rm[i]);
+    for (j = 0; j < Nreal; j++) {
+      diff = fabs(r_v[j] - r[j]);
+      if (diff > max_diff_v)
+        max_diff_v = diff;
+      if (fabs(r[j]) > max_r)
+        max_r = fabs(r[j]);
+    }
+  }
+  g_floatmax(&max_diff_v);
+  g_floatmax(&max_r);
+  node0_printf("BENCH_DIRAC max deviation AoSoA vs AoS %.4g (relative)\n",
+               max_diff_v / max_r);
+#endif
+
+  // Sites done before and after waiting for each fermion_op gather
+  node0_printf("BENCH_HALO %d interior and %d boundary sites on node0\n",
+               n_part_sites[INTERIOR], n_part_sites[BOUNDARY]);
+
+  // Communication report: messages and bytes sent per fermion_op,
+  // with separate gathers and with the coalesced src halo
+  halo_dest[0] = mpm;
+  halo_dest[1] = rm;
+  for (j = 0; j < 2; j++) {
+    halo_coalesce = j;
+    DSq(pm0, halo_dest[j]);
+    gather_stats(&msgs0, &bytes0);
+    dtime = -dclock();
+    for (rep = 0; rep < Nrep; rep++)
+      DSq(pm0, halo_dest[j]);
+    dtime += dclock();
+    gather_stats(&msgs, &bytes);
+    msgs -= msgs0;
+    bytes -= bytes0;
+    g_doublesum(&msgs);
+    g_doublesum(&bytes);
+    nops = 2.0 * Nrep * numnodes();     // Two fermion_ops per DSq
+    node0_printf("BENCH_HALO %-9s %.4g messages %.4g bytes ",
+                 j ? "coalesced" : "separate", msgs / nops, bytes / nops);
+    node0_printf("per fermion_op per node, %.4g sites/sec\n", links / dtime);
+  }
+  halo_coalesce = halo_save;
+
+  // The two should agree exactly
+  FORALLSITES(i, s) {
+    r = (Real *)&(mpm[i]);
+    r_v = (Real *)&(rm[i]);
+    for (j = 0; j < Nreal; j++) {
+      diff = fabs(r_v[j] - r[j]);
+      if (diff > max_halo)
+        max_halo = diff;
+    }
+  }
+  g_floatmax(&max_halo);
+  node0_printf("BENCH_HALO max deviation coalesced vs separate %.4g\n",
+               max_halo);
+
+  // General gathers of the links at the displacements of block_mcrg(),
+  // first making the gathers and then reusing them
+  Nrep = 1 + 10000 / sites_on_node;
+  for (j = 0; j < 2; j++) {
+    gather_stats(&msgs0, &bytes0);
+    ngathers = 0.0;
+    dtime = -dclock();
+    for (rep = 0; rep < (j ? Nrep : 1); rep++) {
+      for (bl = 1; bl <= 2; bl *= 2) {
+        FORALLDIR(dir) {
+          for (k = 0; k < NDIMS; k++)
+            disp[k] = bl * offset[dir][k];
+          tag = start_general_gather_site(F_OFFSET(link[dir]), sizeof(matrix),
+                                          disp, EVENANDODD, gen_pt[0]);
+          wait_general_gather(tag);
+          cleanup_general_gather(tag);
+          ngathers++;
+        }
+      }
+    }
+    dtime += dclock();
+    gather_stats(&msgs, &bytes);
+    bytes -= bytes0;
+    g_doublesum(&bytes);
+    node0_printf("BENCH_GENERAL %-5s %.4g gathers/sec, ",
+                 j ? "reuse" : "first", ngathers / dtime);
+    node0_printf("%.4g bytes per gather per node\n",
+                 bytes / (ngathers * numnodes()));
+  }
+
+  // Library kernels against inline_susy.h, on the first two links
+  // The library versions are called as (name) to bypass -DINLINE
+  Nrep = 1 + 1000000 / sites_on_node;
+  links = (double)Nrep * sites_on_node;
+  BENCH_KERNEL("mult_nn",
+    (mult_nn)(&(s->link[0]), &(s->link[1]), &(tempmat[i])),
+    _inline_mult_nn(&(s->link[0]), &(s->link[1]), &(tempmat2[i])));
+  BENCH_KERNEL("mult_na",
+    (mult_na)(&(s->link[0]), &(s->link[1]), &(tempmat[i])),
+    _inline_mult_na(&(s->link[0]), &(s->link[1]), &(tempmat2[i])));
+  BENCH_KERNEL("mult_an",
+    (mult_an)(&(s->link[0]), &(s->link[1]), &(tempmat[i])),
+    _inline_mult_an(&(s->link[0]), &(s->link[1]), &(tempmat2[i])));
+  BENCH_KERNEL("mult_nn_sum",
+    (mult_nn_sum)(&(s->link[0]), &(s->link[1]), &(tempmat[i])),
+    _inline_mult_nn_sum(&(s->link[0]), &(s->link[1]), &(tempmat2[i])));
+  BENCH_KERNEL("scalar_mult_na_dif",
+    (scalar_mult_na_dif)(&(s->link[0]), &(s->link[1]), 0.5, &(tempmat[i])),
+    _inline_scalar_mult_na_dif(&(s->link[0]), &(s->link[1]), 0.5,
+                               &(tempmat2[i])));
+  BENCH_KERNEL("scalar_mult_sum_adj_matrix",
+    (scalar_mult_sum_adj_matrix)(&(s->link[0]), -0.5, &(tempmat[i])),
+    _inline_scalar_mult_sum_adj_matrix(&(s->link[0]), -0.5, &(tempmat2[i])));
+  BENCH_KERNEL("realtrace",
+    lib_sum += (realtrace)(&(s->link[0]), &(s->link[1])),
+    inl_sum += _inline_realtrace(&(s->link[0]), &(s->link[1])));
+  BENCH_KERNEL("complextrace_nn",
+    tc = (complextrace_nn)(&(s->link[0]), &(s->link[1]));
+    lib_sum += tc.real + tc.imag,
+    tc = _inline_complextrace_nn(&(s->link[0]), &(s->link[1]));
+    inl_sum += tc.real + tc.imag);
+
+  // Fused kernels against the library sequences they replace
+  BENCH_KERNEL("realtrace_mult_nn",
+    (mult_nn)(&(s->link[1]), &(s->link[2]), &tmat);
+    lib_sum += (realtrace)(&(s->link[0]), &tmat),
+    inl_sum += realtrace_mult_nn(&(s->link[0]), &(s->link[1]),
+                                 &(s->link[2])));
+  BENCH_KERNEL("trace_mult_nn",
+    (mult_nn)(&(s->link[0]), &(s->link[1]), &tmat);
+    tc = (trace)(&tmat);
+    lib_sum += tc.real + tc.imag,
+    tc = trace_mult_nn(&(s->link[0]), &(s->link[1]));
+    inl_sum += tc.real + tc.imag);
+  BENCH_KERNEL("scalar_mult_nn_sum (bc)",
+    (scalar_mult_matrix)(&(s->link[1]), -1.0, &tmat);
+    (mult_nn_sum)(&(s->link[0]), &tmat, &(tempmat[i])),
+    _inline_scalar_mult_nn_sum(&(s->link[0]), &(s->link[1]), -1.0,
+                               &(tempmat2[i])));
+  g_floatmax(&max_kernel);
+  node0_printf("BENCH_KERNEL max deviation inline vs library %.4g\n",
+               max_kernel);
+  fflush(stdout);
+  return 0;
+}
+// -----------------------------------------------------------------
@@ -9,7 +9,7 @@ int main(int argc, char *argv[]) {
   double linktr[NUMLINK], linktr_ave, linktr_width;
   double link_det[NUMLINK], det_ave, det_width;
   complex plp = cmplx(99.0, 99.0);
-  int ivec, total_iters = 0;
+  int Nlarge, total_iters = 0;
 #ifndef EIG
   node0_printf("Don't use control_eig unless compiling with -DEIG!\n");
   terminate(1);
@@ -34,69 +34,66 @@ int main(int argc, char *argv[]) {
     node0_printf("ERROR in readin, aborting\n");
     terminate(1);
   }
+  ask_next_lattice(prompt);
   dtime = -dclock();
+  if (Nvec > 12)
+    Nlarge = 12;
+  else
+    Nlarge = Nvec;
 
-  // Check: compute initial plaquette and bosonic action
-  plaquette(&ss_plaq, &st_plaq);
-  node0_printf("START %.8g %.8g %.8g ", ss_plaq, st_plaq, ss_plaq + st_plaq);
-  ss_plaq = gauge_action(NODET);
-  node0_printf("%.8g\n", ss_plaq / (double)volume);
+  // Measure each configuration listed in the input file in turn,
+  // reading the next file ahead while the current one is measured
+  do {
+    // Check: compute initial plaquette and bosonic action
+    plaquette(&ss_plaq, &st_plaq);
+    node0_printf("START %.8g %.8g %.8g ", ss_plaq, st_plaq, ss_plaq + st_plaq);
+    ss_plaq = gauge_action(NODET);
+    node0_printf("%.8g\n", ss_plaq / (double)volume);
 
-  // Do "local" measurements to check configuration
-  // Tr[Udag.U] / N
-  linktr_ave = link_trace(linktr, &linktr_width,
-                          link_det, &det_ave, &det_width);
-  node0_printf("FLINK");
-  FORALLDIR(dir)
-    node0_printf(" %.6g", linktr[dir]);
-  node0_printf(" %.6g %.6g\n", linktr_ave, linktr_width);
-  node0_printf("FLINK_DET");
-  FORALLDIR(dir)
-    node0_printf(" %.6g", link_det[dir]);
-  node0_printf(" %.6g %.6g\n", det_ave, det_width);
+    // Do "local" measurements to check configuration
+    // Tr[Udag.U] / N
+    linktr_ave = link_trace(linktr, &linktr_width,
+                            link_det, &det_ave, &det_width);
+    node0_printf("FLINK");
+    FORALLDIR(dir)
+      node0_printf(" %.6g", linktr[dir]);
+    node0_printf(" %.6g %.6g\n", linktr_ave, linktr_width);
+    node0_printf("FLINK_DET");
+    FORALLDIR(dir)
+      node0_printf(" %.6g", link_det[dir]);
+    node0_printf(" %.6g %.6g\n", det_ave, det_width);
 
-  // Polyakov loop and plaquette measurements
-  // Format: GMES Re(Polyakov) Im(Poyakov) cg_iters ss_plaq st_plaq
-  plp = ploop(TUP, NODET, &plpMod);
-  plaquette(&ss_plaq, &st_plaq);
-  node0_printf("GMES %.8g %.8g 0 %.8g %.8g ",
-               plp.real, plp.imag, ss_plaq, st_plaq);
+    // Polyakov loop and plaquette measurements
+    // Format: GMES Re(Polyakov) Im(Poyakov) cg_iters ss_plaq st_plaq
+    plp = ploop(TUP, NODET, &plpMod);
+    plaquette(&ss_plaq, &st_plaq);
+    node0_printf("GMES %.8g %.8g 0 %.8g %.8g ",
+                 plp.real, plp.imag, ss_plaq, st_plaq);
 
-  // Bosonic action (printed twice by request)
-  // Might as well spit out volume average of Polyakov loop modulus
-  ss_plaq = gauge_action(NODET) / (double)volume;
-  node0_printf("%.8g ", ss_plaq);
-  node0_printf("%.8g\n", plpMod);
-  node0_printf("BACTION %.8g\n", ss_plaq);
+    // Bosonic action (printed twice by request)
+    // Might as well spit out volume average of Polyakov loop modulus
+    ss_plaq = gauge_action(NODET) / (double)volume;
+    node0_printf("%.8g ", ss_plaq);
+    node0_printf("%.8g\n", plpMod);
+    node0_printf("BACTION %.8g\n", ss_plaq);
 
-  // Main measurement: PRIMME eigenvalues
-  // Calculate and print smallest eigenvalues,
-  // checking |D^dag D phi - lambda phi|^2
-  total_iters = make_evs(Nvec, eigVec, eigVal, 1);
+    // Main measurement: PRIMME eigenvalues
+    // Calculate and print smallest eigenvalues,
+    // checking |D^dag D phi - lambda phi|^2
+    total_iters += make_evs(Nvec, eigVec, eigVal, 1);
 
-  // Check matrix elements of D with DDdag eigenmodes
-  // The eigenvalues should be paired, with each pair producing
-  // positive/negative matrix elements
-  // In principle, one could tighten eig_tol until all pairs are found
-  // For now we just print them all out to check offline
-  check_Dmat(Nvec, eigVec);
+    // Check matrix elements of D with DDdag eigenmodes
+    // The eigenvalues should be paired, with each pair producing
+    // positive/negative matrix elements
+    // In principle, one could tighten eig_tol until all pairs are found
+    // For now we just print them all out to check offline
+    check_Dmat(Nvec, eigVec);
 
-  // Calculate and print largest eigenvalues, for tuning RHMC
-  // Don't need to compute many here...
-  // (Initial eigVal/eigVec alloc moved to setup.c)
-  if (Nvec > 12) {
-    free(eigVal);
-    for (ivec = 0; ivec < Nvec; ivec++)
-      free(eigVec[ivec]);
-    free(eigVec);
-
-    Nvec = 12;
-    eigVal = malloc(Nvec * sizeof(*eigVal));
-    eigVec = malloc(Nvec * sizeof(*eigVec));
-    for (ivec = 0; ivec < Nvec; ivec++)
-      FIELD_ALLOC(eigVec[ivec], Twist_Fermion);
-  }
-  total_iters += make_evs(Nvec, eigVec, eigVal, -1);
+    // Calculate and print largest eigenvalues, for tuning RHMC
+    // Don't need to compute many here, so use the first few eigVec
+    // (Initial eigVal/eigVec alloc moved to setup.c)
+    total_iters += make_evs(Nlarge, eigVec, eigVal, -1);
+  } while (next_lattice(prompt));
 
   node0_printf("RUNNING COMPLETED\n");
   dtime += dclock();
@@ -231,6 +231,7 @@ int main(int argc, char *argv[]) {
     FORALLDIR(dir)
       mat_copy(&(s->f_U[dir]), &(s->link[dir]));
   }
+  invalidate_link_halo();
   // ---------------------------------------------------------------
 
 
@@ -356,6 +357,7 @@ int main(int argc, char *argv[]) {
       FORALLDIR(dir)
         mat_copy(&(s->f_U[dir]), &(s->link[dir]));
     }
+    invalidate_link_halo();
   }
   // ---------------------------------------------------------------
 
@@ -33,44 +33,49 @@ int main(int argc, char *argv[]) {
     node0_printf("ERROR in readin, aborting\n");
     terminate(1);
   }
+  ask_next_lattice(prompt);
   dtime = -dclock();
 
-  // Check: compute initial plaquette and bosonic action
-  plaquette(&ss_plaq, &st_plaq);
-  node0_printf("START %.8g %.8g %.8g ", ss_plaq, st_plaq, ss_plaq + st_plaq);
-  ss_plaq = gauge_action(NODET);
-  node0_printf("%.8g\n", ss_plaq / (double)volume);
+  // Measure each configuration listed in the input file in turn,
+  // reading the next file ahead while the current one is measured
+  do {
+    // Check: compute initial plaquette and bosonic action
+    plaquette(&ss_plaq, &st_plaq);
+    node0_printf("START %.8g %.8g %.8g ", ss_plaq, st_plaq, ss_plaq + st_plaq);
+    ss_plaq = gauge_action(NODET);
+    node0_printf("%.8g\n", ss_plaq / (double)volume);
 
-  // Do "local" measurements to check configuration
-  // Polyakov loop measurement
-  // Tr[Udag.U] / N
-  linktr_ave = link_trace(linktr, &linktr_width,
-                          link_det, &det_ave, &det_width);
-  node0_printf("FLINK");
-  FORALLDIR(dir)
-    node0_printf(" %.6g", linktr[dir]);
-  node0_printf(" %.6g %.6g\n", linktr_ave, linktr_width);
-  node0_printf("FLINK_DET");
-  FORALLDIR(dir)
-    node0_printf(" %.6g", link_det[dir]);
-  node0_printf(" %.6g %.6g\n", det_ave, det_width);
+    // Do "local" measurements to check configuration
+    // Polyakov loop measurement
+    // Tr[Udag.U] / N
+    linktr_ave = link_trace(linktr, &linktr_width,
+                            link_det, &det_ave, &det_width);
+    node0_printf("FLINK");
+    FORALLDIR(dir)
+      node0_printf(" %.6g", linktr[dir]);
+    node0_printf(" %.6g %.6g\n", linktr_ave, linktr_width);
+    node0_printf("FLINK_DET");
+    FORALLDIR(dir)
+      node0_printf(" %.6g", link_det[dir]);
+    node0_printf(" %.6g %.6g\n", det_ave, det_width);
 
-  // Polyakov loop and plaquette measurements
-  // Format: GMES Re(Polyakov) Im(Poyakov) cg_iters ss_plaq st_plaq
-  plp = ploop(TUP, NODET, &plpMod);
-  plaquette(&ss_plaq, &st_plaq);
-  node0_printf("GMES %.8g %.8g 0 %.8g %.8g ",
-               plp.real, plp.imag, ss_plaq, st_plaq);
+    // Polyakov loop and plaquette measurements
+    // Format: GMES Re(Polyakov) Im(Poyakov) cg_iters ss_plaq st_plaq
+    plp = ploop(TUP, NODET, &plpMod);
+    plaquette(&ss_plaq, &st_plaq);
+    node0_printf("GMES %.8g %.8g 0 %.8g %.8g ",
+                 plp.real, plp.imag, ss_plaq, st_plaq);
 
-  // Bosonic action (printed twice by request)
-  // Might as well spit out volume average of Polyakov loop modulus
-  ss_plaq = gauge_action(NODET) / (double)volume;
-  node0_printf("%.8g ", ss_plaq);
-  node0_printf("%.8g\n", plpMod);
-  node0_printf("BACTION %.8g\n", ss_plaq);
+    // Bosonic action (printed twice by request)
+    // Might as well spit out volume average of Polyakov loop modulus
+    ss_plaq = gauge_action(NODET) / (double)volume;
+    node0_printf("%.8g ", ss_plaq);
+    node0_printf("%.8g\n", plpMod);
+    node0_printf("BACTION %.8g\n", ss_plaq);
 
-  // Main measurement: pfaffian
-  phase();
+    // Main measurement: pfaffian
+    phase();
+  } while (next_lattice(prompt));
 
   node0_printf("RUNNING COMPLETED\n");
   dtime += dclock();
@@ -12,15 +12,16 @@ double det_force(Real eps) {
   // Loop over directions, update momenta by accumulating
   //   ZWstar[b][a](x) + ZWstar[a][b](x - b) in tr_dest(x)
   // where ZWstar[a][b](x) = plaqdet[a][b](x) [plaqdet[a][b](x) - 1]^*
+  // Start first gather (a = 0 and b = 1), labelled by b
+  // Gather ZWstar[a][b] from x - b
+  // Later gathers are started one step ahead in the main loop
+  tag[1] = start_gather_field(ZWstar[0][1], sizeof(complex),
+                              goffset[1] + 1, EVENANDODD, gen_pt[1]);
+
   FORALLDIR(a) {
     FORALLSITES(i, s)
       tr_dest[i] = cmplx(0.0, 0.0);
 
-    // Start first gather (a = 0 and b = 1), labelled by b
-    // Gather ZWstar[a][b] from x - b
-    tag[1] = start_gather_field(ZWstar[0][1], sizeof(complex),
-                                goffset[1] + 1, EVENANDODD, gen_pt[1]);
-
     // Main loop
     FORALLDIR(b) {
       if (a == b)
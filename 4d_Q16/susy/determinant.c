@@ -6,82 +6,227 @@
 
 
 // -----------------------------------------------------------------
-// Compute complex determinant of given link through LAPACK
-complex find_det(matrix *Q) {
-  int i, row, col, Npt = NCOL, stat = 0;
-  complex det, det2;
-  matrix tmat;
+// Determinant and inverse of a single NCOL x NCOL matrix
+// None of these use global scratch space,
+// so they may be called from threaded site loops
+// Closed-form cofactor expansion for NCOL <= 3,
+// LU decomposition with partial pivoting for NCOL <= 6
+// (all loop bounds are fixed at compile time so the compiler unrolls them)
+// LAPACK with local workspace for larger NCOL
+#if NCOL > 3 && NCOL <= 6
+// LU decomposition of in, pivoting on largest |Re| + |Im| like LAPACK
+// Row i of lu comes from row perm[i] of in
+// Return -1 for an odd number of row swaps, +1 otherwise
+static int LU_decomp(matrix *in, matrix *lu, int *perm) {
+  register int i, j, k, piv;
+  int sign = 1;
+  Real max, tr;
+  complex one = cmplx(1.0, 0.0), inv, tc;
 
-  // Convert Q to column-major double array used by LAPACK
-  for (row = 0; row < NCOL; row++) {
-    for (col = 0; col < NCOL; col++) {
-      i = 2 * (col * NCOL + row);
-      store[i] = Q->e[row][col].real;
-      store[i + 1] = Q->e[row][col].imag;
+  mat_copy(in, lu);
+  for (i = 0; i < NCOL; i++)
+    perm[i] = i;
+
+  for (k = 0; k < NCOL; k++) {
+    piv = k;
+    max = fabs(lu->e[k][k].real) + fabs(lu->e[k][k].imag);
+    for (i = k + 1; i < NCOL; i++) {
+      tr = fabs(lu->e[i][k].real) + fabs(lu->e[i][k].imag);
+      if (tr > max) {
+        max = tr;
+        piv = i;
+      }
+    }
+    if (piv != k) {
+      for (j = 0; j < NCOL; j++) {
+        tc = lu->e[k][j];
+        lu->e[k][j] = lu->e[piv][j];
+        lu->e[piv][j] = tc;
+      }
+      i = perm[k];
+      perm[k] = perm[piv];
+      perm[piv] = i;
+      sign = -sign;
+    }
+
+    // Scale column below pivot, then eliminate
+    CDIV(one, lu->e[k][k], inv);
+    for (i = k + 1; i < NCOL; i++) {
+      CMUL(lu->e[i][k], inv, tc);
+      lu->e[i][k] = tc;
+      for (j = k + 1; j < NCOL; j++)
+        CMULDIF(tc, lu->e[k][j], lu->e[i][j]);
     }
   }
+  return sign;
+}
+#endif
 
-  // Compute LU decomposition of in
-  zgetrf_(&Npt, &Npt, store, &Npt, ipiv, &stat);
+#if NCOL > 6
+// LU decomposition and inverse through LAPACK, with local workspace
+// Pass NULL for out to skip the inverse
+static complex LAPACK_det_inv(matrix *in, matrix *out) {
+  int i, row, col, Npt = NCOL, stat = 0, Nwork = 2 * NCOL;
+  int lpiv[NCOL];
+  double lstore[2 * NCOL * NCOL], lwork[4 * NCOL];
+  complex det, det2, tc;
 
-  // Move the results into the matrix structure tmat
+  // Convert in to column-major double array used by LAPACK
   for (row = 0; row < NCOL; row++) {
     for (col = 0; col < NCOL; col++) {
       i = 2 * (col * NCOL + row);
-      tmat.e[row][col].real = store[i];
-      tmat.e[row][col].imag = store[i + 1];
+      lstore[i] = in->e[row][col].real;
+      lstore[i + 1] = in->e[row][col].imag;
     }
   }
 
+  // Compute LU decomposition of in
+  zgetrf_(&Npt, &Npt, lstore, &Npt, lpiv, &stat);
+
+  // Negate if row has been pivoted according to pivot array
+  // Note 1<=lpiv[i]<=N rather than 0<=lpiv[i]<N because Fortran
   det = cmplx(1.0, 0.0);
   for (i = 0; i < NCOL; i++) {
-    CMUL(det, tmat.e[i][i], det2);
-    // Negate if row has been pivoted according to pivot array
-    // Apparently LAPACK sets up ipiv so this doesn't double-count pivots
-    // Note 1<=ipiv[i]<=N rather than 0<=ipiv[i]<N because Fortran
-    if (ipiv[i] != i + 1) {     // Braces suppress compiler error
+    tc.real = lstore[2 * (i * NCOL + i)];
+    tc.imag = lstore[2 * (i * NCOL + i) + 1];
+    CMUL(det, tc, det2);
+    if (lpiv[i] != i + 1) {     // Braces suppress compiler error
       CNEGATE(det2, det);
     }
     else
       det = det2;
   }
-//  printf("DETER %.4g %.4g\n", det.real, det.imag);
+  if (out == NULL)
+    return det;
+
+  // Invert in given its LU decomposition
+  zgetri_(&Npt, lstore, &Npt, lpiv, lwork, &Nwork, &stat);
+  for (row = 0; row < NCOL; row++) {
+    for (col = 0; col < NCOL; col++) {
+      i = 2 * (col * NCOL + row);
+      out->e[row][col].real = lstore[i];
+      out->e[row][col].imag = lstore[i + 1];
+    }
+  }
   return det;
 }
-// -----------------------------------------------------------------
+#endif
 
+complex find_det(matrix *Q) {
+#if NCOL == 1
+  return Q->e[0][0];
+#elif NCOL == 2
+  complex det;
+  CMUL(Q->e[0][0], Q->e[1][1], det);
+  CMULDIF(Q->e[0][1], Q->e[1][0], det);
+  return det;
+#elif NCOL == 3
+  register int j;
+  complex det = cmplx(0.0, 0.0), cof;
 
+  // Expand along the first row
+  for (j = 0; j < 3; j++) {
+    CMUL(Q->e[1][(j + 1) % 3], Q->e[2][(j + 2) % 3], cof);
+    CMULDIF(Q->e[1][(j + 2) % 3], Q->e[2][(j + 1) % 3], cof);
+    CMULSUM(Q->e[0][j], cof, det);
+  }
+  return det;
+#elif NCOL <= 6
+  register int i;
+  int perm[NCOL];
+  complex det, tc;
+  matrix lu;
+
+  det = cmplx((Real)LU_decomp(Q, &lu, perm), 0.0);
+  for (i = 0; i < NCOL; i++) {
+    CMUL(det, lu.e[i][i], tc);
+    det = tc;
+  }
+  return det;
+#else
+  return LAPACK_det_inv(Q, NULL);
+#endif
+}
 
-// -----------------------------------------------------------------
-// Compute link matrix inverse through LAPACK
 void invert(matrix *in, matrix *out) {
-  // Use LAPACK for more than 4 colors
-  // Checked that this produces the correct results for NCOL <= 4
-  int i, row, col, Npt = NCOL, stat = 0, Nwork = 2 * NCOL;
+#if NCOL <= 3
+  complex one = cmplx(1.0, 0.0), det, inv;
 
-  // Convert in to column-major double array used by LAPACK
-  for (row = 0; row < NCOL; row++) {
-    for (col = 0; col < NCOL; col++) {
-      i = 2 * (col * NCOL + row);
-      store[i] = in->e[row][col].real;
-      store[i + 1] = in->e[row][col].imag;
+  det = find_det(in);
+  CDIV(one, det, inv);
+#if NCOL == 1
+  out->e[0][0] = inv;
+#elif NCOL == 2
+  CMUL(in->e[1][1], inv, out->e[0][0]);
+  CMUL(in->e[0][0], inv, out->e[1][1]);
+  CNEGATE(inv, inv);
+  CMUL(in->e[0][1], inv, out->e[0][1]);
+  CMUL(in->e[1][0], inv, out->e[1][0]);
+#else
+  // out[j][i] is the (i, j) cofactor divided by the determinant
+  register int i, j;
+  complex cof;
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 3; j++) {
+      CMUL(in->e[(i + 1) % 3][(j + 1) % 3], in->e[(i + 2) % 3][(j + 2) % 3],
+           cof);
+      CMULDIF(in->e[(i + 1) % 3][(j + 2) % 3],
+              in->e[(i + 2) % 3][(j + 1) % 3], cof);
+      CMUL(cof, inv, out->e[j][i]);
     }
   }
+#endif
+#elif NCOL <= 6
+  // Solve L U out = P for each column of the identity
+  register int i, j, k;
+  int perm[NCOL];
+  complex one = cmplx(1.0, 0.0), diag_inv[NCOL], x[NCOL];
+  matrix lu;
 
-  // Compute LU decomposition of in
-  zgetrf_(&Npt, &Npt, store, &Npt, ipiv, &stat);
-
-  // Invert in given its LU decomposition
-  zgetri_(&Npt, store, &Npt, ipiv, work, &Nwork, &stat);
+  LU_decomp(in, &lu, perm);
+  for (k = 0; k < NCOL; k++)
+    CDIV(one, lu.e[k][k], diag_inv[k]);
 
-  // Move the results into the matrix structure for out
-  for (row = 0; row < NCOL; row++) {
-    for (col = 0; col < NCOL; col++) {
-      i = 2 * (col * NCOL + row);
-      out->e[row][col].real = store[i];
-      out->e[row][col].imag = store[i + 1];
+  for (j = 0; j < NCOL; j++) {
+    for (i = 0; i < NCOL; i++) {        // L has unit diagonal
+      x[i] = cmplx((perm[i] == j ? 1.0 : 0.0), 0.0);
+      for (k = 0; k < i; k++)
+        CMULDIF(lu.e[i][k], x[k], x[i]);
+    }
+    for (i = NCOL - 1; i >= 0; i--) {
+      for (k = i + 1; k < NCOL; k++)
+        CMULDIF(lu.e[i][k], x[k], x[i]);
+      CMUL(x[i], diag_inv[i], out->e[i][j]);
+      x[i] = out->e[i][j];
     }
   }
+#else
+  LAPACK_det_inv(in, out);
+#endif
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Batched determinants and inverses of the matrix at field offset fo
+// in every site, e.g. F_OFFSET(link[dir]), threaded over sites
+void find_det_site(field_offset fo, complex *det) {
+  register int i;
+  register site *s;
+
+  FORALLSITES_OMP(i, s, ) {
+    det[i] = find_det((matrix *)F_PT(s, fo));
+  } END_LOOP_OMP;
+}
+
+void invert_site(field_offset fo, matrix *inv) {
+  register int i;
+  register site *s;
+
+  FORALLSITES_OMP(i, s, ) {
+    invert((matrix *)F_PT(s, fo), &(inv[i]));
+  } END_LOOP_OMP;
 }
 // -----------------------------------------------------------------
 
@@ -109,9 +254,10 @@ void measure_det() {
       }
     }
   }
-  g_complexsum(&tot);
-  g_complexsum(&tot_sq);
-  g_doublesum(&WSq);
+  g_complexsum_add(&tot);
+  g_complexsum_add(&tot_sq);
+  g_doublesum_add(&WSq);
+  g_sum_wait(g_sum_start());
   CMULREAL(tot, norm, tot);
   CMULREAL(tot_sq, norm, tot_sq);
   node0_printf("DET %.6g %.6g %.6g %.6g %.6g\n",
@@ -184,7 +184,7 @@ int make_evs(int Nvec, Twist_Fermion **eigVec, double *eigVal, int flag) {
   int maxn = sites_on_node * Ndat;
   double check, *rnorms = malloc(Nvec * sizeof(*rnorms));
   Complex_Z *workVecs = malloc(Nvec * maxn * sizeof(*workVecs));
-  static primme_params primme;
+  static RANK_LOCAL primme_params primme;
   Twist_Fermion tTF, *tmpTF = malloc(sites_on_node * sizeof(*tmpTF));
 
   // Check memory allocations
@@ -0,0 +1,461 @@
+// -----------------------------------------------------------------
+// Single-precision fermion operator for the mixed-precision CG
+// The links and everything derived from them are converted once per solve
+// by load_links_f(), after which fermion_op_f and DSq_f work entirely
+// on fmatrix and Twist_Fermion_f, with half the memory traffic
+// The terms themselves are built from fermion_op_terms.h,
+// the same source as the double-precision fermion_op
+// The boundary condition factors are still read from the double-precision bc_t
+#include "susy_includes.h"
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Single-precision versions of the library matrix routines
+// Kept static here so that they can be inlined into the kernels
+// Scaled matrix products, with init = 1 to overwrite c
+// and otherwise adding s * (a * b) to c (s may be negative)
+// c <-- s * a * b
+static void nn_f(fmatrix *a, fmatrix *b, float s, int init, fmatrix *c) {
+  register int i, j, k;
+  register float re, im;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      re = 0.0;
+      im = 0.0;
+      for (k = 0; k < NCOL; k++) {
+        re += a->e[i][k].real * b->e[k][j].real
+            - a->e[i][k].imag * b->e[k][j].imag;
+        im += a->e[i][k].imag * b->e[k][j].real
+            + a->e[i][k].real * b->e[k][j].imag;
+      }
+      if (init) {
+        c->e[i][j].real = s * re;
+        c->e[i][j].imag = s * im;
+      }
+      else {
+        c->e[i][j].real += s * re;
+        c->e[i][j].imag += s * im;
+      }
+    }
+  }
+}
+
+// c <-- s * adag * b
+static void an_f(fmatrix *a, fmatrix *b, float s, int init, fmatrix *c) {
+  register int i, j, k;
+  register float re, im;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      re = 0.0;
+      im = 0.0;
+      for (k = 0; k < NCOL; k++) {
+        re += a->e[k][i].real * b->e[k][j].real
+            + a->e[k][i].imag * b->e[k][j].imag;
+        im += a->e[k][i].real * b->e[k][j].imag
+            - a->e[k][i].imag * b->e[k][j].real;
+      }
+      if (init) {
+        c->e[i][j].real = s * re;
+        c->e[i][j].imag = s * im;
+      }
+      else {
+        c->e[i][j].real += s * re;
+        c->e[i][j].imag += s * im;
+      }
+    }
+  }
+}
+
+// c <-- s * a * bdag
+static void na_f(fmatrix *a, fmatrix *b, float s, int init, fmatrix *c) {
+  register int i, j, k;
+  register float re, im;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      re = 0.0;
+      im = 0.0;
+      for (k = 0; k < NCOL; k++) {
+        re += a->e[i][k].real * b->e[j][k].real
+            + a->e[i][k].imag * b->e[j][k].imag;
+        im += a->e[i][k].imag * b->e[j][k].real
+            - a->e[i][k].real * b->e[j][k].imag;
+      }
+      if (init) {
+        c->e[i][j].real = s * re;
+        c->e[i][j].imag = s * im;
+      }
+      else {
+        c->e[i][j].real += s * re;
+        c->e[i][j].imag += s * im;
+      }
+    }
+  }
+}
+
+static void mult_nn_f(fmatrix *a, fmatrix *b, fmatrix *c) {
+  nn_f(a, b, 1.0, 1, c);
+}
+static void mult_nn_sum_f(fmatrix *a, fmatrix *b, fmatrix *c) {
+  nn_f(a, b, 1.0, 0, c);
+}
+static void mult_nn_dif_f(fmatrix *a, fmatrix *b, fmatrix *c) {
+  nn_f(a, b, -1.0, 0, c);
+}
+static void mult_an_f(fmatrix *a, fmatrix *b, fmatrix *c) {
+  an_f(a, b, 1.0, 1, c);
+}
+static void mult_an_sum_f(fmatrix *a, fmatrix *b, fmatrix *c) {
+  an_f(a, b, 1.0, 0, c);
+}
+static void mult_an_dif_f(fmatrix *a, fmatrix *b, fmatrix *c) {
+  an_f(a, b, -1.0, 0, c);
+}
+static void mult_na_sum_f(fmatrix *a, fmatrix *b, fmatrix *c) {
+  na_f(a, b, 1.0, 0, c);
+}
+static void mult_na_dif_f(fmatrix *a, fmatrix *b, fmatrix *c) {
+  na_f(a, b, -1.0, 0, c);
+}
+
+static void scalar_mult_nn_f(fmatrix *a, fmatrix *b, float s, fmatrix *c) {
+  nn_f(a, b, s, 1, c);
+}
+static void scalar_mult_nn_sum_f(fmatrix *a, fmatrix *b, float s, fmatrix *c) {
+  nn_f(a, b, s, 0, c);
+}
+static void scalar_mult_nn_dif_f(fmatrix *a, fmatrix *b, float s, fmatrix *c) {
+  nn_f(a, b, -s, 0, c);
+}
+static void scalar_mult_an_f(fmatrix *a, fmatrix *b, float s, fmatrix *c) {
+  an_f(a, b, s, 1, c);
+}
+static void scalar_mult_an_dif_f(fmatrix *a, fmatrix *b, float s, fmatrix *c) {
+  an_f(a, b, -s, 0, c);
+}
+static void scalar_mult_na_f(fmatrix *a, fmatrix *b, float s, fmatrix *c) {
+  na_f(a, b, s, 1, c);
+}
+static void scalar_mult_na_sum_f(fmatrix *a, fmatrix *b, float s, fmatrix *c) {
+  na_f(a, b, s, 0, c);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Single-matrix operations
+static void clear_mat_f(fmatrix *c) {
+  register int i, j;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real = 0.0;
+      c->e[i][j].imag = 0.0;
+    }
+  }
+}
+
+// c <-- s * b
+static void scalar_mult_matrix_f(fmatrix *b, float s, fmatrix *c) {
+  register int i, j;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real = s * b->e[i][j].real;
+      c->e[i][j].imag = s * b->e[i][j].imag;
+    }
+  }
+}
+
+// c <-- c + s * b
+static void scalar_mult_sum_matrix_f(fmatrix *b, float s, fmatrix *c) {
+  register int i, j;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real += s * b->e[i][j].real;
+      c->e[i][j].imag += s * b->e[i][j].imag;
+    }
+  }
+}
+
+// c <-- c - s * b
+static void scalar_mult_dif_matrix_f(fmatrix *b, float s, fmatrix *c) {
+  scalar_mult_sum_matrix_f(b, -s, c);
+}
+
+// c <-- c + s * b
+static void c_scalar_mult_sum_mat_f(fmatrix *b, fcomplex *s, fmatrix *c) {
+  register int i, j;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real += b->e[i][j].real * s->real - b->e[i][j].imag * s->imag;
+      c->e[i][j].imag += b->e[i][j].imag * s->real + b->e[i][j].real * s->imag;
+    }
+  }
+}
+
+// c <-- c - s * b
+static void c_scalar_mult_dif_mat_f(fmatrix *b, fcomplex *s, fmatrix *c) {
+  register int i, j;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real -= b->e[i][j].real * s->real - b->e[i][j].imag * s->imag;
+      c->e[i][j].imag -= b->e[i][j].imag * s->real + b->e[i][j].real * s->imag;
+    }
+  }
+}
+
+// c <-- c + (s * b)dag
+static void c_scalar_mult_sum_adj_mat_f(fmatrix *b, fcomplex *s, fmatrix *c) {
+  register int i, j;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real += b->e[j][i].real * s->real - b->e[j][i].imag * s->imag;
+      c->e[i][j].imag -= b->e[j][i].imag * s->real + b->e[j][i].real * s->imag;
+    }
+  }
+}
+
+// c <-- c - (s * b)dag
+static void c_scalar_mult_dif_adj_mat_f(fmatrix *b, fcomplex *s, fmatrix *c) {
+  register int i, j;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      c->e[i][j].real -= b->e[j][i].real * s->real - b->e[j][i].imag * s->imag;
+      c->e[i][j].imag += b->e[j][i].imag * s->real + b->e[j][i].real * s->imag;
+    }
+  }
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Complex numbers and traces
+static fcomplex cmplx_f(float x, float y) {
+  fcomplex c;
+  c.real = x;
+  c.imag = y;
+  return c;
+}
+
+static fcomplex trace_f(fmatrix *a) {
+  register int i;
+  fcomplex sum;
+  sum.real = 0.0;
+  sum.imag = 0.0;
+  for (i = 0; i < NCOL; i++) {
+    sum.real += a->e[i][i].real;
+    sum.imag += a->e[i][i].imag;
+  }
+  return sum;
+}
+
+// Tr[a * b]
+static fcomplex complextrace_nn_f(fmatrix *a, fmatrix *b) {
+  register int i, j;
+  fcomplex sum;
+  sum.real = 0.0;
+  sum.imag = 0.0;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      sum.real += a->e[i][j].real * b->e[j][i].real
+                - a->e[i][j].imag * b->e[j][i].imag;
+      sum.imag += a->e[i][j].real * b->e[j][i].imag
+                + a->e[i][j].imag * b->e[j][i].real;
+    }
+  }
+  return sum;
+}
+
+// Tr[a * bdag]
+static fcomplex complextrace_na_f(fmatrix *a, fmatrix *b) {
+  register int i, j;
+  fcomplex sum;
+  sum.real = 0.0;
+  sum.imag = 0.0;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      sum.real += a->e[i][j].real * b->e[i][j].real
+                + a->e[i][j].imag * b->e[i][j].imag;
+      sum.imag += a->e[i][j].imag * b->e[i][j].real
+                - a->e[i][j].real * b->e[i][j].imag;
+    }
+  }
+  return sum;
+}
+// -----------------------------------------------------------------
+
+
+
+
+
+
+// -----------------------------------------------------------------
+// Single-precision fields, allocated on first use
+static RANK_LOCAL int alloc_f = 0;
+static RANK_LOCAL fmatrix *link_f[NUMLINK], *link_halo_f[NUMLINK][NUMLINK];
+#ifdef QCLOSED
+static RANK_LOCAL fmatrix *DbpP_link_f[NTERMS], *DbmP_link_f[NTERMS];
+#endif
+static RANK_LOCAL fmatrix *Uinv_f[NUMLINK], *tempmat_f, *tempmat2_f;
+static RANK_LOCAL fmatrix Lambda_f[DIMF];
+static RANK_LOCAL fcomplex *plaqdet_f[NUMLINK][NUMLINK], *tempdet_f[NUMLINK][NUMLINK];
+static RANK_LOCAL fcomplex *Tr_Uinv_f[NUMLINK], *tr_eta_f, *tr_dest_f;
+static RANK_LOCAL Twist_Fermion_f *tempTF_f;
+
+static void make_fields_f() {
+  FIELD_ALLOC_VEC(link_f, fmatrix, NUMLINK);
+  FIELD_ALLOC_MAT(link_halo_f, fmatrix, NUMLINK, NUMLINK);
+#ifdef QCLOSED
+  FIELD_ALLOC_VEC(DbpP_link_f, fmatrix, NTERMS);
+  FIELD_ALLOC_VEC(DbmP_link_f, fmatrix, NTERMS);
+#endif
+  FIELD_ALLOC_VEC(Uinv_f, fmatrix, NUMLINK);
+  FIELD_ALLOC(tempmat_f, fmatrix);
+  FIELD_ALLOC(tempmat2_f, fmatrix);
+  FIELD_ALLOC_MAT_OFFDIAG(plaqdet_f, fcomplex, NUMLINK);
+  FIELD_ALLOC_MAT_OFFDIAG(tempdet_f, fcomplex, NUMLINK);
+  FIELD_ALLOC_VEC(Tr_Uinv_f, fcomplex, NUMLINK);
+  FIELD_ALLOC(tr_eta_f, fcomplex);
+  FIELD_ALLOC(tr_dest_f, fcomplex);
+  FIELD_ALLOC(tempTF_f, Twist_Fermion_f);
+  alloc_f = 1;
+}
+
+// Convert the links, link halo, Uinv and plaqdet to single precision
+// Assumes compute_plaqdet() and compute_Uinv() are current if doG,
+// just as fermion_op does
+// Nothing to do until invalidate_link_halo() marks the links as changed
+void load_links_f() {
+  register int i;
+  register site *s;
+  int a, b;
+
+  if (links_f_valid)
+    return;
+  if (!alloc_f)
+    make_fields_f();
+  if (!link_halo_valid)
+    gather_link_halo();
+
+  for (a = 0; a < DIMF; a++)
+    mat_d2f(&(Lambda[a]), &(Lambda_f[a]));
+  FORALLSITES_OMP(i, s, private(a, b)) {
+    FORALLDIR(a) {
+      mat_d2f(&(s->link[a]), &(link_f[a][i]));
+      FORALLDIR(b)
+        mat_d2f(&(link_halo[a][b][i]), &(link_halo_f[a][b][i]));
+      if (!doG)
+        continue;
+
+      mat_d2f(&(Uinv[a][i]), &(Uinv_f[a][i]));
+      FORALLDIR(b) {
+        if (a != b) {
+          plaqdet_f[a][b][i].real = (float)plaqdet[a][b][i].real;
+          plaqdet_f[a][b][i].imag = (float)plaqdet[a][b][i].imag;
+        }
+      }
+    }
+#ifdef QCLOSED
+    for (a = 0; a < NTERMS; a++) {
+      mat_d2f(&(DbpP_link[a][i]), &(DbpP_link_f[a][i]));
+      mat_d2f(&(DbmP_link[a][i]), &(DbmP_link_f[a][i]));
+    }
+#endif
+  } END_LOOP_OMP;
+  links_f_valid = 1;
+}
+
+// -----------------------------------------------------------------
+// Build the terms, fermion_op_f and DSq_f from fermion_op_terms.h,
+// mapping everything it uses to the single-precision versions above
+#define OP_PRECISION 1
+#define LINK_AT(a, i) (link_f[a][i])
+
+// The library versions of some of these are macros
+#undef complex
+#undef matrix
+#undef mult_nn
+#undef mult_nn_sum
+#undef mult_nn_dif
+#undef mult_an
+#undef mult_an_sum
+#undef mult_an_dif
+#undef mult_na_sum
+#undef mult_na_dif
+#undef scalar_mult_nn
+#undef scalar_mult_nn_sum
+#undef scalar_mult_nn_dif
+#undef scalar_mult_an
+#undef scalar_mult_an_dif
+#undef scalar_mult_na
+#undef scalar_mult_na_sum
+#undef clear_mat
+#undef scalar_mult_matrix
+#undef scalar_mult_sum_matrix
+#undef scalar_mult_dif_matrix
+#undef c_scalar_mult_sum_mat
+#undef trace
+#undef complextrace_nn
+#undef complextrace_na
+
+#define Real          float
+#define complex       fcomplex
+#define matrix        fmatrix
+#define Twist_Fermion Twist_Fermion_f
+
+#define link_halo     link_halo_f
+#define DbpP_link     DbpP_link_f
+#define DbmP_link     DbmP_link_f
+#define Uinv          Uinv_f
+#define tempmat       tempmat_f
+#define tempmat2      tempmat2_f
+#define Lambda        Lambda_f
+#define plaqdet       plaqdet_f
+#define tempdet       tempdet_f
+#define Tr_Uinv       Tr_Uinv_f
+#define tr_eta        tr_eta_f
+#define tr_dest       tr_dest_f
+#define tempTF        tempTF_f
+
+#define mult_nn                   mult_nn_f
+#define mult_nn_sum               mult_nn_sum_f
+#define mult_nn_dif               mult_nn_dif_f
+#define mult_an                   mult_an_f
+#define mult_an_sum               mult_an_sum_f
+#define mult_an_dif               mult_an_dif_f
+#define mult_na_sum               mult_na_sum_f
+#define mult_na_dif               mult_na_dif_f
+#define scalar_mult_nn            scalar_mult_nn_f
+#define scalar_mult_nn_sum        scalar_mult_nn_sum_f
+#define scalar_mult_nn_dif        scalar_mult_nn_dif_f
+#define scalar_mult_an            scalar_mult_an_f
+#define scalar_mult_an_dif        scalar_mult_an_dif_f
+#define scalar_mult_na            scalar_mult_na_f
+#define scalar_mult_na_sum        scalar_mult_na_sum_f
+#define clear_mat                 clear_mat_f
+#define scalar_mult_matrix        scalar_mult_matrix_f
+#define scalar_mult_sum_matrix    scalar_mult_sum_matrix_f
+#define scalar_mult_dif_matrix    scalar_mult_dif_matrix_f
+#define c_scalar_mult_sum_mat     c_scalar_mult_sum_mat_f
+#define c_scalar_mult_dif_mat     c_scalar_mult_dif_mat_f
+#define c_scalar_mult_sum_adj_mat c_scalar_mult_sum_adj_mat_f
+#define c_scalar_mult_dif_adj_mat c_scalar_mult_dif_adj_mat_f
+#define cmplx                     cmplx_f
+#define trace                     trace_f
+#define complextrace_nn           complextrace_nn_f
+#define complextrace_na           complextrace_na_f
+#define scalar_mult_sum_TF        scalar_mult_sum_TF_f
+
+#define Dplus       Dplus_f
+#define Dminus      Dminus_f
+#define DbplusPtoP  DbplusPtoP_f
+#define DbminusPtoP DbminusPtoP_f
+#define DbplusStoL  DbplusStoL_f
+#define detStoL     detStoL_f
+#define DbminusLtoS DbminusLtoS_f
+#define detLtoS     detLtoS_f
+#define fermion_op  fermion_op_f
+#define DSq         DSq_f
+#include "fermion_op_terms.h"
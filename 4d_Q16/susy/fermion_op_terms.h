@@ -0,0 +1,830 @@
+// -----------------------------------------------------------------
+// Terms of the fermion operator, with fermion_op and DSq, written once
+// for both precisions
+// utilities.c includes this with OP_PRECISION 2, and fermion_op_f.c
+// with OP_PRECISION 1 after mapping the types, fields and matrix routines
+// used here to their single-precision versions
+// The links at site i are LINK_AT(a, i)
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Separate routines for each term in the fermion operator
+// All called by fermion_op at the bottom of the file
+// Each works directly on the Twist_Fermion src and dest, gathering
+// individual components with strided gathers
+// For the adjoint (sign = MINUS) each product is applied in adjoint form,
+// (A B)^dag = B^dag A^dag, with the overall negation folded into the
+// sum/dif choice, so no conjugated copy of src or dest is ever made
+#ifdef VP
+void Dplus(Twist_Fermion *src, Twist_Fermion *dest, int sign) {
+  register int i;
+  register site *s;
+  char **local_pt[2][2];
+  int mu, nu, index, gather, flip = 0, a, b, part;
+  msg_tag *tag0[2], *tag1[2];
+
+  for (mu = 0; mu < 2; mu++) {
+    local_pt[0][mu] = gen_pt[mu];
+    local_pt[1][mu] = gen_pt[2 + mu];
+  }
+
+  // Start first set of gathers (mu = 0 and nu = 1)
+  // Neighboring links come from link_halo
+  tag0[0] = start_src_gather(&(src[0].Flink[1]), sizeof(Twist_Fermion),
+                             sizeof(matrix), goffset[0], &(local_pt[0][0]));
+
+  tag1[0] = start_src_gather(&(src[0].Flink[0]), sizeof(Twist_Fermion),
+                             sizeof(matrix), goffset[1], &(local_pt[0][1]));
+
+  // Main loop
+  FORALLDIR(mu) {
+    for (nu = mu + 1; nu < NUMLINK; nu++) {
+      index = plaq_index[mu][nu];
+      gather = (flip + 1) % 2;
+      if (index < NPLAQ - 1) {               // Start next set of gathers
+        if (nu == NUMLINK - 1) {
+          a = mu + 1;
+          b = a + 1;
+        }
+        else {
+          a = mu;
+          b = nu + 1;
+        }
+        tag0[gather] = start_src_gather(&(src[0].Flink[b]),
+                                        sizeof(Twist_Fermion), sizeof(matrix),
+                                        goffset[a], &(local_pt[gather][0]));
+
+        tag1[gather] = start_src_gather(&(src[0].Flink[a]),
+                                        sizeof(Twist_Fermion), sizeof(matrix),
+                                        goffset[b], &(local_pt[gather][1]));
+      }
+
+      // Work on the interior while the gathers are in flight
+      for (part = INTERIOR; part <= BOUNDARY; part++) {
+        if (part == BOUNDARY) {
+          wait_src_gather(tag0[flip]);
+          wait_src_gather(tag1[flip]);
+        }
+        if (sign == PLUS) {
+          FORPARTSITES_OMP(i, s, part, ) {
+            // Initialize dest[i].Fplaq[index]
+            scalar_mult_nn(&(LINK_AT(mu, i)), (matrix *)(local_pt[flip][0][i]),
+                           BC1(s, mu), &(dest[i].Fplaq[index]));
+
+            // Add or subtract the other three terms
+            mult_nn_dif(&(src[i].Flink[nu]), &(link_halo[mu][nu][i]),
+                        &(dest[i].Fplaq[index]));
+
+            scalar_mult_nn_dif(&(LINK_AT(nu, i)),
+                               (matrix *)(local_pt[flip][1][i]),
+                               BC1(s, nu), &(dest[i].Fplaq[index]));
+
+            mult_nn_sum(&(src[i].Flink[mu]), &(link_halo[nu][mu][i]),
+                        &(dest[i].Fplaq[index]));
+          } END_LOOP_OMP;
+        }
+        else {
+          FORPARTSITES_OMP(i, s, part, ) {
+            scalar_mult_na((matrix *)(local_pt[flip][0][i]), &(LINK_AT(mu, i)),
+                           -BC1(s, mu), &(dest[i].Fplaq[index]));
+
+            mult_an_sum(&(link_halo[mu][nu][i]), &(src[i].Flink[nu]),
+                        &(dest[i].Fplaq[index]));
+
+            scalar_mult_na_sum((matrix *)(local_pt[flip][1][i]),
+                               &(LINK_AT(nu, i)),
+                               BC1(s, nu), &(dest[i].Fplaq[index]));
+
+            mult_an_dif(&(link_halo[nu][mu][i]), &(src[i].Flink[mu]),
+                        &(dest[i].Fplaq[index]));
+          } END_LOOP_OMP;
+        }
+      }
+      cleanup_src_gather(tag0[flip]);
+      cleanup_src_gather(tag1[flip]);
+      flip = gather;
+    }
+  }
+}
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Use tempmat and tempmat2 for temporary storage
+#ifdef VP
+void Dminus(Twist_Fermion *src, Twist_Fermion *dest, int sign) {
+  register int i;
+  register site *s;
+  char **local_pt[2];
+  int mu, nu, index, gather, flip = 0, a, b, next, opp_mu, part;
+  matrix *mat[2];
+  msg_tag *tag[2];
+
+  local_pt[0] = gen_pt[0];
+  local_pt[1] = gen_pt[1];
+  mat[0] = tempmat;
+  mat[1] = tempmat2;
+
+  // Start first gather (mu = 1 and nu = 0)
+  // Neighboring links come from link_halo
+  index = plaq_index[1][0];
+  FORALLSITES_OMP(i, s, private(mu)) {   // mu = 1 > nu = 0
+    if (sign == PLUS)
+      scalar_mult_nn(&(src[i].Fplaq[index]), &(LINK_AT(1, i)), -1.0,
+                     &(mat[0][i]));
+    else
+      scalar_mult_an(&(LINK_AT(1, i)), &(src[i].Fplaq[index]), -1.0,
+                     &(mat[0][i]));
+    FORALLDIR(mu)
+      clear_mat(&(dest[i].Flink[mu]));  // Initialize
+  } END_LOOP_OMP;
+  tag[0] = start_gather_field(mat[0], sizeof(matrix),
+                              goffset[1] + 1, EVENANDODD, local_pt[0]);
+
+  // Main loop
+  FORALLDIR(nu) {
+    FORALLDIR(mu) {
+      if (mu == nu)
+        continue;
+
+      gather = (flip + 1) % 2;
+      if (nu < NUMLINK - 1 || mu < NUMLINK - 2) { // Start next gather
+        if (mu == NUMLINK - 1) {
+          a = 0;
+          b = nu + 1;
+        }
+        else if (mu == nu - 1) {
+          a = mu + 2;
+          b = nu;
+        }
+        else {
+          a = mu + 1;
+          b = nu;
+        }
+        next = plaq_index[a][b];
+        FORALLSITES_OMP(i, s, ) {
+          if (sign == PLUS) {
+            if (a > b) {      // src is anti-symmetric under a <--> b
+              scalar_mult_nn(&(src[i].Fplaq[next]), &(LINK_AT(a, i)), -1.0,
+                             &(mat[gather][i]));
+            }
+            else {
+              mult_nn(&(src[i].Fplaq[next]), &(LINK_AT(a, i)),
+                      &(mat[gather][i]));
+            }
+          }
+          else {
+            if (a > b) {
+              scalar_mult_an(&(LINK_AT(a, i)), &(src[i].Fplaq[next]), -1.0,
+                             &(mat[gather][i]));
+            }
+            else {
+              mult_an(&(LINK_AT(a, i)), &(src[i].Fplaq[next]),
+                      &(mat[gather][i]));
+            }
+          }
+        } END_LOOP_OMP;
+        tag[gather] = start_gather_field(mat[gather], sizeof(matrix),
+                                         goffset[a] + 1, EVENANDODD,
+                                         local_pt[gather]);
+      }
+
+      index = plaq_index[mu][nu];
+      opp_mu = OPP_LDIR(mu);
+      // Work on the interior while the gather is in flight
+      for (part = INTERIOR; part <= BOUNDARY; part++) {
+        if (part == BOUNDARY) {
+          wait_gather(tag[flip]);
+        }
+        if (sign == PLUS) {
+          FORPARTSITES_OMP(i, s, part, ) {
+            if (mu > nu)    // src is anti-symmetric under mu <--> nu
+              mult_nn_dif(&(link_halo[mu][nu][i]), &(src[i].Fplaq[index]),
+                          &(dest[i].Flink[nu]));
+            else
+              mult_nn_sum(&(link_halo[mu][nu][i]), &(src[i].Fplaq[index]),
+                          &(dest[i].Flink[nu]));
+
+            scalar_mult_dif_matrix((matrix *)(local_pt[flip][i]),
+                                   BC1(s, opp_mu), &(dest[i].Flink[nu]));
+          } END_LOOP_OMP;
+        }
+        else {
+          FORPARTSITES_OMP(i, s, part, ) {
+            if (mu > nu)
+              mult_na_sum(&(src[i].Fplaq[index]), &(link_halo[mu][nu][i]),
+                          &(dest[i].Flink[nu]));
+            else
+              mult_na_dif(&(src[i].Fplaq[index]), &(link_halo[mu][nu][i]),
+                          &(dest[i].Flink[nu]));
+
+            scalar_mult_sum_matrix((matrix *)(local_pt[flip][i]),
+                                   BC1(s, opp_mu), &(dest[i].Flink[nu]));
+          } END_LOOP_OMP;
+        }
+      }
+      cleanup_gather(tag[flip]);
+      flip = gather;
+    }
+  }
+}
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Add to dest instead of overwriting; note factor of 1/2
+#ifdef QCLOSED
+void DbplusPtoP(Twist_Fermion *src, Twist_Fermion *dest, int sign) {
+  register int i;
+  register site *s;
+  char **local_pt[2][2];
+  int a, b, c, d, e, j, gather, next, flip = 0, i_ab, i_de, part;
+  Real tr;
+  msg_tag *tag0[2], *tag1[2];
+
+  for (a = 0; a < 2; a++) {
+    local_pt[0][a] = gen_pt[a];
+    local_pt[1][a] = gen_pt[2 + a];
+  }
+
+  // Start first set of gathers
+  // From setup_lambda.c, we see b > a and e > d
+  d = DbplusPtoP_lookup[0][3];
+  e = DbplusPtoP_lookup[0][4];
+  i_de = plaq_index[d][e];
+  // Neighboring links come from DbpP_link and link_halo
+  tag0[0] = start_src_gather(&(src[0].Fplaq[i_de]), sizeof(Twist_Fermion),
+                             sizeof(matrix), DbpP_d2[0], &(local_pt[0][0]));
+  tag1[0] = start_src_gather(&(src[0].Fplaq[i_de]), sizeof(Twist_Fermion),
+                             sizeof(matrix), DbpP_d1[0], &(local_pt[0][1]));
+
+  // Loop over lookup table
+  for (j = 0; j < NTERMS; j++) {
+    gather = (flip + 1) % 2;
+    if (j < NTERMS - 1) {               // Start next set of gathers
+      next = j + 1;
+      d = DbplusPtoP_lookup[next][3];
+      e = DbplusPtoP_lookup[next][4];
+      i_de = plaq_index[d][e];
+
+      tag0[gather] = start_src_gather(&(src[0].Fplaq[i_de]),
+                                      sizeof(Twist_Fermion), sizeof(matrix),
+                                      DbpP_d2[next], &(local_pt[gather][0]));
+      tag1[gather] = start_src_gather(&(src[0].Fplaq[i_de]),
+                                      sizeof(Twist_Fermion), sizeof(matrix),
+                                      DbpP_d1[next], &(local_pt[gather][1]));
+    }
+
+    // Do this set of computations while next set of gathers runs
+    a = DbplusPtoP_lookup[j][0];
+    b = DbplusPtoP_lookup[j][1];
+    c = DbplusPtoP_lookup[j][2];
+    d = DbplusPtoP_lookup[j][3];
+    e = DbplusPtoP_lookup[j][4];
+    tr = 0.5 * perm[a][b][c][d][e];
+    i_ab = plaq_index[a][b];
+
+    // Work on the interior while the gathers are in flight
+    for (part = INTERIOR; part <= BOUNDARY; part++) {
+      if (part == BOUNDARY) {
+        wait_src_gather(tag0[flip]);
+        wait_src_gather(tag1[flip]);
+      }
+      if (sign == PLUS) {
+        FORPARTSITES_OMP(i, s, part, ) {
+          scalar_mult_na_sum((matrix *)(local_pt[flip][0][i]),
+                             &(DbpP_link[j][i]),
+                             tr * BC3(s, a, b, c), &(dest[i].Fplaq[i_ab]));
+
+          scalar_mult_an_dif(&(link_halo[c][c][i]),
+                             (matrix *)(local_pt[flip][1][i]),
+                             tr * BC2(s, a, b), &(dest[i].Fplaq[i_ab]));
+        } END_LOOP_OMP;
+      }
+      else {
+        FORPARTSITES_OMP(i, s, part, ) {
+          scalar_mult_nn_dif(&(DbpP_link[j][i]),
+                             (matrix *)(local_pt[flip][0][i]),
+                             tr * BC3(s, a, b, c), &(dest[i].Fplaq[i_ab]));
+
+          scalar_mult_nn_sum((matrix *)(local_pt[flip][1][i]),
+                             &(link_halo[c][c][i]),
+                             tr * BC2(s, a, b), &(dest[i].Fplaq[i_ab]));
+        } END_LOOP_OMP;
+      }
+    }
+    cleanup_src_gather(tag0[flip]);
+    cleanup_src_gather(tag1[flip]);
+    flip = gather;
+  }
+}
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Add to dest instead of overwriting; note factor of 1/2
+#ifdef QCLOSED
+void DbminusPtoP(Twist_Fermion *src, Twist_Fermion *dest, int sign) {
+  register int i, opp_a, opp_b, opp_c;
+  register site *s;
+  char **local_pt[2][2];
+  int a, b, c, d, e, j, gather, next, flip = 0, i_ab, i_de, part;
+  Real tr;
+  msg_tag *tag0[2], *tag1[2];
+
+  for (a = 0; a < 2; a++) {
+    local_pt[0][a] = gen_pt[a];
+    local_pt[1][a] = gen_pt[2 + a];
+  }
+
+  // Start first set of gathers
+  // From setup_lambda.c, we see b > a and e > d
+  a = DbminusPtoP_lookup[0][0];
+  b = DbminusPtoP_lookup[0][1];
+  i_ab = plaq_index[a][b];
+
+  // Neighboring links come from DbmP_link and link_halo
+  tag0[0] = start_src_gather(&(src[0].Fplaq[i_ab]), sizeof(Twist_Fermion),
+                             sizeof(matrix), DbmP_d2[0], &(local_pt[0][0]));
+  tag1[0] = start_src_gather(&(src[0].Fplaq[i_ab]), sizeof(Twist_Fermion),
+                             sizeof(matrix), DbmP_d1[0], &(local_pt[0][1]));
+
+  // Loop over lookup table
+  for (j = 0; j < NTERMS; j++) {
+    gather = (flip + 1) % 2;
+    if (j < NTERMS - 1) {               // Start next set of gathers
+      next = j + 1;
+      a = DbminusPtoP_lookup[next][0];
+      b = DbminusPtoP_lookup[next][1];
+      i_ab = plaq_index[a][b];
+      tag0[gather] = start_src_gather(&(src[0].Fplaq[i_ab]),
+                                      sizeof(Twist_Fermion), sizeof(matrix),
+                                      DbmP_d2[next], &(local_pt[gather][0]));
+      tag1[gather] = start_src_gather(&(src[0].Fplaq[i_ab]),
+                                      sizeof(Twist_Fermion), sizeof(matrix),
+                                      DbmP_d1[next], &(local_pt[gather][1]));
+    }
+
+    // Do this set of computations while next set of gathers runs
+    a = DbminusPtoP_lookup[j][0];
+    b = DbminusPtoP_lookup[j][1];
+    c = DbminusPtoP_lookup[j][2];
+    d = DbminusPtoP_lookup[j][3];
+    e = DbminusPtoP_lookup[j][4];
+    tr = 0.5 * perm[a][b][c][d][e];
+    i_de = plaq_index[d][e];
+
+    opp_a = OPP_LDIR(a);
+    opp_b = OPP_LDIR(b);
+    opp_c = OPP_LDIR(c);
+    // Work on the interior while the gathers are in flight
+    for (part = INTERIOR; part <= BOUNDARY; part++) {
+      if (part == BOUNDARY) {
+        wait_src_gather(tag0[flip]);
+        wait_src_gather(tag1[flip]);
+      }
+      if (sign == PLUS) {
+        FORPARTSITES_OMP(i, s, part, ) {
+          scalar_mult_na_sum((matrix *)(local_pt[flip][0][i]),
+                             &(DbmP_link[j][i]),
+                             tr * BC2(s, opp_a, opp_b), &(dest[i].Fplaq[i_de]));
+
+          scalar_mult_an_dif(&(link_halo[c][c][i]),
+                             (matrix *)(local_pt[flip][1][i]),
+                             tr * BC3(s, opp_a, opp_b, opp_c),
+                             &(dest[i].Fplaq[i_de]));
+        } END_LOOP_OMP;
+      }
+      else {
+        FORPARTSITES_OMP(i, s, part, ) {
+          scalar_mult_nn_dif(&(DbmP_link[j][i]),
+                             (matrix *)(local_pt[flip][0][i]),
+                             tr * BC2(s, opp_a, opp_b), &(dest[i].Fplaq[i_de]));
+
+          scalar_mult_nn_sum((matrix *)(local_pt[flip][1][i]),
+                             &(link_halo[c][c][i]),
+                             tr * BC3(s, opp_a, opp_b, opp_c),
+                             &(dest[i].Fplaq[i_de]));
+        } END_LOOP_OMP;
+      }
+    }
+    cleanup_src_gather(tag0[flip]);
+    cleanup_src_gather(tag1[flip]);
+    flip = gather;
+  }
+}
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Term in action connecting site fermion to the link fermions
+// bc1[mu](x) on psi_mu(x) eta(x + mu)
+// Add to dest instead of overwriting; note factor of 1/2
+#ifdef SV
+void DbplusStoL(Twist_Fermion *src, Twist_Fermion *dest, int sign) {
+  register int i;
+  register site *s;
+  int mu, part;
+  char **local_pt[NUMLINK];
+  msg_tag *tag[NUMLINK];
+  matrix tmat;
+
+  FORALLDIR(mu)
+    local_pt[mu] = gen_pt[mu];
+
+  tag[0] = start_src_gather(&(src[0].Fsite), sizeof(Twist_Fermion),
+                            sizeof(matrix), goffset[0], &(local_pt[0]));
+  FORALLDIR(mu) {
+    if (mu < NUMLINK - 1)     // Start next gather
+      tag[mu + 1] = start_src_gather(&(src[0].Fsite), sizeof(Twist_Fermion),
+                                     sizeof(matrix), goffset[mu + 1],
+                                     &(local_pt[mu + 1]));
+
+    // Work on the interior while the gather is in flight
+    for (part = INTERIOR; part <= BOUNDARY; part++) {
+      if (part == BOUNDARY) {
+        wait_src_gather(tag[mu]);
+      }
+      if (sign == PLUS) {
+        FORPARTSITES_OMP(i, s, part, private(tmat)) {
+          scalar_mult_na((matrix *)(local_pt[mu][i]), &(LINK_AT(mu, i)),
+                         BC1(s, mu), &tmat);
+          mult_an_dif(&(LINK_AT(mu, i)), &(src[i].Fsite), &tmat);
+          scalar_mult_sum_matrix(&tmat, 0.5, &(dest[i].Flink[mu]));
+        } END_LOOP_OMP;
+      }
+      else {
+        FORPARTSITES_OMP(i, s, part, private(tmat)) {
+          scalar_mult_nn(&(LINK_AT(mu, i)), (matrix *)(local_pt[mu][i]),
+                         BC1(s, mu), &tmat);
+          mult_nn_dif(&(src[i].Fsite), &(LINK_AT(mu, i)), &tmat);
+          scalar_mult_dif_matrix(&tmat, 0.5, &(dest[i].Flink[mu]));
+        } END_LOOP_OMP;
+      }
+    }
+    cleanup_src_gather(tag[mu]);
+  }
+}
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Plaquette determinant coupling from site source to link destination
+//   U^{-1}[a](x) * sum_b {D[b][a](x) + D[a][b](x - b)}
+// D is Tr[eta] * plaqdet, Tr[eta] = i sqrt(N) eta^D
+// T is Tr[U^{-1} Lambda]
+// Assume compute_plaqdet() has already been run
+// Use tr_dest and tempdet for temporary storage
+// bc1[b](x - b) = bc1[-b](x) on eta(x - b) psi_a(x)
+// Add negative to dest instead of overwriting
+// Negative sign is due to anti-commuting eta past psi
+#ifdef SV
+void detStoL(Twist_Fermion *dest, int sign) {
+  register int i;
+  register site *s;
+  int a, b, opp_b, next;
+  Real localG = -0.5 * C2 * G;
+  complex tc;
+  msg_tag *tag[NUMLINK];
+
+  // Save Tr[eta(x)] plaqdet[a][b](x)
+  //   or Tr[eta(x)] ZWstar[a][b](x) in tempdet[a][b]
+  FORALLDIR(a) {
+    for (b = a + 1; b < NUMLINK; b++) {
+      FORALLSITES_OMP(i, s, ) {
+        CMUL(tr_eta[i], plaqdet[a][b][i], tempdet[a][b][i]);
+        CMUL(tr_eta[i], plaqdet[b][a][i], tempdet[b][a][i]);
+      } END_LOOP_OMP;
+    }
+  }
+
+  // Now we gather tempdet in both cases
+  // Start first gather for (a, b) = (0, 1)
+  tag[1] = start_gather_field(tempdet[0][1], sizeof(complex),
+                              goffset[1] + 1, EVENANDODD, gen_pt[1]);
+
+  FORALLDIR(a) {
+    // Initialize accumulator for sum over b
+    FORALLSITES_OMP(i, s, ) {
+      tr_dest[i] = cmplx(0.0, 0.0);
+    } END_LOOP_OMP;
+
+    FORALLDIR(b) {
+      if (a == b)
+        continue;
+
+      // Start next gather unless we're doing the last (a=4, b=3)
+      next = b + 1;
+      if (next < NUMLINK && a + b < 2 * NUMLINK - 3) {
+        if (next == a)              // Next gather is actually (a, b + 2)
+          next++;
+
+        tag[next] = start_gather_field(tempdet[a][next], sizeof(complex),
+                                       goffset[next] + 1, EVENANDODD,
+                                       gen_pt[next]);
+      }
+      else if (next == NUMLINK) {   // Start next gather (a + 1, 0)
+        tag[0] = start_gather_field(tempdet[a + 1][0], sizeof(complex),
+                                    goffset[0] + 1, EVENANDODD, gen_pt[0]);
+      }
+
+      // Accumulate tempdet[b][a](x) + tempdet[a][b](x - b)
+      opp_b = OPP_LDIR(b);
+      wait_gather(tag[b]);
+      FORALLSITES_OMP(i, s, private(tc)) {
+        tc = *((complex *)(gen_pt[b][i]));
+        tr_dest[i].real += BC1(s, opp_b) * tc.real;
+        tr_dest[i].imag += BC1(s, opp_b) * tc.imag;
+        CSUM(tr_dest[i], tempdet[b][a][i]);
+      } END_LOOP_OMP;
+      cleanup_gather(tag[b]);
+    }
+
+    // Multiply U_a^{-1} by sum, add to dest[i].Flink[a]
+    // The adjoint subtracts (tc U_a^{-1})^dag instead
+    FORALLSITES_OMP(i, s, private(tc)) {
+      CMULREAL(tr_dest[i], localG, tc);
+      if (sign == PLUS)
+        c_scalar_mult_sum_mat(&(Uinv[a][i]), &tc, &(dest[i].Flink[a]));
+      else
+        c_scalar_mult_dif_adj_mat(&(Uinv[a][i]), &tc, &(dest[i].Flink[a]));
+    } END_LOOP_OMP;
+  }
+}
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Term in action connecting the link fermions to the site fermion
+// Given src psi_a, dest is Dbar_a psi_a (Eq. 63 in the arXiv:1108.1503)
+// Use tempmat and tempmat2 for temporary storage
+// bc1[OPP_LDIR(mu)](x) on eta(x - mu) psi_mu(x - mu)
+// Initialize dest; note factor of 1/2
+#ifdef SV
+void DbminusLtoS(Twist_Fermion *src, Twist_Fermion *dest, int sign) {
+  register int i, mu, nu, opp_mu;
+  register site *s;
+  int gather = 1, flip = 0, part;
+  matrix *mat[2];
+  msg_tag *tag[NUMLINK];
+
+  mat[0] = tempmat;
+  mat[1] = tempmat2;
+
+  FORALLSITES_OMP(i, s, ) {           // Set up first gather
+    clear_mat(&(dest[i].Fsite));  // Initialize
+    if (sign == PLUS)
+      mult_an(&(LINK_AT(0, i)), &(src[i].Flink[0]), &(mat[0][i]));
+    else
+      mult_nn(&(src[i].Flink[0]), &(LINK_AT(0, i)), &(mat[0][i]));
+  } END_LOOP_OMP;
+  tag[0] = start_gather_field(mat[0], sizeof(matrix),
+                              goffset[0] + 1, EVENANDODD, gen_pt[0]);
+
+  FORALLDIR(mu) {
+    if (mu < NUMLINK - 1) {   // Start next gather
+      nu = mu + 1;
+      gather = (flip + 1) % 2;
+      FORALLSITES_OMP(i, s, ) {
+        if (sign == PLUS)
+          mult_an(&(LINK_AT(nu, i)), &(src[i].Flink[nu]), &(mat[gather][i]));
+        else
+          mult_nn(&(src[i].Flink[nu]), &(LINK_AT(nu, i)), &(mat[gather][i]));
+      } END_LOOP_OMP;
+      tag[nu] = start_gather_field(mat[gather], sizeof(matrix),
+                                   goffset[nu] + 1, EVENANDODD, gen_pt[nu]);
+    }
+
+    opp_mu = OPP_LDIR(mu);
+    // Work on the interior while the gather is in flight
+    for (part = INTERIOR; part <= BOUNDARY; part++) {
+      if (part == BOUNDARY) {
+        wait_gather(tag[mu]);
+      }
+      if (sign == PLUS) {
+        FORPARTSITES_OMP(i, s, part, ) {
+          scalar_mult_dif_matrix((matrix *)(gen_pt[mu][i]), BC1(s, opp_mu),
+                                 &(dest[i].Fsite));
+          mult_na_sum(&(src[i].Flink[mu]), &(LINK_AT(mu, i)), &(dest[i].Fsite));
+        } END_LOOP_OMP;
+      }
+      else {
+        FORPARTSITES_OMP(i, s, part, ) {
+          scalar_mult_sum_matrix((matrix *)(gen_pt[mu][i]), BC1(s, opp_mu),
+                                 &(dest[i].Fsite));
+          mult_nn_dif(&(LINK_AT(mu, i)), &(src[i].Flink[mu]), &(dest[i].Fsite));
+        } END_LOOP_OMP;
+      }
+    }
+    cleanup_gather(tag[mu]);
+    flip = gather;
+  }
+
+  // Overall factor of 1/2
+  FORALLSITES_OMP(i, s, ) {
+    scalar_mult_matrix(&(dest[i].Fsite), 0.5, &(dest[i].Fsite));
+  } END_LOOP_OMP;
+}
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Plaquette determinant coupling from link source to site destination
+//   sum_{a, b} D[a][b](x) * {T[b](x) +  T[a](x + b)}
+// D is plaqdet and T is Tr[U^{-1} psi]
+// Assume compute_plaqdet() has already been run
+// bc1[b](x) on eta(x) psi_a(x + b)
+// Use Tr_Uinv and tr_dest for temporary storage
+// Add to dest instead of overwriting
+// Has same sign as DbminusLtoS (negative comes from generator normalization)
+#ifdef SV
+void detLtoS(Twist_Fermion *src, Twist_Fermion *dest, int sign) {
+  register int i;
+  register site *s;
+  int a, b, next;
+  Real localG = 0.5 * C2 * G * sqrt((Real)NCOL);
+  complex tc, tc2;
+  msg_tag *tag[NUMLINK];
+
+  // Prepare Tr[U_a^{-1} psi_a] = sum_j Tr[U_a^{-1} Lambda^j] psi_a^j
+  // and save in Tr_Uinv[a]
+  // The adjoint needs Tr[U_a^{-1} psi_a^dag]
+  FORALLSITES_OMP(i, s, private(a)) {
+    tr_dest[i] = cmplx(0.0, 0.0);   // Initialize
+    if (sign == PLUS) {
+      FORALLDIR(a)
+        Tr_Uinv[a][i] = complextrace_nn(&(Uinv[a][i]), &(src[i].Flink[a]));
+    }
+    else {
+      FORALLDIR(a)
+        Tr_Uinv[a][i] = complextrace_na(&(Uinv[a][i]), &(src[i].Flink[a]));
+    }
+  } END_LOOP_OMP;
+
+  // Start first gather of Tr[U_a^{-1} psi_a] from x + b for (0, 1)
+  tag[1] = start_gather_field(Tr_Uinv[0], sizeof(complex),
+                              goffset[1], EVENANDODD, gen_pt[1]);
+
+  // Main loop
+  FORALLDIR(a) {
+    FORALLDIR(b) {
+      if (a == b)
+        continue;
+
+      // Start next gather unless we're doing the last (a=4, b=3)
+      next = b + 1;
+      if (next < NUMLINK && a + b < 2 * NUMLINK - 3) {
+        if (next == a)              // Next gather is actually (a, b + 2)
+          next++;
+        tag[next] = start_gather_field(Tr_Uinv[a], sizeof(complex),
+                                       goffset[next], EVENANDODD,
+                                       gen_pt[next]);
+      }
+      else if (next == NUMLINK) {   // Start next gather (a + 1, 0)
+        tag[0] = start_gather_field(Tr_Uinv[a + 1], sizeof(complex),
+                                    goffset[0], EVENANDODD, gen_pt[0]);
+      }
+
+      // Accumulate D[a][b](x) {T[b](x) + T[a](x + b)} in tr_dest
+      wait_gather(tag[b]);
+      FORALLSITES_OMP(i, s, private(tc, tc2)) {
+        tc = *((complex *)(gen_pt[b][i]));
+        tc2.real = Tr_Uinv[b][i].real + BC1(s, b) * tc.real;
+        tc2.imag = Tr_Uinv[b][i].imag + BC1(s, b) * tc.imag;
+        CMUL(plaqdet[a][b][i], tc2, tc);
+        // localG is purely imaginary...
+        tr_dest[i].real -= tc.imag * localG;
+        tr_dest[i].imag += tc.real * localG;
+      } END_LOOP_OMP;
+      cleanup_gather(tag[b]);
+    }
+  }
+
+  // Add to dest (negative comes from generator normalization)
+  // The adjoint adds (tr_dest Lambda)^dag instead
+  if (sign == PLUS) {
+    FORALLSITES_OMP(i, s, ) {
+      c_scalar_mult_dif_mat(&(Lambda[DIMF - 1]), &(tr_dest[i]),
+                            &(dest[i].Fsite));
+    } END_LOOP_OMP;
+  }
+  else {
+    FORALLSITES_OMP(i, s, ) {
+      c_scalar_mult_sum_adj_mat(&(Lambda[DIMF - 1]), &(tr_dest[i]),
+                                &(dest[i].Fsite));
+    } END_LOOP_OMP;
+  }
+}
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Twist_Fermion matrix--vector operation
+// Applies either the operator (sign = 1) or its adjoint (sign = -1)
+// dest must not alias src
+void fermion_op(Twist_Fermion *src, Twist_Fermion *dest, int sign) {
+  register int i;
+  register site *s;
+  complex tc;
+
+  if (sign != PLUS && sign != MINUS) {
+    node0_printf("Error: incorrect sign in fermion_op: %d\n", sign);
+    terminate(1);
+  }
+
+#if OP_PRECISION == 2
+  // Refresh neighboring links if they have changed since the last call
+  if (!link_halo_valid)
+    gather_link_halo();
+#endif
+
+  // Send every component of src gathered below in one message per node
+  if (halo_coalesce)
+    exchange_src_halo(src, sizeof(Twist_Fermion), sizeof(matrix));
+
+  // The adjoint uses Tr[eta^dag] = Tr[eta]^*
+  FORALLSITES_OMP(i, s, private(tc)) {
+    if (sign == PLUS)
+      tr_eta[i] = trace(&(src[i].Fsite));
+    else {
+      tc = trace(&(src[i].Fsite));
+      CONJG(tc, tr_eta[i]);
+    }
+  } END_LOOP_OMP;
+
+  // Assemble separate routines for each term in the fermion operator
+  // The Q-closed terms only touch dest[i].Fplaq, so they may come first
+#if defined(SIMD_LAYOUT) && OP_PRECISION == 2
+  if (simd_layout)
+    fermion_op_v(src, dest, sign);        // Overwrites dest[i].Flink, Fplaq
+  else {
+#endif
+#ifdef VP
+  Dplus(src, dest, sign);                 // Overwrites dest[i].Fplaq
+  Dminus(src, dest, sign);                // Overwrites dest[i].Flink
+#endif
+
+#ifdef QCLOSED
+  DbminusPtoP(src, dest, sign);           // Adds to dest[i].Fplaq
+  DbplusPtoP(src, dest, sign);            // Adds to dest[i].Fplaq
+#endif
+#if defined(SIMD_LAYOUT) && OP_PRECISION == 2
+  }
+#endif
+
+#ifdef SV
+  DbplusStoL(src, dest, sign);            // Adds to dest[i].Flink
+
+  // Site-to-link plaquette determinant contribution if G is non-zero
+  // Only depends on Tr[eta(x)]
+  if (doG)
+    detStoL(dest, sign);                  // Adds to dest[i].Flink
+
+  DbminusLtoS(src, dest, sign);           // Overwrites dest[i].Fsite
+
+  // Link-to-site plaquette determinant contribution if G is non-zero
+  if (doG)
+    detLtoS(src, dest, sign);             // Adds to dest[i].Fsite
+#endif
+  finish_src_halo();
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Squared Twist_Fermion matrix--vector operation
+//   dest = (D^2 + fmass^2).src
+// Use tempTF for temporary storage, so neither src nor dest may be tempTF
+void DSq(Twist_Fermion *src, Twist_Fermion *dest) {
+  register int i;
+  register site *s;
+
+  fermion_op(src, tempTF, PLUS);
+  fermion_op(tempTF, dest, MINUS);
+  if (fmass > IMAG_TOL) {
+    Real fmass2 = fmass * fmass;
+    FORALLSITES_OMP(i, s, ) {
+      scalar_mult_sum_TF(&(src[i]), fmass2, &(dest[i]));
+    } END_LOOP_OMP;
+  }
+}
+// -----------------------------------------------------------------
@@ -0,0 +1,517 @@
+// -----------------------------------------------------------------
+// AoSoA versions of the vector/plaquette and Q-closed terms
+// in the fermion operator and force, for -DSIMD_LAYOUT builds
+// See simd_layout.h for the layout and the vector kernels
+// The links and link halo are converted once per gauge field
+// by load_links_v(), called from gather_link_halo()
+// fermion_op_v converts the link and plaquette components of src once
+// per call, so every local operand is a contiguous vector load,
+// accumulates the result in the same layout and converts it into dest
+// Gathered neighbors still arrive as AoS matrices through gen_pt
+// and are loaded lane by lane
+// The boundary condition factors are built from bc_t for each block
+#include "susy_includes.h"
+#ifdef SIMD_LAYOUT
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// AoSoA fields, allocated on first use with VBYTES alignment
+// t_v[i] is the timeslice of site i, padded to a whole number of blocks
+static RANK_LOCAL int alloc_v = 0;
+static RANK_LOCAL short *t_v;
+static RANK_LOCAL vmatrix *link_v[NUMLINK], *link_halo_v[NUMLINK][NUMLINK];
+#ifdef QCLOSED
+static RANK_LOCAL vmatrix *DbpP_link_v[NTERMS], *DbmP_link_v[NTERMS];
+#endif
+static RANK_LOCAL vTwist_Fermion *src_v, *dest_v;
+
+static void *malloc_v(size_t size) {
+  void *p = NULL;
+  if (posix_memalign(&p, VBYTES, size) != 0) {
+    printf("make_fields_v: can't malloc fields\n");
+    fflush(stdout);
+    terminate(1);
+  }
+  return p;
+}
+
+static void make_fields_v() {
+  register int i;
+  int a, b;
+  size_t size = NBLOCKS * sizeof(vmatrix);
+
+  t_v = malloc_v(NBLOCKS * VLEN * sizeof(*t_v));
+  for (i = 0; i < NBLOCKS * VLEN; i++)
+    t_v[i] = (i < sites_on_node ? lattice[i].t : 0);
+
+  FORALLDIR(a) {
+    link_v[a] = malloc_v(size);
+    FORALLDIR(b)
+      link_halo_v[a][b] = malloc_v(size);
+  }
+#ifdef QCLOSED
+  for (a = 0; a < NTERMS; a++) {
+    DbpP_link_v[a] = malloc_v(size);
+    DbmP_link_v[a] = malloc_v(size);
+  }
+#endif
+  src_v = malloc_v(NBLOCKS * sizeof(vTwist_Fermion));
+  dest_v = malloc_v(NBLOCKS * sizeof(vTwist_Fermion));
+  alloc_v = 1;
+}
+
+// Boundary condition factors for a path with total temporal offset dt,
+// in the notation of BC1, BC2 and BC3
+static inline vreal vbc(int i0, int dt) {
+  register int l;
+  vreal v;
+  Real *vr = (Real *)&v;
+  for (l = 0; l < VLEN; l++)
+    vr[l] = bc_t[7 * t_v[i0 + l] + 3 + dt];
+  return v;
+}
+
+// Convert the links, link halo, DbpP_link and DbmP_link
+// Called by gather_link_halo() once the AoS halo is complete
+void load_links_v() {
+  register int k, i0;
+  int a, b;
+
+  if (!alloc_v)
+    make_fields_v();
+
+  FORALLBLOCKS_OMP(k, private(i0, a, b)) {
+    i0 = k * VLEN;
+    FORALLDIR(a) {
+      vload((char *)&(lattice[0].link[a]), sizeof(site), i0, &(link_v[a][k]));
+      FORALLDIR(b) {
+        vload((char *)link_halo[a][b], sizeof(matrix), i0,
+              &(link_halo_v[a][b][k]));
+      }
+    }
+#ifdef QCLOSED
+    for (a = 0; a < NTERMS; a++) {
+      vload((char *)DbpP_link[a], sizeof(matrix), i0, &(DbpP_link_v[a][k]));
+      vload((char *)DbmP_link[a], sizeof(matrix), i0, &(DbmP_link_v[a][k]));
+    }
+#endif
+  } END_LOOP_OMP;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Separate routines for each term, term by term the same as in utilities.c
+// Gathers come from the AoS src, local operands from src_v
+// All called by fermion_op_v below
+#ifdef VP
+static void Dplus_v(Twist_Fermion *src, int sign) {
+  register int k, i0;
+  char **local_pt[2][2];
+  int mu, nu, index, gather, flip = 0, a, b;
+  vreal one = vsplat(1.0), bc_mu, bc_nu;
+  vmatrix g0, g1, *d;
+  msg_tag *tag0[2], *tag1[2];
+
+  for (mu = 0; mu < 2; mu++) {
+    local_pt[0][mu] = gen_pt[mu];
+    local_pt[1][mu] = gen_pt[2 + mu];
+  }
+
+  // Start first set of gathers (mu = 0 and nu = 1)
+  tag0[0] = start_src_gather(&(src[0].Flink[1]), sizeof(Twist_Fermion),
+                             sizeof(matrix), goffset[0], &(local_pt[0][0]));
+
+  tag1[0] = start_src_gather(&(src[0].Flink[0]), sizeof(Twist_Fermion),
+                             sizeof(matrix), goffset[1], &(local_pt[0][1]));
+
+  // Main loop
+  FORALLDIR(mu) {
+    for (nu = mu + 1; nu < NUMLINK; nu++) {
+      index = plaq_index[mu][nu];
+      gather = (flip + 1) % 2;
+      if (index < NPLAQ - 1) {               // Start next set of gathers
+        if (nu == NUMLINK - 1) {
+          a = mu + 1;
+          b = a + 1;
+        }
+        else {
+          a = mu;
+          b = nu + 1;
+        }
+        tag0[gather] = start_src_gather(&(src[0].Flink[b]),
+                                        sizeof(Twist_Fermion), sizeof(matrix),
+                                        goffset[a], &(local_pt[gather][0]));
+
+        tag1[gather] = start_src_gather(&(src[0].Flink[a]),
+                                        sizeof(Twist_Fermion), sizeof(matrix),
+                                        goffset[b], &(local_pt[gather][1]));
+      }
+
+      wait_src_gather(tag0[flip]);
+      wait_src_gather(tag1[flip]);
+      FORALLBLOCKS_OMP(k, private(i0, bc_mu, bc_nu, g0, g1, d)) {
+        i0 = k * VLEN;
+        vload_pt(local_pt[flip][0], i0, &g0);
+        vload_pt(local_pt[flip][1], i0, &g1);
+        bc_mu = vbc(i0, tshift[mu]);
+        bc_nu = vbc(i0, tshift[nu]);
+        d = &(dest_v[k].Fplaq[index]);
+        if (sign == PLUS) {
+          vmult_nn(&(link_v[mu][k]), &g0, bc_mu, 1, d);
+          vmult_nn(&(src_v[k].Flink[nu]), &(link_halo_v[mu][nu][k]),
+                   -one, 0, d);
+          vmult_nn(&(link_v[nu][k]), &g1, -bc_nu, 0, d);
+          vmult_nn(&(src_v[k].Flink[mu]), &(link_halo_v[nu][mu][k]),
+                   one, 0, d);
+        }
+        else {
+          vmult_na(&g0, &(link_v[mu][k]), -bc_mu, 1, d);
+          vmult_an(&(link_halo_v[mu][nu][k]), &(src_v[k].Flink[nu]),
+                   one, 0, d);
+          vmult_na(&g1, &(link_v[nu][k]), bc_nu, 0, d);
+          vmult_an(&(link_halo_v[nu][mu][k]), &(src_v[k].Flink[mu]),
+                   -one, 0, d);
+        }
+      } END_LOOP_OMP;
+      cleanup_src_gather(tag0[flip]);
+      cleanup_src_gather(tag1[flip]);
+      flip = gather;
+    }
+  }
+}
+
+// Use tempmat and tempmat2 for temporary storage
+// The products to be gathered are computed in the AoSoA layout
+// and stored into them as AoS matrices
+static void Dminus_v(int sign) {
+  register int k, i0;
+  char **local_pt[2];
+  int mu, nu, index, gather, flip = 0, a, b, next;
+  vreal one = vsplat(1.0), s, bc;
+  vmatrix g, tmat;
+  matrix *mat[2];
+  msg_tag *tag[2];
+
+  local_pt[0] = gen_pt[0];
+  local_pt[1] = gen_pt[1];
+  mat[0] = tempmat;
+  mat[1] = tempmat2;
+
+  // Start first gather (mu = 1 and nu = 0)
+  index = plaq_index[1][0];
+  FORALLBLOCKS_OMP(k, private(i0, tmat)) {   // mu = 1 > nu = 0
+    i0 = k * VLEN;
+    if (sign == PLUS)
+      vmult_nn(&(src_v[k].Fplaq[index]), &(link_v[1][k]), -one, 1, &tmat);
+    else
+      vmult_an(&(link_v[1][k]), &(src_v[k].Fplaq[index]), -one, 1, &tmat);
+    vstore(&tmat, (char *)mat[0], sizeof(matrix), i0);
+    memset(dest_v[k].Flink, 0, sizeof(dest_v[k].Flink));   // Initialize
+  } END_LOOP_OMP;
+  tag[0] = start_gather_field(mat[0], sizeof(matrix),
+                              goffset[1] + 1, EVENANDODD, local_pt[0]);
+
+  // Main loop
+  FORALLDIR(nu) {
+    FORALLDIR(mu) {
+      if (mu == nu)
+        continue;
+
+      gather = (flip + 1) % 2;
+      if (nu < NUMLINK - 1 || mu < NUMLINK - 2) { // Start next gather
+        if (mu == NUMLINK - 1) {
+          a = 0;
+          b = nu + 1;
+        }
+        else if (mu == nu - 1) {
+          a = mu + 2;
+          b = nu;
+        }
+        else {
+          a = mu + 1;
+          b = nu;
+        }
+        next = plaq_index[a][b];
+        s = (a > b ? -one : one);   // src is anti-symmetric under a <--> b
+        FORALLBLOCKS_OMP(k, private(i0, tmat)) {
+          i0 = k * VLEN;
+          if (sign == PLUS)
+            vmult_nn(&(src_v[k].Fplaq[next]), &(link_v[a][k]), s, 1, &tmat);
+          else
+            vmult_an(&(link_v[a][k]), &(src_v[k].Fplaq[next]), s, 1, &tmat);
+          vstore(&tmat, (char *)mat[gather], sizeof(matrix), i0);
+        } END_LOOP_OMP;
+        tag[gather] = start_gather_field(mat[gather], sizeof(matrix),
+                                         goffset[a] + 1, EVENANDODD,
+                                         local_pt[gather]);
+      }
+
+      index = plaq_index[mu][nu];
+      s = (mu > nu ? -one : one);   // src is anti-symmetric under mu <--> nu
+      wait_gather(tag[flip]);
+      FORALLBLOCKS_OMP(k, private(i0, bc, g)) {
+        i0 = k * VLEN;
+        vload_pt(local_pt[flip], i0, &g);
+        bc = vbc(i0, -tshift[mu]);      // BC1 for OPP_LDIR(mu)
+        if (sign == PLUS) {
+          vmult_nn(&(link_halo_v[mu][nu][k]), &(src_v[k].Fplaq[index]),
+                   s, 0, &(dest_v[k].Flink[nu]));
+          vscalar_mult_sum(&g, -bc, &(dest_v[k].Flink[nu]));
+        }
+        else {
+          vmult_na(&(src_v[k].Fplaq[index]), &(link_halo_v[mu][nu][k]),
+                   -s, 0, &(dest_v[k].Flink[nu]));
+          vscalar_mult_sum(&g, bc, &(dest_v[k].Flink[nu]));
+        }
+      } END_LOOP_OMP;
+      cleanup_gather(tag[flip]);
+      flip = gather;
+    }
+  }
+}
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Add to dest_v instead of overwriting; note factor of 1/2
+#ifdef QCLOSED
+static void DbplusPtoP_v(Twist_Fermion *src, int sign) {
+  register int k, i0;
+  char **local_pt[2][2];
+  int a, b, c, d, e, j, gather, next, flip = 0, i_ab, i_de;
+  Real tr;
+  vreal bc2, bc3;
+  vmatrix g0, g1;
+  msg_tag *tag0[2], *tag1[2];
+
+  for (a = 0; a < 2; a++) {
+    local_pt[0][a] = gen_pt[a];
+    local_pt[1][a] = gen_pt[2 + a];
+  }
+
+  // Start first set of gathers
+  d = DbplusPtoP_lookup[0][3];
+  e = DbplusPtoP_lookup[0][4];
+  i_de = plaq_index[d][e];
+  tag0[0] = start_src_gather(&(src[0].Fplaq[i_de]), sizeof(Twist_Fermion),
+                             sizeof(matrix), DbpP_d2[0], &(local_pt[0][0]));
+  tag1[0] = start_src_gather(&(src[0].Fplaq[i_de]), sizeof(Twist_Fermion),
+                             sizeof(matrix), DbpP_d1[0], &(local_pt[0][1]));
+
+  // Loop over lookup table
+  for (j = 0; j < NTERMS; j++) {
+    gather = (flip + 1) % 2;
+    if (j < NTERMS - 1) {               // Start next set of gathers
+      next = j + 1;
+      d = DbplusPtoP_lookup[next][3];
+      e = DbplusPtoP_lookup[next][4];
+      i_de = plaq_index[d][e];
+
+      tag0[gather] = start_src_gather(&(src[0].Fplaq[i_de]),
+                                      sizeof(Twist_Fermion), sizeof(matrix),
+                                      DbpP_d2[next], &(local_pt[gather][0]));
+      tag1[gather] = start_src_gather(&(src[0].Fplaq[i_de]),
+                                      sizeof(Twist_Fermion), sizeof(matrix),
+                                      DbpP_d1[next], &(local_pt[gather][1]));
+    }
+
+    a = DbplusPtoP_lookup[j][0];
+    b = DbplusPtoP_lookup[j][1];
+    c = DbplusPtoP_lookup[j][2];
+    d = DbplusPtoP_lookup[j][3];
+    e = DbplusPtoP_lookup[j][4];
+    tr = 0.5 * perm[a][b][c][d][e];
+    i_ab = plaq_index[a][b];
+
+    wait_src_gather(tag0[flip]);
+    wait_src_gather(tag1[flip]);
+    FORALLBLOCKS_OMP(k, private(i0, bc2, bc3, g0, g1)) {
+      i0 = k * VLEN;
+      vload_pt(local_pt[flip][0], i0, &g0);
+      vload_pt(local_pt[flip][1], i0, &g1);
+      bc3 = tr * vbc(i0, tshift[a] + tshift[b] + tshift[c]);
+      bc2 = tr * vbc(i0, tshift[a] + tshift[b]);
+      if (sign == PLUS) {
+        vmult_na(&g0, &(DbpP_link_v[j][k]), bc3, 0,
+                 &(dest_v[k].Fplaq[i_ab]));
+        vmult_an(&(link_halo_v[c][c][k]), &g1, -bc2, 0,
+                 &(dest_v[k].Fplaq[i_ab]));
+      }
+      else {
+        vmult_nn(&(DbpP_link_v[j][k]), &g0, -bc3, 0,
+                 &(dest_v[k].Fplaq[i_ab]));
+        vmult_nn(&g1, &(link_halo_v[c][c][k]), bc2, 0,
+                 &(dest_v[k].Fplaq[i_ab]));
+      }
+    } END_LOOP_OMP;
+    cleanup_src_gather(tag0[flip]);
+    cleanup_src_gather(tag1[flip]);
+    flip = gather;
+  }
+}
+
+static void DbminusPtoP_v(Twist_Fermion *src, int sign) {
+  register int k, i0;
+  char **local_pt[2][2];
+  int a, b, c, d, e, j, gather, next, flip = 0, i_ab, i_de;
+  Real tr;
+  vreal bc2, bc3;
+  vmatrix g0, g1;
+  msg_tag *tag0[2], *tag1[2];
+
+  for (a = 0; a < 2; a++) {
+    local_pt[0][a] = gen_pt[a];
+    local_pt[1][a] = gen_pt[2 + a];
+  }
+
+  // Start first set of gathers
+  a = DbminusPtoP_lookup[0][0];
+  b = DbminusPtoP_lookup[0][1];
+  i_ab = plaq_index[a][b];
+  tag0[0] = start_src_gather(&(src[0].Fplaq[i_ab]), sizeof(Twist_Fermion),
+                             sizeof(matrix), DbmP_d2[0], &(local_pt[0][0]));
+  tag1[0] = start_src_gather(&(src[0].Fplaq[i_ab]), sizeof(Twist_Fermion),
+                             sizeof(matrix), DbmP_d1[0], &(local_pt[0][1]));
+
+  // Loop over lookup table
+  for (j = 0; j < NTERMS; j++) {
+    gather = (flip + 1) % 2;
+    if (j < NTERMS - 1) {               // Start next set of gathers
+      next = j + 1;
+      a = DbminusPtoP_lookup[next][0];
+      b = DbminusPtoP_lookup[next][1];
+      i_ab = plaq_index[a][b];
+      tag0[gather] = start_src_gather(&(src[0].Fplaq[i_ab]),
+                                      sizeof(Twist_Fermion), sizeof(matrix),
+                                      DbmP_d2[next], &(local_pt[gather][0]));
+      tag1[gather] = start_src_gather(&(src[0].Fplaq[i_ab]),
+                                      sizeof(Twist_Fermion), sizeof(matrix),
+                                      DbmP_d1[next], &(local_pt[gather][1]));
+    }
+
+    a = DbminusPtoP_lookup[j][0];
+    b = DbminusPtoP_lookup[j][1];
+    c = DbminusPtoP_lookup[j][2];
+    d = DbminusPtoP_lookup[j][3];
+    e = DbminusPtoP_lookup[j][4];
+    tr = 0.5 * perm[a][b][c][d][e];
+    i_de = plaq_index[d][e];
+
+    // BC2 and BC3 for the opposite directions
+    wait_src_gather(tag0[flip]);
+    wait_src_gather(tag1[flip]);
+    FORALLBLOCKS_OMP(k, private(i0, bc2, bc3, g0, g1)) {
+      i0 = k * VLEN;
+      vload_pt(local_pt[flip][0], i0, &g0);
+      vload_pt(local_pt[flip][1], i0, &g1);
+      bc2 = tr * vbc(i0, -tshift[a] - tshift[b]);
+      bc3 = tr * vbc(i0, -tshift[a] - tshift[b] - tshift[c]);
+      if (sign == PLUS) {
+        vmult_na(&g0, &(DbmP_link_v[j][k]), bc2, 0,
+                 &(dest_v[k].Fplaq[i_de]));
+        vmult_an(&(link_halo_v[c][c][k]), &g1, -bc3, 0,
+                 &(dest_v[k].Fplaq[i_de]));
+      }
+      else {
+        vmult_nn(&(DbmP_link_v[j][k]), &g0, -bc2, 0,
+                 &(dest_v[k].Fplaq[i_de]));
+        vmult_nn(&g1, &(link_halo_v[c][c][k]), bc3, 0,
+                 &(dest_v[k].Fplaq[i_de]));
+      }
+    } END_LOOP_OMP;
+    cleanup_src_gather(tag0[flip]);
+    cleanup_src_gather(tag1[flip]);
+    flip = gather;
+  }
+}
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Vector/plaquette and Q-closed terms of fermion_op,
+// overwriting dest[i].Flink and dest[i].Fplaq
+// Called by fermion_op, which adds the site-to-link terms afterwards
+void fermion_op_v(Twist_Fermion *src, Twist_Fermion *dest, int sign) {
+  register int k, i0;
+  int a;
+
+  if (!alloc_v)
+    make_fields_v();
+
+  FORALLBLOCKS_OMP(k, private(i0, a)) {
+    i0 = k * VLEN;
+    FORALLDIR(a) {
+      vload((char *)&(src[0].Flink[a]), sizeof(Twist_Fermion), i0,
+            &(src_v[k].Flink[a]));
+    }
+    for (a = 0; a < NPLAQ; a++) {
+      vload((char *)&(src[0].Fplaq[a]), sizeof(Twist_Fermion), i0,
+            &(src_v[k].Fplaq[a]));
+    }
+  } END_LOOP_OMP;
+
+#ifdef VP
+  Dplus_v(src, sign);                 // Overwrites dest_v[k].Fplaq
+  Dminus_v(sign);                     // Overwrites dest_v[k].Flink
+#endif
+
+#ifdef QCLOSED
+  DbminusPtoP_v(src, sign);           // Adds to dest_v[k].Fplaq
+  DbplusPtoP_v(src, sign);            // Adds to dest_v[k].Fplaq
+#endif
+
+  FORALLBLOCKS_OMP(k, private(i0, a)) {
+    i0 = k * VLEN;
+    FORALLDIR(a) {
+      vstore(&(dest_v[k].Flink[a]), (char *)&(dest[0].Flink[a]),
+             sizeof(Twist_Fermion), i0);
+    }
+    for (a = 0; a < NPLAQ; a++) {
+      vstore(&(dest_v[k].Fplaq[a]), (char *)&(dest[0].Fplaq[a]),
+             sizeof(Twist_Fermion), i0);
+    }
+  } END_LOOP_OMP;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Site loop shared by the Q-closed force terms F1Q and F2Q,
+// with pt[0..3] the four gathered fermion components
+//   f_U[c] <-- f_U[c] - 0.5 [s1 pt0 pt1 + s2 pt3 pt2]^dag
+// where s1 and s2 are permm * BC1(s, c) times the boundary condition
+// factors for paths with total temporal offsets dt1 and dt2
+void FQ_sites_v(char **pt[4], Real permm, int dt1, int dt2, int c) {
+  register int k, i0;
+  vreal bc_c, s1, s2;
+  vmatrix g0, g1, g2, g3, tmat;
+
+  if (!alloc_v)
+    make_fields_v();
+
+  FORALLBLOCKS_OMP(k, private(i0, bc_c, s1, s2, g0, g1, g2, g3, tmat)) {
+    i0 = k * VLEN;
+    vload_pt(pt[0], i0, &g0);
+    vload_pt(pt[1], i0, &g1);
+    vload_pt(pt[2], i0, &g2);
+    vload_pt(pt[3], i0, &g3);
+    bc_c = permm * vbc(i0, tshift[c]);
+    s1 = bc_c * vbc(i0, dt1);
+    s2 = -bc_c * vbc(i0, dt2);
+    vmult_nn(&g0, &g1, s1, 1, &tmat);
+    vmult_nn(&g3, &g2, s2, 0, &tmat);
+    vstore_adj_sum(&tmat, -0.5, (char *)&(lattice[0].f_U[c]), sizeof(site),
+                   i0);
+  } END_LOOP_OMP;
+}
+#endif
+// -----------------------------------------------------------------
@@ -19,7 +19,7 @@
 // Write the ASCII info file
 // Call this from one of the lattice output routines in io_lat4.c
 void write_appl_gauge_info(FILE *fp) {
-  char sums[20];
+  char sums[20], value[32];
 
   // The file has already been opened
   // The required magic number, time stamp, and lattice dimensions
@@ -34,6 +34,17 @@ void write_appl_gauge_info(FILE *fp) {
     sprintf(sums, "%x %x", startlat_p->check.sum29, startlat_p->check.sum31);
     write_gauge_info_item(fp, "gauge.previous.checksums", "\"%s\"", sums, 0, 0);
   }
+
+  // Plaquettes, link trace and NERSC checksum found by save_lattice,
+  // which peek_serial reports without loading the links
+  sprintf(value, "%.16e", g_ssplaq);
+  write_gauge_info_item(fp, "gauge.ssplaq", "%s", value, 0, 0);
+  sprintf(value, "%.16e", g_stplaq);
+  write_gauge_info_item(fp, "gauge.stplaq", "%s", value, 0, 0);
+  sprintf(value, "%.16e", linktrsum.real * one_ov_N);
+  write_gauge_info_item(fp, "gauge.nersc_linktr", "%s", value, 0, 0);
+  sprintf(value, "%x", nersc_checksum);
+  write_gauge_info_item(fp, "gauge.nersc_checksum", "%s", value, 0, 0);
 }
 // -----------------------------------------------------------------
 
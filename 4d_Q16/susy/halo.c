@@ -0,0 +1,211 @@
+// -----------------------------------------------------------------
+// Coalesced halo exchange of the fermion_op source
+// Dplus, DbplusStoL and the Q-closed terms gather components of src
+// from neighboring sites, normally with one strided gather at a time
+// If halo_coalesce is set, exchange_src_halo() does all of these
+// gathers at the start of fermion_op (or fermion_op_f) as a single
+// accumulated gather, so that each neighboring node exchanges
+// a single message per operator application
+// The accumulated gather is declared once for each stride and size,
+// then just pointed at the new src on each call
+// The terms then find their neighbors through start_src_gather(),
+// which points into the halo rather than starting a new gather,
+// and wait_src_gather() waits for the halo itself to arrive
+// Dminus, DbminusLtoS and the determinant terms gather fields computed
+// from src inside each term, so they keep their own gathers
+#include "susy_includes.h"
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Components are labelled by k, with Fsite k = 0, Flink[a] k = 1 + a
+// and Fplaq[i] k = 1 + NUMLINK + i, in both Twist_Fermion layouts
+#define MAX_HALO (NUMLINK * NUMLINK + 4 * NTERMS)
+static RANK_LOCAL int n_halo = -1;
+static RANK_LOCAL int halo_comp[MAX_HALO], halo_dir[MAX_HALO];
+
+// Accumulated gather of all components for one stride and size,
+// declared with the first src and moved to each new one
+// Receive buffers of the gather and their pointers in pt are kept
+#define MAX_HALO_PLANS 2      // Double and single precision
+typedef struct {
+  int stride, size;
+  char *src;                  // Field the gather reads now
+  msg_tag *tag;
+  char **pt[MAX_HALO];
+} halo_plan;
+static RANK_LOCAL halo_plan halo_plans[MAX_HALO_PLANS];
+static RANK_LOCAL int n_halo_plans = 0;
+
+// Plan of the halo currently in use, or NULL
+static RANK_LOCAL halo_plan *halo = NULL;
+
+// Add component k from direction dir unless it is already there
+static void add_halo(int k, int dir) {
+  int n;
+
+  for (n = 0; n < n_halo; n++) {
+    if (halo_comp[n] == k && halo_dir[n] == dir)
+      return;
+  }
+  halo_comp[n_halo] = k;
+  halo_dir[n_halo] = dir;
+  n_halo++;
+}
+
+// List every gather of src made by the terms in fermion_op
+static void setup_src_halo() {
+  int a, b, j;
+
+  n_halo = 0;
+#ifdef VP
+  // Dplus: Flink[b](x + a)
+  FORALLDIR(a) {
+    FORALLDIR(b) {
+      if (a != b)
+        add_halo(1 + b, goffset[a]);
+    }
+  }
+#endif
+#ifdef SV
+  // DbplusStoL: Fsite(x + a)
+  FORALLDIR(a)
+    add_halo(0, goffset[a]);
+#endif
+#ifdef QCLOSED
+  // DbplusPtoP and DbminusPtoP: Fplaq from the Q-closed offsets
+  for (j = 0; j < NTERMS; j++) {
+    a = DbplusPtoP_lookup[j][3];
+    b = DbplusPtoP_lookup[j][4];
+    add_halo(1 + NUMLINK + plaq_index[a][b], DbpP_d2[j]);
+    add_halo(1 + NUMLINK + plaq_index[a][b], DbpP_d1[j]);
+
+    a = DbminusPtoP_lookup[j][0];
+    b = DbminusPtoP_lookup[j][1];
+    add_halo(1 + NUMLINK + plaq_index[a][b], DbmP_d2[j]);
+    add_halo(1 + NUMLINK + plaq_index[a][b], DbmP_d1[j]);
+  }
+#endif
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Declare the accumulated gather for this stride and size from src
+static halo_plan* make_halo_plan(char *src, int stride, int size) {
+  int n;
+  halo_plan *hp;
+  msg_tag *mtag;
+
+  if (n_halo_plans == MAX_HALO_PLANS) {
+    node0_printf("make_halo_plan: more than %d halo plans\n", MAX_HALO_PLANS);
+    terminate(1);
+  }
+  hp = &halo_plans[n_halo_plans++];
+  hp->stride = stride;
+  hp->size = size;
+  hp->src = src;
+  hp->tag = NULL;
+  for (n = 0; n < n_halo; n++) {
+    hp->pt[n] = malloc(sites_on_node * sizeof(char *));
+    if (hp->pt[n] == NULL) {
+      printf("make_halo_plan: node%d can't malloc pt\n", this_node);
+      terminate(1);
+    }
+    mtag = declare_strided_gather(src + halo_comp[n] * size, stride, size,
+                                  halo_dir[n], EVENANDODD, hp->pt[n]);
+    accumulate_gather(&hp->tag, mtag);
+    cleanup_gather(mtag);
+  }
+  return hp;
+}
+
+// Move the gather to src, including the pointers to neighbors
+// on this node, which are the only ones into the old src
+static void rebind_halo_plan(halo_plan *hp, char *src) {
+  int i, n;
+  char *old = hp->src, *end = hp->src + sites_on_node * hp->stride;
+
+  for (n = 0; n < n_halo; n++) {
+    for (i = 0; i < sites_on_node; i++) {
+      if (hp->pt[n][i] >= old && hp->pt[n][i] < end)
+        hp->pt[n][i] = src + (hp->pt[n][i] - old);
+    }
+  }
+  rebind_gather(hp->tag, old, src);
+  hp->src = src;
+}
+
+// Exchange the whole halo of src in a single accumulated gather
+// stride is the size of the Twist_Fermion, size that of one component
+void exchange_src_halo(void *src, int stride, int size) {
+  int j;
+  halo_plan *hp = NULL;
+
+  if (n_halo < 0)
+    setup_src_halo();
+
+  for (j = 0; j < n_halo_plans; j++) {
+    if (halo_plans[j].stride == stride && halo_plans[j].size == size) {
+      hp = &halo_plans[j];
+      break;
+    }
+  }
+  if (hp == NULL)
+    hp = make_halo_plan((char *)src, stride, size);
+  else if (hp->src != (char *)src)
+    rebind_halo_plan(hp, (char *)src);
+
+  halo = hp;
+  do_gather(hp->tag);
+}
+
+// Finish the halo once all terms are done, keeping the gather
+void finish_src_halo() {
+  if (halo == NULL)
+    return;
+  wait_gather(halo->tag);
+  release_gather(halo->tag);
+  halo = NULL;
+}
+
+// Start a strided gather of the src component at field from direction dir,
+// with pointers in *pt
+// During a halo exchange, point *pt into the halo instead, returning NULL
+// Pointers to sites on this node are set as soon as the halo is started,
+// so the interior can be used before wait_src_gather()
+msg_tag* start_src_gather(void *field, int stride, int size, int dir,
+                          char ***pt) {
+  int k, n;
+
+  if (halo == NULL)
+    return start_gather_strided(field, stride, size, dir, EVENANDODD, *pt);
+
+  k = ((char *)field - halo->src) / halo->size;
+  for (n = 0; n < n_halo; n++) {
+    if (halo_comp[n] == k && halo_dir[n] == dir) {
+      *pt = halo->pt[n];
+      return NULL;
+    }
+  }
+  node0_printf("start_src_gather: component %d from %d not in halo\n", k, dir);
+  terminate(1);
+  return NULL;
+}
+
+// wait_gather() and cleanup_gather(), with NULL standing for the halo
+// The halo is only cleaned up by finish_src_halo()
+void wait_src_gather(msg_tag *tag) {
+  if (tag != NULL)
+    wait_gather(tag);
+  else if (halo != NULL)
+    wait_gather(halo->tag);
+}
+
+void cleanup_src_gather(msg_tag *tag) {
+  if (tag != NULL)
+    cleanup_gather(tag);
+}
+// -----------------------------------------------------------------
@@ -17,13 +17,13 @@ void hvy_pot_polar() {
 
   node0_printf("hvy_pot_polar: MAX_T = %d, MAX_X = %d\n", MAX_T, MAX_X);
 
-  FORALLSITES(i, s) {
+  FORALLSITES_OMP(i, s, private(tmat, tmat2)) {
    // Polar projection of gauge-fixed links
    // To be multiplied together after projecting
    // !!! Overwrites links
    polar(&(s->link[TUP]), &tmat, &tmat2);
    mat_copy(&tmat, &(s->link[TUP]));
-  }
+  } END_LOOP_OMP;
 
   // Use staple to hold product of t_dist links at each (x, y, z)
   for (t_dist = 1; t_dist <= MAX_T; t_dist++) {
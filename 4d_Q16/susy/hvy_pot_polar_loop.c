@@ -15,7 +15,7 @@ void hvy_pot_polar_loop() {
   complex c_loop;
   matrix tmat, tmat2;
 
-  FORALLSITES(i, s) {
+  FORALLSITES_OMP(i, s, private(mu, tmat, tmat2)) {
     FORALLDIR(mu) {
       // Polar projection of all links (even the unused diagonal link)
       // To be multiplied together after projecting
@@ -23,7 +23,7 @@ void hvy_pot_polar_loop() {
       polar(&(s->link[mu]), &tmat, &tmat2);
       mat_copy(&tmat, &(s->link[mu]));
     }
-  }
+  } END_LOOP_OMP;
 
   node0_printf("hvy_pot_polar_loop: MAX_T = %d, MAX_X = %d\n", MAX_T, MAX_X);
 
@@ -18,15 +18,16 @@ void compute_Ba() {
   int a, b, j, k;
   Real tr;
   complex tc;
-  matrix tmat;
+
+  // Log of hermitian part of polar decomposition
+  FORALLDIR(a) {
+    polar_site(F_OFFSET(link[a]), NULL, Ba[0][a]);
+    matrix_log_field(Ba[0][a], Ba[0][a]);
+  }
 
   FORALLSITES(i, s) {
-    // Construct scalar fields
+    // Construct remaining scalar fields
     FORALLDIR(a) {
-      // Log of hermitian part of polar decomposition
-      polar(&(s->link[a]), &(Ba[0][a][i]), &tmat);
-      matrix_log(&tmat, &(Ba[0][a][i]));
-
       // U.Udag (hermitian so trace is real)
       mult_na(&(s->link[a]), &(s->link[a]), &(Ba[1][a][i]));
 
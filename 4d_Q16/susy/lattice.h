@@ -20,6 +20,14 @@ typedef struct {
   matrix Flink[NUMLINK];
   matrix Fplaq[NPLAQ];
 } Twist_Fermion;
+
+// Single-precision copy for the mixed-precision CG
+typedef struct {
+  fmatrix Fsite;
+  fmatrix Flink[NUMLINK];
+  fmatrix Fplaq[NPLAQ];
+} Twist_Fermion_f;
+#define TF_F_REALS (2 * NCOL * NCOL * (1 + NUMLINK + NPLAQ))
 // -----------------------------------------------------------------
 
 
@@ -46,10 +54,6 @@ typedef struct {
   // as opposed to anti-hermitian matrices
   matrix mom[NUMLINK], f_U[NUMLINK];        // Force matrices
 
-  // Boundary conditions -- many unused
-  Real bc1[2 * NUMLINK], bc2[2 * NUMLINK][2 * NUMLINK];
-  Real bc3[2 * NUMLINK][2 * NUMLINK][2 * NUMLINK];
-
 #ifdef PL_CORR
   complex print_var, ploop_corr, fft1, fft2;
 #endif
@@ -59,11 +63,11 @@ typedef struct {
 
 
 // -----------------------------------------------------------------
-// Definition of global variables
+// Definition of global variables, private to each rank
 #ifdef CONTROL
-#define EXTERN
+#define EXTERN RANK_LOCAL
 #else
-#define EXTERN extern
+#define EXTERN extern RANK_LOCAL
 #endif
 
 EXTERN int nx, ny, nz, nt;  // Lattice dimensions
@@ -72,6 +76,9 @@ EXTERN int PBC;             // Temporal fermion boundary condition flag
 EXTERN int volume;          // Volume of lattice
 EXTERN int iseed;           // Random number seed
 EXTERN int warms, trajecs, niter, propinterval;
+EXTERN int cg_pipelined;    // Pipelined multi-shift CG if 1
+EXTERN int cg_mixed;        // Mixed-precision multi-shift CG if 1
+EXTERN int cg_forecast;     // Number of MD solutions kept for initial guesses
 EXTERN Real traj_length;
 
 // U(N) generators, epsilon tensor
@@ -82,6 +89,7 @@ EXTERN Real perm[NUMLINK][NUMLINK][NUMLINK][NUMLINK][NUMLINK];
 EXTERN int plaq_index[NUMLINK][NUMLINK];
 
 EXTERN Real rsqmin, lambda, kappa, bmass, fmass, kappa_u1, G;
+EXTERN Real rsqmin_MD, rsqmin_accept;  // Zero for uniform rsqmin in the RHMC
 #ifdef DIMREDUCE
 EXTERN Real cWline;       // Coefficient of center-breaking term protecting
                           // single-link 'Wilson line' in reduced dir(s)
@@ -107,6 +115,7 @@ EXTERN int this_node;           // Node number of this node
 // Stuff for multi-mass CG and RHMC
 EXTERN int nsteps[2];           // Fermion and gauge steps
 EXTERN Real ampdeg, *amp, *shift;
+EXTERN Real *shift_tol;         // Per-shift CG stopping factors, if not NULL
 EXTERN Real ampdeg4, *amp4, *shift4;
 EXTERN Real ampdeg8, *amp8, *shift8;
 EXTERN int Nroot, Norder;
@@ -118,6 +127,17 @@ EXTERN double_prn node_prn;
 
 // Stuff for derivative and link terms
 EXTERN int offset[NUMLINK][NDIMS];    // Path along each link
+
+// Fermion boundary conditions depend only on the timeslice t
+// and the total temporal offset k of a path of up to three links
+// bc_t[7 * t + 3 + k] is PBC if t + k is outside [0, nt - 1], otherwise 1
+// tshift[dir] is the temporal offset of each of the 2 * NUMLINK directions
+EXTERN Real *bc_t;
+EXTERN int tshift[2 * NUMLINK];
+#define BC1(s, a)       (bc_t[7 * (s)->t + 3 + tshift[a]])
+#define BC2(s, a, b)    (bc_t[7 * (s)->t + 3 + tshift[a] + tshift[b]])
+#define BC3(s, a, b, c) (bc_t[7 * (s)->t + 3 + tshift[a] + tshift[b] \
+                              + tshift[c]])
 EXTERN int label[NUMLINK];
 EXTERN int q_off_max, q_offset[NQLINK][4];
 
@@ -134,11 +154,36 @@ EXTERN int F1Q_d1[NTERMS], F1Q_d2[NTERMS];
 EXTERN int F2Q_d1[NTERMS], F2Q_d2[NTERMS];
 EXTERN int FQ_lookup[NTERMS][NUMLINK];
 
-// Persistent site, link and plaq fermions for matrix--vector operation
-// Used in fermion_op and assemble_fermion_force
+// Persistent site, link and plaq fermions
+// Used in assemble_fermion_force
 EXTERN matrix *site_src, *link_src[NUMLINK], *plaq_src[NPLAQ];
 EXTERN matrix *site_dest, *link_dest[NUMLINK], *plaq_dest[NPLAQ];
 
+// Persistent halo of neighboring links for fermion_op,
+// gathered once after the links change rather than in every matvec
+// link_halo[a][b] is U_a(x + b) for a != b, while link_halo[a][a] is U_a(x - a)
+// DbpP_link[j] and DbmP_link[j] are U_c(x + DbpP_d1[j]) and U_c(x + DbmP_d1[j])
+// Must be invalidated by any routine that modifies the links
+EXTERN matrix *link_halo[NUMLINK][NUMLINK];
+#ifdef QCLOSED
+EXTERN matrix *DbpP_link[NTERMS], *DbmP_link[NTERMS];
+#endif
+EXTERN int link_halo_valid;
+
+// Whether the single-precision links of fermion_op_f.c are current,
+// cleared along with link_halo_valid so that load_links_f() only
+// converts the links once per gauge field
+EXTERN int links_f_valid;
+
+// fermion_op and fermion_op_f exchange all components of src they gather
+// in a single message per neighboring node if non-zero, see halo.c
+EXTERN int halo_coalesce;
+#ifdef SIMD_LAYOUT
+// fermion_op and the Q-closed force use the AoSoA kernels
+// in fermion_op_v.c if non-zero (the default)
+EXTERN int simd_layout;
+#endif
+
 // For convenience in calculating action and force
 // May be wasteful of space
 EXTERN Real one_ov_N;
@@ -175,6 +220,11 @@ EXTERN site *lattice;
 #define N_POINTERS 10
 EXTERN char **gen_pt[N_POINTERS];
 
+// Sites whose neighbors are all on this node (INTERIOR), and the rest,
+// listed by make_lattice() for FORPARTSITES_OMP
+EXTERN int n_part_sites[2];
+EXTERN int *part_sites[2];
+
 #ifdef CORR
 #define N_B 2
 #define N_K 3    // N_B * (N_B + 1) / 2
@@ -0,0 +1,90 @@
+// -----------------------------------------------------------------
+// Single-precision Twist_Fermion routines for the mixed-precision CG
+// The libraries are compiled at a single PRECISION,
+// so these carry an _f suffix and live here instead
+// Dot products and norms are accumulated in double precision
+#include "susy_includes.h"
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Conversions between precisions
+void mat_d2f(matrix *a, fmatrix *b) {
+  register int i, j;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      b->e[i][j].real = (float)a->e[i][j].real;
+      b->e[i][j].imag = (float)a->e[i][j].imag;
+    }
+  }
+}
+
+void TF_d2f(Twist_Fermion *a, Twist_Fermion_f *b) {
+  register int i;
+  mat_d2f(&(a->Fsite), &(b->Fsite));
+  FORALLDIR(i)
+    mat_d2f(&(a->Flink[i]), &(b->Flink[i]));
+  for (i = 0; i < NPLAQ; i++)
+    mat_d2f(&(a->Fplaq[i]), &(b->Fplaq[i]));
+}
+
+// c <-- c + b, promoting b to the precision of c
+void TF_f2d_sum(Twist_Fermion_f *b, Twist_Fermion *c) {
+  register int i;
+  register float *bf = (float *)b;
+  register Real *cr = (Real *)c;
+  for (i = 0; i < TF_F_REALS; i++)
+    cr[i] += (Real)bf[i];
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Twist_Fermion_f routines, treating each as a flat array of floats
+// since they involve no matrix structure
+void clear_TF_f(Twist_Fermion_f *c) {
+  register int i;
+  register float *cf = (float *)c;
+  for (i = 0; i < TF_F_REALS; i++)
+    cf[i] = 0.0;
+}
+
+// Return |a|^2 accumulated in double precision
+double magsq_TF_f(Twist_Fermion_f *a) {
+  register int i;
+  register float *af = (float *)a;
+  double sum = 0.0;
+  for (i = 0; i < TF_F_REALS; i++)
+    sum += (double)af[i] * af[i];
+  return sum;
+}
+
+// Return ReTr[adag.b] accumulated in double precision
+double TF_rdot_f(Twist_Fermion_f *a, Twist_Fermion_f *b) {
+  register int i;
+  register float *af = (float *)a, *bf = (float *)b;
+  double sum = 0.0;
+  for (i = 0; i < TF_F_REALS; i++)
+    sum += (double)af[i] * bf[i];
+  return sum;
+}
+
+// c <-- c + s * b
+void scalar_mult_sum_TF_f(Twist_Fermion_f *b, float s, Twist_Fermion_f *c) {
+  register int i;
+  register float *bf = (float *)b, *cf = (float *)c;
+  for (i = 0; i < TF_F_REALS; i++)
+    cf[i] += s * bf[i];
+}
+
+// c <-- sa * a + sb * b
+void scalar_mult_add_TF_f(Twist_Fermion_f *a, float sa,
+                          Twist_Fermion_f *b, float sb, Twist_Fermion_f *c) {
+  register int i;
+  register float *af = (float *)a, *bf = (float *)b, *cf = (float *)c;
+  for (i = 0; i < TF_F_REALS; i++)
+    cf[i] = sa * af[i] + sb * bf[i];
+}
+// -----------------------------------------------------------------
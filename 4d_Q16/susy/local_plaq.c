@@ -15,7 +15,7 @@
 #define MY_X x
 #define MY_DIR XUP          // Printed out first time the routine is called
 #define MY_N nx
-static int print_dir = 0;   // Controls printing out MY_DIR
+static RANK_LOCAL int print_dir = 0;   // Controls printing out MY_DIR
 #endif
 
 #define MIN_PLAQ
@@ -30,7 +30,6 @@ double local_plaquette(double *ss_plaq, double *st_plaq) {
   double min_plaq = 200.0 * NCOL;
 #endif
   msg_tag *mtag0, *mtag1;
-  matrix tmat;
 
 #ifdef LOCAL_PLAQ
   int xx;
@@ -66,8 +65,9 @@ double local_plaquette(double *ss_plaq, double *st_plaq) {
 
       if (dir == TUP || dir2 == TUP) {
         FORALLSITES(i, s) {
-          mult_nn(&(tempmat[i]), (matrix *)(gen_pt[0][i]), &tmat);
-          cur_plaq = (double)realtrace((matrix *)(gen_pt[1][i]), &tmat);
+          cur_plaq = (double)realtrace_mult_nn((matrix *)(gen_pt[1][i]),
+                                               &(tempmat[i]),
+                                               (matrix *)(gen_pt[0][i]));
           if (cur_plaq > max_plaq)
             max_plaq = cur_plaq;
 #ifdef MIN_PLAQ
@@ -89,8 +89,9 @@ double local_plaquette(double *ss_plaq, double *st_plaq) {
       }
       else {
         FORALLSITES(i, s) {
-          mult_nn(&(tempmat[i]), (matrix *)(gen_pt[0][i]), &tmat);
-          cur_plaq = (double)realtrace((matrix *)(gen_pt[1][i]), &tmat);
+          cur_plaq = (double)realtrace_mult_nn((matrix *)(gen_pt[1][i]),
+                                               &(tempmat[i]),
+                                               (matrix *)(gen_pt[0][i]));
           if (cur_plaq > max_plaq)
             max_plaq = cur_plaq;
 #ifdef MIN_PLAQ
@@ -36,6 +36,11 @@ typedef struct {
   // Inversion parameters
   int niter;                    // Maximum number of CG iterations
   Real rsqmin;                  // For deciding on convergence
+  Real rsqmin_MD;               // Weighted per shift for MD CG if non-zero
+  Real rsqmin_accept;           // and for accept/reject CG
+  int cg_pipelined;             // Use pipelined multi-shift CG if 1
+  int cg_mixed;                 // Use mixed-precision multi-shift CG if 1
+  int cg_forecast;              // Number of MD solutions used for guesses
   char startfile[MAXFILENAME], savefile[MAXFILENAME];
 
 #ifdef BILIN
@@ -10,7 +10,8 @@
 
 // -----------------------------------------------------------------
 // Return a_i * b_i for two complex vectors (no conjugation!)
-double_complex inner(complex *a, complex *b) {
+// on this node only
+static double_complex inner_node(complex *a, complex *b) {
   int i, Ndat = 16 * DIMF;
   double_complex dot;
 
@@ -20,10 +21,27 @@ double_complex inner(complex *a, complex *b) {
     dot.real += a[i].real * b[i].real - a[i].imag * b[i].imag;
     dot.imag += a[i].imag * b[i].real + a[i].real * b[i].imag;
   }
-  // Accumulate inner product across all nodes
+  return dot;
+}
+
+// Accumulate inner product across all nodes
+double_complex inner(complex *a, complex *b) {
+  double_complex dot = inner_node(a, b);
+
   g_dcomplexsum(&dot);
   return dot;
 }
+
+// Start summing both a_i * c_i and b_i * c_i across all nodes,
+// returning them in dot once g_sum_wait(tag) is done
+static sum_tag* start_inner_pair(complex *a, complex *b, complex *c,
+                                 double_complex *dot) {
+  dot[0] = inner_node(a, c);
+  dot[1] = inner_node(b, c);
+  g_dcomplexsum_add(&(dot[0]));
+  g_dcomplexsum_add(&(dot[1]));
+  return g_sum_start();
+}
 // -----------------------------------------------------------------
 
 
@@ -228,6 +246,8 @@ void phase() {
   int Ndat = 16 * DIMF, shift = this_node * sites_on_node * Ndat;
   double phase, log_mag, tr, dtime;
   complex tc, tc2;
+  double_complex dot[2];
+  sum_tag *tag = NULL;
   complex *diag = malloc(volume * Ndat * sizeof(*diag));
   complex *MonC = malloc(sites_on_node * Ndat * sizeof(*MonC));
   complex **Q = malloc(volume * Ndat * sizeof(**Q));
@@ -309,10 +329,22 @@ void phase() {
     }
 
     // Cycle over ALL subsequent columns
+    // Both inner products for column k are summed across nodes together,
+    // while applying D to column k + 1, which the update of q_k can't affect
+    if (i + 2 < volume * Ndat) {
+      matvec(Q[i + 2], MonC);
+      tag = start_inner_pair(Q[i + 1], Q[i], MonC, dot);
+    }
     for (k = i + 2; k < volume * Ndat; k++) {
       // q_k --> q_k - q_i <q_{i + 1} | D | q_k> - q_{i + 1} <q_i | D | q_k>
-      matvec(Q[k], MonC);
-      tc = inner(Q[i + 1], MonC);
+      if (k + 1 < volume * Ndat)
+        matvec(Q[k + 1], MonC);
+      g_sum_wait(tag);
+      tc = dot[0];
+      tc2 = dot[1];
+      if (k + 1 < volume * Ndat)
+        tag = start_inner_pair(Q[i + 1], Q[i], MonC, dot);
+
       if (i + 1 < sites_on_node * Ndat) {
         for (j = 0; j < i + 2; j++)
           CMULDIF(Q[i][j], tc, Q[k][j]);
@@ -322,14 +354,13 @@ void phase() {
           CMULDIF(Q[i][j], tc, Q[k][j]);
       }
 
-      tc = inner(Q[i], MonC);
       if (i + 1 < sites_on_node * Ndat) {
         for (j = 0; j < i + 2; j++)
-          CMULSUM(Q[i + 1][j], tc, Q[k][j]);
+          CMULSUM(Q[i + 1][j], tc2, Q[k][j]);
       }
       else {
         for (j = 0; j < sites_on_node * Ndat; j++)
-          CMULSUM(Q[i + 1][j], tc, Q[k][j]);
+          CMULSUM(Q[i + 1][j], tc2, Q[k][j]);
       }
     }
     // Print some timing information
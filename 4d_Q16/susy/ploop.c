@@ -16,11 +16,11 @@ complex ploop(int dir, int project, double *plpMod) {
   // Optionally consider polar-projected links,
   // saving original values in UpsiU[0] to be reset at end
   if (project == 1) {
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, private(tmat, tmat2)) {
       mat_copy(&(s->link[dir]), &(UpsiU[0][i]));
       polar(&(s->link[dir]), &tmat, &tmat2);
       mat_copy(&tmat, &(s->link[dir]));
-    }
+    } END_LOOP_OMP;
   }
 
   switch(dir) {
@@ -51,8 +51,7 @@ void random_gauge_trans(Twist_Fermion *TF) {
   }
   // Project out eta^j = -Tr[Lambda^j G eta]
   for (j = 0; j < DIMF; j++) {
-    mult_nn(&(Lambda[j]), &etamat, &tmat);
-    tc = trace(&tmat);
+    tc = trace_mult_nn(&(Lambda[j]), &etamat);
     CNEGATE(tc, TF[s].Fsite.c[j]);
   }
 
@@ -66,12 +65,12 @@ void random_gauge_trans(Twist_Fermion *TF) {
   }
   // Project out eta^j = -Tr[eta Gdag Lambda^j]
   for (j = 0; j < DIMF; j++) {
-    mult_nn(&etamat, &(Lambda[j]), &tmat);
-    tc = trace(&tmat);
+    tc = trace_mult_nn(&etamat, &(Lambda[j]));
     CNEGATE(tc, TF[s].Fsite.c[j]);
   }
 
   // Left side of local links and psis; right side of local chis
+  invalidate_link_halo();
   FORALLDIR(a) {
     mult_nn(&Gmat, &(lattice[s].link[a]), &tmat);
     mat_copy(&tmat, &(lattice[s].link[a]));
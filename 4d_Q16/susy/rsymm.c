@@ -98,9 +98,9 @@ void rsymm_path(int *dir, int *sign, int *kind, int length) {
           terminate(1);
         }
       }
+      cleanup_gather(mtag);
       FORALLSITES(i, s)   // Don't want to overwrite tempmat too soon
         mat_copy(&(tempmat2[i]), &(tempmat[i]));
-      cleanup_gather(mtag);
     }
     else {
       node0_printf("rsymm_path: unrecognized sign[%d] = %d\n", j, sign[j]);
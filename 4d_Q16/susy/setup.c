@@ -6,7 +6,7 @@
 
 // Each node has a params structure for passing simulation parameters
 #include "params.h"
-params par_buf;
+RANK_LOCAL params par_buf;
 // -----------------------------------------------------------------
 
 
@@ -21,6 +21,9 @@ int initial_set() {
            NCOL, DIMF);
     printf("Microcanonical simulation with refreshing\n");
     printf("Machine = %s, with %d nodes\n", machine_type(), numnodes());
+#ifdef OMP
+    printf("with %d OpenMP threads per node\n", omp_get_max_threads());
+#endif
 #ifdef HMC_ALGORITHM
     printf("Hybrid Monte Carlo algorithm\n");
 #endif
@@ -137,6 +140,23 @@ void make_fields() {
   FIELD_ALLOC_VEC(plaq_src, matrix, NPLAQ);
   FIELD_ALLOC_VEC(plaq_dest, matrix, NPLAQ);
 
+  // Persistent halo of neighboring links for fermion_op
+  size += (Real)(NUMLINK * NUMLINK) * sizeof(matrix);
+  FIELD_ALLOC_MAT(link_halo, matrix, NUMLINK, NUMLINK);
+#ifdef QCLOSED
+  size += (Real)(2.0 * NTERMS) * sizeof(matrix);
+  FIELD_ALLOC_VEC(DbpP_link, matrix, NTERMS);
+  FIELD_ALLOC_VEC(DbmP_link, matrix, NTERMS);
+#endif
+  link_halo_valid = 0;
+  links_f_valid = 0;
+#ifdef HALO_COALESCE
+  halo_coalesce = 1;
+#endif
+#ifdef SIMD_LAYOUT
+  simd_layout = 1;
+#endif
+
   // For convenience in calculating action and force
   size += (Real)(1.0 + NPLAQ + 3.0 * NUMLINK) * sizeof(matrix);
   size += (Real)(NUMLINK + 6.0 * NPLAQ) * sizeof(complex);
@@ -152,17 +172,17 @@ void make_fields() {
 
   // CG Twist_Fermions
   size += (Real)(3.0 * sizeof(Twist_Fermion));
-  FIELD_ALLOC(mpm, Twist_Fermion);
-  FIELD_ALLOC(pm0, Twist_Fermion);
-  FIELD_ALLOC(rm, Twist_Fermion);
+  FIELD_ALLOC_SHARED(mpm, Twist_Fermion);
+  FIELD_ALLOC_SHARED(pm0, Twist_Fermion);
+  FIELD_ALLOC_SHARED(rm, Twist_Fermion);
 
   // Temporary matrices and Twist_Fermion
   size += (Real)(3.0 * sizeof(matrix));
   size += (Real)(sizeof(Twist_Fermion));
-  FIELD_ALLOC(tempmat, matrix);
-  FIELD_ALLOC(tempmat2, matrix);
+  FIELD_ALLOC_SHARED(tempmat, matrix);
+  FIELD_ALLOC_SHARED(tempmat2, matrix);
   FIELD_ALLOC(staple, matrix);
-  FIELD_ALLOC(tempTF, Twist_Fermion);
+  FIELD_ALLOC_SHARED(tempTF, Twist_Fermion);
 
 #ifdef CORR
   int j;
@@ -185,8 +205,8 @@ void make_fields() {
 
 #if defined(EIG) || defined(PHASE)
   size += (Real)(2.0 * sizeof(Twist_Fermion));
-  FIELD_ALLOC(src, Twist_Fermion);
-  FIELD_ALLOC(res, Twist_Fermion);
+  FIELD_ALLOC_SHARED(src, Twist_Fermion);
+  FIELD_ALLOC_SHARED(res, Twist_Fermion);
 #endif
 
 #if defined(CHEB) || defined(MODE)
@@ -341,6 +361,42 @@ int readin(int prompt) {
       par_buf.rsqmin = x * x;
     }
 
+    // Error per site for the RHMC molecular dynamics and accept/reject CG,
+    // with per-shift stopping conditions weighted by the rational function
+    // 0 uses error_per_site for all shifts
+    IF_OK {
+      status += get_f(stdin, prompt, "error_MD", &x);
+      par_buf.rsqmin_MD = x * x;
+    }
+    IF_OK {
+      status += get_f(stdin, prompt, "error_accept", &x);
+      par_buf.rsqmin_accept = x * x;
+    }
+
+    // Whether to use the communication-hiding pipelined CG (0 or 1)
+    IF_OK status += get_i(stdin, prompt, "cg_pipelined", &par_buf.cg_pipelined);
+
+    // Whether to use the mixed-precision CG with reliable updates (0 or 1)
+    IF_OK status += get_i(stdin, prompt, "cg_mixed", &par_buf.cg_mixed);
+    if (par_buf.cg_pipelined == 1 && par_buf.cg_mixed == 1) {
+      node0_printf("ERROR: Can't use both cg_pipelined and cg_mixed\n");
+      status++;
+    }
+    if ((par_buf.cg_pipelined == 1 || par_buf.cg_mixed == 1)
+        && (par_buf.rsqmin_MD > 0.0 || par_buf.rsqmin_accept > 0.0)) {
+      node0_printf("ERROR: Per-shift error_MD and error_accept ");
+      node0_printf("need cg_pipelined 0 and cg_mixed 0\n");
+      status++;
+    }
+
+    // Number of previous MD solutions used to forecast initial CG guesses
+    // 0 starts every solve from zero
+    IF_OK status += get_i(stdin, prompt, "cg_forecast", &par_buf.cg_forecast);
+    if (par_buf.cg_forecast < 0) {
+      node0_printf("ERROR: cg_forecast can't be negative\n");
+      status++;
+    }
+
 #ifdef BILIN
     // Number of stochastic sources for fermion bilinear and susy trans
     // Also used for stochastic mode number computation
@@ -423,6 +479,11 @@ int readin(int prompt) {
   fixflag = par_buf.fixflag;
   niter = par_buf.niter;
   rsqmin = par_buf.rsqmin;
+  rsqmin_MD = par_buf.rsqmin_MD;
+  rsqmin_accept = par_buf.rsqmin_accept;
+  cg_pipelined = par_buf.cg_pipelined;
+  cg_mixed = par_buf.cg_mixed;
+  cg_forecast = par_buf.cg_forecast;
 
   lambda = par_buf.lambda;
   kappa_u1 = par_buf.kappa_u1;
@@ -518,6 +579,10 @@ int readin(int prompt) {
 
   // Do whatever is needed to get lattice
   startlat_p = reload_lattice(startflag, startfile);
+  // Peeking only reports on the file, without loading the links
+  if (startflag == PEEK)
+    normal_exit(0);
+  invalidate_link_halo();
 
   // Allocate arrays to be used by LAPACK in determinant.c
   // Needs to be above compute_Uinv()
@@ -537,3 +602,83 @@ int readin(int prompt) {
   return 0;
 }
 // -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// The measurement drivers may list further configurations after the
+// ending lattice option, each as 'reload_serial' or 'reload_parallel'
+// followed by the file name, and measure them in turn
+// The next file is read into the page cache while the current one
+// is measured, and is decoded by reload_lattice as usual
+typedef struct {
+  int flag;                   // 0 once the input has run out
+  char file[MAXFILENAME];
+} next_lattice_buf;
+
+static RANK_LOCAL next_lattice_buf next_buf;
+
+// On node zero, read the next configuration, if any, and send to others
+void ask_next_lattice(int prompt) {
+  int c, status = 0;
+
+  if (this_node == 0) {
+    next_buf.flag = 0;
+    if (prompt != 0)
+      printf("enter another starting lattice, or EOF to finish\n");
+    fscanf(stdin, " ");
+    c = getc(stdin);
+    if (c != EOF) {
+      ungetc(c, stdin);
+      status = ask_starting_lattice(stdin, prompt, &next_buf.flag,
+                                    next_buf.file);
+      if (status == 0 && next_buf.flag != RELOAD_SERIAL
+                      && next_buf.flag != RELOAD_PARALLEL) {
+        printf("ERROR: Can only reload further lattices\n");
+        status++;
+      }
+#ifdef PHASE
+      if (ckpt_load > 0 || ckpt_save > 0) {
+        printf("ERROR: Can't checkpoint with further lattices\n");
+        status++;
+      }
+#endif
+      if (status > 0)
+        next_buf.flag = -1;
+    }
+  }
+
+  // Broadcast the next configuration from node0 to all other nodes
+  broadcast_bytes((char *)&next_buf, sizeof(next_buf));
+  if (next_buf.flag < 0)
+    terminate(1);
+  if (next_buf.flag != 0)
+    prefetch_lattice(next_buf.file);
+}
+
+// Reload the next configuration, redoing what readin does after its
+// reload, and ask for the one after that
+// Returns 0 once the input has run out
+int next_lattice(int prompt) {
+  if (next_buf.flag == 0)
+    return 0;
+  finish_prefetch();
+
+  startflag = next_buf.flag;
+  strcpy(startfile, next_buf.file);
+  if (startlat_p != NULL) {
+    free(startlat_p->header);
+    free(startlat_p);
+  }
+  startlat_p = reload_lattice(startflag, startfile);
+  invalidate_link_halo();
+
+  compute_plaqdet();
+  compute_Uinv();
+  compute_DmuUmu();
+  compute_Fmunu();
+
+  ask_next_lattice(prompt);
+  return 1;
+}
+// -----------------------------------------------------------------
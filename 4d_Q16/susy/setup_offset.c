@@ -64,82 +64,28 @@ int check_list(int my_offset[4], int *minus) {
 
 
 // -----------------------------------------------------------------
+// Boundary condition table for BC1, BC2 and BC3 in lattice.h,
+// covering all paths of up to three links
 void setup_bc() {
-  register int i, dir, dir2, dir3, tocheck;
-  register site *s;
+  register int t, k, dir;
 
-  // Single-offset terms
   FORALLDIR(dir) {
-    FORALLSITES(i, s) {
-      s->bc1[dir] = 1.0;
-      s->bc1[OPP_LDIR(dir)] = 1.0;
-
-      if (s->t + offset[dir][TUP] < 0)
-        s->bc1[dir] = PBC;
-      else if (s->t + offset[dir][TUP] > nt - 1)
-        s->bc1[dir] = PBC;
-      if (s->t - offset[dir][TUP] < 0)
-        s->bc1[OPP_LDIR(dir)] = PBC;
-      else if (s->t - offset[dir][TUP] > nt - 1)
-        s->bc1[OPP_LDIR(dir)] = PBC;
-    }
+    tshift[dir] = offset[dir][TUP];
+    tshift[OPP_LDIR(dir)] = -offset[dir][TUP];
   }
 
-  // BC1 test
-//  FORALLSITES(i, s) {
-//    if (s->x == 1 && s->y == 1 && s->z == 2) {
-//      printf("%d %d %d %d:", s->x, s->y, s->z, s->t);
-//      for (dir = 0; dir < 2 * NUMLINK; dir++)
-//        printf("  %4.2g", s->bc1[dir]);
-//      printf("\n");
-//    }
-//  }
-
-  // Double-offset terms -- don't need mixed -+ and +-
-  FORALLDIR(dir) {
-    FORALLDIR(dir2) {
-      FORALLSITES(i, s) {
-        s->bc2[dir][dir2] = 1.0;
-        s->bc2[OPP_LDIR(dir)][OPP_LDIR(dir2)] = 1.0;
-
-        tocheck = s->t + offset[dir][TUP] + offset[dir2][TUP];
-        if (tocheck < 0)
-          s->bc2[dir][dir2] = PBC;
-        else if (tocheck > nt - 1)
-          s->bc2[dir][dir2] = PBC;
-
-        tocheck = s->t - offset[dir][TUP] - offset[dir2][TUP];
-        if (tocheck < 0)
-          s->bc2[OPP_LDIR(dir)][OPP_LDIR(dir2)] = PBC;
-        else if (tocheck > nt - 1)
-          s->bc2[OPP_LDIR(dir)][OPP_LDIR(dir2)] = PBC;
-      }
-    }
+  bc_t = malloc(7 * nt * sizeof(*bc_t));
+  if (bc_t == NULL) {
+    printf("setup_bc: can't malloc bc_t\n");
+    fflush(stdout);
+    terminate(1);
   }
-
-  // Triple-offset terms -- don't need mixed -++, +-+, ++-, --+, -+- or +--
-  FORALLDIR(dir) {
-    FORALLDIR(dir2) {
-      FORALLDIR(dir3) {
-        FORALLSITES(i, s) {
-          s->bc3[dir][dir2][dir3] = 1.0;
-          s->bc3[OPP_LDIR(dir)][OPP_LDIR(dir2)][OPP_LDIR(dir3)] = 1.0;
-
-          tocheck = s->t + offset[dir][TUP] + offset[dir2][TUP]
-                         + offset[dir3][TUP];
-          if (tocheck < 0)
-            s->bc3[dir][dir2][dir3] = PBC;
-          else if (tocheck > nt - 1)
-            s->bc3[dir][dir2][dir3] = PBC;
-
-          tocheck = s->t - offset[dir][TUP] - offset[dir2][TUP]
-                         - offset[dir3][TUP];
-          if (tocheck < 0)
-            s->bc3[OPP_LDIR(dir)][OPP_LDIR(dir2)][OPP_LDIR(dir3)] = PBC;
-          else if (tocheck > nt - 1)
-            s->bc3[OPP_LDIR(dir)][OPP_LDIR(dir2)][OPP_LDIR(dir3)] = PBC;
-        }
-      }
+  for (t = 0; t < nt; t++) {
+    for (k = -3; k <= 3; k++) {
+      if (t + k < 0 || t + k > nt - 1)
+        bc_t[7 * t + 3 + k] = PBC;
+      else
+        bc_t[7 * t + 3 + k] = 1.0;
     }
   }
 }
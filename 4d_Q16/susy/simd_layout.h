@@ -0,0 +1,209 @@
+// -----------------------------------------------------------------
+// Array-of-structs-of-arrays (AoSoA) layout for -DSIMD_LAYOUT builds
+// Sites are grouped into blocks of VLEN consecutive sites, and each
+// element of a vmatrix holds that element for all VLEN sites of a block,
+// so the site index is innermost and every complex multiply-add
+// in a matrix product acts on full vector registers
+// VLEN follows the instruction set selected by SIMDARCH in the Makefile:
+// 8 doubles for AVX-512, 4 for AVX2 and 2 (SSE2) otherwise
+// The kernels use GCC vector extensions rather than intrinsics,
+// so the same code compiles to each instruction set
+#ifndef _SIMD_LAYOUT_H
+#define _SIMD_LAYOUT_H
+
+#if defined(__AVX512F__)
+#define VBYTES 64
+#elif defined(__AVX__)
+#define VBYTES 32
+#else
+#define VBYTES 16
+#endif
+#define VLEN ((int)(VBYTES / sizeof(Real)))
+#define NBLOCKS ((sites_on_node + VLEN - 1) / VLEN)
+
+typedef Real vreal __attribute__ ((vector_size (VBYTES)));
+
+typedef struct {
+  vreal re[NCOL][NCOL], im[NCOL][NCOL];
+} vmatrix;
+
+typedef struct {
+  vmatrix Fsite;
+  vmatrix Flink[NUMLINK];
+  vmatrix Fplaq[NPLAQ];
+} vTwist_Fermion;
+
+// Threaded loop over blocks, closed by END_LOOP_OMP
+#ifdef OMP
+#define FORALLBLOCKS_OMP(k,args) \
+    _Pragma(STRINGIFY(omp parallel for private(k) args)) \
+    for(k=0;k<NBLOCKS;k++){
+#else
+#define FORALLBLOCKS_OMP(k,args) for(k=0;k<NBLOCKS;k++){
+#endif
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Conversions between a block of AoS matrices and a vmatrix
+// The matrix for site i is at base + i * stride bytes
+// Lanes past the end of the lattice load the first site of the block
+// and are never stored
+// Element j = NCOL * row + col of lane l is at vr[VLEN * j + l]
+static inline void vload(char *base, size_t stride, int i0, vmatrix *v) {
+  register int l, j, i;
+  Real *vr = (Real *)v->re, *vi = (Real *)v->im, *m;
+  for (l = 0; l < VLEN; l++) {
+    i = (i0 + l < sites_on_node ? i0 + l : i0);
+    m = (Real *)(base + i * stride);
+    for (j = 0; j < NCOL * NCOL; j++) {
+      vr[VLEN * j + l] = m[2 * j];
+      vi[VLEN * j + l] = m[2 * j + 1];
+    }
+  }
+}
+
+// Gathered matrices, with pt[i] pointing to the matrix for site i
+static inline void vload_pt(char **pt, int i0, vmatrix *v) {
+  register int l, j, i;
+  Real *vr = (Real *)v->re, *vi = (Real *)v->im, *m;
+  for (l = 0; l < VLEN; l++) {
+    i = (i0 + l < sites_on_node ? i0 + l : i0);
+    m = (Real *)(pt[i]);
+    for (j = 0; j < NCOL * NCOL; j++) {
+      vr[VLEN * j + l] = m[2 * j];
+      vi[VLEN * j + l] = m[2 * j + 1];
+    }
+  }
+}
+
+static inline void vstore(vmatrix *v, char *base, size_t stride, int i0) {
+  register int l, j;
+  Real *vr = (Real *)v->re, *vi = (Real *)v->im, *m;
+  for (l = 0; l < VLEN && i0 + l < sites_on_node; l++) {
+    m = (Real *)(base + (i0 + l) * stride);
+    for (j = 0; j < NCOL * NCOL; j++) {
+      m[2 * j] = vr[VLEN * j + l];
+      m[2 * j + 1] = vi[VLEN * j + l];
+    }
+  }
+}
+
+// m <-- m + s * vdag, for the force collectors
+static inline void vstore_adj_sum(vmatrix *v, Real s,
+                                  char *base, size_t stride, int i0) {
+  register int l, j, k;
+  Real *vr = (Real *)v->re, *vi = (Real *)v->im, *m;
+  for (l = 0; l < VLEN && i0 + l < sites_on_node; l++) {
+    m = (Real *)(base + (i0 + l) * stride);
+    for (j = 0; j < NCOL; j++) {
+      for (k = 0; k < NCOL; k++) {
+        m[2 * (NCOL * j + k)] += s * vr[VLEN * (NCOL * k + j) + l];
+        m[2 * (NCOL * j + k) + 1] -= s * vi[VLEN * (NCOL * k + j) + l];
+      }
+    }
+  }
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Scaled matrix products with a separate scale factor for each lane,
+// with init = 1 to overwrite c and otherwise adding s * (a * b) to c
+// init is always a constant, so the branch disappears once inlined
+// c <-- s * a * b
+static inline void vmult_nn(vmatrix *a, vmatrix *b, vreal s, int init,
+                            vmatrix *c) {
+  register int i, j, k;
+  vreal re, im;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      re = a->re[i][0] * b->re[0][j] - a->im[i][0] * b->im[0][j];
+      im = a->im[i][0] * b->re[0][j] + a->re[i][0] * b->im[0][j];
+      for (k = 1; k < NCOL; k++) {
+        re += a->re[i][k] * b->re[k][j] - a->im[i][k] * b->im[k][j];
+        im += a->im[i][k] * b->re[k][j] + a->re[i][k] * b->im[k][j];
+      }
+      if (init) {
+        c->re[i][j] = s * re;
+        c->im[i][j] = s * im;
+      }
+      else {
+        c->re[i][j] += s * re;
+        c->im[i][j] += s * im;
+      }
+    }
+  }
+}
+
+// c <-- s * adag * b
+static inline void vmult_an(vmatrix *a, vmatrix *b, vreal s, int init,
+                            vmatrix *c) {
+  register int i, j, k;
+  vreal re, im;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      re = a->re[0][i] * b->re[0][j] + a->im[0][i] * b->im[0][j];
+      im = a->re[0][i] * b->im[0][j] - a->im[0][i] * b->re[0][j];
+      for (k = 1; k < NCOL; k++) {
+        re += a->re[k][i] * b->re[k][j] + a->im[k][i] * b->im[k][j];
+        im += a->re[k][i] * b->im[k][j] - a->im[k][i] * b->re[k][j];
+      }
+      if (init) {
+        c->re[i][j] = s * re;
+        c->im[i][j] = s * im;
+      }
+      else {
+        c->re[i][j] += s * re;
+        c->im[i][j] += s * im;
+      }
+    }
+  }
+}
+
+// c <-- s * a * bdag
+static inline void vmult_na(vmatrix *a, vmatrix *b, vreal s, int init,
+                            vmatrix *c) {
+  register int i, j, k;
+  vreal re, im;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      re = a->re[i][0] * b->re[j][0] + a->im[i][0] * b->im[j][0];
+      im = a->im[i][0] * b->re[j][0] - a->re[i][0] * b->im[j][0];
+      for (k = 1; k < NCOL; k++) {
+        re += a->re[i][k] * b->re[j][k] + a->im[i][k] * b->im[j][k];
+        im += a->im[i][k] * b->re[j][k] - a->re[i][k] * b->im[j][k];
+      }
+      if (init) {
+        c->re[i][j] = s * re;
+        c->im[i][j] = s * im;
+      }
+      else {
+        c->re[i][j] += s * re;
+        c->im[i][j] += s * im;
+      }
+    }
+  }
+}
+
+// c <-- c + s * b
+static inline void vscalar_mult_sum(vmatrix *b, vreal s, vmatrix *c) {
+  register int i, j;
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      c->re[i][j] += s * b->re[i][j];
+      c->im[i][j] += s * b->im[i][j];
+    }
+  }
+}
+
+// The same scale factor in every lane
+static inline vreal vsplat(Real s) {
+  vreal v = {0};
+  return v + s;
+}
+// -----------------------------------------------------------------
+#endif
+// -----------------------------------------------------------------
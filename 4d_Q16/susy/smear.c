@@ -155,6 +155,7 @@ void stout_smear(int Nsmear, double alpha) {
     // Overwrites s->link
     exp_mult();
   }
+  invalidate_link_halo();
 }
 // -----------------------------------------------------------------
 
@@ -173,7 +174,7 @@ void APE_smear(int Nsmear, double alpha, int project) {
   tr = alpha / ((Real)n * tr2);
 
   for (n = 0; n < Nsmear; n++) {
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, private(dir, tmat)) {
       FORALLDIR(dir) {
         // Decide what to do with links before smearing
         // Polar project, divide out determinant, or nothing
@@ -184,7 +185,7 @@ void APE_smear(int Nsmear, double alpha, int project) {
         else
           mat_copy(&(s->link[dir]), &(s->mom[dir]));
       }
-    }
+    } END_LOOP_OMP;
 
     FORALLDIR(dir) {
       FORALLSITES(i, s)
@@ -209,5 +210,6 @@ void APE_smear(int Nsmear, double alpha, int project) {
       }
     }
   }
+  invalidate_link_halo();
 }
 // -----------------------------------------------------------------
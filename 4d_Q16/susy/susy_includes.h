@@ -7,9 +7,16 @@
 #include <string.h>             // For print_var.c, setup.c, gauge_info.c
 #include "../include/complex.h"
 #include "../include/susy.h"
+#include "../include/inline_susy.h"
 #include "../include/macros.h"
 #include "lattice.h"
+#ifdef SIMD_LAYOUT
+#include "simd_layout.h"
+#endif
 #include "../include/comdefs.h"
+#ifdef OMP
+#include <omp.h>
+#endif
 #include "../include/io_lat.h"
 #include "../include/generic.h"
 #include "../include/dirs.h"
@@ -22,6 +29,8 @@
 // Prototypes for functions in high level code
 int setup();
 int readin(int prompt);
+void ask_next_lattice(int prompt);
+int next_lattice(int prompt);
 int update();
 void update_h(Real eps);
 void update_u(Real eps);
@@ -73,9 +82,45 @@ double det_force(Real eps);
 
 // Fermion matrix--vector operators (D & D^2) and multi-mass CG
 void fermion_op(Twist_Fermion *src, Twist_Fermion *dest, int sign);
+void invalidate_link_halo();    // Call after any change to the links
+void gather_link_halo();
+
+// Coalesced halo exchange of the fermion_op source, if halo_coalesce
+void exchange_src_halo(void *src, int stride, int size);
+void finish_src_halo();
+msg_tag* start_src_gather(void *field, int stride, int size, int dir,
+                          char ***pt);
+void wait_src_gather(msg_tag *tag);
+void cleanup_src_gather(msg_tag *tag);
 void DSq(Twist_Fermion *src, Twist_Fermion *dest);
 int congrad_multi(Twist_Fermion *src, Twist_Fermion **psim,
                   int MaxCG, Real RsdCG, Real *size_r);
+double true_residual(Twist_Fermion *src, Twist_Fermion *psi,
+                     Real shift, Twist_Fermion *r);
+int refine_shift(Twist_Fermion *src, Twist_Fermion *psi, Real shift,
+                 int MaxCG, double rsq, double rsqstop);
+int congrad_multi_add(Twist_Fermion *src, Twist_Fermion **psim,
+                      int MaxCG, Real RsdCG, Real *size_r, Real *weight);
+Real cg_lambda_min();            // Smallest eigenvalue of D^2 from last CG
+
+// Multi-mass CG with initial guesses forecast from previous MD solutions
+void forecast_reset();          // Call at the start of each trajectory
+int congrad_forecast(int n, Twist_Fermion *src, Twist_Fermion **psim,
+                     int MaxCG, Real RsdCG, Real *size_r);
+
+// Single-precision operator and mixed-precision multi-mass CG
+void load_links_f();            // Call at the start of each solve
+void fermion_op_f(Twist_Fermion_f *src, Twist_Fermion_f *dest, int sign);
+void DSq_f(Twist_Fermion_f *src, Twist_Fermion_f *dest);
+int congrad_multi_mixed(Twist_Fermion *src, Twist_Fermion **psim,
+                        int MaxCG, Real RsdCG, Real *size_r);
+
+#ifdef SIMD_LAYOUT
+// AoSoA vector/plaquette and Q-closed terms of fermion_op and the force
+void load_links_v();            // Called by gather_link_halo
+void fermion_op_v(Twist_Fermion *src, Twist_Fermion *dest, int sign);
+void FQ_sites_v(char **pt[4], Real permm, int dt1, int dt2, int c);
+#endif
 
 // Compute average Tr[Udag U] / N_c
 // Number of blocking steps only affects output formatting
@@ -101,6 +146,17 @@ void scalar_mult_add_TF(Twist_Fermion *a, Twist_Fermion *b, Real s,
                         Twist_Fermion *c);
 void scalar_mult_TF(Twist_Fermion *src, Real s, Twist_Fermion *dest);
 
+// Single-precision Twist_Fermion_f utilities in library_util_f.c
+void mat_d2f(matrix *a, fmatrix *b);
+void TF_d2f(Twist_Fermion *a, Twist_Fermion_f *b);
+void TF_f2d_sum(Twist_Fermion_f *b, Twist_Fermion *c);
+void clear_TF_f(Twist_Fermion_f *c);
+double magsq_TF_f(Twist_Fermion_f *a);
+double TF_rdot_f(Twist_Fermion_f *a, Twist_Fermion_f *b);
+void scalar_mult_sum_TF_f(Twist_Fermion_f *b, float s, Twist_Fermion_f *c);
+void scalar_mult_add_TF_f(Twist_Fermion_f *a, float sa,
+                          Twist_Fermion_f *b, float sb, Twist_Fermion_f *c);
+
 // Other routines in library_util.c that loop over all sites
 void gauge_field_copy(field_offset src, field_offset dest);
 void shiftmat(matrix *dat, matrix *temp, int dir);
@@ -114,7 +170,11 @@ void widths();        // Widths of plaquette and det distributions
 complex find_det(matrix *Q);
 void det_project(matrix *in, matrix *out);
 
-// Use LAPACK in determinant and matrix calculations
+// Batched over all sites, for e.g. fo = F_OFFSET(link[dir])
+void find_det_site(field_offset fo, complex *det);
+void invert_site(field_offset fo, matrix *inv);
+
+// Use LAPACK in determinant and matrix calculations for NCOL > 6
 // Compute LU decomposition of a complex matrix
 // http://www.physics.orst.edu/~rubin/nacphy/lapack/routines/zgetrf.html
 // First and second arguments are the dimensions of the matrix
@@ -131,7 +191,7 @@ void zgetrf_(int *N1, int *N2, double *store, int *lda, int *ipiv, int *stat);
 void zgetri_(int *N, double *store, int *lda, int *ipiv,
              double *work, int *Nwork, int* stat);
 
-// Matrix inverse via LAPACK
+// Matrix inverse, closed form for NCOL <= 6 and via LAPACK otherwise
 void invert(matrix *in, matrix *out);
 
 // Modified Wilson loops use invert and path
@@ -192,6 +252,18 @@ void zheev_(char *doV, char *uplo, int *N1, double *store, int *N2,
 void polar(matrix *in, matrix *u, matrix *P);
 void matrix_log(matrix *in, matrix *out);
 
+// Thread-safe eigensolver used by polar and matrix_log
+// Eigenvectors are the columns of V
+void herm_eig(matrix *H, double *eval, matrix *V);
+
+// Batched over all sites, for e.g. fo = F_OFFSET(link[dir])
+void polar_site(field_offset fo, matrix *u, matrix *P);
+void matrix_log_field(matrix *in, matrix *out);
+
+// Reference LAPACK versions, not thread-safe
+void polar_LAPACK(matrix *in, matrix *u, matrix *P);
+void matrix_log_LAPACK(matrix *in, matrix *out);
+
 // Monopole computation uses find_det
 void monopole();
 
@@ -1,45 +1,246 @@
 // -----------------------------------------------------------------
-// Polar decomposition now uses LAPACK to isolate gauge vs. scalar d.o.f.
+// Polar decomposition and matrix log to isolate gauge vs. scalar d.o.f.
+// Both diagonalize a hermitian matrix with herm_eig below,
+// which uses no global scratch space so can run in threaded site loops
 #include "susy_includes.h"
 // -----------------------------------------------------------------
 
 
 
 // -----------------------------------------------------------------
-// Take log of hermitian part of decomposition to define scalar field
-void matrix_log(matrix *in, matrix *out) {
-  char V = 'V';     // Ask LAPACK for both eigenvalues and eigenvectors
-  char U = 'U';     // Have LAPACK store upper triangle of in
-  int row, col, Npt = NCOL, stat = 0, Nwork = 2 * NCOL;
-  matrix evecs, tmat;
+// Jacobi rotation that zeroes A[p][q] = |A[p][q]| e,
+// applied as A --> J^dag.A.J and accumulated in V --> V.J, with
+//   J[p][p] = c    J[p][q] = s    J[q][p] = -s e^*    J[q][q] = c e^*
+static void jacobi_rotate(matrix *A, matrix *V, int p, int q) {
+  register int k;
+  double abs_pq, tau, t, c, sn;
+  complex e, akp, akq, tc;
 
-  // Convert in to column-major double array used by LAPACK
-  for (row = 0; row < NCOL; row++) {
-    for (col = 0; col < NCOL; col++) {
-      store[2 * (col * NCOL + row)] = in->e[row][col].real;
-      store[2 * (col * NCOL + row) + 1] = in->e[row][col].imag;
+  abs_pq = cabs(&(A->e[p][q]));
+  if (abs_pq == 0.0)
+    return;
+  CDIVREAL(A->e[p][q], abs_pq, e);
+  tau = (A->e[q][q].real - A->e[p][p].real) / (2.0 * abs_pq);
+  t = 1.0 / (fabs(tau) + sqrt(1.0 + tau * tau));
+  if (tau < 0.0)
+    t = -t;
+  c = 1.0 / sqrt(1.0 + t * t);
+  sn = t * c;
+
+  for (k = 0; k < NCOL; k++) {    // Columns of A and V
+    akp = A->e[k][p];
+    akq = A->e[k][q];
+    CMUL_J(akq, e, tc);           // akq e^*
+    A->e[k][p].real = c * akp.real - sn * tc.real;
+    A->e[k][p].imag = c * akp.imag - sn * tc.imag;
+    A->e[k][q].real = sn * akp.real + c * tc.real;
+    A->e[k][q].imag = sn * akp.imag + c * tc.imag;
+
+    akp = V->e[k][p];
+    akq = V->e[k][q];
+    CMUL_J(akq, e, tc);
+    V->e[k][p].real = c * akp.real - sn * tc.real;
+    V->e[k][p].imag = c * akp.imag - sn * tc.imag;
+    V->e[k][q].real = sn * akp.real + c * tc.real;
+    V->e[k][q].imag = sn * akp.imag + c * tc.imag;
+  }
+  for (k = 0; k < NCOL; k++) {    // Rows of A
+    akp = A->e[p][k];
+    akq = A->e[q][k];
+    CMUL(e, akq, tc);             // e aqk
+    A->e[p][k].real = c * akp.real - sn * tc.real;
+    A->e[p][k].imag = c * akp.imag - sn * tc.imag;
+    A->e[q][k].real = sn * akp.real + c * tc.real;
+    A->e[q][k].imag = sn * akp.imag + c * tc.imag;
+  }
+  A->e[p][q] = cmplx(0.0, 0.0);
+  A->e[q][p] = cmplx(0.0, 0.0);
+  A->e[p][p].imag = 0.0;
+  A->e[q][q].imag = 0.0;
+}
+
+// Cyclic Jacobi sweeps until the off-diagonal part of A is negligible
+// For NCOL = 2 a single rotation suffices
+#define JACOBI_MAX_SWEEPS 50
+static void jacobi_eig(matrix *A, matrix *V) {
+  register int p, q, sweep;
+  double off, norm;
+
+  for (sweep = 0; sweep < JACOBI_MAX_SWEEPS; sweep++) {
+    off = 0.0;
+    norm = 0.0;
+    for (p = 0; p < NCOL; p++) {
+      norm += A->e[p][p].real * A->e[p][p].real;
+      for (q = p + 1; q < NCOL; q++)
+        off += cabs_sq(&(A->e[p][q]));
+    }
+    if (off <= 1.0e-32 * norm)
+      return;
+
+    for (p = 0; p < NCOL; p++) {
+      for (q = p + 1; q < NCOL; q++)
+        jacobi_rotate(A, V, p, q);
     }
   }
+}
 
-  // Compute eigenvalues and eigenvectors of in
-  zheev_(&V, &U, &Npt, store, &Npt, eigs, work, &Nwork, Rwork, &stat);
+#if NCOL == 3
+// Bilinear cross product, satisfying x.(x cross y) = y.(x cross y) = 0
+static void cross3(complex *x, complex *y, complex *out) {
+  CMUL(x[1], y[2], out[0]);
+  CMULDIF(x[2], y[1], out[0]);
+  CMUL(x[2], y[0], out[1]);
+  CMULDIF(x[0], y[2], out[1]);
+  CMUL(x[0], y[1], out[2]);
+  CMULDIF(x[1], y[0], out[2]);
+}
 
-  if (stat != 0)
-    printf("WARNING: zheev returned error message %d\n", stat);
+// Analytic eigenvalues from the trigonometric solution of the cubic,
+// with eigenvectors from cross products of the rows of H - lambda I
+// Return 0 without touching eval or V if the spectrum is too close to
+// degenerate for the cross products to be accurate
+#define EIG3_GAP_TOL 1.0e-4
+static int herm_eig3(matrix *H, double *eval, matrix *V) {
+  register int i, j, k;
+  double q, p, r, phi, scale, norm, max, l[3];
+  complex v[3][3], cr[3], tc;
+  matrix B;
 
-  // Move the results back into matrix structures
-  // Use evecs to hold the eigenvectors for projection
-  clear_mat(out);
-  for (row = 0; row < NCOL; row++) {
-    for (col = 0; col < NCOL; col++) {
-      evecs.e[row][col].real = store[2 * (col * NCOL + row)];
-      evecs.e[row][col].imag = store[2 * (col * NCOL + row) + 1];
+  q = (H->e[0][0].real + H->e[1][1].real + H->e[2][2].real) / 3.0;
+  p = cabs_sq(&(H->e[0][1])) + cabs_sq(&(H->e[0][2]))
+    + cabs_sq(&(H->e[1][2]));
+  p *= 2.0;
+  for (i = 0; i < 3; i++)
+    p += (H->e[i][i].real - q) * (H->e[i][i].real - q);
+  p = sqrt(p / 6.0);
+  scale = fabs(q) + p;
+  if (p <= EIG3_GAP_TOL * scale)
+    return 0;
+
+  // Eigenvalues of B = (H - q) / p are 2cos(phi + 2pi k / 3)
+  mat_copy(H, &B);
+  scalar_add_diag(&B, -q);
+  scalar_mult_matrix(&B, 1.0 / p, &B);
+  tc = find_det(&B);
+  r = 0.5 * tc.real;
+  if (r <= -1.0)
+    phi = PI / 3.0;
+  else if (r >= 1.0)
+    phi = 0.0;
+  else
+    phi = acos(r) / 3.0;
+  l[0] = q + 2.0 * p * cos(phi);                  // Largest
+  l[2] = q + 2.0 * p * cos(phi + 2.0 * PI / 3.0); // Smallest
+  l[1] = 3.0 * q - l[0] - l[2];
+  if (l[0] - l[1] < EIG3_GAP_TOL * scale || l[1] - l[2] < EIG3_GAP_TOL * scale)
+    return 0;
+
+  // Largest cross product of rows of H - lambda I for lambda = l[0], l[2]
+  for (k = 0; k < 3; k += 2) {
+    mat_copy(H, &B);
+    scalar_add_diag(&B, -l[k]);
+    max = -1.0;
+    for (i = 0; i < 3; i++) {
+      for (j = i + 1; j < 3; j++) {
+        cross3(B.e[i], B.e[j], cr);
+        norm = cabs_sq(&(cr[0])) + cabs_sq(&(cr[1])) + cabs_sq(&(cr[2]));
+        if (norm > max) {
+          max = norm;
+          v[k][0] = cr[0];
+          v[k][1] = cr[1];
+          v[k][2] = cr[2];
+        }
+      }
+    }
+    norm = 1.0 / sqrt(max);
+    for (i = 0; i < 3; i++)
+      CMULREAL(v[k][i], norm, v[k][i]);
+  }
+
+  // Re-orthogonalize v[2] against v[0], then v[1] = (v[0] cross v[2])^*
+  tc = cmplx(0.0, 0.0);
+  for (i = 0; i < 3; i++) {
+    CMULJ_(v[0][i], v[2][i], cr[0]);    // <v[0]|v[2]>
+    CSUM(tc, cr[0]);
+  }
+  norm = 0.0;
+  for (i = 0; i < 3; i++) {
+    CMULDIF(tc, v[0][i], v[2][i]);
+    norm += cabs_sq(&(v[2][i]));
+  }
+  norm = 1.0 / sqrt(norm);
+  for (i = 0; i < 3; i++)
+    CMULREAL(v[2][i], norm, v[2][i]);
+
+  cross3(v[0], v[2], cr);
+  norm = 1.0 / sqrt(cabs_sq(&(cr[0])) + cabs_sq(&(cr[1])) + cabs_sq(&(cr[2])));
+  for (i = 0; i < 3; i++) {
+    CONJG(cr[i], v[1][i]);
+    CMULREAL(v[1][i], norm, v[1][i]);
+  }
+
+  // Eigenvectors are the columns of V, as from LAPACK
+  for (k = 0; k < 3; k++) {
+    eval[k] = l[k];
+    for (i = 0; i < 3; i++)
+      V->e[i][k] = v[k][i];
+  }
+  return 1;
+}
+#endif
+
+// Eigenvalues and eigenvectors (columns of V) of hermitian H
+// Analytic for NCOL <= 3, otherwise (or near degeneracy) Jacobi
+void herm_eig(matrix *H, double *eval, matrix *V) {
+  register int i;
+  matrix A;
+
+#if NCOL == 3
+  if (herm_eig3(H, eval, V))
+    return;
+#endif
+
+  mat_copy(H, &A);
+  clear_mat(V);
+  for (i = 0; i < NCOL; i++)
+    V->e[i][i].real = 1.0;
+  jacobi_eig(&A, V);
+  for (i = 0; i < NCOL; i++)
+    eval[i] = A.e[i][i].real;
+}
+
+// out = V.diag(f).V^dag
+static void herm_func(matrix *V, double *f, matrix *out) {
+  register int i, j, k;
+  complex tc, tc2;
+
+  for (i = 0; i < NCOL; i++) {
+    for (j = 0; j < NCOL; j++) {
+      out->e[i][j] = cmplx(0.0, 0.0);
+      for (k = 0; k < NCOL; k++) {
+        CMULREAL(V->e[i][k], f[k], tc);
+        CMUL_J(tc, V->e[j][k], tc2);
+        CSUM(out->e[i][j], tc2);
+      }
     }
-    out->e[row][row].real = log(eigs[row]);
   }
-  // Inverse of eigenvector matrix is simply adjoint
-  mult_na(out, &evecs, &tmat);
-  mult_nn(&evecs, &tmat, out);
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Take log of hermitian part of decomposition to define scalar field
+// in and out may be the same matrix
+void matrix_log(matrix *in, matrix *out) {
+  register int i;
+  double eval[NCOL];
+  matrix evecs;
+
+  herm_eig(in, eval, &evecs);
+  for (i = 0; i < NCOL; i++)
+    eval[i] = log(eval[i]);
+  herm_func(&evecs, eval, out);
 }
 // -----------------------------------------------------------------
 
@@ -48,52 +249,35 @@ void matrix_log(matrix *in, matrix *out) {
 // -----------------------------------------------------------------
 // Given matrix in = P.u, calculate the unitary matrix u = [1 / P].in
 //   and the positive P = sqrt[in.in^dag]
-// We diagonalize PSq = in.in^dag using LAPACK,
+// We diagonalize PSq = in.in^dag,
 // then project out its inverse square root
 void polar(matrix *in, matrix *u, matrix *P) {
-  char V = 'V';     // Ask LAPACK for both eigenvalues and eigenvectors
-  char U = 'U';     // Have LAPACK store upper triangle of U.Ubar
-  int row, col, Npt = NCOL, stat = 0, Nwork = 2 * NCOL;
-  matrix PSq, Pinv, tmat;
+  register int row, col;
+  double eval[NCOL], f[NCOL];
+  matrix PSq, Pinv, evecs;
+#ifdef DEBUG_CHECK
+  matrix tmat;
+#endif
 
-  // Convert PSq to column-major double array used by LAPACK
   mult_na(in, in, &PSq);
-  for (row = 0; row < NCOL; row++) {
-    for (col = 0; col < NCOL; col++) {
-      store[2 * (col * NCOL + row)] = PSq.e[row][col].real;
-      store[2 * (col * NCOL + row) + 1] = PSq.e[row][col].imag;
-    }
-  }
-
-  // Compute eigenvalues and eigenvectors of PSq
-  zheev_(&V, &U, &Npt, store, &Npt, eigs, work, &Nwork, Rwork, &stat);
+  herm_eig(&PSq, eval, &evecs);
 
   // Check for degenerate eigenvalues (broke previous Jacobi algorithm)
   for (row = 0; row < NCOL; row++) {
     for (col = row + 1; col < NCOL; col++) {
-      if (fabs(eigs[row] - eigs[col]) < IMAG_TOL)
-        printf("WARNING: w[%d] = w[%d] = %.8g\n", row, col, eigs[row]);
+      if (fabs(eval[row] - eval[col]) < IMAG_TOL)
+        printf("WARNING: w[%d] = w[%d] = %.8g\n", row, col, eval[row]);
     }
   }
 
-  // Move the results back into matrix structures
-  // Overwrite PSq to hold the eigenvectors for projection
-  for (row = 0; row < NCOL; row++) {
-    for (col = 0; col < NCOL; col++) {
-      PSq.e[row][col].real = store[2 * (col * NCOL + row)];
-      PSq.e[row][col].imag = store[2 * (col * NCOL + row) + 1];
-      P->e[row][col] = cmplx(0.0, 0.0);
-      Pinv.e[row][col] = cmplx(0.0, 0.0);
-    }
-    P->e[row][row].real = sqrt(eigs[row]);
-    Pinv.e[row][row].real = 1.0 / sqrt(eigs[row]);
-  }
-  mult_na(P, &PSq, &tmat);
-  mult_nn(&PSq, &tmat, P);
+  for (row = 0; row < NCOL; row++)
+    f[row] = sqrt(eval[row]);
+  herm_func(&evecs, f, P);
 
   // Now project out 1 / sqrt[in.in^dag] to find u = [1 / P].in
-  mult_na(&Pinv, &PSq, &tmat);
-  mult_nn(&PSq, &tmat, &Pinv);
+  for (row = 0; row < NCOL; row++)
+    f[row] = 1.0 / f[row];
+  herm_func(&evecs, f, &Pinv);
   mult_nn(&Pinv, in, u);
 
 #ifdef DEBUG_CHECK
@@ -157,3 +341,120 @@ void polar(matrix *in, matrix *u, matrix *P) {
 #endif
 }
 // -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Batched over all sites, for e.g. fo = F_OFFSET(link[dir])
+// Either u or P may be NULL if not needed
+void polar_site(field_offset fo, matrix *u, matrix *P) {
+  register int i;
+  register site *s;
+  matrix tu, tP;
+
+  FORALLSITES_OMP(i, s, private(tu, tP)) {
+    polar((matrix *)F_PT(s, fo), &tu, &tP);
+    if (u != NULL)
+      mat_copy(&tu, &(u[i]));
+    if (P != NULL)
+      mat_copy(&tP, &(P[i]));
+  } END_LOOP_OMP;
+}
+
+// in and out may be the same field
+void matrix_log_field(matrix *in, matrix *out) {
+  register int i;
+  register site *s;
+
+  FORALLSITES_OMP(i, s, ) {
+    matrix_log(&(in[i]), &(out[i]));
+  } END_LOOP_OMP;
+}
+// -----------------------------------------------------------------
+
+
+
+// -----------------------------------------------------------------
+// Reference LAPACK versions of matrix_log and polar, for checking
+// These use the global LAPACK scratch space so are not thread-safe
+void matrix_log_LAPACK(matrix *in, matrix *out) {
+  char V = 'V';     // Ask LAPACK for both eigenvalues and eigenvectors
+  char U = 'U';     // Have LAPACK store upper triangle of in
+  int row, col, Npt = NCOL, stat = 0, Nwork = 2 * NCOL;
+  matrix evecs, tmat;
+
+  // Convert in to column-major double array used by LAPACK
+  for (row = 0; row < NCOL; row++) {
+    for (col = 0; col < NCOL; col++) {
+      store[2 * (col * NCOL + row)] = in->e[row][col].real;
+      store[2 * (col * NCOL + row) + 1] = in->e[row][col].imag;
+    }
+  }
+
+  // Compute eigenvalues and eigenvectors of in
+  zheev_(&V, &U, &Npt, store, &Npt, eigs, work, &Nwork, Rwork, &stat);
+
+  if (stat != 0)
+    printf("WARNING: zheev returned error message %d\n", stat);
+
+  // Move the results back into matrix structures
+  // Use evecs to hold the eigenvectors for projection
+  clear_mat(out);
+  for (row = 0; row < NCOL; row++) {
+    for (col = 0; col < NCOL; col++) {
+      evecs.e[row][col].real = store[2 * (col * NCOL + row)];
+      evecs.e[row][col].imag = store[2 * (col * NCOL + row) + 1];
+    }
+    out->e[row][row].real = log(eigs[row]);
+  }
+  // Inverse of eigenvector matrix is simply adjoint
+  mult_na(out, &evecs, &tmat);
+  mult_nn(&evecs, &tmat, out);
+}
+void polar_LAPACK(matrix *in, matrix *u, matrix *P) {
+  char V = 'V';     // Ask LAPACK for both eigenvalues and eigenvectors
+  char U = 'U';     // Have LAPACK store upper triangle of U.Ubar
+  int row, col, Npt = NCOL, stat = 0, Nwork = 2 * NCOL;
+  matrix PSq, Pinv, tmat;
+
+  // Convert PSq to column-major double array used by LAPACK
+  mult_na(in, in, &PSq);
+  for (row = 0; row < NCOL; row++) {
+    for (col = 0; col < NCOL; col++) {
+      store[2 * (col * NCOL + row)] = PSq.e[row][col].real;
+      store[2 * (col * NCOL + row) + 1] = PSq.e[row][col].imag;
+    }
+  }
+
+  // Compute eigenvalues and eigenvectors of PSq
+  zheev_(&V, &U, &Npt, store, &Npt, eigs, work, &Nwork, Rwork, &stat);
+
+  // Check for degenerate eigenvalues (broke previous Jacobi algorithm)
+  for (row = 0; row < NCOL; row++) {
+    for (col = row + 1; col < NCOL; col++) {
+      if (fabs(eigs[row] - eigs[col]) < IMAG_TOL)
+        printf("WARNING: w[%d] = w[%d] = %.8g\n", row, col, eigs[row]);
+    }
+  }
+
+  // Move the results back into matrix structures
+  // Overwrite PSq to hold the eigenvectors for projection
+  for (row = 0; row < NCOL; row++) {
+    for (col = 0; col < NCOL; col++) {
+      PSq.e[row][col].real = store[2 * (col * NCOL + row)];
+      PSq.e[row][col].imag = store[2 * (col * NCOL + row) + 1];
+      P->e[row][col] = cmplx(0.0, 0.0);
+      Pinv.e[row][col] = cmplx(0.0, 0.0);
+    }
+    P->e[row][row].real = sqrt(eigs[row]);
+    Pinv.e[row][row].real = 1.0 / sqrt(eigs[row]);
+  }
+  mult_na(P, &PSq, &tmat);
+  mult_nn(&PSq, &tmat, P);
+
+  // Now project out 1 / sqrt[in.in^dag] to find u = [1 / P].in
+  mult_na(&Pinv, &PSq, &tmat);
+  mult_nn(&PSq, &tmat, &Pinv);
+  mult_nn(&Pinv, in, u);
+}
+// -----------------------------------------------------------------
@@ -35,10 +35,10 @@ double gauge_force(Real eps) {
                                        gen_pt[mu + 1]);
 
     wait_gather(tag[mu]);
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, ) {
       mult_an(&(s->link[mu]), &(DmuUmu[i]), &(s->f_U[mu]));   // Initialize
       mult_na_dif((matrix *)(gen_pt[mu][i]), &(s->link[mu]), &(s->f_U[mu]));
-    }
+    } END_LOOP_OMP;
     cleanup_gather(tag[mu]);
   }
 
@@ -48,7 +48,7 @@ double gauge_force(Real eps) {
   // Only compute if G is non-zero
   // Use tr_dest for temporary storage
   if (doG) {
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, private(tc, mu, nu)) {
       tc = trace(&DmuUmu[i]);
       FORALLDIR(mu) {
         for (nu = mu + 1; nu < NUMLINK; nu++) {
@@ -56,7 +56,7 @@ double gauge_force(Real eps) {
           CMUL(tc, plaqdet[nu][mu][i], tempdet[nu][mu][i]);
         }
       }
-    }
+    } END_LOOP_OMP;
 
     // Start first gather (mu = 0 and nu = 1), labelled by nu
     // Gather D[mu][nu] from x - nu
@@ -66,8 +66,9 @@ double gauge_force(Real eps) {
     // Main loop
     FORALLDIR(mu) {
       // Zero tr_dest to hold sum
-      FORALLSITES(i, s)
+      FORALLSITES_OMP(i, s, ) {
         tr_dest[i] = cmplx(0.0, 0.0);
+      } END_LOOP_OMP;
 
       FORALLDIR(nu) {
         if (mu == nu)
@@ -92,30 +93,32 @@ double gauge_force(Real eps) {
         }
 
         // Add D[nu][mu](x) to sum while gather runs
-        FORALLSITES(i, s)
+        FORALLSITES_OMP(i, s, ) {
           CSUM(tr_dest[i], tempdet[nu][mu][i]);
+        } END_LOOP_OMP;
 
         // Add D[mu][nu](x - nu) to sum
         wait_gather(tag[nu]);
-        FORALLSITES(i, s)
+        FORALLSITES_OMP(i, s, ) {
           CSUM(tr_dest[i], *((complex *)(gen_pt[nu][i])));
+        } END_LOOP_OMP;
         cleanup_gather(tag[nu]);
       }
 
       // Now add to force
-      FORALLSITES(i, s) {
+      FORALLSITES_OMP(i, s, private(tc)) {
         CMULREAL(tr_dest[i], G, tc);
         c_scalar_mult_sum_mat(&(Uinv[mu][i]), &tc, &(s->f_U[mu]));
-      }
+      } END_LOOP_OMP;
     }
   }
 
   // Overall factor of C2 on all d^2 contributions
   if (C2 - 1.0 > IMAG_TOL) {
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, private(mu)) {
       FORALLDIR(mu)
         scalar_mult_matrix(&(s->f_U[mu]), C2, &(s->f_U[mu]));
-    }
+    } END_LOOP_OMP;
   }
 
   // Contribution from Fbar_{ab} F_{ab} term
@@ -131,8 +134,9 @@ double gauge_force(Real eps) {
                               goffset[0], EVENANDODD, local_pt[0][0]);
 
   index = plaq_index[0][1];
-  FORALLSITES(i, s)     // mu = 0 < nu = 1
+  FORALLSITES_OMP(i, s, ) {     // mu = 0 < nu = 1
     mult_an(&(Fmunu[index][i]), &(s->link[1]), &(mat[0][i]));
+  } END_LOOP_OMP;
   tag1[0] = start_gather_field(mat[0], sizeof(matrix),
                                goffset[1] + 1, EVENANDODD, local_pt[0][1]);
 
@@ -162,14 +166,14 @@ double gauge_force(Real eps) {
                                          EVENANDODD, local_pt[gather][0]);
 
         next = plaq_index[a][b];
-        FORALLSITES(i, s) {
+        FORALLSITES_OMP(i, s, private(tmat)) {
           if (a > b) {
             scalar_mult_matrix(&(Fmunu[next][i]), -1.0, &tmat);
             mult_an(&tmat, &(s->link[b]), &(mat[gather][i]));
           }
           else
             mult_an(&(Fmunu[next][i]), &(s->link[b]), &(mat[gather][i]));
-        }
+        } END_LOOP_OMP;
         tag1[gather] = start_gather_field(mat[gather], sizeof(matrix),
                                           goffset[b] + 1, EVENANDODD,
                                           local_pt[gather][1]);
@@ -178,7 +182,7 @@ double gauge_force(Real eps) {
       index = plaq_index[mu][nu];
       wait_gather(tag0[flip]);
       wait_gather(tag1[flip]);
-      FORALLSITES(i, s) {
+      FORALLSITES_OMP(i, s, private(tmat, tmat2)) {
         if (mu > nu) {
           scalar_mult_matrix(&(Fmunu[index][i]), -1.0, &tmat);
           mult_na((matrix *)local_pt[flip][0][i], &tmat, &tmat2);
@@ -188,7 +192,7 @@ double gauge_force(Real eps) {
 
         sub_matrix(&tmat2, (matrix *)local_pt[flip][1][i], &tmat);
         scalar_mult_sum_matrix(&tmat, 2.0, &(s->f_U[mu]));
-      }
+      } END_LOOP_OMP;
       cleanup_gather(tag0[flip]);
       cleanup_gather(tag1[flip]);
       flip = gather;
@@ -205,7 +209,7 @@ double gauge_force(Real eps) {
     dmu = 2.0 * one_ov_N * bmass * bmass;
 #endif
 
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, private(mu, tmat, tr)) {
       FORALLDIR(mu) {
 #ifdef EIG_POT
         // Ubar_a(x) [U_a(x) Ubar_a(x) - I]
@@ -219,7 +223,7 @@ double gauge_force(Real eps) {
         scalar_mult_sum_adj_matrix(&(s->link[mu]), tr, &(s->f_U[mu]));
 #endif
       }
-    }
+    } END_LOOP_OMP;
   }
 
 #ifdef DIMREDUCE
@@ -230,11 +234,11 @@ double gauge_force(Real eps) {
     Real dcW = cWline * cWline;
     FORALLUPDIR(mu) {
       if (length[mu] == 1) {
-        FORALLSITES(i, s) {
+        FORALLSITES_OMP(i, s, private(tmat)) {
           mat_copy(&(s->link[mu]), &tmat);
           scalar_add_diag(&tmat, -1.0);
           scalar_mult_sum_adj_matrix(&tmat, dcW, &(s->f_U[mu]));
-        }
+        } END_LOOP_OMP;
       }
     }
   }
@@ -245,12 +249,12 @@ double gauge_force(Real eps) {
   // Subtract to reproduce -Adj(f_U)
   // Compute average gauge force in same loop
   tr = kappa * eps;
-  FORALLSITES(i, s) {
+  FORALLSITES_OMP(i, s, private(mu) reduction(+:returnit)) {
     FORALLDIR(mu) {
       scalar_mult_dif_adj_matrix(&(s->f_U[mu]), tr, &(s->mom[mu]));
       returnit += realtrace(&(s->f_U[mu]), &(s->f_U[mu]));
     }
-  }
+  } END_LOOP_OMP;
   g_doublesum(&returnit);
   returnit *= kappa * kappa;
 
@@ -276,7 +280,6 @@ void F1Q(matrix *plaq_sol[NPLAQ], matrix *plaq_psol[NPLAQ]) {
   int a, b, c, d, e, j, i_ab, i_de, gather, next, flip = 0;
   Real permm, tr;
   msg_tag *tag0[2], *tag1[2], *tag2[2], *tag3[2];
-  matrix tmat;
 
   for (a = 0; a < 4; a++) {
     local_pt[0][a] = gen_pt[a];
@@ -343,16 +346,26 @@ void F1Q(matrix *plaq_sol[NPLAQ], matrix *plaq_psol[NPLAQ]) {
     wait_gather(tag1[flip]);
     wait_gather(tag2[flip]);
     wait_gather(tag3[flip]);
-    FORALLSITES(i, s) {
-      tr = permm * (s->bc3[a][b][c]) * (s->bc1[c]);
-      scalar_mult_matrix((matrix *)(local_pt[flip][1][i]), tr, &tmat);
-      mult_nn((matrix *)(local_pt[flip][0][i]), &tmat, &(tempmat[i]));
-
-      tr = -1.0 * permm * (s->bc2[opp_a][opp_b]) * (s->bc1[c]);
-      scalar_mult_matrix((matrix *)(local_pt[flip][3][i]), tr, &tmat);
-      mult_nn_sum(&tmat, (matrix *)(local_pt[flip][2][i]), &(tempmat[i]));
+#ifdef SIMD_LAYOUT
+    if (simd_layout) {
+      FQ_sites_v(local_pt[flip], permm, tshift[a] + tshift[b] + tshift[c],
+                 tshift[opp_a] + tshift[opp_b], c);
+    }
+    else {
+#endif
+    FORALLSITES_OMP(i, s, private(tr)) {
+      tr = permm * (BC3(s, a, b, c)) * (BC1(s, c));
+      scalar_mult_nn((matrix *)(local_pt[flip][0][i]),
+                     (matrix *)(local_pt[flip][1][i]), tr, &(tempmat[i]));
+
+      tr = -1.0 * permm * (BC2(s, opp_a, opp_b)) * (BC1(s, c));
+      scalar_mult_nn_sum((matrix *)(local_pt[flip][3][i]),
+                         (matrix *)(local_pt[flip][2][i]), tr, &(tempmat[i]));
       scalar_mult_sum_adj_matrix(&(tempmat[i]), -0.5, &(s->f_U[c]));
+    } END_LOOP_OMP;
+#ifdef SIMD_LAYOUT
     }
+#endif
     cleanup_gather(tag0[flip]);
     cleanup_gather(tag1[flip]);
     cleanup_gather(tag2[flip]);
@@ -374,7 +387,6 @@ void F2Q(matrix *plaq_sol[NPLAQ], matrix *plaq_psol[NPLAQ]) {
   int a, b, c, d, e, j, i_ab, i_de, gather, next, flip = 0;
   Real permm, tr;
   msg_tag *tag0[2], *tag1[2], *tag2[2], *tag3[2];
-  matrix tmat;
 
   for (a = 0; a < 4; a++) {
     local_pt[0][a] = gen_pt[a];
@@ -441,16 +453,26 @@ void F2Q(matrix *plaq_sol[NPLAQ], matrix *plaq_psol[NPLAQ]) {
     wait_gather(tag1[flip]);
     wait_gather(tag2[flip]);
     wait_gather(tag3[flip]);
-    FORALLSITES(i, s) {
-      tr = permm * (s->bc2[opp_a][opp_b]) * (s->bc1[c]);
-      scalar_mult_matrix((matrix *)(local_pt[flip][1][i]), tr, &tmat);
-      mult_nn((matrix *)(local_pt[flip][0][i]), &tmat, &(tempmat[i]));
-
-      tr = -1.0 * permm * (s->bc3[a][b][c]) * (s->bc1[c]);
-      scalar_mult_matrix((matrix *)(local_pt[flip][3][i]), tr, &tmat);
-      mult_nn_sum(&tmat, (matrix *)(local_pt[flip][2][i]), &(tempmat[i]));
+#ifdef SIMD_LAYOUT
+    if (simd_layout) {
+      FQ_sites_v(local_pt[flip], permm, tshift[opp_a] + tshift[opp_b],
+                 tshift[a] + tshift[b] + tshift[c], c);
+    }
+    else {
+#endif
+    FORALLSITES_OMP(i, s, private(tr)) {
+      tr = permm * (BC2(s, opp_a, opp_b)) * (BC1(s, c));
+      scalar_mult_nn((matrix *)(local_pt[flip][0][i]),
+                     (matrix *)(local_pt[flip][1][i]), tr, &(tempmat[i]));
+
+      tr = -1.0 * permm * (BC3(s, a, b, c)) * (BC1(s, c));
+      scalar_mult_nn_sum((matrix *)(local_pt[flip][3][i]),
+                         (matrix *)(local_pt[flip][2][i]), tr, &(tempmat[i]));
       scalar_mult_sum_adj_matrix(&(tempmat[i]), -0.5, &(s->f_U[c]));
+    } END_LOOP_OMP;
+#ifdef SIMD_LAYOUT
     }
+#endif
     cleanup_gather(tag0[flip]);
     cleanup_gather(tag1[flip]);
     cleanup_gather(tag2[flip]);
@@ -488,14 +510,15 @@ void detF(matrix *eta, matrix *psi[NUMLINK], int sign) {
   }
 
   // Set up and store some basic ingredients
-  FORALLSITES(i, s)
+  FORALLSITES_OMP(i, s, ) {
     tr_eta[i] = trace(&(eta[i]));
+  } END_LOOP_OMP;
   // Need all directions for upcoming sums
   FORALLDIR(a) {
     // U_a(x)^{-1} and Udag_a(x)^{-1} are already in Uinv[a] and Udag_inv[a]
     // Save Tr[U_a(x)^{-1} psi_a(x) in Tr_Uinv[a]
     // Save U_a(x)^{-1} psi_a(x) U_a(x)^{-1} in UpsiU[a]
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, private(b, tmat)) {
       mult_nn(&(Uinv[a][i]), &(psi[a][i]), &tmat);
       mult_nn(&tmat, &(Uinv[a][i]), &(UpsiU[a][i]));
       Tr_Uinv[a][i] = trace(&tmat);
@@ -505,7 +528,7 @@ void detF(matrix *eta, matrix *psi[NUMLINK], int sign) {
         CMUL(tr_eta[i], plaqdet[a][b][i], tempdet[a][b][i]);
         CMUL(tr_eta[i], plaqdet[b][a][i], tempdet[b][a][i]);
       }
-    }
+    } END_LOOP_OMP;
   }
 
   // Now we are ready to gather, accumulate and add to force
@@ -517,11 +540,11 @@ void detF(matrix *eta, matrix *psi[NUMLINK], int sign) {
   // TODO: Could try to overlap these gathers, but that looks nasty...
   FORALLDIR(a) {
     // Initialize accumulators for sums over b
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, ) {
       plaq_term[i] = cmplx(0.0, 0.0);
       inv_term[i] = cmplx(0.0, 0.0);
       adj_term[i] = cmplx(0.0, 0.0);
-    }
+    } END_LOOP_OMP;
     FORALLDIR(b) {
       if (a == b)
         continue;
@@ -554,8 +577,9 @@ void detF(matrix *eta, matrix *psi[NUMLINK], int sign) {
       // Step two of Tr_Uinv[b](x - b + a) gather, including BC
       // Use tr_dest for temporary storage
       wait_gather(mtag[0]);
-      FORALLSITES(i, s)
-        CMULREAL(*((complex *)(gen_pt[0][i])), s->bc1[a], tr_dest[i]);
+      FORALLSITES_OMP(i, s, ) {
+        CMULREAL(*((complex *)(gen_pt[0][i])), BC1(s, a), tr_dest[i]);
+      } END_LOOP_OMP;
       cleanup_gather(mtag[0]);
       mtag[0] = start_gather_field(tr_dest, sizeof(complex),
                                    goffset[b] + 1, EVENANDODD, gen_pt[0]);
@@ -569,13 +593,13 @@ void detF(matrix *eta, matrix *psi[NUMLINK], int sign) {
       wait_gather(mtag[5]);         // 3) T[b](x + a)
       wait_gather(mtag[6]);         // 4) T[b](x - b)
       wait_gather(mtag[0]);         // 0) T[b](x + a - b)
-      FORALLSITES(i, s) {
+      FORALLSITES_OMP(i, s, private(tc, tc2)) {
         // Accumulate plaq_term
         // D[b][a](x) {T[a](x) + T[b](x + a)}
         // gen_pt[5] is T[b](x + a)
         tc = *((complex *)(gen_pt[5][i]));
-        tc2.real = Tr_Uinv[a][i].real + s->bc1[a] * tc.real;
-        tc2.imag = Tr_Uinv[a][i].imag + s->bc1[a] * tc.imag;
+        tc2.real = Tr_Uinv[a][i].real + BC1(s, a) * tc.real;
+        tc2.imag = Tr_Uinv[a][i].imag + BC1(s, a) * tc.imag;
         plaq_term[i].real += tempdet[b][a][i].real * tc2.real
                            - tempdet[b][a][i].imag * tc2.imag;
         plaq_term[i].imag += tempdet[b][a][i].imag * tc2.real
@@ -584,8 +608,8 @@ void detF(matrix *eta, matrix *psi[NUMLINK], int sign) {
         // D[a][b](x - b) {T[a](x) + T[b](x - b)}
         // gen_pt[6] is T[b](x - b)
         tc = *((complex *)(gen_pt[6][i]));
-        tc2.real = tc.real + s->bc1[opp_b] * Tr_Uinv[a][i].real;
-        tc2.imag = tc.imag + s->bc1[opp_b] * Tr_Uinv[a][i].imag;
+        tc2.real = tc.real + BC1(s, opp_b) * Tr_Uinv[a][i].real;
+        tc2.imag = tc.imag + BC1(s, opp_b) * Tr_Uinv[a][i].imag;
         // gen_pt[1] is D[a][b](x - b)
         tc = *((complex *)(gen_pt[1][i]));
         plaq_term[i].real += tc.real * tc2.real - tc.imag * tc2.imag;
@@ -595,8 +619,8 @@ void detF(matrix *eta, matrix *psi[NUMLINK], int sign) {
         // D[a][b](x) {T[b](x) + T[a](x + b)}
         // gen_pt[3] is T[a](x + b)
         tc = *((complex *)(gen_pt[3][i]));
-        tc2.real = Tr_Uinv[b][i].real + s->bc1[b] * tc.real;
-        tc2.imag = Tr_Uinv[b][i].imag + s->bc1[b] * tc.imag;
+        tc2.real = Tr_Uinv[b][i].real + BC1(s, b) * tc.real;
+        tc2.imag = Tr_Uinv[b][i].imag + BC1(s, b) * tc.imag;
         adj_term[i].real += tempdet[a][b][i].real * tc2.real
                           - tempdet[a][b][i].imag * tc2.imag;
         adj_term[i].imag += tempdet[a][b][i].imag * tc2.real
@@ -614,9 +638,9 @@ void detF(matrix *eta, matrix *psi[NUMLINK], int sign) {
         // Accumulate inv_term = sum_b D[b][a](x) + D[a][b](x - b)
         // gen_pt[1] is D[a][b](x - b)
         tc = *((complex *)(gen_pt[1][i]));
-        inv_term[i].real += tempdet[b][a][i].real + s->bc1[opp_b] * tc.real;
-        inv_term[i].imag += tempdet[b][a][i].imag + s->bc1[opp_b] * tc.imag;
-      }
+        inv_term[i].real += tempdet[b][a][i].real + BC1(s, opp_b) * tc.real;
+        inv_term[i].imag += tempdet[b][a][i].imag + BC1(s, opp_b) * tc.imag;
+      } END_LOOP_OMP;
       cleanup_gather(mtag[0]);
       cleanup_gather(mtag[1]);
       cleanup_gather(mtag[2]);
@@ -627,7 +651,7 @@ void detF(matrix *eta, matrix *psi[NUMLINK], int sign) {
     }
 
     // Now add to force
-    FORALLSITES(i, s) {
+    FORALLSITES_OMP(i, s, private(tc)) {
       // Start with plaq_term hitting U_a(x)^{-1}
       CMULREAL(plaq_term[i], localG, tc);
       c_scalar_mult_sum_mat(&(Uinv[a][i]), &tc, &(s->f_U[a]));
@@ -639,7 +663,7 @@ void detF(matrix *eta, matrix *psi[NUMLINK], int sign) {
       // Finally subtract inv_term hitting U_a(x)^{-1} psi_a(x) U_a(x)^{-1}
       CMULREAL(inv_term[i], localG, tc);
       c_scalar_mult_dif_mat(&(UpsiU[a][i]), &tc, &(s->f_U[a]));
-    }
+    } END_LOOP_OMP;
   }
   free(plaq_term);
   free(inv_term);
@@ -676,7 +700,7 @@ void assemble_fermion_force(Twist_Fermion *sol, Twist_Fermion *psol) {
   // into persistent site, link and plaq fermions
   // We can reuse "src" and "dest" for this storage,
   // corresponding to "sol" and "psol", respectively
-  FORALLSITES(i, s) {
+  FORALLSITES_OMP(i, s, private(mu)) {
     mat_copy(&(sol[i].Fsite), &(site_src[i]));
     adjoint(&(psol[i].Fsite), &(site_dest[i]));
     FORALLDIR(mu) {
@@ -687,7 +711,7 @@ void assemble_fermion_force(Twist_Fermion *sol, Twist_Fermion *psol) {
       mat_copy(&(sol[i].Fplaq[mu]), &(plaq_src[mu][i]));
       adjoint(&(psol[i].Fplaq[mu]), &(plaq_dest[mu][i]));
     }
-  }
+  } END_LOOP_OMP;
 
 #ifdef SV
   // Accumulate both terms in UpsiU[mu], use to initialize f_U[mu]
@@ -702,11 +726,11 @@ void assemble_fermion_force(Twist_Fermion *sol, Twist_Fermion *psol) {
                                         gen_pt[mu + 1]);
     }
     wait_gather(mtag[mu]);
-    FORALLSITES(i, s) {
-      scalar_mult_matrix((matrix *)(gen_pt[mu][i]), s->bc1[mu], &tmat);
-      mult_nn(&(link_src[mu][i]), &tmat, &(UpsiU[mu][i]));   // Initialize
+    FORALLSITES_OMP(i, s, ) {
+      scalar_mult_nn(&(link_src[mu][i]), (matrix *)(gen_pt[mu][i]),
+                     BC1(s, mu), &(UpsiU[mu][i]));            // Initialize
       mult_nn_dif(&(site_dest[i]), &(link_src[mu][i]), &(UpsiU[mu][i]));
-    }
+    } END_LOOP_OMP;
     cleanup_gather(mtag[mu]);
   }
 
@@ -721,14 +745,14 @@ void assemble_fermion_force(Twist_Fermion *sol, Twist_Fermion *psol) {
                                         gen_pt[mu + 1]);
     }
     wait_gather(mtag[mu]);
-    FORALLSITES(i, s) {
-      scalar_mult_matrix((matrix *)(gen_pt[mu][i]), s->bc1[mu], &tmat);
-      mult_nn_dif(&(link_dest[mu][i]), &tmat, &(UpsiU[mu][i]));
+    FORALLSITES_OMP(i, s, ) {
+      scalar_mult_nn_dif(&(link_dest[mu][i]), (matrix *)(gen_pt[mu][i]),
+                         BC1(s, mu), &(UpsiU[mu][i]));
       mult_nn_sum(&(site_src[i]), &(link_dest[mu][i]), &(UpsiU[mu][i]));
 
       // Initialize the force collectors---done with UpsiU[mu]
       scalar_mult_adj_matrix(&(UpsiU[mu][i]), 0.5, &(s->f_U[mu]));
-    }
+    } END_LOOP_OMP;
     cleanup_gather(mtag[mu]);
   }
 #endif
@@ -740,8 +764,9 @@ void assemble_fermion_force(Twist_Fermion *sol, Twist_Fermion *psol) {
 
   // Prepare and gather other term in tempmat*
   index = plaq_index[0][1];
-  FORALLSITES(i, s)     // mu = 0 < nu = 1
+  FORALLSITES_OMP(i, s, ) {     // mu = 0 < nu = 1
     mult_nn(&(plaq_dest[index][i]), &(link_src[1][i]), &(mat[0][i]));
+  } END_LOOP_OMP;
   tag1[0] = start_gather_field(mat[0], sizeof(matrix),
                                goffset[1] + 1, EVENANDODD, local_pt[0][1]);
 
@@ -771,14 +796,14 @@ void assemble_fermion_force(Twist_Fermion *sol, Twist_Fermion *psol) {
 
         // Prepare and gather other term in tempmat*
         next = plaq_index[a][b];
-        FORALLSITES(i, s) {
+        FORALLSITES_OMP(i, s, private(tmat)) {
           if (a > b) {      // plaq_dest is anti-symmetric under a <--> b
             scalar_mult_matrix(&(plaq_dest[next][i]), -1.0, &tmat);
           }                 // Suppress compiler error
           else
             mat_copy(&(plaq_dest[next][i]), &tmat);
           mult_nn(&tmat, &(link_src[b][i]), &(mat[gather][i]));
-        }
+        } END_LOOP_OMP;
         tag1[gather] = start_gather_field(mat[gather], sizeof(matrix),
                                           goffset[b] + 1, EVENANDODD,
                                           local_pt[gather][1]);
@@ -787,18 +812,18 @@ void assemble_fermion_force(Twist_Fermion *sol, Twist_Fermion *psol) {
       index = plaq_index[mu][nu];
       wait_gather(tag0[flip]);
       wait_gather(tag1[flip]);
-      FORALLSITES(i, s) {
+      FORALLSITES_OMP(i, s, private(tmat)) {
         if (mu > nu) {    // plaq_dest is anti-symmetric under mu <--> nu
           scalar_mult_matrix((matrix *)(local_pt[flip][0][i]),
-                             s->bc1[mu], &tmat);
+                             BC1(s, mu), &tmat);
         }                 // Suppress compiler error
         else
           scalar_mult_matrix((matrix *)(local_pt[flip][0][i]),
-                             -1.0 * s->bc1[mu], &tmat);
+                             -1.0 * BC1(s, mu), &tmat);
 
         mult_nn_sum(&tmat, &(plaq_dest[index][i]), &(s->f_U[mu]));
         sum_matrix((matrix *)(local_pt[flip][1][i]), &(s->f_U[mu]));
-      }
+      } END_LOOP_OMP;
       cleanup_gather(tag0[flip]);
       cleanup_gather(tag1[flip]);
       flip = gather;
@@ -812,8 +837,9 @@ void assemble_fermion_force(Twist_Fermion *sol, Twist_Fermion *psol) {
 
   // Prepare and gather other term in tempmat*
   index = plaq_index[0][1];
-  FORALLSITES(i, s)     // mu = 0 < nu = 1
+  FORALLSITES_OMP(i, s, ) {     // mu = 0 < nu = 1
     mult_nn(&(plaq_src[index][i]), &(link_dest[1][i]), &(mat[0][i]));
+  } END_LOOP_OMP;
   tag1[0] = start_gather_field(mat[0], sizeof(matrix),
                                goffset[1] + 1, EVENANDODD, local_pt[0][1]);
 
@@ -843,14 +869,14 @@ void assemble_fermion_force(Twist_Fermion *sol, Twist_Fermion *psol) {
 
         // Prepare and gather other term in tempmat*
         next = plaq_index[a][b];
-        FORALLSITES(i, s) {
+        FORALLSITES_OMP(i, s, private(tmat)) {
           if (a > b) {      // plaq_src is anti-symmetric under a <--> b
             scalar_mult_matrix(&(plaq_src[next][i]), -1.0, &tmat);
           }                 // Suppress compiler error
           else
             mat_copy(&(plaq_src[next][i]), &tmat);
           mult_nn(&tmat, &(link_dest[b][i]), &(mat[gather][i]));
-        }
+        } END_LOOP_OMP;
         tag1[gather] = start_gather_field(mat[gather], sizeof(matrix),
                                           goffset[b] + 1, EVENANDODD,
                                           local_pt[gather][1]);
@@ -859,16 +885,13 @@ void assemble_fermion_force(Twist_Fermion *sol, Twist_Fermion *psol) {
       index = plaq_index[mu][nu];
       wait_gather(tag0[flip]);
       wait_gather(tag1[flip]);
-      FORALLSITES(i, s) {
-        if (mu > nu) {    // plaq_src is anti-symmetric under mu <--> nu
-          scalar_mult_matrix(&(plaq_src[index][i]), -1.0 * s->bc1[mu], &tmat);
-        }                 // Suppress compiler error
-        else
-          scalar_mult_matrix(&(plaq_src[index][i]), s->bc1[mu], &tmat);
-
-        mult_nn_sum((matrix *)(local_pt[flip][0][i]), &tmat, &(s->f_U[mu]));
+      FORALLSITES_OMP(i, s, ) {
+        // plaq_src is anti-symmetric under mu <--> nu
+        scalar_mult_nn_sum((matrix *)(local_pt[flip][0][i]),
+                           &(plaq_src[index][i]),
+                           (mu > nu ? -1.0 : 1.0) * BC1(s, mu), &(s->f_U[mu]));
         dif_matrix((matrix *)(local_pt[flip][1][i]), &(s->f_U[mu]));
-      }
+      } END_LOOP_OMP;
       cleanup_gather(tag0[flip]);
       cleanup_gather(tag1[flip]);
       flip = gather;
@@ -926,18 +949,21 @@ double fermion_force(Real eps, Twist_Fermion *src, Twist_Fermion **sol) {
 
   // Initialize fullforce[mu]
   fermion_op(sol[0], tempTF, PLUS);
-  FORALLSITES(i, s)
+  FORALLSITES_OMP(i, s, ) {
     scalar_mult_TF(&(tempTF[i]), amp4[0], &(tempTF[i]));
+  } END_LOOP_OMP;
   assemble_fermion_force(sol[0], tempTF);
   FORALLDIR(mu) {
-    FORALLSITES(i, s)
+    FORALLSITES_OMP(i, s, ) {
       adjoint(&(s->f_U[mu]), &(fullforce[mu][i]));
+    } END_LOOP_OMP;
   }
   for (n = 1; n < Norder; n++) {
     fermion_op(sol[n], tempTF, PLUS);
     // Makes sense to multiply here by amp4[n]...
-    FORALLSITES(i, s)
+    FORALLSITES_OMP(i, s, ) {
       scalar_mult_TF(&(tempTF[i]), amp4[n], &(tempTF[i]));
+    } END_LOOP_OMP;
 
     assemble_fermion_force(sol[n], tempTF);
 #ifdef FORCE_DEBUG
@@ -1030,12 +1056,12 @@ double fermion_force(Real eps, Twist_Fermion *src, Twist_Fermion **sol) {
   // Opposite sign as to gauge force,
   // because dS_G / dU = 2F_g while ds_F / dU = -2F_f
   // Move negation here as well, though adjoint remains above
-  FORALLSITES(i, s) {
+  FORALLSITES_OMP(i, s, private(mu) reduction(+:returnit)) {
     FORALLDIR(mu) {
       scalar_mult_dif_matrix(&(fullforce[mu][i]), eps, &(s->mom[mu]));
       returnit += realtrace(&(fullforce[mu][i]), &(fullforce[mu][i]));
     }
-  }
+  } END_LOOP_OMP;
   g_doublesum(&returnit);
 
   free(fullforce);
@@ -22,6 +22,7 @@ void update_uu(Real eps) {
     FORALLDIR(mu)
       scalar_mult_sum_matrix(&(s->mom[mu]), eps, &(s->link[mu]));
   }
+  invalidate_link_halo();
 
   // Update plaquette determinants, DmuUmu and Fmunu with new links
   // (Needs to be done before calling gauge_force)
@@ -155,6 +156,7 @@ int update() {
   if (exp(-change) < (double)xrandom) {
     if (traj_length > 0.0) {
       gauge_field_copy(F_OFFSET(old_link[0]), F_OFFSET(link[0]));
+      invalidate_link_halo();
       compute_plaqdet();
       compute_Uinv();
       compute_DmuUmu();
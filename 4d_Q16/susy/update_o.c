@@ -25,6 +25,7 @@ void update_uu(Real eps) {
     FORALLDIR(mu)
       scalar_mult_sum_matrix(&(s->mom[mu]), eps, &(s->link[mu]));
   }
+  invalidate_link_halo();
 
   // Update plaquette determinants, DmuUmu and Fmunu with new links
   // (Needs to be done before calling gauge_force)
@@ -63,10 +64,81 @@ double update_gauge_step(Real eps) {
 
 
 
+// -----------------------------------------------------------------
+// Per-shift CG stopping conditions for the MD and accept/reject solves
+// The error (D^2 + shift4[j])^(-1) r_j of shift j enters the fermion
+// action with coefficient amp4[j], so its contribution is bounded by
+// w_j |r_j| |src| with w_j = |amp4[j]| / (shift4[j] + lambda),
+// where lambda is the smallest eigenvalue of D^2
+// The fermion force brings in one more D, and an extra factor
+// sqrt(lam) / (lam + shift4[j]) with lam = max(lambda, shift4[j])
+// We relax the stopping condition of each shift with w_j < W,
+// where W = 0.1 (sum_k w_k) / Norder, until w_j |r_j| = W times the
+// uniform error, so the bound sum_j w_j |r_j| on the total error
+// grows by at most 10%
+// The estimated lambda is an upper bound, so we use half of it
+// Without an estimate we fall back to uniform stopping conditions
+static RANK_LOCAL Real *tol_MD = NULL, *tol_accept = NULL, lambda_est = 0.0;
+
+static void setup_shift_tol(Real lambda) {
+  int j;
+  Real lam;
+  double W_MD = 0.0, W_accept = 0.0;
+
+  if (tol_MD == NULL) {
+    tol_MD = malloc(Norder * sizeof(*tol_MD));
+    tol_accept = malloc(Norder * sizeof(*tol_accept));
+  }
+  lambda_est = lambda;
+  if (lambda <= 0.0)
+    return;
+
+  lambda *= 0.5;
+  for (j = 0; j < Norder; j++) {
+    tol_accept[j] = fabs(amp4[j]) / (shift4[j] + lambda);
+    lam = (shift4[j] > lambda ? shift4[j] : lambda);
+    tol_MD[j] = tol_accept[j] * sqrt(lam) / (lam + shift4[j]);
+    W_accept += tol_accept[j];
+    W_MD += tol_MD[j];
+  }
+  W_accept *= 0.1 / (double)Norder;
+  W_MD *= 0.1 / (double)Norder;
+  for (j = 0; j < Norder; j++) {
+    if (tol_accept[j] > 0.0 && tol_accept[j] < W_accept)
+      tol_accept[j] = W_accept * W_accept / (tol_accept[j] * tol_accept[j]);
+    else
+      tol_accept[j] = 1.0;
+    if (tol_MD[j] > 0.0 && tol_MD[j] < W_MD)
+      tol_MD[j] = W_MD * W_MD / (tol_MD[j] * tol_MD[j]);
+    else
+      tol_MD[j] = 1.0;
+#ifdef UPDATE_DEBUG
+    node0_printf("shift %d tolerance factors MD %.4g accept %.4g\n",
+                 j, tol_MD[j], tol_accept[j]);
+#endif
+  }
+}
+
+// Set shift_tol for MD (accept = 0) or accept/reject (accept = 1) solves
+// and return the corresponding errormin
+static Real cg_stop(int accept) {
+  Real rsq = (accept ? rsqmin_accept : rsqmin_MD);
+
+  shift_tol = NULL;
+  if (rsq <= 0.0)
+    return rsqmin;
+  if (lambda_est > 0.0)
+    shift_tol = (accept ? tol_accept : tol_MD);
+  return rsq;
+}
+// -----------------------------------------------------------------
+
+
+
 // -----------------------------------------------------------------
 int update_step(Twist_Fermion **src, Twist_Fermion ***psim) {
   int iters = 0, i_multi0, n;
-  Real final_rsq, f_eps, g_eps, tr;
+  Real final_rsq, f_eps, g_eps, tr, errormin;
 
   f_eps = traj_length / (Real)nsteps[0];
   g_eps = f_eps / (Real)(2.0 * nsteps[1]);
@@ -88,9 +160,11 @@ int update_step(Twist_Fermion **src, Twist_Fermion ***psim) {
       max_gf = tr;
 
 #ifndef PUREGAUGE
+    errormin = cg_stop(0);
     for (n = 0; n < Nroot; n++) {
       // Do conjugate gradient to get (Mdag M)^(-1 / 4) chi
-      iters += congrad_multi(src[n], psim[n], niter, rsqmin, &final_rsq);
+      iters += congrad_forecast(n, src[n], psim[n], niter, errormin,
+                                &final_rsq);
       tr = fermion_force(f_eps * LAMBDA_MID, src[n], psim[n]);
       fnorm[n] += tr;
       if (tr > max_ff[n])
@@ -103,9 +177,12 @@ int update_step(Twist_Fermion **src, Twist_Fermion ***psim) {
       max_gf = tr;
 
 #ifndef PUREGAUGE
+    // The last solutions are also used for the accept/reject test
+    errormin = cg_stop(i_multi0 == nsteps[0]);
     for (n = 0; n < Nroot; n++) {
       // Do conjugate gradient to get (Mdag M)^(-1 / 4) chi
-      iters += congrad_multi(src[n], psim[n], niter, rsqmin, &final_rsq);
+      iters += congrad_forecast(n, src[n], psim[n], niter, errormin,
+                                &final_rsq);
 
       if (i_multi0 < nsteps[0])
         tr = fermion_force(f_eps * TWO_LAMBDA, src[n], psim[n]);
@@ -126,7 +203,7 @@ int update_step(Twist_Fermion **src, Twist_Fermion ***psim) {
 // -----------------------------------------------------------------
 int update() {
   int j, n, iters = 0;
-  Real final_rsq;
+  Real final_rsq, errormin;
   double startaction, endaction, change;
   Twist_Fermion **src = malloc(Nroot * sizeof(**src));
   Twist_Fermion ***psim = malloc(Nroot * sizeof(***psim));
@@ -147,6 +224,11 @@ int update() {
   for (n = 0; n < Nroot; n++)
     iters += grsource(src[n]);
 
+  // Estimate the smallest eigenvalue of D^2 from the last grsource CG
+  // to set up per-shift stopping conditions for this trajectory
+  if (rsqmin_MD > 0.0 || rsqmin_accept > 0.0)
+    setup_shift_tol(cg_lambda_min());
+
   // Do a CG to get psim,
   // rational approximation to (Mdag M)^(-1 / 4) src = (Mdag M)^(-1 / 8) g
   for (j = 0; j < Norder; j++)
@@ -154,9 +236,12 @@ int update() {
 #ifdef UPDATE_DEBUG
   node0_printf("Calling CG in update_o -- original action\n");
 #endif
-  // congrad_multi initializes psim
+  // congrad_forecast initializes psim, starting a new history of solutions
+  forecast_reset();
+  errormin = cg_stop(1);
   for (n = 0; n < Nroot; n++)
-    iters += congrad_multi(src[n], psim[n], niter, rsqmin, &final_rsq);
+    iters += congrad_forecast(n, src[n], psim[n], niter, errormin,
+                              &final_rsq);
 #endif // ifndef PUREGAUGE
 
   // Find initial action
@@ -193,6 +278,7 @@ int update() {
   // If the final step were a gauge update, CG would be necessary
   endaction = action(src, psim);
   change = endaction - startaction;
+  shift_tol = NULL;
 #ifdef HMC_ALGORITHM
   // Reject configurations giving overflow
 #ifndef HAVE_IEEEFP_H
@@ -213,6 +299,7 @@ int update() {
   if (exp(-change) < (double)xrandom) {
     if (traj_length > 0.0) {
       gauge_field_copy(F_OFFSET(old_link[0]), F_OFFSET(link[0]));
+      invalidate_link_halo();
       compute_plaqdet();
       compute_Uinv();
       compute_DmuUmu();
@@ -241,6 +328,8 @@ int update() {
 
   if (traj_length > 0) {
     node0_printf("IT_PER_TRAJ %d\n", iters);
+    if (rsqmin_MD > 0.0 || rsqmin_accept > 0.0)
+      node0_printf("CG_LAMBDA_MIN %.4g\n", lambda_est);
     node0_printf("MONITOR_FORCE_GAUGE    %.4g %.4g\n",
                  gnorm / (double)(2 * nsteps[0]), max_gf);
     for (n = 0; n < Nroot; n++) {
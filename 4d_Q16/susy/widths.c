@@ -51,12 +51,13 @@ void widths() {
       cleanup_gather(mtag2);
     }
   }
-  g_doublesum(&plaq);
-  g_doublesum(&plaqSq);
-  g_doublesum(&re);
-  g_doublesum(&reSq);
-  g_doublesum(&im);
-  g_doublesum(&imSq);
+  g_doublesum_add(&plaq);
+  g_doublesum_add(&plaqSq);
+  g_doublesum_add(&re);
+  g_doublesum_add(&reSq);
+  g_doublesum_add(&im);
+  g_doublesum_add(&imSq);
+  g_sum_wait(g_sum_start());
 
   // Now compute and print square root of variances
   // Format: WIDTHS plaq re im